@@ -65,8 +65,10 @@ int task_root_set_stackguard(int tid /*! The task ID */,
 
 
 u8 task_get_exec_count();
+s8 task_get_ready_priority();
 u64 task_gettime(int tid);
 u64 task_root_gettime(int tid) MCU_ROOT_CODE;
+u64 task_root_get_cycles() MCU_ROOT_CODE;
 
 void task_root_delete(int id /*! The task to delete */) MCU_ROOT_CODE;
 
@@ -88,6 +90,11 @@ void task_svcall_interrupt(void * args) MCU_ROOT_CODE;
 int task_mpu_calc_protection(task_memories_t * mem);
 u32 task_interrupt_stacksize();
 
+int task_root_claim_fpu() MCU_ROOT_CODE;
+u32 task_get_fpu_save_count();
+u32 task_get_fpu_restore_count();
+int task_get_fpu_owner();
+
 s8 task_get_current_priority();
 void task_root_set_current_priority(s8 value);
 void task_root_elevate_current_priority(s8 value);
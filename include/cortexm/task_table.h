@@ -31,7 +31,7 @@ extern "C" {
 
 //flags 0 to 7 are unused
 #define TASK_FLAGS_USED (1<<0) //task is currently being used
-#define TASK_FLAGS_EXEC (1<<1) //set if task is part of current tasks being executed (highest priority of active tasks)
+#define TASK_FLAGS_EXEC (1<<1) //reserved (task 0 only) -- execution is tracked with the ready queues
 #define TASK_FLAGS_ACTIVE (1<<2) //Task is currently active (it is not blocked or sleeping)
 #define TASK_FLAGS_THREAD (1<<3) //Task is a thread task rather than a process (first thread)
 #define TASK_FLAGS_FIFO (1<<4) //Task is executed in FIFO rather than Round Robin mode
@@ -39,7 +39,16 @@ extern "C" {
 #define TASK_FLAGS_ROOT (1<<6) //Task has root privileges
 #define TASK_FLAGS_YIELD (1<<7) //current task wants to yield the processor -- also used internally by context switcher to track SVCALL
 
+//changing any of these flags can move a task in or out of the ready queues
+#define TASK_FLAGS_READY_MASK (TASK_FLAGS_USED | TASK_FLAGS_ACTIVE | TASK_FLAGS_STOPPED)
+
+//number of ready queues (one per priority level)
+#define TASK_PRIORITY_COUNT 32
+
 extern volatile task_t sos_task_table[];
+extern volatile s8 m_task_current_priority;
+
+void task_root_update_ready(int id) MCU_ROOT_CODE;
 
 static inline int task_enabled_active_not_stopped(int id){
     return (sos_task_table[id].flags & (TASK_FLAGS_USED | TASK_FLAGS_ACTIVE | TASK_FLAGS_STOPPED)) == (TASK_FLAGS_ACTIVE | TASK_FLAGS_USED );
@@ -49,8 +58,14 @@ static inline int task_enabled_not_active(int id){
     return (sos_task_table[id].flags & (TASK_FLAGS_USED | TASK_FLAGS_ACTIVE)) == (TASK_FLAGS_USED );
 }
 
-static inline void task_assert_flag(int id, u8 flag){ sos_task_table[id].flags |= flag; }
-static inline void task_deassert_flag(int id, u8 flag){ sos_task_table[id].flags &= ~flag; }
+static inline void task_assert_flag(int id, u8 flag){
+    sos_task_table[id].flags |= flag;
+    if( flag & TASK_FLAGS_READY_MASK ){ task_root_update_ready(id); }
+}
+static inline void task_deassert_flag(int id, u8 flag){
+    sos_task_table[id].flags &= ~flag;
+    if( flag & TASK_FLAGS_READY_MASK ){ task_root_update_ready(id); }
+}
 static inline int task_flag_asserted(int id, u8 flag){
     return ( (sos_task_table[id].flags & (flag)) ==  flag);
 }
@@ -65,9 +80,11 @@ static inline void task_deassert_used(int id){ task_deassert_flag(id, TASK_FLAGS
 static inline int task_used_asserted(int id){ return task_flag_asserted(id, TASK_FLAGS_USED); }
 static inline int task_enabled(int id){ return task_flag_asserted(id, TASK_FLAGS_USED); }
 
-static inline void task_assert_exec(int id){ task_assert_flag(id, TASK_FLAGS_EXEC); }
-static inline void task_deassert_exec(int id){ task_deassert_flag(id, TASK_FLAGS_EXEC); }
-static inline int task_exec_asserted(int id){ return task_flag_asserted(id, TASK_FLAGS_EXEC); }
+//a task is executing if it is queued at the currently executing priority (task 0 always executes)
+static inline int task_exec_asserted(int id){
+    if( id == 0 ){ return 1; }
+    return sos_task_table[id].ready_queue == (m_task_current_priority + 1);
+}
 
 static inline void task_assert_active(int id){ task_assert_flag(id, TASK_FLAGS_ACTIVE); }
 static inline void task_deassert_active(int id){ task_deassert_flag(id, TASK_FLAGS_ACTIVE); }
@@ -95,7 +112,10 @@ static inline int task_yield_asserted(int id){ return task_flag_asserted(id, TAS
 
 static inline void task_set_parent(int id, int parent){ sos_task_table[id].parent = parent; }
 static inline int task_get_parent(int id){ return sos_task_table[id].parent; }
-static inline void task_set_priority(int id, int priority){ sos_task_table[id].priority = priority; }
+static inline void task_set_priority(int id, int priority){
+    sos_task_table[id].priority = priority;
+    task_root_update_ready(id);
+}
 static inline s8 task_get_priority(int id){ return sos_task_table[id].priority; }
 
 extern volatile int m_task_current;
@@ -75,6 +75,14 @@ typedef struct MCU_PACK {
 	void * global_reent /*! Points to process re-entrancy data */;
 	void * reent /*! Points to thread re-entrancy data */;
 	int rr_time /*! The amount of time the task used in the round robin */;
+	volatile u8 ready_next /*! Next task in the ready queue */;
+	volatile u8 ready_prev /*! Previous task in the ready queue */;
+	volatile u8 ready_queue /*! Ready queue priority plus one (zero if the task is not queued) */;
+	volatile u8 ready_wake /*! Set when the task becomes ready and cleared when it runs */;
+	u32 ready_cycles /*! Cycle count when the task last became ready */;
+	u32 max_latency /*! Worst-case cycles between becoming ready and running */;
+	u32 switch_count /*! Number of times the task has been switched in */;
+	u32 min_sp /*! Lowest stack pointer seen at a context switch (zero if not switched out yet) */;
 #if __FPU_USED == 1
 	u32 fp[32];
 	u32 fpscr;
@@ -27,6 +27,8 @@
 typedef struct MCU_PACK {
 	u32 * owner_array;
 	fifo_state_t * fifo_state_array;
+	devfs_transfer_handler_t transfer_handler; //used with reads at CFIFO_LOC_READY
+	u32 o_wait; //channels the CFIFO_LOC_READY read is waiting on
 } cfifo_state_t;
 
 /*! \brief MCFIFO Configuration
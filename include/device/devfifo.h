@@ -33,6 +33,7 @@ typedef struct {
 	bool overflow;
 	devfs_async_t * rop;
 	int len;
+	devfs_poll_handler_t poll_handler;
 } devfifo_state_t;
 
 int devfifo_open(const devfs_handle_t * handle);
@@ -24,6 +24,7 @@
 #include "sos/dev/drive.h"
 #include "mcu/spi.h"
 #include "mcu/qspi.h"
+#include "device/drive_erase_queue.h"
 
 //Serial Flash Discoverable Parameters -- the minimum need for the driver to work
 typedef struct {
@@ -57,11 +58,46 @@ typedef struct {
     u8 erase_size4;
     u8 opcode_erase_size3;
     u8 erase_size3;
+    u16 page_program_size;
+    u8 address_bytes;
+    u8 resd;
 } drive_cfi_sfdp_t;
 
+#define DRIVE_CFI_SFDP_SIGNATURE 0x50444653 //"SFDP" read as a little endian word
+
+enum drive_cfi_sfdp_flags {
+	DRIVE_CFI_SFDP_FLAG_IS_VALID /*! Basic flash parameter table was read from the device */ = (1<<0),
+	DRIVE_CFI_SFDP_FLAG_IS_ERASE_4KB /*! Device supports a uniform 4KB erase (opcode_4kb_erase) */ = (1<<1),
+	DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_112 /*! Device supports 1-1-2 fast read */ = (1<<2),
+	DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_122 /*! Device supports 1-2-2 fast read */ = (1<<3),
+	DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_144 /*! Device supports 1-4-4 fast read */ = (1<<4),
+	DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_114 /*! Device supports 1-1-4 fast read */ = (1<<5),
+	DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_222 /*! Device supports 2-2-2 fast read */ = (1<<6),
+	DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_444 /*! Device supports 4-4-4 fast read */ = (1<<7),
+};
+
 typedef struct {
     mcu_event_handler_t handler;
 	 u8 is_initialized;
+	 u8 is_read_open; //CS is still asserted following a continuous read
+	 u8 block_erase_opcode;
+	 u8 fast_read_opcode;
+	 u16 page_program_size;
+	 u8 read_dummy_cycles;
+	 u8 status; //status register value read by the page program state machine
+	 u32 block_erase_size;
+	 u32 read_qspi_flags; //data and address lines of fast_read_opcode (QSPI only)
+	 u32 read_address; //address that follows the last byte of the open read
+	 devfs_async_t * program_async; //multi-page program in progress
+	 const u8 * program_buffer;
+	 u32 program_address;
+	 int program_nbyte;
+	 int program_remaining;
+	 int program_page_nbyte;
+	 u32 busy_poll_count;
+	 devfs_async_t status_async; //polls the status register between pages
+	 drive_cfi_sfdp_t sfdp;
+	 drive_erase_queue_t erase_queue;
 } drive_cfi_state_t;
 
 typedef struct {
@@ -107,8 +143,17 @@ typedef struct {
 	drive_cfi_opcode_config_t opcode;
 	mcu_pin_t cs;
 	u32 qspi_flags;
+	u32 o_flags;
+	const drive_erase_queue_timer_config_t * erase_timer /*! Checks queued erases in the background (null to check only when the driver is called) */;
 } drive_cfi_config_t;
 
+enum drive_cfi_config_flags {
+	/*! Keep CS asserted after a read so a read starting at the next address
+	 * streams without a new instruction. Only use this when the flash
+	 * is the only device on the serial bus. */
+	DRIVE_CFI_CONFIG_FLAG_IS_CONTINUOUS_READ = (1<<0),
+};
+
 
 DEVFS_DRIVER_DECLARTION(drive_cfi_spi);
 DEVFS_DRIVER_DECLARTION(drive_cfi_qspi);
@@ -0,0 +1,111 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef DEVICE_DRIVE_ERASE_QUEUE_H_
+#define DEVICE_DRIVE_ERASE_QUEUE_H_
+
+#include "sos/fs/devfs.h"
+#include "sos/dev/drive.h"
+
+#if !defined DRIVE_ERASE_QUEUE_SIZE
+#define DRIVE_ERASE_QUEUE_SIZE 4
+#endif
+
+//number of checks the queue waits for a read that found the drive erasing
+#if !defined DRIVE_ERASE_QUEUE_YIELD_COUNT
+#define DRIVE_ERASE_QUEUE_YIELD_COUNT 4
+#endif
+
+typedef struct {
+	u32 next /*! Next location to erase */;
+	u32 end /*! Last location to erase (inclusive) */;
+} drive_erase_range_t;
+
+/*! \details Timer that checks the drive while the queue erases.
+ *
+ * The timer must already be running. The queue only uses one
+ * output compare channel and its action.
+ *
+ */
+typedef struct {
+	const devfs_device_t * device /*! Timer device (mcu_tmr driver) */;
+	u32 interval /*! Timer counts between checks of the busy flag */;
+	u32 period /*! Timer value where the count returns to zero (0 if it counts to 2^32) */;
+	u8 channel /*! Output compare channel used by the queue */;
+} drive_erase_queue_timer_config_t;
+
+/*! \details Returns the number of locations that were erased starting
+ * at  start (the erase completes in the background) or a negative value on error.
+ *  end is the last location in the queued range (inclusive).
+ */
+typedef int (*drive_erase_queue_erase_t)(const devfs_handle_t * handle, u32 start, u32 end);
+
+/*! \details Returns non-zero while the drive is executing an erase. */
+typedef int (*drive_erase_queue_is_busy_t)(const devfs_handle_t * handle);
+
+/*! \details Background erase queue for drives that erase
+ * with \ref DRIVE_FLAG_ERASE_ASYNC.
+ *
+ * The drive has no interrupt to report the end of an erase. If the
+ * driver config has a timer (drive_erase_queue_timer_config_t), the
+ * queue checks the drive from the timer interrupt and starts the next
+ * erase as soon as the last one is done. The queue also advances when a
+ * transfer completes (drive_erase_queue_resume()) and when the driver is
+ * called (\ref I_DRIVE_ISBUSY and other ioctls).
+ *
+ * Reads (and writes outside the queued ranges) use the drive between
+ * erases. A read that finds the drive erasing makes the queue hold the
+ * next erase for a few checks so that the read can retry.
+ *
+ */
+typedef struct {
+	drive_erase_range_t range[DRIVE_ERASE_QUEUE_SIZE];
+	mcu_event_handler_t handler /*! Executed when the queue empties (set with \ref I_DRIVE_SETACTION) */;
+	const devfs_handle_t * handle;
+	drive_erase_queue_erase_t erase;
+	drive_erase_queue_is_busy_t is_busy;
+	const drive_erase_queue_timer_config_t * timer;
+	u8 head;
+	u8 count;
+	u8 is_erasing /*! An erase from the queue was started and has not been reported complete */;
+	u8 is_locked /*! The driver is using the bus (the timer leaves the drive alone) */;
+	u8 yield_count /*! Checks left before the next erase starts anyway */;
+	u8 resd[3];
+} drive_erase_queue_t;
+
+void drive_erase_queue_init(
+		drive_erase_queue_t * queue,
+		const devfs_handle_t * handle,
+		drive_erase_queue_erase_t erase,
+		drive_erase_queue_is_busy_t is_busy,
+		const drive_erase_queue_timer_config_t * timer
+		);
+int drive_erase_queue_push(drive_erase_queue_t * queue, u32 start, u32 end);
+int drive_erase_queue_service(drive_erase_queue_t * queue);
+int drive_erase_queue_pause(drive_erase_queue_t * queue);
+void drive_erase_queue_resume(drive_erase_queue_t * queue);
+int drive_erase_queue_is_queued(const drive_erase_queue_t * queue, u32 start, u32 end);
+void drive_erase_queue_set_action(drive_erase_queue_t * queue, const mcu_action_t * action);
+void drive_erase_queue_cancel(drive_erase_queue_t * queue);
+
+static inline int drive_erase_queue_is_active(const drive_erase_queue_t * queue){
+	return queue->count || queue->is_erasing;
+}
+
+#endif /* DEVICE_DRIVE_ERASE_QUEUE_H_ */
@@ -23,6 +23,7 @@
 #include "sos/fs/devfs.h"
 #include "sos/dev/drive.h"
 #include "mcu/spi.h"
+#include "device/drive_erase_queue.h"
 
 typedef struct {
 	const char * buf;
@@ -33,6 +34,12 @@ typedef struct {
 	devfs_async_t op;
 	mcu_event_handler_t handler;
 	u32 flags;
+	u32 block_count /*! Blocks transferred so far */;
+	u32 block_total /*! Blocks in the operation (CMD18/CMD25 are used if more than one) */;
+	u8 busy_action /*! What to do when the card is no longer busy */;
+	int busy_err /*! Error reported when the card is no longer busy */;
+	int busy_nbyte /*! Result reported when the card is no longer busy */;
+	drive_erase_queue_t erase_queue /*! Erases started with DRIVE_FLAG_ERASE_ASYNC */;
 } drive_sdspi_state_t;
 
 typedef struct {
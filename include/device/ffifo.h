@@ -34,6 +34,7 @@ typedef struct MCU_PACK {
     volatile fifo_atomic_position_t atomic_position;
     devfs_transfer_handler_t transfer_handler;
     volatile u32 o_flags;
+    devfs_poll_handler_t poll_handler;
 } ffifo_state_t;
 
 /*! \details This is the configuration for a framed FIFO (ffifo)
@@ -50,6 +51,8 @@ int ffifo_ioctl(const devfs_handle_t * handle, int request, void * ctl);
 int ffifo_read(const devfs_handle_t * handle, devfs_async_t * async);
 int ffifo_write(const devfs_handle_t * handle, devfs_async_t * async);
 int ffifo_close(const devfs_handle_t * handle);
+int ffifo_try_read(const devfs_handle_t * handle, devfs_async_t * async);
+int ffifo_try_write(const devfs_handle_t * handle, devfs_async_t * async);
 
 int ffifo_open_local(const ffifo_config_t * config, ffifo_state_t * state);
 int ffifo_close_local(const ffifo_config_t * config, ffifo_state_t * state);
@@ -92,6 +95,13 @@ void ffifo_data_received(const ffifo_config_t * cfgp, ffifo_state_t * state);
 void ffifo_cancel_async_read(ffifo_state_t * state);
 void ffifo_cancel_async_write(ffifo_state_t * state);
 
+//MCU_EVENT_FLAG_DATA_READY and/or MCU_EVENT_FLAG_WRITE_COMPLETE depending on the current state
+u32 ffifo_get_poll_events(const ffifo_config_t * config, ffifo_state_t * state);
+
+//lend and release frames for I_FFIFO_FRAME
+int ffifo_lend_frame(const ffifo_config_t * config, ffifo_state_t * state, ffifo_frame_t * frame);
+int ffifo_release_frame(const ffifo_config_t * config, ffifo_state_t * state, const ffifo_frame_t * frame);
+
 
 #define FFIFO_DEFINE_CONFIG(ffifo_frame_count, ffifo_frame_size, ffifo_buffer) .frame_count = ffifo_frame_count, .frame_size = ffifo_frame_size, .buffer = ffifo_buffer
 
@@ -38,6 +38,7 @@ typedef struct MCU_PACK {
     volatile fifo_atomic_position_t atomic_position; //4 bytes
     devfs_transfer_handler_t transfer_handler; //8 bytes
     volatile u32 o_flags; //4 bytes
+    devfs_poll_handler_t poll_handler; //12 bytes
 } fifo_state_t;
 
 /*! \brief FIFO Configuration
@@ -54,6 +55,10 @@ int fifo_ioctl(const devfs_handle_t * handle, int request, void * ctl);
 int fifo_read(const devfs_handle_t * handle, devfs_async_t * async);
 int fifo_write(const devfs_handle_t * handle, devfs_async_t * async);
 int fifo_close(const devfs_handle_t * handle);
+int fifo_try_read(const devfs_handle_t * handle, devfs_async_t * async);
+int fifo_try_write(const devfs_handle_t * handle, devfs_async_t * async);
+int fifo_readv(const devfs_handle_t * handle, devfs_async_t * async, const struct iovec * iov, int iovcnt);
+int fifo_writev(const devfs_handle_t * handle, devfs_async_t * async, const struct iovec * iov, int iovcnt);
 
 int fifo_open_local(const fifo_config_t * config, fifo_state_t * state);
 int fifo_close_local(const fifo_config_t * config, fifo_state_t * state);
@@ -91,6 +96,9 @@ void fifo_data_received(const fifo_config_t * cfgp, fifo_state_t * state);
 void fifo_cancel_async_read(fifo_state_t * state);
 void fifo_cancel_async_write(fifo_state_t * state);
 
+//MCU_EVENT_FLAG_DATA_READY and/or MCU_EVENT_FLAG_WRITE_COMPLETE depending on the current state
+u32 fifo_get_poll_events(const fifo_config_t * config, fifo_state_t * state);
+
 
 #define FIFO_DEFINE_CONFIG(fifo_size, fifo_buffer) .size = fifo_size, .buffer = fifo_buffer
 
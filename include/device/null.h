@@ -27,5 +27,7 @@ int null_ioctl(const devfs_handle_t * handle, int request, void * ctl);
 int null_read(const devfs_handle_t * handle, devfs_async_t * rop);
 int null_write(const devfs_handle_t * handle, devfs_async_t * wop);
 int null_close(const devfs_handle_t * handle);
+int null_try_read(const devfs_handle_t * handle, devfs_async_t * rop);
+int null_try_write(const devfs_handle_t * handle, devfs_async_t * wop);
 
 #endif /* MCU_NULL_H_ */
@@ -39,6 +39,9 @@ typedef struct {
     u16 transaction_limit;
     u16 packet_size;
     mcu_event_handler_t event_handler;
+    u32 ready_cycles[2]; //cycle count when each buffer was filled
+    u32 transaction_count; //number of packets written to the output
+    u32 max_latency_cycles; //worst-case cycles from a buffer being filled to being written
 } switchboard_state_t;
 
 typedef struct {
@@ -0,0 +1,97 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+/*! \addtogroup USB_PACKET
+ * @{
+ * \ingroup IFACE_DEV
+ *
+ * \details The USB packet device receives an OUT endpoint directly into
+ * a pool of large buffers. Unlike the USB FIFO, received data is not copied
+ * one byte at a time through a ring buffer. Each endpoint packet is read (or DMA'd)
+ * in place and the reader copies it out once.
+ *
+ * When every buffer is holding unread data, the endpoint is not re-armed so the host
+ * is NAK'd until the reader frees a buffer.
+ *
+ */
+
+/*! \file  */
+
+#ifndef DEV_USBPACKET_H_
+#define DEV_USBPACKET_H_
+
+#include "sos/dev/fifo.h"
+#include "sos/fs/devfs.h"
+#include "mcu/usb.h"
+
+#define USBPACKET_BUFFER_COUNT_MAX 8
+
+/*! \details This stores the data for the state of the packet device.
+ *
+ */
+typedef struct {
+	devfs_transfer_handler_t transfer_handler;
+	devfs_async_t async_read;
+	u16 length[USBPACKET_BUFFER_COUNT_MAX] /*! Bytes in each complete buffer */;
+	u16 head /*! Buffer the endpoint is receiving to */;
+	u16 head_nbyte /*! Bytes received to the head buffer */;
+	u16 tail /*! Buffer being read */;
+	u16 tail_offset /*! Bytes already read from the tail buffer */;
+	u16 complete_count /*! Number of buffers that are complete but not fully read */;
+	u8 is_stalled /*! The endpoint was not re-armed because no buffers were free */;
+	u8 resd;
+} usbpacket_state_t;
+
+/*! \details This is used for the configuration of the device.
+ *
+ */
+typedef struct {
+	usb_config_t usb;
+	int endpoint /*! The USB endpoint number to read */;
+	int endpoint_size /*! The USB endpoint data size */;
+	u16 buffer_count /*! Number of buffers in the pool (2 to USBPACKET_BUFFER_COUNT_MAX) */;
+	u16 buffer_size /*! Size of each buffer (a multiple of endpoint_size) */;
+	char * buffer /*! Pool of buffer_count*buffer_size bytes (must be usable by the USB DMA) */;
+} usbpacket_config_t;
+
+int usbpacket_open(const devfs_handle_t * handle);
+int usbpacket_ioctl(const devfs_handle_t * handle, int request, void * ctl);
+int usbpacket_read(const devfs_handle_t * handle, devfs_async_t * async);
+int usbpacket_write(const devfs_handle_t * handle, devfs_async_t * async);
+int usbpacket_close(const devfs_handle_t * handle);
+
+#define USBPACKET_DECLARE_CONFIG_STATE(usb_packet_name,\
+	usb_packet_buffer_count, \
+	usb_packet_buffer_size, \
+	usb_attr_endpoint, \
+	usb_attr_endpoint_size ) \
+	usbpacket_state_t usb_packet_name##_state MCU_SYS_MEM; \
+	char usb_packet_name##_buffer[(usb_packet_buffer_count)*(usb_packet_buffer_size)] MCU_ALIGN(32); \
+	const usbpacket_config_t usb_packet_name##_config = { \
+	.endpoint = usb_attr_endpoint, \
+	.endpoint_size = usb_attr_endpoint_size, \
+	.buffer_count = usb_packet_buffer_count, \
+	.buffer_size = usb_packet_buffer_size, \
+	.buffer = usb_packet_name##_buffer \
+	}
+
+#endif /* DEV_USBPACKET_H_ */
+
+
+/*! @} */
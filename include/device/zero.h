@@ -41,6 +41,8 @@ int zero_ioctl(const devfs_handle_t * handle, int request, void * ctl);
 int zero_read(const devfs_handle_t * handle, devfs_async_t * rop);
 int zero_write(const devfs_handle_t * handle, devfs_async_t * wop);
 int zero_close(const devfs_handle_t * handle);
+int zero_try_read(const devfs_handle_t * handle, devfs_async_t * rop);
+int zero_try_write(const devfs_handle_t * handle, devfs_async_t * wop);
 
 
 #endif /* DEV_ZERO_H_ */
@@ -0,0 +1,50 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef POLL_H_
+#define POLL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pollfd {
+	int fd /*! The file descriptor to poll (ignored if negative) */;
+	short events /*! The events to wait for */;
+	short revents /*! The events that are ready */;
+};
+
+typedef unsigned int nfds_t;
+
+#define POLLIN 0x0001
+#define POLLRDNORM POLLIN
+#define POLLOUT 0x0004
+#define POLLWRNORM POLLOUT
+#define POLLERR 0x0008
+#define POLLHUP 0x0010
+#define POLLNVAL 0x0020
+
+int poll(struct pollfd fds[], nfds_t nfds, int timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* POLL_H_ */
@@ -27,6 +27,8 @@
  *
  */
 
+#include <sys/uio.h>
+
 #if !defined SOS_BOOTSTRAP_SOCKETS
 #include <lwip/sockets.h>
 #else
@@ -36,7 +38,6 @@ typedef u32 socklen_t;
 typedef u32 fd_set;
 struct sockaddr;
 struct msghdr;
-struct iovec;
 struct in_addr {
 	int dummy;
 };
@@ -69,10 +70,10 @@ int sendto(int s, const void *dataptr, size_t size, int flags,
 int socket(int domain, int type, int protocol);
 
 //these functions are currently only for sockets but should be supported on non-sockets as well
-int writev(int s, const struct iovec *iov, int iovcnt);
 int select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset, struct timeval *timeout);
 
 //these are supported on both sockets and non-sockets
+//ssize_t writev(int s, const struct iovec *iov, int iovcnt); -- see sys/uio.h
 //int read(int s, void *mem, size_t len);
 //int ioctl(int s, long cmd, void *argp);
 //int fcntl(int s, int cmd, int val);
@@ -0,0 +1,53 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef SYS_UIO_H_
+#define SYS_UIO_H_
+
+#if !defined __link
+
+#include <sys/types.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+//lwip only declares iovec if it isn't already defined
+#if !defined iovec
+struct iovec {
+	void * iov_base;
+	size_t iov_len;
+};
+#define iovec iovec
+#endif
+
+#if !defined IOV_MAX
+#define IOV_MAX 16
+#endif
+
+ssize_t readv(int fildes, const struct iovec * iov, int iovcnt);
+ssize_t writev(int fildes, const struct iovec * iov, int iovcnt);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif
+
+#endif /* SYS_UIO_H_ */
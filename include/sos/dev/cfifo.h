@@ -38,7 +38,7 @@
 #include "fifo.h"
 #include "mcu/types.h"
 
-#define CFIFO_VERSION (0x030000)
+#define CFIFO_VERSION (0x030100)
 #define CFIFO_IOC_CHAR 'M'
 
 enum {
@@ -76,6 +76,49 @@ typedef struct MCU_PACK {
 	fifo_info_t info;
 } cfifo_fifoinfo_t;
 
+/*! \brief Channel Buffer
+ * \details This describes one channel to read with I_CFIFO_READ.
+ */
+typedef struct MCU_PACK {
+	u32 channel /*! The channel to read */;
+	void * buf /*! Where to store the data */;
+	u32 nbyte /*! The maximum number of bytes to read */;
+	s32 result /*! The number of bytes read (zero if the channel wasn't ready) */;
+} cfifo_buffer_t;
+
+/*! \brief Batch Read
+ * \details This reads every ready channel in \a buffers in one request.
+ *
+ * \code
+ * cfifo_buffer_t buffers[2] = {
+ * 	{ .channel = 0, .buf = accel, .nbyte = sizeof(accel) },
+ * 	{ .channel = 3, .buf = gyro, .nbyte = sizeof(gyro) }
+ * };
+ * cfifo_read_t batch = { .count = 2, .buffers = buffers };
+ * u32 o_wait = 0; //zero waits for any channel
+ * pread(cfifo_fd, &o_wait, sizeof(o_wait), CFIFO_LOC_READY); //blocks until a channel is ready
+ * ioctl(cfifo_fd, I_CFIFO_READ, &batch);
+ * \endcode
+ *
+ */
+typedef struct MCU_PACK {
+	u32 count /*! The number of entries in \a buffers */;
+	cfifo_buffer_t * buffers /*! The channels to read */;
+	u32 o_ready /*! Bitmask of the channels that were read (set by the driver) */;
+	u32 resd[4];
+} cfifo_read_t;
+
+/*! \details Reading a u32 at this location blocks until one of
+ * the channels in the bitmask (zero for all channels) has data.
+ * The value is then replaced with the bitmask of ready channels.
+ *
+ * The read uses the readiness handlers of the channels it waits on.
+ * It fails with EBUSY if poll() is waiting on one of them and poll()
+ * gets EBUSY for those channels until the read completes. Devices
+ * with more than 32 channels return EINVAL.
+ */
+#define CFIFO_LOC_READY (0x8000)
+
 #define I_CFIFO_GETVERSION _IOCTL(CFIFO_IOC_CHAR, I_MCU_GETVERSION)
 #define I_CFIFO_GETINFO _IOCTLR(CFIFO_IOC_CHAR, 0, cfifo_info_t)
 #define I_CFIFO_SETATTR _IOCTLW(CFIFO_IOC_CHAR, 1, cfifo_attr_t)
@@ -88,6 +131,7 @@ typedef struct MCU_PACK {
 #define I_CFIFO_FIFOEXIT _IOCTLW(CFIFO_IOC_CHAR, 6, cfifo_fiforequest_t)
 #define I_CFIFO_FIFOSETATTR _IOCTLW(CFIFO_IOC_CHAR, 7, cfifo_fifoattr_t)
 #define I_CFIFO_FIFOGETINFO _IOCTLRW(CFIFO_IOC_CHAR, 8, cfifo_fifoinfo_t)
+#define I_CFIFO_READ _IOCTLRW(CFIFO_IOC_CHAR, 9, cfifo_read_t)
 
 
 
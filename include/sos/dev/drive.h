@@ -60,7 +60,8 @@ enum {
 	DRIVE_FLAG_POWERDOWN /*! Puts the drive in power down mode. */ = (1<<4),
 	DRIVE_FLAG_POWERUP /*! Powers up the driver (after power down). */ = (1<<5),
 	DRIVE_FLAG_INIT /*! Initializes the drive. */ = (1<<6),
-	DRIVE_FLAG_RESET /*! Issue a reset to the drive. */ = (1<<7)
+	DRIVE_FLAG_RESET /*! Issue a reset to the drive. */ = (1<<7),
+	DRIVE_FLAG_ERASE_ASYNC /*! Used with \ref DRIVE_FLAG_ERASE_BLOCKS to queue the blocks from start to end (inclusive) and return immediately. The driver erases the queued blocks in the background. \ref I_DRIVE_ISBUSY returns non-zero until the queue is empty. The action set with \ref I_DRIVE_SETACTION is executed with MCU_EVENT_FLAG_WRITE_COMPLETE (or MCU_EVENT_FLAG_ERROR) when the queue empties. */ = (1<<8)
 } drive_flags_t;
 
 /*! \brief Drive Info
@@ -101,12 +102,18 @@ typedef struct MCU_PACK {
 #define I_DRIVE_GETINFO _IOCTLR(DRIVE_IOC_IDENT_CHAR, I_MCU_GETINFO, drive_info_t)
 /*! \details Sets the drive attributes (\sa drive_attr_t). */
 #define I_DRIVE_SETATTR _IOCTLW(DRIVE_IOC_IDENT_CHAR, I_MCU_SETATTR, drive_attr_t)
+/*! \details Sets the action to execute when queued erases
+ * (\ref DRIVE_FLAG_ERASE_ASYNC) complete (\sa mcu_action_t).
+ */
 #define I_DRIVE_SETACTION _IOCTLW(DRIVE_IOC_IDENT_CHAR, I_MCU_SETATTR, mcu_action_t)
 
 /*! \details See if the drive is busy.
  * This ioctl call will return greater than one if the
  * device is busy and 0 if drive is not busy.
  *
+ * Drives that support \ref DRIVE_FLAG_ERASE_ASYNC start the next
+ * queued erase when this is called and the drive is not busy.
+ *
  */
 #define I_DRIVE_ISBUSY _IOCTL(DRIVE_IOC_IDENT_CHAR, I_MCU_TOTAL)
 
@@ -38,7 +38,7 @@
 #include "fifo.h"
 #include "mcu/types.h"
 
-#define FFIFO_VERSION (0x030000)
+#define FFIFO_VERSION (0x030100)
 #define FFIFO_IOC_CHAR 'F'
 
 enum {
@@ -58,6 +58,26 @@ typedef struct MCU_PACK {
 } ffifo_info_t;
 
 
+/*! \details Flags used with ffifo_frame_t and I_FFIFO_FRAME.
+ *
+ */
+enum {
+	FFIFO_FRAME_FLAG_READ /*! Lend the oldest frame so it can be read in place */ = (1<<0),
+	FFIFO_FRAME_FLAG_WRITE /*! Lend the next free frame so it can be written in place */ = (1<<1),
+	FFIFO_FRAME_FLAG_RELEASE /*! Return a lent frame (use with FFIFO_FRAME_FLAG_READ or FFIFO_FRAME_FLAG_WRITE) */ = (1<<2)
+};
+
+/*! \brief FFIFO Frame
+ * \details This structure is used with I_FFIFO_FRAME to access
+ * a frame without copying it.
+ *
+ */
+typedef struct MCU_PACK {
+	u32 o_flags /*! Frame flags */;
+	void * buf /*! A pointer to the lent frame (set by the driver) */;
+	u32 nbyte /*! The frame size when lending; when releasing, zero returns the frame unused */;
+} ffifo_frame_t;
+
 /*! \brief FIFO Attributes
  * \details This structure defines the attributes of a FIFO.
  *
@@ -71,6 +91,27 @@ typedef struct MCU_PACK {
 #define I_FFIFO_GETINFO _IOCTLR(FIFO_IOC_CHAR, 0, ffifo_info_t)
 #define I_FFIFO_SETATTR _IOCTLW(FIFO_IOC_CHAR, 1, ffifo_attr_t)
 
+/*! \brief See details below.
+ * \hideinitializer
+ *
+ * \details This request lends a frame to the caller so the frame
+ * can be read or written in place. This is used by the switchboard
+ * to move frames between devices without copying them.
+ *
+ * With FFIFO_FRAME_FLAG_READ, the oldest frame is lent. Releasing it
+ * with a non-zero \a nbyte removes it from the FIFO. While the frame is lent,
+ * an overflowing write drops the new frame rather than overwriting it.
+ *
+ * With FFIFO_FRAME_FLAG_WRITE, the next free frame is lent. Releasing it
+ * with a non-zero \a nbyte adds it to the FIFO.
+ *
+ * Only one frame in each direction can be lent at a time. The request
+ * returns the frame size when a frame is lent (or when o_flags is zero), and
+ * fails with errno set to EAGAIN if no frame is available.
+ *
+ */
+#define I_FFIFO_FRAME _IOCTLRW(FIFO_IOC_CHAR, 6, ffifo_frame_t)
+
 #define I_FFIFO_FLUSH I_FIFO_FLUSH
 #define I_FFIFO_INIT I_FIFO_INIT
 #define I_FFIFO_EXIT I_FIFO_EXIT
@@ -52,7 +52,9 @@ enum {
 	FIFO_FLAG_IS_READ_BUSY /*! Set internally when FIFO is reading */ = (1<<7),
 	FIFO_FLAG_IS_WRITE_WHILE_READ_BUSY /*! Set internally when FIFO is written while reading */ = (1<<8),
 	FIFO_FLAG_IS_WRITE_BUSY /*! Set internally when FIFO is being written */ = (1<<9),
-	FIFO_FLAG_IS_WRITE_WHILE_WRITE_BUSY /*! Set internally when FIFO is written while being written */ = (1<<10)
+	FIFO_FLAG_IS_WRITE_WHILE_WRITE_BUSY /*! Set internally when FIFO is written while being written */ = (1<<10),
+	FIFO_FLAG_IS_READ_LENT /*! Set internally when the oldest frame is lent to a reader (ffifo only) */ = (1<<11),
+	FIFO_FLAG_IS_WRITE_LENT /*! Set internally when the next free frame is lent to a writer (ffifo only) */ = (1<<12)
 };
 
 typedef struct MCU_PACK {
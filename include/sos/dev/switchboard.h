@@ -94,6 +94,19 @@
  *
  * Using this scheme all USB channels are executed at the same priority level.
  *
+ * When one terminal of a persistent connection is an FFIFO whose frame size
+ * matches the packet size, the switchboard borrows frames from the FFIFO
+ * using I_FFIFO_FRAME rather than copying each packet through its own buffers.
+ * In the example above, the I2S is read directly into an FFIFO frame and the
+ * USB is written directly from an FFIFO frame. While waiting for a frame, the
+ * switchboard uses the FFIFO readiness handler (see MCU_EVENT_FLAG_POLL) so the
+ * FFIFO shouldn't be polled by an application at the same time. Connections that use
+ * fill flags always copy.
+ *
+ * The status of each connection includes the number of packets written and the
+ * worst-case latency from a packet being read to being written. Sampling the
+ * status twice gives the throughput.
+ *
  *
  *
  *
@@ -114,7 +127,7 @@
 extern "C" {
 #endif
 
-#define SWITCHBOARD_VERSION (0x030600)
+#define SWITCHBOARD_VERSION (0x030700)
 #define SWITCHBOARD_IOC_IDENT_CHAR 'W'
 
 /*! \details Switchboard flags used with
@@ -139,7 +152,9 @@ typedef enum {
 	SWITCHBOARD_FLAG_IS_FILL_LAST_32 /*! If no data is available on a non-blocking input, a packet is filled with the last 32-bit word of the previous packet */ = (1<<14),
 	SWITCHBOARD_FLAG_IS_FILL_LAST_64 /*! If no data is available on a non-blocking input, a packet is filled with the last 64-bit word of the previous packet */ = (1<<15),
 	SWITCHBOARD_FLAG_CLEAN /*! Cleanup connectections that have stopped on an error */ = (1<<16),
-	SWITCHBOARD_FLAG_IS_CANCELED /*! Set if a connection operation was cancelled */ = (1<<17)
+	SWITCHBOARD_FLAG_IS_CANCELED /*! Set if a connection operation was cancelled */ = (1<<17),
+	SWITCHBOARD_FLAG_IS_ZERO_COPY_INPUT /*! The output is written directly from frames lent by the input FFIFO (used in o_flags of switchboard_connection_t for status) */ = (1<<18),
+	SWITCHBOARD_FLAG_IS_ZERO_COPY_OUTPUT /*! The input is read directly into frames lent by the output FFIFO (used in o_flags of switchboard_connection_t for status) */ = (1<<19)
 } switchboard_flag_t;
 
 
@@ -197,8 +212,21 @@ typedef struct MCU_PACK {
  * read(fd, &status, 2); //returns an error with errno set to EINVAL
  * \endcode
  *
+ * The status starts with the same members as switchboard_connection_t.
+ * Applications built before version 0x030700 read sizeof(switchboard_connection_t)
+ * bytes per connection and get the status without the counters.
+ *
  */
-typedef switchboard_connection_t switchboard_status_t;
+typedef struct MCU_PACK {
+	u32 o_flags /*! Bitmask flags for connection state */;
+	u16 id /*! Connection id of total */;
+	u16 transaction_limit /*! The maximum number of synchronous transactions that can occur before aborting */;
+	switchboard_terminal_t input /*! Input device (device that is read) */;
+	switchboard_terminal_t output /*! Output device (device that is written) */;
+	s32 nbyte /*! Number of bytes to transfer (packet size for persisent connections); will be negative when reading to indicate an error */;
+	u32 transaction_count /*! Number of packets written to the output */;
+	u32 max_latency_cycles /*! Worst-case CPU cycles between a packet being read and finishing its write */;
+} switchboard_status_t;
 
 /*! \brief Switchboard Attributes
  * \details Switchboard attributes are used with I_SWITCHBOARD_SETATTR
@@ -195,6 +195,82 @@ typedef struct MCU_PACK {
 	u8 data[32];
 } sys_secret_key_t;
 
+/*! \brief Task Block Reasons
+ * \details These values index sys_taskprofile_t::block_usec.
+ */
+enum sys_block_reason {
+	SYS_BLOCK_REASON_NONE /*! Not blocked (or unknown) */,
+	SYS_BLOCK_REASON_MUTEX /*! Waiting on a mutex */,
+	SYS_BLOCK_REASON_SEMAPHORE /*! Waiting on a semaphore */,
+	SYS_BLOCK_REASON_RWLOCK /*! Waiting on a read/write lock */,
+	SYS_BLOCK_REASON_COND /*! Waiting on a condition variable */,
+	SYS_BLOCK_REASON_SLEEP /*! Sleeping or timed out */,
+	SYS_BLOCK_REASON_WAIT /*! Waiting for a child process */,
+	SYS_BLOCK_REASON_SIGNAL /*! Stopped or woken by a signal */,
+	SYS_BLOCK_REASON_TRANSFER /*! Waiting for a device data transfer */,
+	SYS_BLOCK_REASON_MQ /*! Waiting on a message queue */,
+	SYS_BLOCK_REASON_PTHREAD_JOINED /*! Waiting to be joined */,
+	SYS_BLOCK_REASON_PTHREAD_JOINED_THREAD_COMPLETE /*! Waiting for a joined thread to complete */,
+	SYS_BLOCK_REASON_AIO /*! Waiting in aio_suspend() or lio_listio() */
+};
+
+#define SYS_TASKPROFILE_BLOCK_COUNT 16
+
+/*! \brief Task Profile
+ * \details This structure is used with I_SYS_GETTASKPROFILE.
+ * The u32 counters wrap, so they are meant to be polled
+ * and compared with a previous sample (see link_diff_task_profile()).
+ */
+typedef struct MCU_PACK {
+	u32 tid /*! \brief Task ID (written by caller) */;
+	u32 pid /*! \brief PID for the task */;
+	u64 run_cycles /*! \brief CPU cycles the task has executed */;
+	u32 switch_count /*! \brief Number of times the task has been switched in */;
+	u32 max_latency_cycles /*! \brief Worst-case CPU cycles between waking and running */;
+	u32 max_stack_size /*! \brief Deepest stack usage in bytes (sampled at context switches) */;
+	u8 is_enabled /*! \brief Non-zero if the task is in use */;
+	u8 resd8[3];
+	u32 block_usec[SYS_TASKPROFILE_BLOCK_COUNT] /*! \brief Microseconds spent blocked indexed by \ref sys_block_reason */;
+	u32 resd[4];
+} sys_taskprofile_t;
+
+#define SYS_TRACE_READ_MAX 32
+
+/*! \details Flags used with sys_trace_read_t.o_flags.
+ *
+ */
+enum sys_trace_flags {
+	SYS_TRACE_FLAG_ENABLE /*! Start writing records to the trace ring */ = (1<<0),
+	SYS_TRACE_FLAG_DISABLE /*! Stop writing records to the trace ring */ = (1<<1),
+	SYS_TRACE_FLAG_FLUSH /*! Discard the records in the trace ring before reading */ = (1<<2)
+};
+
+/*! \brief Trace Ring Read
+ * \details This structure is used with I_SYS_READTRACE.
+ */
+typedef struct MCU_PACK {
+	u32 o_flags /*! \brief Bitmask of \ref sys_trace_flags (written by caller) */;
+	u32 count /*! \brief Number of records that were read */;
+	u32 dropped /*! \brief Records overwritten before they could be read (since the last read) */;
+	u32 frequency /*! \brief Frequency of the record timestamps in Hz */;
+	u8 is_enabled /*! \brief Non-zero if records are being written */;
+	u8 resd8[3];
+	u32 resd[3];
+	link_trace_record_t record[SYS_TRACE_READ_MAX] /*! \brief Records in the order they were written */;
+} sys_trace_read_t;
+
+/*! \brief FPU Context Statistics
+ * \details This structure is used with I_SYS_GETFPUSTATS.
+ * The FPU registers are only saved and restored when
+ * a different task executes a floating point instruction.
+ */
+typedef struct MCU_PACK {
+	u32 save_count /*! \brief Number of times the FPU registers were saved to the task table */;
+	u32 restore_count /*! \brief Number of times the FPU registers were loaded from the task table */;
+	s32 owner_tid /*! \brief Task that owns the FPU registers (-1 if none) */;
+	u32 resd[5];
+} sys_fpu_stats_t;
+
 #define I_SYS_GETVERSION _IOCTL(SYS_IOC_IDENT_CHAR, I_MCU_GETVERSION)
 #define I_SYS_GETINFO _IOCTLR(SYS_IOC_CHAR, I_MCU_GETINFO, sys_info_t)
 #define I_SYS_26_GETINFO _IOCTLR(SYS_IOC_CHAR, I_MCU_GETINFO, sys_26_info_t)
@@ -289,7 +365,41 @@ typedef struct MCU_PACK {
  */
 #define I_SYS_DEAUTHENTICATE _IOCTL(SYS_IOC_CHAR, I_MCU_TOTAL+10)
 
-#define I_SYS_TOTAL 11
+/*! \brief See below for details.
+ * \details Reads the FPU context switching statistics.
+ * The counters are zero if the system does not use the FPU.
+ * \code
+ * sys_fpu_stats_t stats;
+ * ioctl(fd, I_SYS_GETFPUSTATS, &stats);
+ * \endcode
+ */
+#define I_SYS_GETFPUSTATS _IOCTLR(SYS_IOC_CHAR, I_MCU_TOTAL+11, sys_fpu_stats_t)
+
+/*! \brief See below for details.
+ * \details Reads the profile of the specified task. The return
+ * value is the same as I_SYS_GETTASK.
+ * \code
+ * sys_taskprofile_t profile;
+ * profile.tid = 1;
+ * ioctl(fd, I_SYS_GETTASKPROFILE, &profile);
+ * \endcode
+ */
+#define I_SYS_GETTASKPROFILE _IOCTLRW(SYS_IOC_CHAR, I_MCU_TOTAL+12, sys_taskprofile_t)
+
+/*! \brief See below for details.
+ * \details Reads up to SYS_TRACE_READ_MAX records from
+ * the kernel trace ring. The return value is the number
+ * of records read. The ring can be enabled, disabled, or
+ * flushed using o_flags in the same request.
+ * \code
+ * sys_trace_read_t trace;
+ * trace.o_flags = SYS_TRACE_FLAG_ENABLE;
+ * ioctl(fd, I_SYS_READTRACE, &trace);
+ * \endcode
+ */
+#define I_SYS_READTRACE _IOCTLRW(SYS_IOC_CHAR, I_MCU_TOTAL+13, sys_trace_read_t)
+
+#define I_SYS_TOTAL 14
 
 
 #ifdef __cplusplus
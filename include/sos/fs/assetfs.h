@@ -68,6 +68,72 @@ typedef struct {
 	const assetfs_dirent_t entries[];
 } assetfs_config_t;
 
+#define ASSETFS_CHUNK_SIGNATURE 0x315a5341 /*! "ASZ1" */
+#define ASSETFS_CHUNK_SIZE 4096
+#define ASSETFS_CHUNK_INVALID 0xffffffff
+
+/*! \details Header of a block-compressed asset.
+ *
+ * The header is followed by \a chunk_count + 1 u32 offsets
+ * (relative to the start of the header). Chunk n is stored
+ * between offset[n] and offset[n+1]. Each chunk holds
+ * \a chunk_size bytes of the asset (the last may be shorter)
+ * compressed in the LZ4 block format. A chunk that would not
+ * get smaller is stored as is.
+ *
+ * assetfs and drive_assetfs detect the header when an asset
+ * is opened and decompress only the chunks that are read.
+ *
+ */
+typedef struct MCU_PACK {
+	u32 signature /*! Always \ref ASSETFS_CHUNK_SIGNATURE */;
+	u32 size /*! Uncompressed size of the asset */;
+	u32 chunk_size /*! Always \ref ASSETFS_CHUNK_SIZE */;
+	u32 chunk_count /*! Number of chunks */;
+} assetfs_chunk_header_t;
+
+//shared by the kernel and the link packer (assetfs_chunk_codec.c)
+int assetfs_chunk_is_valid(const assetfs_chunk_header_t * header, u32 stored_size);
+int assetfs_chunk_is_valid_offset(const assetfs_chunk_header_t * header, u32 stored_size, const u32 offset[2]);
+int assetfs_chunk_compress(const u8 * src, int size, u8 * dest); //dest needs 2*size bytes -- returns -1 if the chunk doesn't get smaller
+int assetfs_chunk_decompress(const u8 * src, int src_size, u8 * dest, int dest_size);
+
+#if !defined __link
+#include <pthread.h>
+
+/*! \details Decode buffer shared by the readers of one filesystem.
+ *
+ * The buffers are allocated when the first reader is opened and
+ * freed when the last one is closed. The chunk in \a data belongs
+ * to \a owner so a reader only decodes again when another reader
+ * used the buffer in the meantime.
+ *
+ */
+typedef struct {
+	pthread_mutex_t mutex;
+	const void * owner /*! Reader whose chunk is in data (or null) */;
+	u32 chunk /*! Chunk held in data */;
+	u32 users /*! Number of open readers */;
+	u8 * data /*! Decompressed chunk */;
+	u8 * compressed /*! Space to read a compressed chunk (if the readers are not memory mapped) */;
+} assetfs_chunk_cache_t;
+
+typedef struct {
+	const void * context;
+	int (*read)(const void * context, u32 offset, void * buf, int nbyte) /*! Reads stored bytes (used if base is null) */;
+	const u8 * base /*! Memory mapped location of the stored asset (or null) */;
+	u32 size /*! Uncompressed size */;
+	u32 stored_size /*! Stored size (chunk offsets are checked against this) */;
+	u32 chunk_count;
+	assetfs_chunk_cache_t * cache;
+} assetfs_chunk_reader_t;
+
+int assetfs_chunk_init_cache(assetfs_chunk_cache_t * cache);
+int assetfs_chunk_open_reader(assetfs_chunk_reader_t * reader, assetfs_chunk_cache_t * cache, const assetfs_chunk_header_t * header, u32 stored_size, const u8 * base);
+void assetfs_chunk_close_reader(assetfs_chunk_reader_t * reader);
+int assetfs_chunk_read(assetfs_chunk_reader_t * reader, int loc, void * buf, int nbyte);
+#endif
+
 
 #define ASSETFS_MOUNT(mount_loc_name, cfgp, permissions_value, owner_value) { \
 	.mount_path = mount_loc_name, \
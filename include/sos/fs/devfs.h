@@ -93,6 +93,20 @@ int devfs_lookup_name(const devfs_device_t * list, const devfs_device_t * device
 	.driver.read = driver_name##_read, \
 	.driver.write = driver_name##_write
 
+/* The try entry points are called before read/write. They return the number of bytes
+ * transferred if the operation completes synchronously. If the operation would
+ * block, they return 0 without registering a callback and the regular entry point is used.
+ */
+#define DEVFS_DRIVER_TRY(driver_name) .driver.try_read = driver_name##_try_read, \
+	.driver.try_write = driver_name##_try_write
+
+/* The vector entry points receive a kernel copy of the readv()/writev() list. They
+ * return the number of bytes transferred during the call or 0 if nothing can be
+ * transferred without blocking (the first buffer then uses the regular entry point).
+ */
+#define DEVFS_DRIVER_VECTOR(driver_name) .driver.readv = driver_name##_readv, \
+	.driver.writev = driver_name##_writev
+
 #define DEVFS_DRIVER_DECLARTION_OPEN(driver_name) int driver_name##_open(const devfs_handle_t *) MCU_ROOT_CODE
 #define DEVFS_DRIVER_DECLARTION_CLOSE(driver_name) int driver_name##_close(const devfs_handle_t *) MCU_ROOT_CODE
 #define DEVFS_DRIVER_DECLARTION_IOCTL(driver_name) int driver_name##_ioctl(const devfs_handle_t *, int, void *) MCU_ROOT_CODE
@@ -172,6 +186,29 @@ int devfs_mcu_ioctl(const devfs_handle_t * handle,
 	.handle.config = handle_config \
 }
 
+//use with drivers that provide try_read and try_write (e.g. fifo, ffifo, null, zero)
+#define DEVFS_TRY_DEVICE(device_name, periph_name, handle_port, handle_config, handle_state, mode_value, uid_value, device_type) { \
+	.name = device_name, \
+	DEVFS_MODE(mode_value, uid_value, device_type), \
+	DEVFS_DRIVER(periph_name), \
+	DEVFS_DRIVER_TRY(periph_name), \
+	.handle.port = handle_port, \
+	.handle.state = handle_state, \
+	.handle.config = handle_config \
+}
+
+//use with drivers that also provide readv and writev (e.g. fifo)
+#define DEVFS_VECTOR_DEVICE(device_name, periph_name, handle_port, handle_config, handle_state, mode_value, uid_value, device_type) { \
+	.name = device_name, \
+	DEVFS_MODE(mode_value, uid_value, device_type), \
+	DEVFS_DRIVER(periph_name), \
+	DEVFS_DRIVER_TRY(periph_name), \
+	DEVFS_DRIVER_VECTOR(periph_name), \
+	.handle.port = handle_port, \
+	.handle.state = handle_state, \
+	.handle.config = handle_config \
+}
+
 #define DEVFS_TERMINATOR { \
 	.driver.open = NULL \
 }
@@ -194,10 +231,17 @@ int devfs_execute_write_handler(devfs_transfer_handler_t * transfer_handler, voi
 //executes read and write handlers (if they exist) with MCU_EVENT_FLAG_CANCELED set
 void devfs_execute_cancel_handler(devfs_transfer_handler_t * transfer_handler, void * data, int nbyte, u32 o_flags);
 
+//handles I_MCU_SETACTION with MCU_EVENT_FLAG_POLL: returns MCU_EVENT_FLAG_POLL plus the requested events in o_ready (the handler is only kept if none are ready)
+int devfs_set_poll_handler(devfs_poll_handler_t * poll_handler, const mcu_action_t * action, u32 o_ready);
+//executes the poll handler (if it exists and is waiting on one of o_ready) and nulls it so it can be assigned again
+int devfs_execute_poll_handler(devfs_poll_handler_t * poll_handler, u32 o_ready);
+
 int devfs_init(const void * cfg);
 int devfs_open(const void * cfg, void ** handle, const char * path, int flags, int mode);
 int devfs_read(const void * cfg, void * handle, int flags, int loc, void * buf, int nbyte);
 int devfs_write(const void * cfg, void * handle, int flags, int loc, const void * buf, int nbyte);
+int devfs_readv(const void * cfg, void * handle, int flags, int loc, const struct iovec * iov, int iovcnt);
+int devfs_writev(const void * cfg, void * handle, int flags, int loc, const struct iovec * iov, int iovcnt);
 int devfs_aio(const void * cfg, void * handle, struct aiocb * aio);
 int devfs_ioctl(const void * cfg, void * handle, int request, void * ctl);
 int devfs_close(const void * cfg, void ** handle);
@@ -224,6 +268,8 @@ int devfs_closedir(const void * cfg, void ** handle);
 	.fsync = SYSFS_NOTSUP, \
 	.read = devfs_read, \
 	.write = devfs_write, \
+	.readv = devfs_readv, \
+	.writev = devfs_writev, \
 	.close = devfs_close, \
 	.rename = SYSFS_NOTSUP, \
 	.unlink = SYSFS_NOTSUP, \
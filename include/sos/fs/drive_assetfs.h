@@ -21,6 +21,7 @@
 #include "sos/dev/drive.h"
 #include "../link/types.h"
 #include "sysfs.h"
+#include "assetfs.h"
 
 int drive_assetfs_init(const void* cfg);
 int drive_assetfs_exit(const void* cfg);
@@ -49,6 +50,40 @@ typedef struct {
 	const drive_assetfs_dirent_t entries[];
 } drive_assetfs_header_t;
 
+#define DRIVE_ASSETFS_SIGNATURE_V2 0x32534641 /*! "AFS2" */
+
+/*! \details Header of a version 2 image.
+ *
+ * The header is followed by \a count u32 name hashes (see
+ * drive_assetfs_hash()) sorted in ascending order and then
+ * the directory entries in the same order. The hashes are
+ * cached in RAM when the filesystem is mounted so a lookup
+ * is a binary search plus a single drive read.
+ *
+ * Images that start with a count rather than the signature
+ * are version 1 images and are searched linearly.
+ *
+ */
+typedef struct MCU_PACK {
+	u32 signature /*! Always \ref DRIVE_ASSETFS_SIGNATURE_V2 */;
+	u32 count /*! Number of entries */;
+	u32 hash_offset /*! Image offset of the hash table */;
+	u32 entry_offset /*! Image offset of the first drive_assetfs_dirent_t */;
+} drive_assetfs_header_v2_t;
+
+/*! \details Hashes an asset name (32-bit FNV-1a). The packer
+ * and the filesystem must agree on this function.
+ */
+static inline u32 drive_assetfs_hash(const char * name, int max){
+	u32 hash = 2166136261UL;
+	int i;
+	for(i=0; (i < max) && name[i]; i++){
+		hash ^= (u8)name[i];
+		hash *= 16777619UL;
+	}
+	return hash;
+}
+
 
 #if !defined __link
 typedef struct {
@@ -58,6 +93,10 @@ typedef struct {
 
 typedef struct {
 	sysfs_shared_state_t drive;
+	u32 count /*! Number of entries (cached at init) */;
+	u32 entry_offset /*! Image offset of the first directory entry */;
+	u32 * hash_table /*! Sorted name hashes (version 2 images only) */;
+	assetfs_chunk_cache_t chunk_cache /*! Decode buffer shared by the open compressed assets */;
 } drive_assetfs_state_t;
 
 
@@ -159,7 +159,9 @@ int sffs_fstat(const void * cfg, void * handle, struct stat * stat);
 int sffs_open(const void * cfg, void ** handle, const char * path, int flags, int mode);
 int sffs_read(const void * cfg, void * handle, int flags, int loc, void * buf, int nbyte);
 int sffs_write(const void * cfg, void * handle, int flags, int loc, const void * buf, int nbyte);
+int sffs_aio(const void * cfg, void * handle, struct aiocb * aio);
 int sffs_close(const void * cfg, void ** handle);
+int sffs_fsync(const void * cfg, void * handle);
 int sffs_remove(const void * cfg, const char * path);
 int sffs_unlink(const void * cfg, const char * path);
 
@@ -180,11 +182,11 @@ int sffs_ismounted(const void * cfg);
 	.startup = SYSFS_NOTSUP, \
 	.mkfs = sffs_mkfs, \
 	.open = sffs_open, \
-	.aio = SYSFS_NOTSUP, \
+	.aio = sffs_aio, \
 	.read = sffs_read, \
 	.write = sffs_write, \
 	.close = sffs_close, \
-	.fsync = SYSFS_NOTSUP, \
+	.fsync = sffs_fsync, \
 	.ioctl = SYSFS_NOTSUP, \
 	.rename = SYSFS_NOTSUP, \
 	.unlink = sffs_unlink, \
@@ -29,6 +29,7 @@
 #include <sys/stat.h>
 
 struct dirent;
+struct iovec;
 
 #if !defined __link
 #include <sys/lock.h>
@@ -78,6 +79,8 @@ typedef struct {
 	int (*ioctl)(const void*, void*, int, void*);
 	int (*read)(const void*, void*, int, int, void*, int);
 	int (*write)(const void*, void*, int, int, const void*, int);
+	int (*readv)(const void*, void*, int, int, const struct iovec*, int); //optional (NULL or ENOTSUP) -- sysfs_file_readv() falls back to read()
+	int (*writev)(const void*, void*, int, int, const struct iovec*, int); //optional (NULL or ENOTSUP) -- sysfs_file_writev() falls back to write()
 	int (*fsync)(const void*, void*);
 	int (*close)(const void*, void**);
 	int (*fstat)(const void*, void*, struct stat*);
@@ -183,18 +186,92 @@ int sysfs_file_ioctl(sysfs_file_t * file, int request, void * ctl);
 int sysfs_file_fsync(sysfs_file_t * file);
 int sysfs_file_read(sysfs_file_t * file, void * buf, int nbyte);
 int sysfs_file_write(sysfs_file_t * file, const void * buf, int nbyte);
+int sysfs_file_readv(sysfs_file_t * file, const struct iovec * iov, int iovcnt);
+int sysfs_file_writev(sysfs_file_t * file, const struct iovec * iov, int iovcnt);
+int sysfs_file_pread(sysfs_file_t * file, void * buf, int nbyte, int loc);
+int sysfs_file_pwrite(sysfs_file_t * file, const void * buf, int nbyte, int loc);
 int sysfs_file_aio(sysfs_file_t * file, void * aio);
 int sysfs_file_close(sysfs_file_t * file);
 
+/*! \details Executes \a aio synchronously for sysfs_aio_submit().
+ * It returns the number of bytes transferred or a value from SYSFS_SET_RETURN().
+ */
+typedef int (*sysfs_aio_execute_t)(const void * config, void * handle, struct aiocb * aio);
+
+//filesystems without interrupt driven transfers can use this to implement the aio callback
+int sysfs_aio_submit(const void * config, void * handle, struct aiocb * aio, sysfs_aio_execute_t execute);
+void sysfs_aio_root_cancel_pid(int pid);
+
+enum sysfs_cache_line_flags {
+	SYSFS_CACHE_LINE_FLAG_VALID /*! The line holds data read from (or destined for) the drive */ = (1<<0),
+	SYSFS_CACHE_LINE_FLAG_DIRTY /*! The line has data that has not been written to the drive */ = (1<<1),
+	SYSFS_CACHE_LINE_FLAG_REFERENCED /*! The line was accessed since the clock hand last passed */ = (1<<2)
+};
+
+typedef struct {
+	u32 address /*! Byte address of the first byte in the line */;
+	u32 o_flags /*! Line flags (see \ref SYSFS_CACHE_LINE_FLAG_VALID) */;
+} sysfs_cache_line_t;
+
+/*! \details Block cache that sits between a filesystem and
+ * the drive it is mounted on. Lines are \a line_size bytes and
+ * are replaced using the CLOCK algorithm. Writes are held in the
+ * cache until the line is evicted or the cache is flushed
+ * (fsync, close or before an erase).
+ *
+ * Use SYSFS_CACHE_DECLARE() to allocate the lines and data.
+ * The counters are never reset by the cache so the hit rate
+ * can be read from the cache object at any time.
+ *
+ */
+typedef struct {
+	u32 line_size /*! Bytes per line (must be a multiple of the drive's write and address size) */;
+	u16 line_count /*! Number of lines */;
+	u16 read_ahead /*! Lines to prefetch when sequential reads are detected */;
+	sysfs_cache_line_t * lines;
+	u8 * data;
+	u32 hand /*! CLOCK hand */;
+	u32 next_address /*! Address a sequential read would start at */;
+	u32 hit_count /*! Lines read or written that were in the cache */;
+	u32 miss_count /*! Lines read or written that were not in the cache (including bypassed lines) */;
+	u32 bypass_count /*! Lines of large aligned transfers that went straight to the drive */;
+	u32 read_ahead_count /*! Lines prefetched by read ahead */;
+	u32 write_back_count /*! Dirty lines written to the drive */;
+} sysfs_cache_t;
+
+#define SYSFS_CACHE_DECLARE(cache_name, line_count_value, line_size_value) \
+	sysfs_cache_line_t cache_name##_lines[line_count_value]; \
+	u8 cache_name##_data[(line_count_value)*(line_size_value)] __attribute__((aligned(4))); \
+	sysfs_cache_t cache_name = { \
+	.line_size = line_size_value, \
+	.line_count = line_count_value, \
+	.read_ahead = 1, \
+	.lines = cache_name##_lines, \
+	.data = cache_name##_data \
+	}
+
+typedef struct {
+	const void * context;
+	int (*read)(const void * context, u32 address, void * buf, int nbyte);
+	int (*write)(const void * context, u32 address, const void * buf, int nbyte);
+} sysfs_cache_drive_t;
+
+int sysfs_cache_read(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive, u32 address, void * buf, int nbyte);
+int sysfs_cache_write(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive, u32 address, const void * buf, int nbyte);
+int sysfs_cache_flush(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive);
+void sysfs_cache_invalidate(sysfs_cache_t * cache);
+
 typedef struct {
 	sysfs_file_t file;
 	pthread_mutex_t mutex;
+	u32 address_size /*! Bytes per drive location (drive_info_t::addressable_size) */;
 } sysfs_shared_state_t;
 
 typedef struct {
 	const sysfs_t * devfs;
 	const char * name;
 	sysfs_shared_state_t * state;
+	sysfs_cache_t * cache /*! Optional write-back block cache (null to access the drive directly) */;
 } sysfs_shared_config_t;
 
 int sysfs_shared_open(const sysfs_shared_config_t * config);
@@ -57,12 +57,23 @@ typedef int (*devfs_read_t)(const devfs_handle_t*, devfs_async_t *);
 typedef int (*devfs_write_t)(const devfs_handle_t*, devfs_async_t *);
 typedef int (*devfs_close_t)(const devfs_handle_t*);
 
+struct iovec;
+
+//called with a kernel copy of the list that is only valid during the call -- returns the bytes
+//transferred or 0 if nothing can be transferred without blocking (the first buffer then uses read/write)
+typedef int (*devfs_readv_t)(const devfs_handle_t*, devfs_async_t *, const struct iovec *, int);
+typedef int (*devfs_writev_t)(const devfs_handle_t*, devfs_async_t *, const struct iovec *, int);
+
 typedef struct {
 	devfs_open_t open;
 	devfs_ioctl_t ioctl;
 	devfs_read_t read;
 	devfs_write_t write;
 	devfs_close_t close;
+	devfs_readv_t readv /*! Optional scatter read (NULL if not supported) */;
+	devfs_writev_t writev /*! Optional gather write (NULL if not supported) */;
+	devfs_read_t try_read /*! Optional read that only completes synchronously (NULL if not supported) */;
+	devfs_write_t try_write /*! Optional write that only completes synchronously (NULL if not supported) */;
 } devfs_driver_t;
 
 
@@ -71,6 +82,11 @@ typedef struct {
     devfs_async_t * write; //used with write operations
 } devfs_transfer_handler_t;
 
+typedef struct {
+	mcu_event_handler_t handler; //executed once when one of o_events is ready (see poll())
+	u32 o_events; //MCU_EVENT_FLAG_DATA_READY and/or MCU_EVENT_FLAG_WRITE_COMPLETE
+} devfs_poll_handler_t;
+
 //mcu_execute_read_complete(devfs_transfer_handler_t * transfer_handler);
 
 typedef struct {
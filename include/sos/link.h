@@ -21,6 +21,7 @@
 #define DEV_LINK_H_
 
 
+#include <stdio.h>
 #include <time.h>
 
 #include "sos/dev/appfs.h"
@@ -50,7 +51,14 @@ extern "C" {
 
 
 
-extern int link_errno;
+#if defined _MSC_VER
+#define LINK_THREAD_LOCAL __declspec(thread)
+#else
+#define LINK_THREAD_LOCAL __thread
+#endif
+
+//each thread has its own value so sessions on different devices can run concurrently
+extern LINK_THREAD_LOCAL int link_errno;
 
 
 #include "link/commands.h"
@@ -75,6 +83,77 @@ int link_connect(link_transport_mdriver_t * driver, const char * sn);
 int link_ping(link_transport_mdriver_t * driver, const char * name, int is_keep_open, int is_legacy);
 int link_disconnect(link_transport_mdriver_t * driver /*! The device to close */);
 char * link_new_device_list(link_transport_mdriver_t * driver, int max);
+
+#define LINK_DEVICE_SERIALNO_SIZE 128
+
+/*! \details Device found by link_probe_devices().
+ *
+ * Each device has its own driver (copied from the template
+ * passed to link_probe_devices()) so sessions with different devices
+ * can run concurrently on separate threads.
+ *
+ */
+typedef struct {
+	char serialno[LINK_DEVICE_SERIALNO_SIZE] /*! Serial number of the device */;
+	link_transport_mdriver_t driver /*! Connected driver (driver.dev_name is the phy name) */;
+} link_device_t;
+
+int link_probe_devices(const link_transport_mdriver_t * driver, link_device_t * devices, int max, int thread_count);
+link_device_t * link_find_device(link_device_t * devices, int count, const char * serialno);
+void link_disconnect_devices(link_device_t * devices, int count);
+
+enum link_async_ops {
+	LINK_ASYNC_OP_READ,
+	LINK_ASYNC_OP_WRITE,
+	LINK_ASYNC_OP_IOCTL
+};
+
+typedef struct link_async_request link_async_request_t;
+
+/*! \details Called on the I/O thread when a request completes. */
+typedef void (*link_async_callback_t)(link_async_request_t * request, void * context);
+
+/*! \details Asynchronous link request.
+ *
+ * The caller owns the memory and must keep it (and the buffer) valid
+ * until the request completes.
+ *
+ */
+struct link_async_request {
+	int op /*! LINK_ASYNC_OP_READ, LINK_ASYNC_OP_WRITE or LINK_ASYNC_OP_IOCTL */;
+	int fildes /*! File descriptor on the device */;
+	int loc /*! Location to seek to before the transfer (-1 to use the current offset) */;
+	void * buf /*! Data for read and write (ioctl control) */;
+	int nbyte /*! Number of bytes to transfer (ioctl request) */;
+	int result /*! Result of the operation (valid once complete) */;
+	int err_number /*! link_errno for the operation */;
+	volatile int is_complete;
+	link_async_callback_t callback;
+	void * context;
+	link_async_request_t * next;
+};
+
+/*! \details I/O thread that executes queued requests for one driver.
+ *
+ * While the I/O thread is running, the driver must not be used
+ * directly by any other thread.
+ *
+ */
+typedef struct {
+	link_transport_mdriver_t * driver;
+	void * thread /*! Thread and synchronization state (allocated by link_async_start()) */;
+	link_async_request_t * head;
+	link_async_request_t * tail;
+	int is_stopping;
+} link_async_t;
+
+int link_async_start(link_async_t * async, link_transport_mdriver_t * driver);
+void link_async_stop(link_async_t * async);
+int link_async_submit(link_async_t * async, link_async_request_t * request);
+int link_async_read(link_async_t * async, link_async_request_t * request, int fildes, int loc, void * buf, int nbyte, link_async_callback_t callback, void * context);
+int link_async_write(link_async_t * async, link_async_request_t * request, int fildes, int loc, const void * buf, int nbyte, link_async_callback_t callback, void * context);
+int link_async_ioctl(link_async_t * async, link_async_request_t * request, int fildes, int request_number, void * ctl, link_async_callback_t callback, void * context);
+int link_async_wait(link_async_t * async, link_async_request_t * request);
 void link_del_device_list(char * sn_list /*! The list to free */);
 char * link_device_list_entry(char * list, int entry);
 int link_get_err();
@@ -129,6 +208,41 @@ int link_gettime(link_transport_mdriver_t * driver, struct link_tm * t);
 
 int link_kill_pid(link_transport_mdriver_t * driver, int pid, int signo);
 int link_get_sys_info(link_transport_mdriver_t * driver, sys_info_t * sys_info);
+int link_get_task_profile(link_transport_mdriver_t * driver, sys_taskprofile_t * profile, int max);
+void link_diff_task_profile(const sys_taskprofile_t * previous, const sys_taskprofile_t * current, sys_taskprofile_t * delta);
+
+/*! \details State used to convert trace ring records
+ * to the Chrome/Perfetto JSON trace format.
+ */
+typedef struct {
+	u64 cycles /*! Extended timestamp of the last record */;
+	u32 last_timestamp /*! Raw timestamp of the last record */;
+	u32 frequency /*! Timestamp frequency in Hz */;
+	u32 record_count /*! Records decoded */;
+	u32 event_count /*! JSON events written */;
+	int current_tid /*! Task that is running (-1 if unknown) */;
+} link_trace_decoder_t;
+
+int link_read_trace(link_transport_mdriver_t * driver, u32 o_flags, sys_trace_read_t * trace);
+void link_trace_json_start(link_trace_decoder_t * decoder, FILE * out);
+int link_trace_json_write(link_trace_decoder_t * decoder, const sys_trace_read_t * trace, FILE * out);
+void link_trace_json_finish(link_trace_decoder_t * decoder, FILE * out);
+
+/*! \details Describes a host file to add to a drive_assetfs image. */
+typedef struct {
+	const char * name /*! Name of the asset in the image */;
+	const char * path /*! Host path to read the data from */;
+	u16 uid /*! Owner (SYSFS_ROOT or SYSFS_USER) */;
+	u16 mode /*! Access mode such as 0444 */;
+	u32 o_flags /*! Set to \ref LINK_ASSETFS_FLAG_COMPRESS to store the asset compressed */;
+} link_assetfs_source_t;
+
+#define LINK_ASSETFS_FLAG_COMPRESS (1<<0)
+
+int link_drive_assetfs_pack(const link_assetfs_source_t * sources, int count, FILE * out);
+int link_assetfs_compress(const void * data, u32 size, u8 ** compressed);
+int link_assetfs_compress_file(const char * path, FILE * out);
+int link_assetfs_decompress(const void * compressed, u32 size, u8 ** data);
 
 int link_isbootloader(link_transport_mdriver_t * driver);
 int link_bootloader_attr(link_transport_mdriver_t * driver, bootloader_attr_t * attr, u32 id);
@@ -137,6 +251,7 @@ int link_isbootloader_legacy(link_transport_mdriver_t * driver);
 int link_bootloader_attr_legacy(link_transport_mdriver_t * driver, bootloader_attr_t * attr, u32 id);
 
 int link_readserialno(link_transport_mdriver_t * driver, char * serialno, int len);
+int link_set_packet_size(link_transport_mdriver_t * driver, int size);
 int link_reset(link_transport_mdriver_t * driver);
 
 int link_resetbootloader(link_transport_mdriver_t * driver);
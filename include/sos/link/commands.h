@@ -78,6 +78,11 @@ typedef struct MCU_PACK {
 	s32 whence;
 } link_lseek_t;
 
+typedef struct MCU_PACK {
+	link_cmd_t cmd;
+	u32 size /*! Requested data bytes per LINK2 packet */;
+} link_packet_size_t;
+
 typedef struct MCU_PACK {
 	link_cmd_t cmd;
 	u32 path_size;
@@ -236,6 +241,7 @@ typedef union {
 		link_chown_t chown;
 		link_chmod_t chmod;
 		link_mkfs_t mkfs;
+		link_packet_size_t packet_size;
 } link_op_t;
 
 typedef struct MCU_PACK {
@@ -267,6 +273,7 @@ enum {
 	LINK_CMD_CHMOD,
 	LINK_CMD_EXEC,
 	LINK_CMD_MKFS,
+	LINK_CMD_SETPACKETSIZE,
 	LINK_CMD_TOTAL
 };
 
@@ -35,6 +35,9 @@
 #define LINK2_PACKET_HEADER_SIZE (6)  //start, size and checksum (2 bytes)
 #define LINK2_MAX_PACKET_SIZE (1024+LINK2_PACKET_HEADER_SIZE)
 #define LINK2_PACKET_DATA_SIZE (LINK2_MAX_PACKET_SIZE - LINK2_PACKET_HEADER_SIZE)
+//largest packet that can be negotiated with LINK_CMD_SETPACKETSIZE
+#define LINK2_PACKET_DATA_SIZE_MAX (16*1024)
+#define LINK2_PACKET_BUFFER_SIZE(data_size) ((data_size) + LINK2_PACKET_HEADER_SIZE)
 #define LINK2_PACKET_ACK (0x07)
 #define LINK2_PACKET_NACK (0x54)
 
@@ -100,6 +103,9 @@ typedef struct link_transport_driver {
 	int (*transport_write)(struct link_transport_driver * driver, const void * buf, int nbyte, int (*callback)(void*,void*,int), void * context);
 	int timeout;
 	u8 o_flags;
+	u16 packet_data_size /*! Negotiated LINK2 packet data size (zero for LINK2_PACKET_DATA_SIZE) */;
+	void * packet_buffer /*! Slave storage for packets larger than LINK2_PACKET_DATA_SIZE (null to only use the default size) */;
+	u32 packet_buffer_size /*! Size of packet_buffer in bytes (see LINK2_PACKET_BUFFER_SIZE()) */;
 } link_transport_driver_t;
 
 typedef struct {
@@ -161,6 +167,8 @@ void link2_transport_insert_checksum(link2_pkt_t * pkt);
 bool link2_transport_checksum_isok(link2_pkt_t * pkt);
 int link2_transport_wait_packet(link_transport_driver_t * driver, link2_pkt_t * pkt, int timeout);
 int link2_transport_wait_start(link_transport_driver_t * driver, link2_pkt_t * pkt, int timeout);
+int link2_transport_get_packet_data_size(const link_transport_driver_t * driver);
+int link2_transport_set_packet_data_size(link_transport_driver_t * driver, int size);
 
 
 
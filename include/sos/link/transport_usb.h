@@ -20,6 +20,7 @@ limitations under the License.
 
 #include "transport.h"
 #include "device/usbfifo.h"
+#include "device/usbpacket.h"
 #include "usbd/msft.h"
 #include "usbd/control.h"
 #include "usbd/cdc.h"
@@ -114,6 +115,11 @@ void sos_link_transport_usb_flush(link_transport_phy_t handle);
 extern const usbfifo_config_t sos_link_transport_usb_fifo_cfg;
 extern usbfifo_state_t sos_link_transport_usb_fifo_state MCU_SYS_MEM;
 
+//provided for the link device as packet buffers that the endpoint receives to directly (use instead of the fifo)
+//DEVFS_DEVICE("link-phy-usb", usbpacket, 0, &sos_link_transport_usb_packet_cfg, &sos_link_transport_usb_packet_state, 0666, USER_ROOT, GROUP_ROOT),
+extern const usbpacket_config_t sos_link_transport_usb_packet_cfg;
+extern usbpacket_state_t sos_link_transport_usb_packet_state MCU_SYS_MEM;
+
 
 link_transport_phy_t boot_link_transport_usb_open(
 		const char * name,
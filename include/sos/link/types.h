@@ -360,6 +360,34 @@ typedef struct MCU_PACK {
 	u32 sum32; //must be aligned on 4-byte boundary
 } link_trace_event_t;
 
+/*! \hideinitializer \details Compact trace record: a task was switched in (value is the previous task ID) */
+#define LINK_TRACE_RECORD_SWITCH 0x8000
+
+/*! \hideinitializer \details Compact trace record: a task became ready to run (value is the ID of the task) */
+#define LINK_TRACE_RECORD_READY 0x8001
+
+/*! \hideinitializer \details Compact trace record: start of a user-defined span (value identifies the span) */
+#define LINK_TRACE_RECORD_BEGIN 0x8002
+
+/*! \hideinitializer \details Compact trace record: end of a user-defined span (value identifies the span) */
+#define LINK_TRACE_RECORD_END 0x8003
+
+/*! \details Compact fixed-size trace record.
+ *
+ * Records are written to the kernel trace ring without any
+ * locks and read out in bulk. Event IDs less than 0x8000
+ * are POSIX trace event IDs (see LINK_POSIX_TRACE_MESSAGE);
+ * the others are LINK_TRACE_RECORD_* values.
+ *
+ */
+typedef struct MCU_PACK {
+	u32 timestamp /*! Low 32 bits of the CPU cycle counter when the record was written */;
+	u16 event_id /*! Event ID */;
+	u8 tid /*! Task ID that was running when the record was written */;
+	u8 o_flags /*! Record flags (used by the kernel while the record is written) */;
+	u32 value /*! One word of event payload */;
+} link_trace_record_t;
+
 
 
 
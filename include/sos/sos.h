@@ -525,11 +525,21 @@ int sos_trace_stack(u32 count);
 void sos_trace_event_addr_tid(link_trace_event_id_t event_id, const void * data_ptr, size_t data_len, u32 addr, int tid);
 void sos_trace_root_trace_event(link_trace_event_id_t event_id, const void * data_ptr, size_t data_len);
 
+void sos_trace_root_record(u16 event_id, u32 value) MCU_ROOT_CODE;
+void sos_trace_root_record_tid(u16 event_id, int tid, u32 value) MCU_ROOT_CODE;
+void sos_trace_record(u16 event_id, u32 value);
+void sos_trace_record_tid(u16 event_id, int tid, u32 value);
+int sos_trace_root_read_records(link_trace_record_t * dest, int max, u32 * dropped) MCU_ROOT_CODE;
+void sos_trace_root_set_enabled(int value) MCU_ROOT_CODE;
+int sos_trace_is_enabled();
+void sos_trace_root_flush() MCU_ROOT_CODE;
+
 #define SOS_SCHEDULER_TIMEVAL_SECONDS 2048
 #define STFY_SCHEDULER_TIMEVAL_SECONDS SOS_SCHEDULER_TIMEVAL_SECONDS
 #define SOS_USECOND_PERIOD (1000000UL * SOS_SCHEDULER_TIMEVAL_SECONDS)
 #define STFY_USECOND_PERIOD SOS_USECOND_PERIOD
 #define SOS_PROCESS_TIMER_COUNT 4
+#define SOS_TASK_BLOCK_REASON_COUNT 16
 
 typedef struct {
 	u32 o_flags;
@@ -538,20 +548,40 @@ typedef struct {
 	struct sigevent sigevent;
 } sos_process_timer_t;
 
+/*! \details Per task scheduler state that is not needed on every tick.
+ *
+ * The state that is scanned on every tick (flags, wake time and
+ * blocking object) is kept in the compact parallel arrays
+ * sos_sched_flags, sos_sched_wake and sos_sched_block_object.
+ *
+ */
 typedef struct {
 	pthread_attr_t attr /*! This holds the task's pthread attributes */;
-	volatile void * block_object /*! The blocking object */;
 	union {
 		volatile int exit_status /*! The task's exit status */;
 		void * (*init)(void*) /*! Task 0 init routine */;
 	};
 	pthread_mutex_t * signal_delay_mutex /*! The mutex to lock if the task cannot be interrupted */;
-	volatile struct mcu_timeval wake /*! When to wake the task */;
-	volatile u16 flags /*! This indicates whether the process is active or not */;
 	trace_id_t trace_id /*! Trace ID is PID is being traced (0 otherwise) */;
 	sos_process_timer_t timer[SOS_PROCESS_TIMER_COUNT];
+	const void * wait_object /*! The block object of the wait list entry (the entry is stale if the task is blocked on something else) */;
+	u8 wait_next /*! Next task in the wait list */;
+	u8 wait_prev /*! Previous task in the wait list */;
+	u8 wait_list /*! Wait list index plus one (zero if the task is not in a wait list) */;
+	u8 wait_is_mutex /*! Non-zero if the task is waiting to lock a mutex */;
 } sched_task_t;
 
+/*! \details Per task blocking time for I_SYS_GETTASKPROFILE.
+ *
+ * The times are kept in CPU cycles and converted to microseconds
+ * when the profile is read.
+ *
+ */
+typedef struct {
+	u64 block_start /*! Cycle count when the task blocked (zero if it is not blocked) */;
+	u64 block_cycles[SOS_TASK_BLOCK_REASON_COUNT] /*! Cycles spent blocked indexed by unblock type */;
+} sched_task_profile_t;
+
 #if !defined __link
 
 /*! \brief Stratify Board Configuration Structure
@@ -584,12 +614,20 @@ typedef struct MCU_PACK {
 
 //must be provided by board support package
 extern volatile sched_task_t sos_sched_table[];
+extern volatile u32 sos_sched_flags[] /*! Scheduler flags for each task (see scheduler_flags.h) */;
+extern volatile struct mcu_timeval sos_sched_wake[] /*! When to wake each task */;
+extern volatile void * volatile sos_sched_block_object[] /*! The object each task is blocked on */;
+extern volatile sched_task_profile_t sos_sched_profile[] /*! Blocking time of each task */;
 extern volatile task_t sos_task_table[];
 extern const sos_board_config_t sos_board_config;
 
 
 #define SOS_DECLARE_TASK_TABLE(task_count) \
 	volatile sched_task_t sos_sched_table[task_count] MCU_SYS_MEM; \
+	volatile u32 sos_sched_flags[task_count] MCU_SYS_MEM; \
+	volatile struct mcu_timeval sos_sched_wake[task_count] MCU_SYS_MEM; \
+	volatile void * volatile sos_sched_block_object[task_count] MCU_SYS_MEM; \
+	volatile sched_task_profile_t sos_sched_profile[task_count] MCU_SYS_MEM; \
 	volatile task_t sos_task_table[task_count] MCU_SYS_MEM
 
 #define SOS_USER_ROOT 0
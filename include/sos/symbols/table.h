@@ -21,6 +21,7 @@
 #include "mcu/arch.h"
 #include "sos/sos.h"
 #include "arpa/inet.h"
+#include <poll.h>
 
 #include "defines.h"
 
@@ -31,6 +32,8 @@
 #endif
 
 extern int seteuid(uid_t uid);
+extern ssize_t pread(int fildes, void * buf, size_t nbyte, off_t offset);
+extern ssize_t pwrite(int fildes, const void * buf, size_t nbyte, off_t offset);
 
 u32 const symbols_table[] SYMBOLS_TABLE_WEAK;
 u32 const symbols_table[] = {
@@ -685,6 +688,11 @@ u32 const symbols_table[] = {
 	(u32)pthread_testcancel,
 	(u32)pthread_setcancelstate,
 	(u32)pthread_setcanceltype,
+	(u32)readv,
+	(u32)writev,
+	(u32)pread,
+	(u32)pwrite,
+	(u32)poll,
 	1
 };
 
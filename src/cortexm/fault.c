@@ -243,6 +243,10 @@ void usagefault_handler(u32 usage_status, hw_stack_frame_t * handler_stack){
 	fault.addr = (void*)0xFFFFFFFF;
 	fault.num = MCU_FAULT_USAGE_UNKNOWN;
 
+	if ( (usage_status & (1<<3)) && (task_root_claim_fpu() == 0) ){
+		return; //the FPU context was switched to the current task -- retry the instruction (interrupt handlers can't claim the FPU)
+	}
+
 	if ( usage_status & (1<<9) ){
 		fault.num = MCU_FAULT_USAGE_DIVBYZERO;
 	}
@@ -30,9 +30,18 @@ volatile s8 m_task_current_priority MCU_SYS_MEM;
 static volatile u8 m_task_exec_count MCU_SYS_MEM;
 int m_task_rr_reload MCU_SYS_MEM;
 volatile int m_task_current MCU_SYS_MEM;
+
+//DWT cycle counter extended to 64 bits
+static volatile u32 m_task_cycles_high MCU_SYS_MEM;
+static volatile u32 m_task_cycles_last MCU_SYS_MEM;
+
 static void svcall_read_rr_timer(u32 * val);
 static int set_systick_interval(int interval) MCU_ROOT_CODE;
 static void switch_contexts();
+static void select_next_task();
+#if __FPU_USED == 1
+static void fpu_update_access();
+#endif
 
 
 
@@ -43,6 +52,25 @@ void system_reset(){
 
 
 u8 task_get_exec_count(){ return m_task_exec_count; }
+
+u64 task_root_get_cycles(){
+	u32 primask;
+	u32 now;
+	u64 result;
+
+	//the counter is read at least every context switch so a wrap can't be missed
+	primask = __get_PRIMASK();
+	__disable_irq();
+	now = DWT->CYCCNT;
+	if( now < m_task_cycles_last ){
+		m_task_cycles_high++;
+	}
+	m_task_cycles_last = now;
+	result = ((u64)m_task_cycles_high << 32) | now;
+	__set_PRIMASK(primask);
+	return result;
+}
+
 u8 task_get_total(){ return sos_board_config.task_total; }
 s8 task_get_current_priority(){ return m_task_current_priority; }
 void task_root_set_current_priority(s8 value){ m_task_current_priority = value; }
@@ -97,6 +125,19 @@ int task_init(int interval,
 	m_task_current = 0;
 	m_task_current_priority = 0;
 
+	task_ready_init();
+	task_fpu_init();
+
+	//the cycle counter is used to profile tasks
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if defined ARM_MATH_CM7
+	DWT->LAR = 0xC5ACCE55; //unlock the DWT registers
+#endif
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	m_task_cycles_high = 0;
+	m_task_cycles_last = 0;
+
 	//Set the interrupt priorities
 	for(i=0; i <= mcu_config.irq_total; i++){
 		mcu_core_set_nvic_priority(i, mcu_config.irq_middle_prio*2-1); //mark as middle priority
@@ -123,7 +164,7 @@ int task_init(int interval,
 	asm volatile("ISB");
 
 	//FPU->FPCCR = (1<<31) | (1<<30); //set CONTROL<2> when FPU is used, enable lazy state preservation
-	FPU->FPCCR = 0; //don't automatically save the FPU registers -- save them manually
+	FPU->FPCCR = 0; //don't automatically save the FPU registers -- save them manually when the FPU changes owners
 #endif
 
 
@@ -208,15 +249,21 @@ void task_svcall_new_task(new_task_t * task){
 			sos_task_table[i].flags = task->flags;
 			//never start a task with root set -- call seteuid() to make root
 			sos_task_table[i].flags &= ~TASK_FLAGS_ROOT;
+			task_root_update_ready(i); //new tasks are not active until the scheduler starts them
 			sos_task_table[i].sp = (u8*)task->stackaddr - sizeof(hw_stack_frame_t) - sizeof(sw_stack_frame_t);
 			sos_task_table[i].reent = task->reent;
 			sos_task_table[i].global_reent = task->global_reent;
 			sos_task_table[i].timer.t = 0;
 			sos_task_table[i].rr_time = m_task_rr_reload;
+			sos_task_table[i].ready_wake = 0;
+			sos_task_table[i].max_latency = 0;
+			sos_task_table[i].switch_count = 0;
+			sos_task_table[i].min_sp = 0;
 			memcpy((void*)&(sos_task_table[i].mem), task->mem, sizeof(task_memories_t));
 #if __FPU_USED != 0
 			sos_task_table[i].fpscr = FPU->FPDSCR;
 			memset((void*)sos_task_table[i].fp, 0, sizeof(sos_task_table[i].fp));
+			task_root_fpu_release(i);
 #endif
 			break;
 		}
@@ -244,7 +291,7 @@ void task_svcall_new_task(new_task_t * task){
 void task_root_delete(int id){
 	if ( (id < task_get_total() ) && (id >= 1)){
 		task_deassert_used(id);
-		task_deassert_exec(id);
+		task_root_fpu_release(id);
 	}
 }
 
@@ -331,6 +378,94 @@ u64 task_gettime(int tid){
 	}
 }
 
+void select_next_task(){
+	int current = m_task_current;
+	int next;
+	u32 now;
+	u32 sp;
+
+	now = (u32)task_root_get_cycles();
+	sp = (u32)sos_task_table[current].sp;
+	if( (sos_task_table[current].min_sp == 0) || (sp < sos_task_table[current].min_sp) ){
+		sos_task_table[current].min_sp = sp;
+	}
+	sos_task_table[current].ready_wake = 0; //woke before it was switched out
+
+	if( (current != 0) && (sos_task_table[current].rr_time < SYSTICK_MIN_CYCLES) ){
+		//the task has used up its RR time -- reload it for the next pass
+		sos_task_table[current].timer.t += (m_task_rr_reload - sos_task_table[current].rr_time);
+		sos_task_table[current].rr_time = m_task_rr_reload;
+	}
+
+	//the scheduler sets the executing priority (it can be held above the ready tasks)
+	next = task_root_ready_select(current, task_get_current_priority());
+
+	if( next == 0 ){
+		//The scheduler only uses OS mem -- disable the process MPU regions
+		if( sos_task_table[0].rr_time < SYSTICK_MIN_CYCLES ){
+			sos_task_table[0].rr_time = m_task_rr_reload;
+			sos_task_table[0].timer.t += (m_task_rr_reload);
+		}
+	}
+
+	if( next != current ){
+		sos_task_table[next].switch_count++;
+	}
+
+	if( sos_task_table[next].ready_wake ){
+		u32 latency = now - sos_task_table[next].ready_cycles;
+		if( latency > sos_task_table[next].max_latency ){
+			sos_task_table[next].max_latency = latency;
+		}
+		sos_task_table[next].ready_wake = 0;
+	}
+
+	m_task_current = next;
+
+	if( next != current ){
+		sos_trace_root_record(LINK_TRACE_RECORD_SWITCH, current);
+	}
+}
+
+#if __FPU_USED == 1
+void task_root_fpu_save(int id){
+	asm volatile ("VMRS %0, fpscr\n\t" : "=r" (sos_task_table[id].fpscr) );
+	asm volatile ("vstm %0, {s0-s31}\n\t" : : "r" (sos_task_table[id].fp) : "memory");
+}
+
+void task_root_fpu_load(int id){
+	asm volatile ("VMSR fpscr, %0\n\t" : : "r" (sos_task_table[id].fpscr) );
+	asm volatile ("vldm %0, {s0-s31}\n\t" : : "r" (sos_task_table[id].fp) : "memory");
+}
+
+void fpu_update_access(){
+	if( task_fpu_is_owner(m_task_current) ){
+		SCB->CPACR |= (0x0F<<20); //registers already hold this task's context
+	} else {
+		SCB->CPACR &= ~(0x0F<<20); //trap (NOCP) on the first floating point instruction
+	}
+}
+#endif
+
+int task_root_claim_fpu(){
+#if __FPU_USED == 1
+	int is_handler_mode;
+	if( SCB->CPACR & (0x0F<<20) ){
+		return -1; //the FPU is accessible so the fault wasn't caused by FPU ownership
+	}
+
+	//RETTOBASE is clear if the fault preempted another exception (the instruction is in an interrupt handler)
+	is_handler_mode = (SCB->ICSR & SCB_ICSR_RETTOBASE_Msk) == 0;
+	if( is_handler_mode == 0 ){
+		SCB->CPACR |= (0x0F<<20); //needed to save and load the registers
+		asm volatile("ISB");
+	}
+	return task_root_fpu_claim(task_get_current(), is_handler_mode);
+#else
+	return -1;
+#endif
+}
+
 void switch_contexts(){
 	//Save the PSP to the current task's stack pointer
 	asm volatile ("MRS %0, psp\n\t" : "=r" (sos_task_table[m_task_current].sp) );
@@ -352,55 +487,7 @@ void switch_contexts(){
 		SCB->SHCSR &= ~(1<<15);
 	}
 
-#if __FPU_USED == 1
-	volatile void * fpu_stack;
-	if( m_task_current != 0 ){
-		//only do this if the task has used the FPU -- copy FPU registers to task table
-		fpu_stack = sos_task_table[m_task_current].fp + 32;
-		asm volatile ("VMRS %0, fpscr\n\t" : "=r" (sos_task_table[m_task_current].fpscr) );
-		asm volatile ("mov r1, %0\n\t" : : "r" (fpu_stack) );
-		asm volatile ("vstmdb r1!, {s0-s31}\n\t");
-	}
-#endif
-
-	do {
-		m_task_current++;
-		if ( m_task_current == task_get_total() ){
-			//The scheduler only uses OS mem -- disable the process MPU regions
-			m_task_current = 0;
-			if( sos_task_table[0].rr_time < SYSTICK_MIN_CYCLES ){
-				sos_task_table[0].rr_time = m_task_rr_reload;
-				sos_task_table[0].timer.t += (m_task_rr_reload);
-			}
-
-			//see if all tasks have used up their RR time
-			int i;
-			for(i=1; i < task_get_total(); i++){
-				if ( task_exec_asserted(i) && (sos_task_table[i].rr_time >= SYSTICK_MIN_CYCLES) ){
-					break;
-				}
-			}
-
-			//if all executing tasks have used up their RR time -- reload the RR time for executing tasks
-			if ( i == task_get_total() ){
-				for(i=1; i < task_get_total(); i++){
-					if ( task_exec_asserted(i) ){
-						sos_task_table[i].timer.t += (m_task_rr_reload - sos_task_table[i].rr_time);
-						sos_task_table[i].rr_time = m_task_rr_reload;
-					}
-				}
-			}
-
-			break;
-		} else if ( task_exec_asserted(m_task_current) ){
-			if ( (sos_task_table[m_task_current].rr_time >= SYSTICK_MIN_CYCLES) || //is there time remaining on the RR
-				  task_fifo_asserted(m_task_current) ){ //is this a FIFO task
-				//check to see if task is low on memory -- kill if necessary?
-
-				break;
-			}
-		}
-	} while(1);
+	select_next_task();
 
 	//Enable the MPU for the task stack guard
 #if MPU_PRESENT || __MPU_PRESENT
@@ -439,14 +526,8 @@ void switch_contexts(){
 	}
 
 #if __FPU_USED == 1
-	//only do this if the task has used the FPU
-	//task_load_fpu();
-	if( m_task_current != 0 ){
-		fpu_stack = sos_task_table[m_task_current].fp;
-		asm volatile ("VMSR fpscr, %0\n\t" : : "r" (sos_task_table[m_task_current].fpscr) );
-		asm volatile ("mov r1, %0\n\t" : : "r" (fpu_stack) );
-		asm volatile ("vldm r1!, {s0-s31}\n\t");
-	}
+	//the FPU registers are only swapped when the new task executes a floating point instruction
+	fpu_update_access();
 #endif
 
 	if( task_yield_asserted(task_get_current()) ){
@@ -487,21 +568,9 @@ void mcu_core_pendsv_handler(){
 	task_save_context();
 
 	//disable interrupts -- Re-entrant scheduler issue #130
-	m_task_exec_count = 0;
 	cortexm_disable_interrupts();
-	int i;
-	for(i=1; i < task_get_total(); i++){
-
-		if( task_enabled_active_not_stopped(i) && //enabled, active, and not stopped
-			 ( task_get_priority(i) == task_get_current_priority() ) ){ //task is equal to the currently executing priority
-			//Enable process execution for highest active priority tasks
-			task_assert_exec(i);
-			m_task_exec_count++;
-		} else {
-			//Disable process execution for lower priority tasks
-			task_deassert_exec(i);
-		}
-	}
+	//the ready queue at the currently executing priority is executed in round robin
+	m_task_exec_count = task_get_ready_count(task_get_current_priority());
 
 	//enable interrupts -- Re-entrant scheduler issue
 	cortexm_enable_interrupts();
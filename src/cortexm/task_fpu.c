@@ -0,0 +1,76 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "task_local.h"
+#include "cortexm/task.h"
+
+/*
+ * The FPU registers hold the context of one task (the owner). A context
+ * switch only enables coprocessor access if the new task is the owner.
+ * Any other task traps (NOCP) on its first floating point instruction and
+ * the fault handler claims the registers for it.
+ *
+ * Interrupt handlers don't have an FPU context. The registers belong to
+ * whichever task was interrupted and the handler would overwrite them, so
+ * a claim from handler mode is refused and the fault is reported.
+ *
+ */
+
+//task whose context is loaded in the FPU registers (-1 if none)
+static volatile int m_task_fpu_owner MCU_SYS_MEM;
+static volatile u32 m_task_fpu_save_count MCU_SYS_MEM;
+static volatile u32 m_task_fpu_restore_count MCU_SYS_MEM;
+
+void task_fpu_init(){
+	//task 0 is executing and the registers are whatever it left in them
+	m_task_fpu_owner = 0;
+	m_task_fpu_save_count = 0;
+	m_task_fpu_restore_count = 0;
+}
+
+int task_fpu_is_owner(int id){
+	return m_task_fpu_owner == id;
+}
+
+int task_root_fpu_claim(int id, int is_handler_mode){
+	if( is_handler_mode ){
+		return -1;
+	}
+
+	if( m_task_fpu_owner != id ){
+		if( m_task_fpu_owner >= 0 ){
+			task_root_fpu_save(m_task_fpu_owner);
+			m_task_fpu_save_count++;
+		}
+		task_root_fpu_load(id);
+		m_task_fpu_restore_count++;
+		m_task_fpu_owner = id;
+	}
+	return 0;
+}
+
+void task_root_fpu_release(int id){
+	if( m_task_fpu_owner == id ){
+		m_task_fpu_owner = -1; //the registers belong to a task that no longer exists
+	}
+}
+
+u32 task_get_fpu_save_count(){ return m_task_fpu_save_count; }
+u32 task_get_fpu_restore_count(){ return m_task_fpu_restore_count; }
+int task_get_fpu_owner(){ return m_task_fpu_owner; }
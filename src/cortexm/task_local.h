@@ -60,6 +60,20 @@ extern int task_total MCU_SYS_MEM;
 extern task_t * task_table MCU_SYS_MEM;
 extern volatile int m_task_current MCU_SYS_MEM;
 
+//per-priority ready queues (task_ready.c)
+void task_ready_init() MCU_ROOT_CODE;
+int task_get_ready_count(int priority);
+int task_root_ready_select(int current, int priority) MCU_ROOT_CODE;
+
+//FPU register ownership (task_fpu.c)
+void task_fpu_init() MCU_ROOT_CODE;
+int task_fpu_is_owner(int id);
+int task_root_fpu_claim(int id, int is_handler_mode) MCU_ROOT_CODE;
+void task_root_fpu_release(int id) MCU_ROOT_CODE;
+//copy the FPU registers to and from the task table (task.c)
+void task_root_fpu_save(int id) MCU_ROOT_CODE;
+void task_root_fpu_load(int id) MCU_ROOT_CODE;
+
 typedef struct {
 	int tid;
 	int pid;
@@ -0,0 +1,172 @@
+/* Copyright 2011-2018 Tyler Gilbert; 
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include <string.h>
+
+#include "task_local.h"
+#include "sos/sos.h"
+#include "cortexm/task.h"
+
+//one bit per priority that has at least one ready task
+static volatile u32 m_task_ready_mask MCU_SYS_MEM;
+//circular ready queue per priority (0 is empty because task 0 is never queued)
+static volatile u8 m_task_ready_head[TASK_PRIORITY_COUNT] MCU_SYS_MEM;
+static volatile u8 m_task_ready_count[TASK_PRIORITY_COUNT] MCU_SYS_MEM;
+//where the round robin picks up if the current task leaves its queue (-1 none, 0 end of pass)
+static volatile int m_task_ready_resume MCU_SYS_MEM;
+static volatile int m_task_ready_resume_priority MCU_SYS_MEM;
+
+static void ready_queue_insert(int id, int priority);
+static void ready_queue_remove(int id);
+
+void task_ready_init(){
+	m_task_ready_mask = 0;
+	m_task_ready_resume = -1;
+	m_task_ready_resume_priority = -1;
+	memset((void*)m_task_ready_head, 0, sizeof(m_task_ready_head));
+	memset((void*)m_task_ready_count, 0, sizeof(m_task_ready_count));
+}
+
+s8 task_get_ready_priority(){
+	u32 mask = m_task_ready_mask;
+	if( mask == 0 ){
+		return -1;
+	}
+	return 31 - __CLZ(mask);
+}
+
+int task_get_ready_count(int priority){
+	if( (priority < 0) || (priority >= TASK_PRIORITY_COUNT) ){
+		return 0;
+	}
+	return m_task_ready_count[priority];
+}
+
+int task_root_ready_select(int current, int priority){
+	int resume = m_task_ready_resume;
+	int head;
+
+	m_task_ready_resume = -1;
+
+	if( task_get_ready_count(priority) == 0 ){
+		return 0;
+	}
+
+	if( m_task_ready_resume_priority != priority ){
+		resume = -1; //the task left a different queue (e.g., a higher priority task blocked)
+	}
+
+	head = m_task_ready_head[priority];
+	if( (current != 0) && (sos_task_table[current].ready_queue == priority + 1) ){
+		if( sos_task_table[current].ready_next == head ){
+			return 0; //end of the pass -- task 0 runs between passes
+		}
+		return sos_task_table[current].ready_next;
+	}
+
+	if( (resume > 0) && (sos_task_table[resume].ready_queue == priority + 1) ){
+		return resume; //the current task stopped -- continue the pass where it left off
+	}
+
+	if( (current != 0) && (resume == 0) ){
+		return 0; //the last task of the pass stopped
+	}
+
+	return head;
+}
+
+void ready_queue_insert(int id, int priority){
+	int head = m_task_ready_head[priority];
+	if( head == 0 ){
+		sos_task_table[id].ready_next = id;
+		sos_task_table[id].ready_prev = id;
+		m_task_ready_head[priority] = id;
+		m_task_ready_mask |= (1<<priority);
+	} else {
+		//new tasks go to the end of the round robin
+		int tail = sos_task_table[head].ready_prev;
+		sos_task_table[id].ready_next = head;
+		sos_task_table[id].ready_prev = tail;
+		sos_task_table[tail].ready_next = id;
+		sos_task_table[head].ready_prev = id;
+	}
+	m_task_ready_count[priority]++;
+	sos_task_table[id].ready_queue = priority + 1;
+}
+
+void ready_queue_remove(int id){
+	int priority = sos_task_table[id].ready_queue - 1;
+	int next = sos_task_table[id].ready_next;
+	int prev = sos_task_table[id].ready_prev;
+	int head = m_task_ready_head[priority];
+
+	if( id == task_get_current() ){
+		m_task_ready_resume = (next == head) ? 0 : next;
+		m_task_ready_resume_priority = priority;
+	}
+
+	if( next == id ){
+		m_task_ready_head[priority] = 0;
+		m_task_ready_mask &= ~(1<<priority);
+	} else {
+		sos_task_table[prev].ready_next = next;
+		sos_task_table[next].ready_prev = prev;
+		if( head == id ){
+			m_task_ready_head[priority] = next;
+		}
+	}
+	m_task_ready_count[priority]--;
+	sos_task_table[id].ready_queue = 0;
+}
+
+void task_root_update_ready(int id){
+	u32 primask;
+	int priority;
+
+	if( id == 0 ){
+		return; //task 0 runs between passes of the round robin and is never queued
+	}
+
+	//this can be called from interrupts of any priority
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if( task_enabled_active_not_stopped(id) ){
+		priority = sos_task_table[id].priority;
+		if( priority < 0 ){
+			priority = 0;
+		} else if( priority >= TASK_PRIORITY_COUNT ){
+			priority = TASK_PRIORITY_COUNT-1;
+		}
+
+		if( sos_task_table[id].ready_queue != priority + 1 ){
+			if( sos_task_table[id].ready_queue ){
+				ready_queue_remove(id);
+			} else {
+				//the task just became ready -- time how long it waits to run
+				sos_task_table[id].ready_cycles = (u32)task_root_get_cycles();
+				sos_task_table[id].ready_wake = 1;
+				sos_trace_root_record(LINK_TRACE_RECORD_READY, id);
+			}
+			ready_queue_insert(id, priority);
+		}
+	} else if( sos_task_table[id].ready_queue ){
+		ready_queue_remove(id);
+	}
+	__set_PRIMASK(primask);
+}
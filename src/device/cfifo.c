@@ -20,10 +20,21 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <stddef.h>
+#include <string.h>
 #include "mcu/debug.h"
+#include "cortexm/cortexm.h"
+#include "cortexm/task.h"
 #include "device/cfifo.h"
 
+//the ready masks are u32 so CFIFO_LOC_READY works with up to 32 channels
+#define CFIFO_READY_CHANNEL_MAX 32
+
 static u32 get_ready_channels(const cfifo_config_t * config, cfifo_state_t * state);
+static u32 get_waiting_channels(const cfifo_config_t * config, cfifo_state_t * state, u32 o_wait);
+static int read_batch(const cfifo_config_t * config, cfifo_state_t * state, cfifo_read_t * batch);
+static int read_ready(const devfs_handle_t * handle, devfs_async_t * async);
+static int ready_callback(void * context, const mcu_event_t * event);
+static void clear_ready_actions(const cfifo_config_t * config, cfifo_state_t * state);
 
 int cfifo_open(const devfs_handle_t * handle){
 	return 0;
@@ -93,11 +104,26 @@ int cfifo_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 				I_FIFO_GETINFO,
 				&fifo_info->info);
 
+	case I_CFIFO_READ:
+		return read_batch(config, state, ctl);
 
 	case I_MCU_SETACTION:
+		if( (action->channel == CFIFO_LOC_READY) && (action->handler.callback == 0) ){
+			//cancel a read that is waiting for a channel to be ready
+			clear_ready_actions(config, state);
+			devfs_execute_read_handler(&state->transfer_handler, 0, -1, MCU_EVENT_FLAG_CANCELED);
+			return 0;
+		}
+
 		//mcu action channel to figure out which fifo
 		if( action->channel < config->count ){
 
+			if( (action->o_events & MCU_EVENT_FLAG_POLL) &&
+				 (state->fifo_state_array[action->channel].poll_handler.handler.callback == ready_callback) ){
+				//a CFIFO_LOC_READY read is using the channel's readiness handler
+				return SYSFS_SET_RETURN(EBUSY);
+			}
+
 			return fifo_ioctl_local(
 					config->fifo_config_array + action->channel,
 					state->fifo_state_array + action->channel,
@@ -116,6 +142,8 @@ int cfifo_read(const devfs_handle_t * handle, devfs_async_t * async){
 	cfifo_state_t * state = handle->state;
 	if( loc < config->count ){
         ret = fifo_read_local(config->fifo_config_array + loc, state->fifo_state_array + loc, async, 1);
+	} else if( loc == CFIFO_LOC_READY ){
+		ret = read_ready(handle, async);
 	} else {
         ret = SYSFS_SET_RETURN(EINVAL);
     }
@@ -146,15 +174,157 @@ u32 get_ready_channels(const cfifo_config_t * config, cfifo_state_t * state){
 	int i;
 
 	o_ready = 0;
-	for(i=0; i < config->count; i++){
+	for(i=0; (i < config->count) && (i < CFIFO_READY_CHANNEL_MAX); i++){
 		fifo_state_t * fifo_state;
 		const fifo_config_t * fifo_config;
 		fifo_config = config->fifo_config_array + i;
 		fifo_state = state->fifo_state_array + i;
 		fifo_getinfo(&info, fifo_config, fifo_state);
         if( info.size_ready > 0 ){
-			o_ready |= (1<<i);
+			o_ready |= ((u32)1<<i);
+		}
+	}
+	return o_ready;
+}
+
+u32 get_waiting_channels(const cfifo_config_t * config, cfifo_state_t * state, u32 o_wait){
+	u32 o_ready = 0;
+	int i;
+	for(i=0; i < config->count; i++){
+		if( (o_wait & ((u32)1<<i)) &&
+			 (fifo_get_poll_events(config->fifo_config_array + i, state->fifo_state_array + i) & MCU_EVENT_FLAG_DATA_READY) ){
+			o_ready |= ((u32)1<<i);
 		}
 	}
 	return o_ready;
 }
+
+int read_batch(const cfifo_config_t * config, cfifo_state_t * state, cfifo_read_t * batch){
+	int count = 0;
+	u32 i;
+
+	if( task_validate_memory(batch->buffers, batch->count * sizeof(cfifo_buffer_t)) < 0 ){
+		return SYSFS_SET_RETURN(EPERM);
+	}
+
+	batch->o_ready = 0;
+	for(i=0; i < batch->count; i++){
+		cfifo_buffer_t * buffer = batch->buffers + i;
+		fifo_state_t * fifo_state;
+		const fifo_config_t * fifo_config;
+
+		buffer->result = 0;
+		if( (buffer->channel >= config->count) ||
+			 (task_validate_memory(buffer->buf, buffer->nbyte) < 0) ){
+			buffer->result = -1;
+			continue;
+		}
+
+		fifo_config = config->fifo_config_array + buffer->channel;
+		fifo_state = state->fifo_state_array + buffer->channel;
+		if( fifo_state->transfer_handler.read != 0 ){
+			//a blocked read() on the channel gets the data first
+			continue;
+		}
+
+		buffer->result = fifo_read_buffer(fifo_config, fifo_state, buffer->buf, buffer->nbyte);
+		if( buffer->result > 0 ){
+			//see if anything needs to write the FIFO
+			fifo_data_transmitted(fifo_config, fifo_state);
+			if( buffer->channel < CFIFO_READY_CHANNEL_MAX ){
+				batch->o_ready |= ((u32)1<<buffer->channel);
+			}
+			count++;
+		}
+	}
+
+	return count;
+}
+
+int read_ready(const devfs_handle_t * handle, devfs_async_t * async){
+	const cfifo_config_t * config = handle->config;
+	cfifo_state_t * state = handle->state;
+	mcu_action_t action;
+	u32 o_wait;
+	u32 o_ready;
+	int i;
+
+	if( (async->nbyte != sizeof(u32)) || (config->count > CFIFO_READY_CHANNEL_MAX) ){
+		return SYSFS_SET_RETURN(EINVAL);
+	}
+
+	DEVFS_DRIVER_IS_BUSY(state->transfer_handler.read, async);
+
+	memcpy(&o_wait, async->buf, sizeof(u32));
+	if( o_wait == 0 ){
+		o_wait = 0xffffffff;
+	}
+
+	//a channel can't become ready between checking and registering the handlers
+	cortexm_disable_interrupts();
+	for(i=0; i < config->count; i++){
+		if( (o_wait & ((u32)1<<i)) &&
+			 (state->fifo_state_array[i].poll_handler.handler.callback != 0) &&
+			 (state->fifo_state_array[i].poll_handler.handler.callback != ready_callback) ){
+			//poll() is waiting on the channel -- each channel has one readiness handler
+			cortexm_enable_interrupts();
+			state->transfer_handler.read = 0;
+			return SYSFS_SET_RETURN(EBUSY);
+		}
+	}
+
+	o_ready = get_waiting_channels(config, state, o_wait);
+	if( (o_ready == 0) && ((async->flags & O_NONBLOCK) == 0) ){
+		//the per channel readiness handlers complete the read
+		state->o_wait = o_wait;
+		memset(&action, 0, sizeof(action));
+		action.handler.callback = ready_callback;
+		action.handler.context = (void*)handle;
+		action.o_events = MCU_EVENT_FLAG_POLL | MCU_EVENT_FLAG_DATA_READY;
+		for(i=0; i < config->count; i++){
+			if( o_wait & ((u32)1<<i) ){
+				devfs_set_poll_handler(&state->fifo_state_array[i].poll_handler, &action, 0);
+			}
+		}
+		cortexm_enable_interrupts();
+		return 0;
+	}
+	cortexm_enable_interrupts();
+
+	state->transfer_handler.read = 0;
+	if( o_ready == 0 ){
+		return SYSFS_SET_RETURN(EAGAIN);
+	}
+
+	memcpy(async->buf, &o_ready, sizeof(u32));
+	return sizeof(u32);
+}
+
+int ready_callback(void * context, const mcu_event_t * event){
+	const devfs_handle_t * handle = context;
+	const cfifo_config_t * config = handle->config;
+	cfifo_state_t * state = handle->state;
+	u32 o_ready;
+
+	clear_ready_actions(config, state);
+	if( state->transfer_handler.read != 0 ){
+		o_ready = get_waiting_channels(config, state, state->o_wait);
+		memcpy(state->transfer_handler.read->buf, &o_ready, sizeof(u32));
+		devfs_execute_read_handler(
+					&state->transfer_handler,
+					0,
+					sizeof(u32),
+					MCU_EVENT_FLAG_DATA_READY);
+	}
+	return 0;
+}
+
+void clear_ready_actions(const cfifo_config_t * config, cfifo_state_t * state){
+	int i;
+	for(i=0; i < config->count; i++){
+		devfs_poll_handler_t * poll_handler = &state->fifo_state_array[i].poll_handler;
+		if( poll_handler->handler.callback == ready_callback ){
+			poll_handler->handler.callback = 0;
+		}
+	}
+}
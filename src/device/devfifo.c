@@ -95,6 +95,9 @@ static int data_received(void * context, const mcu_event_t * data){
 		}
 	}
 
+	if( state->head != state->tail ){
+		devfs_execute_poll_handler(&state->poll_handler, MCU_EVENT_FLAG_DATA_READY);
+	}
 
 	return 1; //leave the callback in place
 }
@@ -107,6 +110,7 @@ int devfifo_open(const devfs_handle_t * handle){
 	state->tail = 0;
 	state->rop = NULL;
 	state->overflow = false;
+	state->poll_handler.handler.callback = NULL;
 	//setup the device to write to the fifo when data arrives
 	if ( device->driver.open(&(device->handle)) < 0 ){
 		return -1;
@@ -121,6 +125,7 @@ int devfifo_open(const devfs_handle_t * handle){
 
 int devfifo_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 	devfifo_attr_t * attr = ctl;
+	const mcu_action_t * action = ctl;
     const devfifo_config_t * cfgp = handle->config;
     devfifo_state_t * state = handle->state;
 	const devfs_device_t * device = cfgp->dev;
@@ -135,6 +140,12 @@ int devfifo_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 		attr->overflow = state->overflow;
 		state->overflow = false; //clear the overflow flag now that it has been read
 		return 0;
+	} else if( (request == I_MCU_SETACTION) && (action->o_events & MCU_EVENT_FLAG_POLL) ){
+		//writes go directly to the device so only reads can wait
+		return devfs_set_poll_handler(
+					&state->poll_handler,
+					action,
+					(state->head != state->tail ? MCU_EVENT_FLAG_DATA_READY : 0) | MCU_EVENT_FLAG_WRITE_COMPLETE);
 	} else {
 		return device->driver.ioctl(&(device->handle), request, ctl);
 	}
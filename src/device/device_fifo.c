@@ -174,6 +174,11 @@ int device_fifo_ioctl(const devfs_handle_t * handle, int request, void * ctl){
     case I_DEVICE_FIFO_SETACTION:
     case I_MCU_SETACTION:
 
+        if( action->o_events & MCU_EVENT_FLAG_POLL ){
+            //the rx and tx fifos don't share a readiness handler
+            return SYSFS_SET_RETURN(ENOTSUP);
+        }
+
         //this needs to handle cancelling wop/rop of tx and rx fifos
         if( (action->o_events & MCU_EVENT_FLAG_DATA_READY) && (action->handler.callback == 0) ){
             //cancel the fifo rx
@@ -117,6 +117,20 @@ enum {
     CFI_SFDP_FLAG_IS_FAST_READ_222 = (1<<10)
 };
 
+//JEDEC basic flash parameter table (JESD216) -- dwords used by the drivers
+#define DRIVE_CFI_SFDP_BASIC_TABLE_WORDS 11
+
+typedef int (*drive_cfi_read_sfdp_t)(const devfs_handle_t * handle, u32 address, u8 * data, u8 nbyte);
+
+//reads and parses the basic flash parameter table, returns -1 if the device has none
+int drive_cfi_sfdp_load(const devfs_handle_t * handle, drive_cfi_sfdp_t * sfdp, drive_cfi_read_sfdp_t read_sfdp);
+
+//sets the page size, block erase and 1-1-1 fast read in the state from the config and state->sfdp
+void drive_cfi_sfdp_apply(const devfs_handle_t * handle);
+
+//picks the fastest read that state->sfdp lists for the data lines in o_data_flags (QSPI_FLAG_IS_*), returns 1 if one was chosen
+int drive_cfi_sfdp_select_fast_read(const devfs_handle_t * handle, u32 o_data_flags);
+
 
 
 
@@ -3,7 +3,11 @@
 #include "mcu/pio.h"
 #include "mcu/debug.h"
 
-#include "device/drive_cfi.h"
+#include "device/drive_erase_queue.h"
+#include "drive_cfi_local.h"
+
+//qspi_command_t carries up to 32 data bytes
+#define SFDP_READ_CHUNK_SIZE 32
 
 
 static int drive_cfi_qspi_execute_command(
@@ -22,6 +26,14 @@ static int drive_cfi_qspi_execute_quick_command(
 		u32 o_flags);
 
 static u8 drive_cfi_qspi_read_status(const devfs_handle_t * handle);
+static int drive_cfi_qspi_read_sfdp(const devfs_handle_t * handle, u32 address, u8 * data, u8 nbyte);
+static int drive_cfi_qspi_erase_block(const devfs_handle_t * handle, u32 start, u32 end);
+static int drive_cfi_qspi_erase_queued(const devfs_handle_t * handle, u32 start, u32 end);
+static int drive_cfi_qspi_handle_complete(void * context, const mcu_event_t * event);
+static void drive_cfi_qspi_begin_transfer(const devfs_handle_t * handle, devfs_async_t * async);
+static int drive_cfi_qspi_end_transfer(const devfs_handle_t * handle, devfs_async_t * async, int result);
+static int drive_cfi_qspi_is_busy(const devfs_handle_t * handle);
+static int drive_cfi_qspi_service_erase(const devfs_handle_t * handle);
 static int drive_initialize(const devfs_handle_t * handle);
 
 
@@ -56,6 +68,17 @@ int drive_initialize(const devfs_handle_t * handle){
 			return result;
 		}
 
+		drive_erase_queue_init(
+					&state->erase_queue,
+					handle,
+					drive_cfi_qspi_erase_queued,
+					drive_cfi_qspi_is_busy,
+					config->erase_timer);
+
+		//SFDP is read in single line SPI mode before the device switches to QPI
+		drive_cfi_sfdp_load(handle, &state->sfdp, drive_cfi_qspi_read_sfdp);
+		drive_cfi_sfdp_apply(handle);
+		drive_cfi_sfdp_select_fast_read(handle, config->qspi_flags);
 
 		if( config->qspi_flags & QSPI_FLAG_IS_OPCODE_QUAD ){
 			//enter QPI mode
@@ -89,20 +112,36 @@ int drive_initialize(const devfs_handle_t * handle){
 
 int drive_cfi_qspi_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 	const drive_cfi_config_t * config = handle->config;
+	drive_cfi_state_t * state = handle->state;
 	drive_attr_t * attr = ctl;
 	drive_info_t * info = ctl;
-	u8 status;
+	int result;
 
 	switch(request){
 		case I_DRIVE_GETVERSION: return DRIVE_VERSION;
 
+		case I_DRIVE_SETACTION:
+			drive_erase_queue_set_action(&state->erase_queue, ctl);
+			return SYSFS_RETURN_SUCCESS;
+
 		case I_DRIVE_SETATTR:
 			{
 				if( attr == 0 ){ return SYSFS_SET_RETURN(EINVAL); }
 				u32 o_flags = attr->o_flags;
 
+				if( (o_flags & DRIVE_FLAG_ERASE_BLOCKS) && (o_flags & DRIVE_FLAG_ERASE_ASYNC) ){
+					result = drive_erase_queue_push(&state->erase_queue, attr->start, attr->end);
+					if( result < 0 ){ return result; }
+					result = drive_cfi_qspi_service_erase(handle);
+					return result < 0 ? result : SYSFS_RETURN_SUCCESS;
+				}
+
+				//other operations wait for the queued erases
+				if( drive_cfi_qspi_service_erase(handle) != 0 ){
+					return SYSFS_SET_RETURN(EBUSY);
+				}
+
 				if( o_flags & DRIVE_FLAG_INIT ){
-					int result;
 					//set serial driver attributes to defaults
 					result = drive_initialize(handle);
 					if( result < 0 ){ return result; }
@@ -176,36 +215,8 @@ int drive_cfi_qspi_ioctl(const devfs_handle_t * handle, int request, void * ctl)
 				}
 
 				if( o_flags & DRIVE_FLAG_ERASE_BLOCKS ){
-					//erase the smallest possible section size
-
-					u32 erase_size = attr->end - attr->start;
-					u8 opcode;
-
-					if( (erase_size >= config->info.erase_sector_size) &&
-						 (attr->start % config->info.erase_sector_size == 0) ){
-						erase_size = config->info.erase_sector_size;
-						opcode = config->opcode.sector_erase;
-					} else {
-						erase_size = config->info.erase_block_size;
-						opcode = config->opcode.block_erase;
-					}
-
-					drive_cfi_qspi_execute_quick_command(
-								handle,
-								config->opcode.write_enable,
-								0,
-								config->qspi_flags
-								);
-
-					drive_cfi_qspi_execute_quick_command(
-								handle,
-								opcode,
-								attr->start + config->info.partition_start,
-								QSPI_FLAG_IS_ADDRESS_WRITE | config->qspi_flags
-								);
-
 					//only one block can be erased at a time
-					return erase_size;
+					return drive_cfi_qspi_erase_block(handle, attr->start, attr->end);
 				}
 
 				if( (config->opcode.device_erase != 0xff) &&
@@ -232,6 +243,7 @@ int drive_cfi_qspi_ioctl(const devfs_handle_t * handle, int request, void * ctl)
 					DRIVE_FLAG_PROTECT |
 					DRIVE_FLAG_UNPROTECT |
 					DRIVE_FLAG_ERASE_BLOCKS |
+					DRIVE_FLAG_ERASE_ASYNC |
 					DRIVE_FLAG_POWERUP |
 					DRIVE_FLAG_POWERDOWN |
 					0;
@@ -247,18 +259,16 @@ int drive_cfi_qspi_ioctl(const devfs_handle_t * handle, int request, void * ctl)
 			info->erase_block_time = config->info.erase_block_time;
 			info->erase_device_time = config->info.erase_device_time;
 			info->bitrate = config->info.bitrate;
-			info->page_program_size = config->opcode.page_program_size;
+			info->page_program_size = state->page_program_size;
 			info->partition_start = config->info.partition_start;
 
 			break;
 
 		case I_DRIVE_ISBUSY:
-			status = drive_cfi_qspi_read_status(handle);
-			if( (status & config->opcode.busy_status_mask) != 0 ){
-				//device is busy
-				return 1;
-			}
-			break;
+			//this also starts the next queued erase
+			result = drive_cfi_qspi_service_erase(handle);
+			if( result != 0 ){ return result; }
+			return drive_cfi_qspi_is_busy(handle);
 
 	}
 
@@ -267,6 +277,8 @@ int drive_cfi_qspi_ioctl(const devfs_handle_t * handle, int request, void * ctl)
 
 int drive_cfi_qspi_read(const devfs_handle_t * handle, devfs_async_t * async){
 	const drive_cfi_config_t * config = handle->config;
+	drive_cfi_state_t * state = handle->state;
+	u32 o_flags = config->qspi_flags;
 
 	//check for the end of the drive
 	int num_blocks =
@@ -282,22 +294,36 @@ int drive_cfi_qspi_read(const devfs_handle_t * handle, devfs_async_t * async){
 				num_blocks * config->info.addressable_size;
 	}
 
+	//reads use the array between queued erases
+	if( drive_erase_queue_pause(&state->erase_queue) != 0 ){ return SYSFS_SET_RETURN(EBUSY); }
+
+	if( state->read_qspi_flags ){
+		//the read chosen from SFDP sets its own address and data lines
+		o_flags &= ~(QSPI_FLAG_IS_ADDRESS_DUAL | QSPI_FLAG_IS_ADDRESS_QUAD | QSPI_FLAG_IS_DATA_DUAL | QSPI_FLAG_IS_DATA_QUAD);
+		o_flags |= state->read_qspi_flags;
+	}
+
 	//get ready for the read by sending the read command
 	int result = drive_cfi_qspi_execute_command(
 				handle,
-				config->opcode.fast_read,
-				config->opcode.read_dummy_cycles,
+				state->fast_read_opcode,
+				state->read_dummy_cycles,
 				0, //data is null because it will be ready with read()
 				async->nbyte, //the number of bytes to read
 				async->loc + config->info.partition_start,  //the address to read
-				config->qspi_flags | QSPI_FLAG_IS_ADDRESS_WRITE
+				o_flags | QSPI_FLAG_IS_ADDRESS_WRITE
 				);
 
-	if( result < 0 ){ return result; }
+	if( result < 0 ){
+		drive_erase_queue_resume(&state->erase_queue);
+		return result;
+	}
 
-	return config->serial_device->driver.read(
-				&config->serial_device->handle,
-				async
+	drive_cfi_qspi_begin_transfer(handle, async);
+	return drive_cfi_qspi_end_transfer(
+				handle,
+				async,
+				config->serial_device->driver.read(&config->serial_device->handle, async)
 				);
 }
 
@@ -305,6 +331,7 @@ int drive_cfi_qspi_read(const devfs_handle_t * handle, devfs_async_t * async){
 
 int drive_cfi_qspi_write(const devfs_handle_t * handle, devfs_async_t * async){
 	const drive_cfi_config_t * config = handle->config;
+	drive_cfi_state_t * state = handle->state;
 	//check for the end of the drive
 	int num_blocks = async->nbyte / config->info.addressable_size;
 	if( async->loc + num_blocks > config->info.num_write_blocks ){
@@ -315,7 +342,13 @@ int drive_cfi_qspi_write(const devfs_handle_t * handle, devfs_async_t * async){
 		async->nbyte = num_blocks * config->info.addressable_size;
 	}
 
-	u32 page_size = config->opcode.page_program_size;
+	//pages can be programmed between queued erases if they are outside the queued ranges
+	if( drive_erase_queue_is_queued(&state->erase_queue, async->loc, async->loc + num_blocks - 1) ){
+		return SYSFS_SET_RETURN(EBUSY);
+	}
+	if( drive_erase_queue_pause(&state->erase_queue) != 0 ){ return SYSFS_SET_RETURN(EBUSY); }
+
+	u32 page_size = state->page_program_size;
 	u32 page_program_mask = page_size-1;
 
 	if( ((async->loc & page_program_mask) + async->nbyte) > page_size ){
@@ -337,11 +370,44 @@ int drive_cfi_qspi_write(const devfs_handle_t * handle, devfs_async_t * async){
 				);
 
 	if( result < 0 ){
+		drive_erase_queue_resume(&state->erase_queue);
 		return result;
 	}
 
-	return config->serial_device->driver.write(&config->serial_device->handle, async);
+	drive_cfi_qspi_begin_transfer(handle, async);
+	return drive_cfi_qspi_end_transfer(
+				handle,
+				async,
+				config->serial_device->driver.write(&config->serial_device->handle, async)
+				);
+}
+
+void drive_cfi_qspi_begin_transfer(const devfs_handle_t * handle, devfs_async_t * async){
+	drive_cfi_state_t * state = handle->state;
+	//the transfer completes through this driver so the erase queue can continue
+	state->handler = async->handler;
+	async->handler.callback = drive_cfi_qspi_handle_complete;
+	async->handler.context = (void*)handle;
+}
 
+int drive_cfi_qspi_end_transfer(const devfs_handle_t * handle, devfs_async_t * async, int result){
+	drive_cfi_state_t * state = handle->state;
+	if( result != 0 ){
+		//completed synchronously or failed to start
+		async->handler = state->handler;
+		state->handler.callback = 0;
+		drive_erase_queue_resume(&state->erase_queue);
+	}
+	return result;
+}
+
+int drive_cfi_qspi_handle_complete(void * context, const mcu_event_t * event){
+	const devfs_handle_t * handle = context;
+	drive_cfi_state_t * state = handle->state;
+	devfs_execute_event_handler(&state->handler, event->o_events, event->data);
+	state->handler.callback = 0;
+	drive_erase_queue_resume(&state->erase_queue);
+	return 0;
 }
 
 int drive_cfi_qspi_close(const devfs_handle_t * handle){
@@ -377,6 +443,74 @@ u8 drive_cfi_qspi_read_status(const devfs_handle_t * handle){
 	return status;
 }
 
+int drive_cfi_qspi_read_sfdp(const devfs_handle_t * handle, u32 address, u8 * data, u8 nbyte){
+	u8 offset;
+	for(offset = 0; offset < nbyte; offset += SFDP_READ_CHUNK_SIZE){
+		u8 size = nbyte - offset;
+		if( size > SFDP_READ_CHUNK_SIZE ){ size = SFDP_READ_CHUNK_SIZE; }
+		//1-1-1 with eight dummy cycles and a 3 byte address (JESD216)
+		int result = drive_cfi_qspi_execute_command(
+					handle,
+					CFI_COMMAND_READ_SFDP,
+					8,
+					data + offset,
+					size,
+					address + offset,
+					QSPI_FLAG_IS_DATA_READ | QSPI_FLAG_IS_ADDRESS_WRITE | QSPI_FLAG_IS_ADDRESS_24_BITS
+					);
+		if( result < 0 ){ return result; }
+	}
+	return nbyte;
+}
+
+int drive_cfi_qspi_erase_block(const devfs_handle_t * handle, u32 start, u32 end){
+	const drive_cfi_config_t * config = handle->config;
+	//erase the smallest possible section size
+	u32 erase_size = end - start;
+	u8 opcode;
+
+	if( (erase_size >= config->info.erase_sector_size) &&
+		 (start % config->info.erase_sector_size == 0) ){
+		erase_size = config->info.erase_sector_size;
+		opcode = config->opcode.sector_erase;
+	} else {
+		erase_size = config->info.erase_block_size;
+		opcode = config->opcode.block_erase;
+	}
+
+	drive_cfi_qspi_execute_quick_command(
+				handle,
+				config->opcode.write_enable,
+				0,
+				config->qspi_flags
+				);
+
+	drive_cfi_qspi_execute_quick_command(
+				handle,
+				opcode,
+				start + config->info.partition_start,
+				QSPI_FLAG_IS_ADDRESS_WRITE | config->qspi_flags
+				);
+
+	return erase_size;
+}
+
+int drive_cfi_qspi_is_busy(const devfs_handle_t * handle){
+	const drive_cfi_config_t * config = handle->config;
+	u8 status = drive_cfi_qspi_read_status(handle);
+	return (status & config->opcode.busy_status_mask) != 0;
+}
+
+int drive_cfi_qspi_erase_queued(const devfs_handle_t * handle, u32 start, u32 end){
+	//queued ranges include the end address -- erase_block() takes the end as exclusive
+	return drive_cfi_qspi_erase_block(handle, start, end + 1);
+}
+
+int drive_cfi_qspi_service_erase(const devfs_handle_t * handle){
+	drive_cfi_state_t * state = handle->state;
+	return drive_erase_queue_service(&state->erase_queue);
+}
+
 int drive_cfi_qspi_execute_quick_command(
 		const devfs_handle_t * handle,
 		u8 instruction,
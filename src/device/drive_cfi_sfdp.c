@@ -0,0 +1,197 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include <string.h>
+
+#include "drive_cfi_local.h"
+
+#define DEFAULT_PAGE_PROGRAM_SIZE 256
+
+static u32 sfdp_word(const u8 * table, int dword){
+	//SFDP numbers dwords from 1
+	const u8 * p = table + (dword-1)*sizeof(u32);
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static void sfdp_load_fast_read(u16 value, u8 * opcode, u8 * mode_bits, u8 * wait_states){
+	*wait_states = value & 0x1f;
+	*mode_bits = (value >> 5) & 0x07;
+	*opcode = value >> 8;
+}
+
+int drive_cfi_sfdp_load(
+		const devfs_handle_t * handle,
+		drive_cfi_sfdp_t * sfdp,
+		drive_cfi_read_sfdp_t read_sfdp){
+	u8 header[16];
+	u8 table[DRIVE_CFI_SFDP_BASIC_TABLE_WORDS*sizeof(u32)];
+	u32 value;
+
+	memset(sfdp, 0, sizeof(drive_cfi_sfdp_t));
+	memset(table, 0, sizeof(table));
+
+	//SFDP header followed by the first parameter header (always the basic flash parameter table)
+	if( read_sfdp(handle, 0, header, sizeof(header)) < 0 ){ return -1; }
+	if( sfdp_word(header, 1) != DRIVE_CFI_SFDP_SIGNATURE ){ return -1; }
+
+	u32 words = header[11];
+	u32 pointer = header[12] | (header[13] << 8) | (header[14] << 16);
+	if( words > DRIVE_CFI_SFDP_BASIC_TABLE_WORDS ){ words = DRIVE_CFI_SFDP_BASIC_TABLE_WORDS; }
+
+	//parameter ID 0x00 is the JEDEC basic flash parameter table
+	if( (header[8] != 0x00) || (words < 9) ){ return -1; }
+	if( read_sfdp(handle, pointer, table, words*sizeof(u32)) < 0 ){ return -1; }
+
+	sfdp->o_flags = DRIVE_CFI_SFDP_FLAG_IS_VALID;
+
+	value = sfdp_word(table, 1);
+	if( (value & 0x03) == 0x01 ){ sfdp->o_flags |= DRIVE_CFI_SFDP_FLAG_IS_ERASE_4KB; }
+	if( value & (1<<16) ){ sfdp->o_flags |= DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_112; }
+	if( value & (1<<20) ){ sfdp->o_flags |= DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_122; }
+	if( value & (1<<21) ){ sfdp->o_flags |= DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_144; }
+	if( value & (1<<22) ){ sfdp->o_flags |= DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_114; }
+	sfdp->opcode_4kb_erase = value >> 8;
+	//volatile status bits use 0x50 unless the table says 0x06 is required
+	sfdp->opcode_write_enable_status = ((value & (1<<4)) && ((value & (1<<3)) == 0)) ? 0x50 : 0x06;
+	sfdp->address_bytes = ((value >> 17) & 0x03) == 0x02 ? 4 : 3;
+
+	value = sfdp_word(table, 2);
+	if( value & 0x80000000 ){
+		value &= 0x7fffffff;
+		//density is 2^N bits
+		sfdp->size = (value >= 3) && (value < 35) ? (1UL << (value - 3)) : 0xffffffff;
+	} else {
+		sfdp->size = (value >> 3) + 1;
+	}
+
+	value = sfdp_word(table, 3);
+	sfdp_load_fast_read(value, &sfdp->opcode_fast_read_144, &sfdp->opcode_fast_read_144_mode_bits, &sfdp->opcode_fast_read_144_wait_states);
+	sfdp_load_fast_read(value >> 16, &sfdp->opcode_fast_read_114, &sfdp->opcode_fast_read_114_mode_bits, &sfdp->opcode_fast_read_114_wait_states);
+
+	value = sfdp_word(table, 4);
+	sfdp_load_fast_read(value, &sfdp->opcode_fast_read_112, &sfdp->opcode_fast_read_112_mode_bits, &sfdp->opcode_fast_read_112_wait_states);
+	sfdp_load_fast_read(value >> 16, &sfdp->opcode_fast_read_122, &sfdp->opcode_fast_read_122_mode_bits, &sfdp->opcode_fast_read_122_wait_states);
+
+	value = sfdp_word(table, 5);
+	if( value & (1<<0) ){ sfdp->o_flags |= DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_222; }
+	if( value & (1<<4) ){ sfdp->o_flags |= DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_444; }
+
+	sfdp_load_fast_read(sfdp_word(table, 6) >> 16, &sfdp->opcode_fast_read_222, &sfdp->opcode_fast_read_222_mode_bits, &sfdp->opcode_fast_read_222_wait_states);
+	sfdp_load_fast_read(sfdp_word(table, 7) >> 16, &sfdp->opcode_fast_read_444, &sfdp->opcode_fast_read_444_mode_bits, &sfdp->opcode_fast_read_444_wait_states);
+
+	//erase types -- sizes are stored as 2^N bytes
+	value = sfdp_word(table, 8);
+	sfdp->erase_size1 = value;
+	sfdp->opcode_erase_size1 = value >> 8;
+	sfdp->erase_size2 = value >> 16;
+	sfdp->opcode_erase_size2 = value >> 24;
+	value = sfdp_word(table, 9);
+	sfdp->erase_size3 = value;
+	sfdp->opcode_erase_size3 = value >> 8;
+	sfdp->erase_size4 = value >> 16;
+	sfdp->opcode_erase_size4 = value >> 24;
+
+	if( words >= 11 ){
+		value = (sfdp_word(table, 11) >> 4) & 0x0f;
+		if( value ){ sfdp->page_program_size = 1 << value; }
+	}
+
+	return 0;
+}
+
+void drive_cfi_sfdp_apply(const devfs_handle_t * handle){
+	const drive_cfi_config_t * config = handle->config;
+	drive_cfi_state_t * state = handle->state;
+	const drive_cfi_sfdp_t * sfdp = &state->sfdp;
+
+	//the board config takes precedence -- SFDP fills in what it leaves out
+	state->page_program_size = config->opcode.page_program_size;
+	if( state->page_program_size == 0 ){
+		state->page_program_size = sfdp->page_program_size ? sfdp->page_program_size : DEFAULT_PAGE_PROGRAM_SIZE;
+	}
+
+	state->block_erase_opcode = config->opcode.block_erase;
+	state->block_erase_size = config->info.erase_block_size;
+	if( (state->block_erase_opcode == 0 || state->block_erase_opcode == 0xff) &&
+		 (sfdp->o_flags & DRIVE_CFI_SFDP_FLAG_IS_ERASE_4KB) ){
+		state->block_erase_opcode = sfdp->opcode_4kb_erase;
+		state->block_erase_size = 4096;
+	}
+
+	state->fast_read_opcode = config->opcode.fast_read;
+	state->read_dummy_cycles = config->opcode.read_dummy_cycles;
+	state->read_qspi_flags = 0;
+	if( state->fast_read_opcode == 0 || state->fast_read_opcode == 0xff ){
+		state->fast_read_opcode = CFI_COMMAND_FAST_READ;
+		state->read_dummy_cycles = 8;
+	}
+}
+
+int drive_cfi_sfdp_select_fast_read(const devfs_handle_t * handle, u32 o_data_flags){
+	const drive_cfi_config_t * config = handle->config;
+	drive_cfi_state_t * state = handle->state;
+	const drive_cfi_sfdp_t * sfdp = &state->sfdp;
+
+	//a fast read opcode in the board config is used as is
+	if( config->opcode.fast_read != 0 && config->opcode.fast_read != 0xff ){ return 0; }
+
+	//mode clocks are sent as dummy cycles
+	if( o_data_flags & QSPI_FLAG_IS_OPCODE_QUAD ){
+		//in QPI mode every phase uses four lines
+		if( sfdp->o_flags & DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_444 ){
+			state->fast_read_opcode = sfdp->opcode_fast_read_444;
+			state->read_dummy_cycles = sfdp->opcode_fast_read_444_wait_states + sfdp->opcode_fast_read_444_mode_bits;
+			state->read_qspi_flags = QSPI_FLAG_IS_OPCODE_QUAD | QSPI_FLAG_IS_ADDRESS_QUAD | QSPI_FLAG_IS_DATA_QUAD;
+			return 1;
+		}
+		return 0;
+	}
+
+	if( o_data_flags & QSPI_FLAG_IS_DATA_QUAD ){
+		if( sfdp->o_flags & DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_144 ){
+			state->fast_read_opcode = sfdp->opcode_fast_read_144;
+			state->read_dummy_cycles = sfdp->opcode_fast_read_144_wait_states + sfdp->opcode_fast_read_144_mode_bits;
+			state->read_qspi_flags = QSPI_FLAG_IS_ADDRESS_QUAD | QSPI_FLAG_IS_DATA_QUAD;
+			return 1;
+		}
+		if( sfdp->o_flags & DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_114 ){
+			state->fast_read_opcode = sfdp->opcode_fast_read_114;
+			state->read_dummy_cycles = sfdp->opcode_fast_read_114_wait_states + sfdp->opcode_fast_read_114_mode_bits;
+			state->read_qspi_flags = QSPI_FLAG_IS_DATA_QUAD;
+			return 1;
+		}
+	}
+
+	if( o_data_flags & (QSPI_FLAG_IS_DATA_QUAD | QSPI_FLAG_IS_DATA_DUAL) ){
+		if( sfdp->o_flags & DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_122 ){
+			state->fast_read_opcode = sfdp->opcode_fast_read_122;
+			state->read_dummy_cycles = sfdp->opcode_fast_read_122_wait_states + sfdp->opcode_fast_read_122_mode_bits;
+			state->read_qspi_flags = QSPI_FLAG_IS_ADDRESS_DUAL | QSPI_FLAG_IS_DATA_DUAL;
+			return 1;
+		}
+		if( sfdp->o_flags & DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_112 ){
+			state->fast_read_opcode = sfdp->opcode_fast_read_112;
+			state->read_dummy_cycles = sfdp->opcode_fast_read_112_wait_states + sfdp->opcode_fast_read_112_mode_bits;
+			state->read_qspi_flags = QSPI_FLAG_IS_DATA_DUAL;
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -1,9 +1,11 @@
 
+#include <string.h>
 #include "sos/dev/spi.h"
 #include "mcu/pio.h"
 #include "mcu/debug.h"
 
-#include "device/drive_cfi.h"
+#include "device/drive_erase_queue.h"
+#include "drive_cfi_local.h"
 
 #if 0
 enum cfi_instructions {
@@ -50,6 +52,11 @@ enum cfi_instructions {
 };
 #endif
 
+#define INSTRUCTION_READ_SFDP_REGISTER 0x5A
+
+//maximum number of status register reads while a page programs
+#define BUSY_POLL_MAX 100000
+
 static int drive_cfi_spi_write_instruction(
 		const devfs_handle_t * handle,
 		u8 instruction,
@@ -63,11 +70,21 @@ static int drive_cfi_spi_write_instruction_with_cs(
 		u8 data_size);
 
 static u8 drive_cfi_spi_read_status_with_cs(const devfs_handle_t * handle);
+static int drive_cfi_spi_read_sfdp(const devfs_handle_t * handle, u32 address, u8 * data, u8 nbyte);
+static void drive_cfi_spi_end_read(const devfs_handle_t * handle);
+static int drive_cfi_spi_program_page(const devfs_handle_t * handle);
+static void drive_cfi_spi_continue_program(const devfs_handle_t * handle);
+static void drive_cfi_spi_complete_program(const devfs_handle_t * handle, int result);
+static int drive_cfi_spi_start_status_poll(const devfs_handle_t * handle);
+static int drive_cfi_spi_erase_block(const devfs_handle_t * handle, u32 start, u32 end);
+static int drive_cfi_spi_is_busy(const devfs_handle_t * handle);
+static int drive_cfi_spi_service_erase(const devfs_handle_t * handle);
 
 static void drive_cfi_spi_initialize_cs(const devfs_handle_t * handle);
 static void drive_cfi_spi_assert_cs(const devfs_handle_t * handle);
 static void drive_cfi_spi_deassert_cs(const devfs_handle_t * handle);
 static int drive_cfi_spi_handle_complete(void * context, const mcu_event_t * event);
+static int drive_cfi_spi_handle_status(void * context, const mcu_event_t * event);
 static int drive_initialize(const devfs_handle_t * handle);
 
 int drive_cfi_spi_open(const devfs_handle_t * handle){
@@ -98,6 +115,18 @@ int drive_initialize(const devfs_handle_t * handle){
 
 		if( result < 0 ){ return result; }
 
+		state->is_read_open = 0;
+		state->program_async = 0;
+		drive_erase_queue_init(
+					&state->erase_queue,
+					handle,
+					drive_cfi_spi_erase_block,
+					drive_cfi_spi_is_busy,
+					config->erase_timer);
+		drive_cfi_sfdp_load(handle, &state->sfdp, drive_cfi_spi_read_sfdp);
+		//this driver has a single data line so only 1-1-1 fast read is usable
+		drive_cfi_sfdp_apply(handle);
+
 		drive_cfi_spi_write_instruction_with_cs(handle, config->opcode.write_enable, 0, 0);
 		drive_cfi_spi_write_instruction_with_cs(handle, config->opcode.unprotect, 0, 0);
 
@@ -113,18 +142,38 @@ int drive_initialize(const devfs_handle_t * handle){
 
 int drive_cfi_spi_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 	const drive_cfi_config_t * config = handle->config;
+	drive_cfi_state_t * state = handle->state;
 	drive_attr_t * attr = ctl;
 	drive_info_t * info = ctl;
-	u8 status;
+	int result;
+
+	//any instruction ends a continuous read
+	drive_cfi_spi_end_read(handle);
 
 	switch(request){
 		case I_DRIVE_GETVERSION: return DRIVE_VERSION;
 
+		case I_DRIVE_SETACTION:
+			drive_erase_queue_set_action(&state->erase_queue, ctl);
+			return SYSFS_RETURN_SUCCESS;
+
 		case I_DRIVE_SETATTR:
 			{
 				if( attr == 0 ){ return SYSFS_SET_RETURN(EINVAL); }
 				u32 o_flags = attr->o_flags;
 
+				if( (o_flags & DRIVE_FLAG_ERASE_BLOCKS) && (o_flags & DRIVE_FLAG_ERASE_ASYNC) ){
+					result = drive_erase_queue_push(&state->erase_queue, attr->start, attr->end);
+					if( result < 0 ){ return result; }
+					result = drive_cfi_spi_service_erase(handle);
+					return result < 0 ? result : SYSFS_RETURN_SUCCESS;
+				}
+
+				//other operations wait for the queued erases
+				if( drive_cfi_spi_service_erase(handle) != 0 ){
+					return SYSFS_SET_RETURN(EBUSY);
+				}
+
 				if( o_flags & DRIVE_FLAG_INIT ){
 					int result;
 					//set serial driver attributes to defaults
@@ -157,13 +206,7 @@ int drive_cfi_spi_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 
 				if( o_flags & DRIVE_FLAG_ERASE_BLOCKS ){
 					//erase the smallest possible section size
-					u8 address[3];
-					address[0] = attr->start >> 16;
-					address[1] = attr->start >> 8;
-					address[2] = attr->start;
-					drive_cfi_spi_write_instruction_with_cs(handle, config->opcode.write_enable, 0, 0);
-					drive_cfi_spi_write_instruction_with_cs(handle, config->opcode.block_erase, address, sizeof(address));
-					return config->info.erase_block_size;
+					return drive_cfi_spi_erase_block(handle, attr->start, attr->end);
 				}
 
 				if( o_flags & DRIVE_FLAG_ERASE_DEVICE ){
@@ -182,6 +225,7 @@ int drive_cfi_spi_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 					DRIVE_FLAG_UNPROTECT |
 					DRIVE_FLAG_ERASE_BLOCKS |
 					DRIVE_FLAG_ERASE_DEVICE |
+					DRIVE_FLAG_ERASE_ASYNC |
 					DRIVE_FLAG_POWERUP |
 					DRIVE_FLAG_POWERDOWN |
 					0;
@@ -190,20 +234,18 @@ int drive_cfi_spi_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 			info->addressable_size = config->info.addressable_size; //one byte for each address location
 			info->write_block_size = config->info.write_block_size; //can write one byte at a time
 			info->num_write_blocks = config->info.num_write_blocks;
-			info->erase_block_size = config->info.erase_block_size;
+			info->erase_block_size = state->block_erase_size;
 			info->erase_block_time = config->info.erase_block_time;
 			info->erase_device_time = config->info.erase_device_time;
 			info->bitrate = config->info.bitrate;
-			info->page_program_size = config->opcode.page_program_size;
+			info->page_program_size = state->page_program_size;
 			break;
 
 		case I_DRIVE_ISBUSY:
-			status = drive_cfi_spi_read_status_with_cs(handle);
-			if( (status & config->opcode.busy_status_mask) != 0 ){
-				//device is busy
-				return 1;
-			}
-			break;
+			//this also starts the next queued erase
+			result = drive_cfi_spi_service_erase(handle);
+			if( result != 0 ){ return result; }
+			return drive_cfi_spi_is_busy(handle);
 
 	}
 
@@ -212,18 +254,135 @@ int drive_cfi_spi_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 
 int drive_cfi_spi_handle_complete(void * context, const mcu_event_t * event){
 	const devfs_handle_t * handle = context;
+	const drive_cfi_config_t * config = handle->config;
 	drive_cfi_state_t * state = handle->state;
 
 	//operation is complete
 
-	//deassert the cs
-	drive_cfi_spi_deassert_cs(handle);
+	if( state->program_async ){
+		//deassert the cs to start programming the page that was just sent
+		drive_cfi_spi_deassert_cs(handle);
+		if( event->o_events & (MCU_EVENT_FLAG_CANCELED | MCU_EVENT_FLAG_ERROR) ){
+			drive_cfi_spi_complete_program(handle, 0);
+		} else {
+			drive_cfi_spi_continue_program(handle);
+		}
+		return 0;
+	}
+
+	//a read -- leave CS asserted if the next sequential read can continue the stream
+	//queued erases need the bus so they end the stream
+	if( (config->o_flags & DRIVE_CFI_CONFIG_FLAG_IS_CONTINUOUS_READ) &&
+		 ((event->o_events & (MCU_EVENT_FLAG_CANCELED | MCU_EVENT_FLAG_ERROR)) == 0) &&
+		 (drive_erase_queue_is_active(&state->erase_queue) == 0) ){
+		state->is_read_open = 1;
+	} else {
+		drive_cfi_spi_deassert_cs(handle);
+	}
 
 	devfs_execute_event_handler(&state->handler, MCU_EVENT_FLAG_WRITE_COMPLETE | MCU_EVENT_FLAG_DATA_READY, 0);
 	state->handler.callback = 0;
+
+	//start the next queued erase
+	drive_erase_queue_resume(&state->erase_queue);
+	return 0;
+}
+
+int drive_cfi_spi_handle_status(void * context, const mcu_event_t * event){
+	const devfs_handle_t * handle = context;
+	const drive_cfi_config_t * config = handle->config;
+	drive_cfi_state_t * state = handle->state;
+	int result;
+
+	if( event->o_events & (MCU_EVENT_FLAG_CANCELED | MCU_EVENT_FLAG_ERROR) ){
+		drive_cfi_spi_deassert_cs(handle);
+		drive_cfi_spi_complete_program(handle, SYSFS_SET_RETURN(EIO));
+		return 0;
+	}
+
+	if( state->status & config->opcode.busy_status_mask ){
+		//the device repeats the status register for as long as CS is asserted
+		state->busy_poll_count++;
+		if( (state->busy_poll_count < BUSY_POLL_MAX) &&
+			 (config->serial_device->driver.read(&config->serial_device->handle, &state->status_async) == 0) ){
+			return 1;
+		}
+		drive_cfi_spi_deassert_cs(handle);
+		drive_cfi_spi_complete_program(handle, SYSFS_SET_RETURN(EIO));
+		return 0;
+	}
+
+	drive_cfi_spi_deassert_cs(handle);
+	result = drive_cfi_spi_program_page(handle);
+	if( result > 0 ){
+		//the serial driver finished the page synchronously
+		drive_cfi_spi_continue_program(handle);
+	} else if( result < 0 ){
+		drive_cfi_spi_complete_program(handle, result);
+	}
+	return 0;
+}
+
+void drive_cfi_spi_continue_program(const devfs_handle_t * handle){
+	drive_cfi_state_t * state = handle->state;
+
+	state->program_buffer += state->program_page_nbyte;
+	state->program_address += state->program_page_nbyte;
+	state->program_remaining -= state->program_page_nbyte;
+	if( state->program_remaining <= 0 ){
+		drive_cfi_spi_complete_program(handle, 0);
+		return;
+	}
+
+	//the next page can't be programmed until the device finishes this one
+	if( drive_cfi_spi_start_status_poll(handle) < 0 ){
+		drive_cfi_spi_complete_program(handle, SYSFS_SET_RETURN(EIO));
+	}
+}
+
+int drive_cfi_spi_start_status_poll(const devfs_handle_t * handle){
+	const drive_cfi_config_t * config = handle->config;
+	drive_cfi_state_t * state = handle->state;
+	devfs_async_t * async = &state->status_async;
+
+	//each status byte is read in the serial interrupt and checked by drive_cfi_spi_handle_status()
+	drive_cfi_spi_assert_cs(handle);
+	drive_cfi_spi_write_instruction(handle, config->opcode.read_busy_status, 0, 0);
+
+	state->busy_poll_count = 0;
+	memset(async, 0, sizeof(devfs_async_t));
+	async->tid = state->program_async->tid;
+	async->flags = state->program_async->flags;
+	async->buf = &state->status;
+	async->nbyte = 1;
+	async->handler.callback = drive_cfi_spi_handle_status;
+	async->handler.context = (void*)handle;
+	if( config->serial_device->driver.read(&config->serial_device->handle, async) != 0 ){
+		drive_cfi_spi_deassert_cs(handle);
+		return SYSFS_SET_RETURN(EIO);
+	}
 	return 0;
 }
 
+void drive_cfi_spi_complete_program(const devfs_handle_t * handle, int result){
+	drive_cfi_state_t * state = handle->state;
+	devfs_async_t * async = state->program_async;
+
+	//report everything that was programmed to the caller
+	state->program_async = 0;
+	async->nbyte = state->program_nbyte - state->program_remaining;
+	if( (async->nbyte == 0) && (result < 0) ){
+		async->nbyte = result;
+	}
+	async->handler = state->handler;
+
+	devfs_execute_event_handler(&state->handler, MCU_EVENT_FLAG_WRITE_COMPLETE | MCU_EVENT_FLAG_DATA_READY, 0);
+	state->handler.callback = 0;
+
+	//start the next queued erase
+	drive_erase_queue_resume(&state->erase_queue);
+}
+
 int drive_cfi_spi_read(const devfs_handle_t * handle, devfs_async_t * async){
 	int result;
 	const drive_cfi_config_t * config = handle->config;
@@ -242,31 +401,83 @@ int drive_cfi_spi_read(const devfs_handle_t * handle, devfs_async_t * async){
 	//is device already busy?
 	if( state->handler.callback != 0 ){ return SYSFS_SET_RETURN(EBUSY); }
 
-	//assert CS for the page program and data write
-	drive_cfi_spi_assert_cs(handle);
+	//reads use the array between queued erases
+	if( drive_erase_queue_pause(&state->erase_queue) != 0 ){ return SYSFS_SET_RETURN(EBUSY); }
 
-	//read instruction
 	u32 address = async->loc & 0x00ffffff;
-	u8 fast_read[4];
-	fast_read[0] = address >> 16;
-	fast_read[1] = address >> 8;
-	fast_read[2] = address;
-	fast_read[3] = 0; //dummy byte
-	drive_cfi_spi_write_instruction(handle, config->opcode.fast_read, fast_read, sizeof(fast_read));
+	if( (state->is_read_open == 0) || (state->read_address != address) ){
+		drive_cfi_spi_end_read(handle);
+
+		//assert CS for the read instruction and the data
+		drive_cfi_spi_assert_cs(handle);
+
+		//read instruction
+		u8 fast_read[4];
+		fast_read[0] = address >> 16;
+		fast_read[1] = address >> 8;
+		fast_read[2] = address;
+		fast_read[3] = 0; //dummy byte
+		drive_cfi_spi_write_instruction(handle, state->fast_read_opcode, fast_read, sizeof(fast_read));
+	}
+
+	//an open read continues from here after this transfer completes
+	state->is_read_open = 0;
+	state->read_address = address + async->nbyte;
 
 	//hi-jack the callback handler and restore it laster
+	state->program_async = 0;
 	state->handler = async->handler;
 	async->handler.callback = drive_cfi_spi_handle_complete;
 	async->handler.context = (void*)handle;
 	result = config->serial_device->driver.read(&config->serial_device->handle, async);
 	if( result != 0 ){
 		drive_cfi_spi_deassert_cs(handle);
+		state->handler.callback = 0;
+		drive_erase_queue_resume(&state->erase_queue);
 	}
 
 	return result;
 }
 
+int drive_cfi_spi_program_page(const devfs_handle_t * handle){
+	int result;
+	const drive_cfi_config_t * config = handle->config;
+	drive_cfi_state_t * state = handle->state;
+	devfs_async_t * async = state->program_async;
+	u32 page_size = state->page_program_size;
+	u32 page_program_mask = page_size-1;
+
+	//program up to the end of the page that holds the address
+	state->program_page_nbyte = page_size - (state->program_address & page_program_mask);
+	if( state->program_page_nbyte > state->program_remaining ){
+		state->program_page_nbyte = state->program_remaining;
+	}
+
+	//write enable instruction
+	drive_cfi_spi_write_instruction_with_cs(handle, config->opcode.write_enable, 0, 0);
+
+	//assert CS for the page program and data write
+	drive_cfi_spi_assert_cs(handle);
+
+	//page program instruction
+	u32 address = state->program_address & 0x00ffffff;
+	u8 page_program[3];
+	page_program[0] = address >> 16;
+	page_program[1] = address >> 8;
+	page_program[2] = address;
+	drive_cfi_spi_write_instruction(handle, config->opcode.page_program, page_program, sizeof(page_program));
 
+	//the serial driver writes just this page and calls back to the state machine
+	async->buf_const = state->program_buffer;
+	async->nbyte = state->program_page_nbyte;
+	async->handler.callback = drive_cfi_spi_handle_complete;
+	async->handler.context = (void*)handle;
+	result = config->serial_device->driver.write(&config->serial_device->handle, async);
+	if( result != 0 ){
+		drive_cfi_spi_deassert_cs(handle);
+	}
+	return result;
+}
 
 int drive_cfi_spi_write(const devfs_handle_t * handle, devfs_async_t * async){
 	int result;
@@ -286,41 +497,37 @@ int drive_cfi_spi_write(const devfs_handle_t * handle, devfs_async_t * async){
 	//is device already busy?
 	if( state->handler.callback != 0 ){ return SYSFS_SET_RETURN(EBUSY); }
 
-	u32 page_size = config->opcode.page_program_size;
-	u32 page_program_mask = page_size-1;
+	drive_cfi_spi_end_read(handle);
 
-	if( ((async->loc & page_program_mask) + async->nbyte) > page_size ){
-		//allow a partial page program but don't allow overflow
-		async->nbyte = page_size - (async->loc & page_program_mask);
+	//pages can be programmed between queued erases if they are outside the queued ranges
+	if( drive_erase_queue_is_queued(&state->erase_queue, async->loc, async->loc + num_blocks - 1) ){
+		return SYSFS_SET_RETURN(EBUSY);
 	}
+	if( drive_erase_queue_pause(&state->erase_queue) != 0 ){ return SYSFS_SET_RETURN(EBUSY); }
 
-	//write enable instruction
-	drive_cfi_spi_write_instruction_with_cs(handle, config->opcode.write_enable, 0, 0);
-
-	//assert CS for the page program and data write
-	drive_cfi_spi_assert_cs(handle);
+	//the completion callback programs one page after another until all bytes are written
+	state->program_async = async;
+	state->program_buffer = async->buf_const;
+	state->program_address = async->loc;
+	state->program_nbyte = async->nbyte;
+	state->program_remaining = async->nbyte;
 
-	//page program instruction
-	u32 address = async->loc & 0x00ffffff;
-	u8 page_program[3];
-	page_program[0] = address >> 16;
-	page_program[1] = address >> 8;
-	page_program[2] = address;
-	drive_cfi_spi_write_instruction(handle, config->opcode.page_program, page_program, sizeof(page_program));
-
-	//hi-jack the callback handler and restore it laster
+	//hi-jack the callback handler and restore it when the last page is done
 	state->handler = async->handler;
-	async->handler.callback = drive_cfi_spi_handle_complete;
-	async->handler.context = (void*)handle;
-	result = config->serial_device->driver.write(&config->serial_device->handle, async);
+	result = drive_cfi_spi_program_page(handle);
 	if( result != 0 ){
-		drive_cfi_spi_deassert_cs(handle);
+		//nothing is pending -- on a synchronous first page the caller writes the remaining pages
+		state->program_async = 0;
+		async->handler = state->handler;
+		state->handler.callback = 0;
+		drive_erase_queue_resume(&state->erase_queue);
 	}
 	return result;
 }
 
 int drive_cfi_spi_close(const devfs_handle_t * handle){
 	drive_cfi_state_t * state = handle->state;
+	drive_cfi_spi_end_read(handle);
 	if( state->is_initialized ){
 		state->is_initialized--;
 		if( state->is_initialized == 0 ){
@@ -406,3 +613,49 @@ int drive_cfi_spi_write_instruction(
 
 	return 0;
 }
+
+int drive_cfi_spi_erase_block(const devfs_handle_t * handle, u32 start, u32 end){
+	const drive_cfi_config_t * config = handle->config;
+	drive_cfi_state_t * state = handle->state;
+	u8 address[3];
+	address[0] = start >> 16;
+	address[1] = start >> 8;
+	address[2] = start;
+	drive_cfi_spi_write_instruction_with_cs(handle, config->opcode.write_enable, 0, 0);
+	drive_cfi_spi_write_instruction_with_cs(handle, state->block_erase_opcode, address, sizeof(address));
+	return state->block_erase_size;
+}
+
+int drive_cfi_spi_is_busy(const devfs_handle_t * handle){
+	const drive_cfi_config_t * config = handle->config;
+	u8 status = drive_cfi_spi_read_status_with_cs(handle);
+	return (status & config->opcode.busy_status_mask) != 0;
+}
+
+int drive_cfi_spi_service_erase(const devfs_handle_t * handle){
+	drive_cfi_state_t * state = handle->state;
+	return drive_erase_queue_service(&state->erase_queue);
+}
+
+void drive_cfi_spi_end_read(const devfs_handle_t * handle){
+	drive_cfi_state_t * state = handle->state;
+	if( state->is_read_open ){
+		drive_cfi_spi_deassert_cs(handle);
+		state->is_read_open = 0;
+	}
+}
+
+int drive_cfi_spi_read_sfdp(const devfs_handle_t * handle, u32 address, u8 * data, u8 nbyte){
+	u8 buffer[4 + DRIVE_CFI_SFDP_BASIC_TABLE_WORDS*sizeof(u32)];
+	if( nbyte > sizeof(buffer) - 4 ){
+		return SYSFS_SET_RETURN(EINVAL);
+	}
+	buffer[0] = address >> 16;
+	buffer[1] = address >> 8;
+	buffer[2] = address;
+	buffer[3] = 0; //dummy byte
+	memset(buffer + 4, 0xff, nbyte);
+	drive_cfi_spi_write_instruction_with_cs(handle, INSTRUCTION_READ_SFDP_REGISTER, buffer, nbyte + 4);
+	memcpy(data, buffer + 4, nbyte);
+	return nbyte;
+}
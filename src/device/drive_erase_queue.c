@@ -0,0 +1,200 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include <errno.h>
+#include "sos/dev/tmr.h"
+#include "device/drive_erase_queue.h"
+
+static int service(drive_erase_queue_t * queue);
+static void start_timer(drive_erase_queue_t * queue);
+static int handle_timer(void * context, const mcu_event_t * event);
+static void complete(drive_erase_queue_t * queue, u32 o_events);
+
+void drive_erase_queue_init(
+		drive_erase_queue_t * queue,
+		const devfs_handle_t * handle,
+		drive_erase_queue_erase_t erase,
+		drive_erase_queue_is_busy_t is_busy,
+		const drive_erase_queue_timer_config_t * timer
+		){
+	drive_erase_queue_cancel(queue);
+	queue->handle = handle;
+	queue->erase = erase;
+	queue->is_busy = is_busy;
+	queue->timer = timer;
+	queue->is_erasing = 0;
+	queue->is_locked = 0;
+	queue->yield_count = 0;
+}
+
+int drive_erase_queue_push(drive_erase_queue_t * queue, u32 start, u32 end){
+	drive_erase_range_t * range;
+	if( queue->erase == 0 ){ return SYSFS_SET_RETURN(EIO); }
+	if( end < start ){ return SYSFS_SET_RETURN(EINVAL); }
+	if( queue->count == DRIVE_ERASE_QUEUE_SIZE ){ return SYSFS_SET_RETURN(EAGAIN); }
+	range = queue->range + ((queue->head + queue->count) % DRIVE_ERASE_QUEUE_SIZE);
+	range->next = start;
+	range->end = end;
+	queue->count++;
+	return 0;
+}
+
+int drive_erase_queue_service(drive_erase_queue_t * queue){
+	int result;
+
+	if( drive_erase_queue_is_active(queue) == 0 ){ return 0; }
+
+	//a transfer or a check in the timer interrupt is using the bus
+	if( queue->is_locked ){ return 1; }
+
+	queue->is_locked = 1;
+	result = service(queue);
+	queue->is_locked = 0;
+
+	if( result > 0 ){
+		start_timer(queue);
+	}
+	return result;
+}
+
+int drive_erase_queue_pause(drive_erase_queue_t * queue){
+	//lock first so the timer can't start an erase while the drive is checked
+	queue->is_locked = 1;
+	if( queue->is_erasing && queue->is_busy(queue->handle) ){
+		//hold the next erase so the caller can retry between erases
+		queue->yield_count = DRIVE_ERASE_QUEUE_YIELD_COUNT;
+		queue->is_locked = 0;
+		return 1;
+	}
+	queue->yield_count = 0;
+	return 0;
+}
+
+void drive_erase_queue_resume(drive_erase_queue_t * queue){
+	queue->is_locked = 0;
+	drive_erase_queue_service(queue);
+}
+
+int drive_erase_queue_is_queued(const drive_erase_queue_t * queue, u32 start, u32 end){
+	const drive_erase_range_t * range;
+	u8 i;
+	for(i=0; i < queue->count; i++){
+		range = queue->range + ((queue->head + i) % DRIVE_ERASE_QUEUE_SIZE);
+		if( (start <= range->end) && (end >= range->next) ){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void drive_erase_queue_set_action(drive_erase_queue_t * queue, const mcu_action_t * action){
+	queue->handler = action->handler;
+}
+
+void drive_erase_queue_cancel(drive_erase_queue_t * queue){
+	//an erase that has already started runs to completion in the drive
+	queue->count = 0;
+	queue->head = 0;
+}
+
+int service(drive_erase_queue_t * queue){
+	drive_erase_range_t * range;
+	int result;
+
+	if( queue->is_erasing && queue->is_busy(queue->handle) ){
+		//the erase that was started last is still running
+		return 1;
+	}
+
+	if( queue->count ){
+		if( queue->yield_count ){
+			//a read is waiting to use the drive between erases
+			queue->yield_count--;
+			return 1;
+		}
+
+		range = queue->range + queue->head;
+		result = queue->erase(queue->handle, range->next, range->end);
+		if( result <= 0 ){
+			drive_erase_queue_cancel(queue);
+			complete(queue, MCU_EVENT_FLAG_ERROR);
+			return result < 0 ? result : SYSFS_SET_RETURN(EIO);
+		}
+
+		if( (u32)result > range->end - range->next ){
+			//this erase covers the rest of the range
+			queue->head = (queue->head + 1) % DRIVE_ERASE_QUEUE_SIZE;
+			queue->count--;
+		} else {
+			range->next += result;
+		}
+		queue->is_erasing = 1;
+		return 1;
+	}
+
+	//the last erase is done and nothing else is queued
+	complete(queue, MCU_EVENT_FLAG_WRITE_COMPLETE);
+	return 0;
+}
+
+void start_timer(drive_erase_queue_t * queue){
+	const drive_erase_queue_timer_config_t * timer = queue->timer;
+	mcu_action_t action;
+	mcu_channel_t channel;
+	u32 now = 0;
+
+	if( (timer == 0) || (timer->device == 0) ){ return; }
+
+	timer->device->driver.ioctl(&timer->device->handle, I_TMR_GET, &now);
+	channel.loc = timer->channel;
+	channel.value = now + timer->interval;
+	if( timer->period && (channel.value >= timer->period) ){
+		channel.value -= timer->period;
+	}
+
+	action.channel = timer->channel;
+	action.prio = 0;
+	action.o_events = MCU_EVENT_FLAG_MATCH;
+	action.handler.callback = handle_timer;
+	action.handler.context = queue;
+	timer->device->driver.ioctl(&timer->device->handle, I_TMR_SETCHANNEL, &channel);
+	timer->device->driver.ioctl(&timer->device->handle, I_TMR_SETACTION, &action);
+}
+
+int handle_timer(void * context, const mcu_event_t * event){
+	MCU_UNUSED_ARGUMENT(event);
+	drive_erase_queue_t * queue = context;
+
+	if( drive_erase_queue_is_active(queue) == 0 ){ return 0; }
+
+	if( queue->is_locked ){
+		//the transfer that holds the bus continues the queue when it is done
+		start_timer(queue);
+		return 1;
+	}
+
+	//this starts the timer again while the queue is active
+	return drive_erase_queue_service(queue) > 0;
+}
+
+void complete(drive_erase_queue_t * queue, u32 o_events){
+	queue->is_erasing = 0;
+	queue->yield_count = 0;
+	devfs_execute_event_handler(&queue->handler, o_events, 0);
+}
@@ -44,11 +44,25 @@
 #define FLAG_PROTECTED (1<<0)
 #define FLAG_SDSC (1<<1)
 
+//what to do when the card stops driving the busy signal
+#define BUSY_ACTION_NEXT_BLOCK 0
+#define BUSY_ACTION_COMPLETE 1
+
+//maximum number of CMD_FRAME_SIZE reads while the card is busy
+#define BUSY_TIMEOUT 5000
+
 
 static int is_sdsc(const devfs_handle_t * handle);
 
 static int erase_blocks(const devfs_handle_t * handle, uint32_t block_num, uint32_t end_block);
 static int is_busy(const devfs_handle_t * handle);
+static int is_erase_busy(const devfs_handle_t * handle);
+static int begin_transfer(const devfs_handle_t * handle);
+static int end_transfer(const devfs_handle_t * handle, int result);
+static int start_read(const devfs_handle_t * handle, devfs_async_t * rop);
+static int start_write(const devfs_handle_t * handle, devfs_async_t * wop);
+static int erase_queued_blocks(const devfs_handle_t * handle, u32 block_num, u32 end_block);
+static int service_erase(const devfs_handle_t * handle);
 static int get_status(const devfs_handle_t * handle, uint8_t * buf);
 static int exec_csd(const devfs_handle_t * handle, uint8_t * buf);
 
@@ -68,6 +82,13 @@ static int spi_transfer(const devfs_handle_t * handle, const uint8_t * data_out,
 static int try_read(const devfs_handle_t * handle, int first);
 static int continue_spi_read(void * handle, const mcu_event_t * ignore);
 static int continue_spi_write(void * handle, const mcu_event_t * ignore);
+static int continue_spi_busy(void * handle, const mcu_event_t * ignore);
+static int start_block_write(const devfs_handle_t * handle);
+static int start_busy_poll(const devfs_handle_t * handle, int action, int err, int nbyte);
+static void complete_write(const devfs_handle_t * handle, int err);
+static void stop_transmission(const devfs_handle_t * handle);
+static char * get_block_buffer(drive_sdspi_state_t * state);
+static int check_r1(drive_sdspi_r1_t r1);
 
 static void deassert_chip_select(const devfs_handle_t * handle){
 	const drive_sdspi_config_t * config = handle->config;
@@ -128,6 +149,9 @@ void state_callback(const devfs_handle_t * handle, int err, int nbyte){
 		state->handler.callback(state->handler.context, 0);
 		state->handler.callback = 0;
 	}
+
+	//start the next queued erase
+	drive_erase_queue_resume(&state->erase_queue);
 }
 
 int continue_spi_read(void * handle, const mcu_event_t * ignore){
@@ -141,6 +165,10 @@ int continue_spi_read(void * handle, const mcu_event_t * ignore){
 		state->timeout++;
 		if( state->timeout > 5000 ){
 			//failed to read the data
+			if( state->block_total > 1 ){
+				stop_transmission(handle);
+				return start_busy_poll(handle, BUSY_ACTION_COMPLETE, EIO, -2);
+			}
 			deassert_chip_select(handle);
 			state_callback(handle, EIO, -2);
 			return 0;
@@ -150,19 +178,37 @@ int continue_spi_read(void * handle, const mcu_event_t * ignore){
 		return try_read(handle, 0);
 
 	} else {
-		//the read is complete
+		//the block is complete
 		int err = 0;
-		spi_transfer(handle, 0, state->cmd, CMD_FRAME_SIZE); //gobble up the CRC
+		if( state->block_total > 1 ){
+			//only the CRC -- the next start token can follow right after it
+			spi_transfer(handle, 0, state->cmd, 2);
+		} else {
+			spi_transfer(handle, 0, state->cmd, CMD_FRAME_SIZE); //gobble up the CRC
+		}
 		checksum = (state->cmd[0] << 8) + state->cmd[1];
-		checksum_calc = mcu_calc_crc16(0x0000, 0x1021, (const uint8_t *)state->buf, (size_t)*(state->nbyte));
+		checksum_calc = mcu_calc_crc16(0x0000, 0x1021, (const uint8_t *)get_block_buffer(state), BLOCK_SIZE);
 		if( checksum != checksum_calc ){
 			mcu_debug_printf("Bad checksum 0x%04X != 0x%04X\n", checksum, checksum_calc);
-			*(state->nbyte) = -1;
 			err = EINVAL;
 		}
 
+		state->block_count++;
+		if( (err == 0) && (state->block_count < state->block_total) ){
+			//look for the start token of the next block
+			memset(state->cmd, 0xFF, CMD_FRAME_SIZE);
+			state->timeout = 0;
+			return try_read(handle, 0);
+		}
+
+		if( state->block_total > 1 ){
+			//the callback executes when the card is no longer busy
+			stop_transmission(handle);
+			return start_busy_poll(handle, BUSY_ACTION_COMPLETE, err, err ? -1 : (int)(state->block_count * BLOCK_SIZE));
+		}
+
 		//execute the callback
-		state_callback(handle, err, *(state->nbyte));
+		state_callback(handle, err, err ? -1 : (int)(state->block_count * BLOCK_SIZE));
 	}
 
 	return 0;
@@ -171,10 +217,11 @@ int continue_spi_read(void * handle, const mcu_event_t * ignore){
 int try_read(const devfs_handle_t * handle, int first){
 	int ret;
 	drive_sdspi_state_t * state = handle->state;
-	state->count = parse_data((uint8_t*)state->buf, *(state->nbyte), -1, SDSPI_START_BLOCK_TOKEN, state->cmd);
+	char * buf = get_block_buffer(state);
+	state->count = parse_data((uint8_t*)buf, BLOCK_SIZE, -1, SDSPI_START_BLOCK_TOKEN, state->cmd);
 	if( state->count >= 0 ){
-		state->op.nbyte = *(state->nbyte) - state->count;
-		state->op.buf = (void*)&(state->buf[state->count]);
+		state->op.nbyte = BLOCK_SIZE - state->count;
+		state->op.buf = buf + state->count;
 	} else {
 		state->op.nbyte = CMD_FRAME_SIZE;
 		state->op.buf = state->cmd;
@@ -201,25 +248,35 @@ int try_read(const devfs_handle_t * handle, int first){
 }
 
 int drive_sdspi_read(const devfs_handle_t * handle, devfs_async_t * rop){
-	//first write the header command
-	drive_sdspi_state_t * state = handle->state;
-	drive_sdspi_r1_t r1;
-	u32 loc;
+	int result;
 
-	if( rop->nbyte != BLOCK_SIZE ){
+	if( (rop->nbyte < BLOCK_SIZE) || (rop->nbyte % BLOCK_SIZE) ){
 		return SYSFS_SET_RETURN(EINVAL);
 	}
 
-	if( is_busy(handle) != 0 ){
-		return SYSFS_SET_RETURN(EBUSY);
+	//reads use the card between queued erases
+	if( (result = begin_transfer(handle)) < 0 ){
+		return result;
 	}
 
+	return end_transfer(handle, start_read(handle, rop));
+}
+
+int start_read(const devfs_handle_t * handle, devfs_async_t * rop){
+	//first write the header command
+	drive_sdspi_state_t * state = handle->state;
+	drive_sdspi_r1_t r1;
+	u32 loc;
+	int result;
+
 	state->handler.context = rop->handler.context;
 	state->handler.callback = rop->handler.callback;
 	state->nbyte = &(rop->nbyte);
 	state->buf = rop->buf;
 	state->timeout = 0;
 	state->op.tid = rop->tid;
+	state->block_count = 0;
+	state->block_total = rop->nbyte / BLOCK_SIZE;
 
 	if( is_sdsc(handle) ){
 		loc = rop->loc*BLOCK_SIZE;
@@ -227,29 +284,14 @@ int drive_sdspi_read(const devfs_handle_t * handle, devfs_async_t * rop){
 		loc = rop->loc;
 	}
 
-	r1 = exec_cmd_r1(handle, SDSPI_CMD17_READ_SINGLE_BLOCK, loc, state->cmd);
-	if( r1.u8 != 0x00 ){
-		if( (r1.param_error) ){
-			return SYSFS_SET_RETURN(EINVAL);
-		}
-
-		if( (r1.addr_error) ){
-			return SYSFS_SET_RETURN(EINVAL);
-		}
-
-		if( (r1.erase_sequence_error) ){
-			return SYSFS_SET_RETURN(EINVAL);
-		}
-
-		if( (r1.crc_error) ){
-			return SYSFS_SET_RETURN(EINVAL);
-		}
-
-		if( (r1.illegal_command) ){
-			return SYSFS_SET_RETURN(EINVAL);
-		}
-
-		return SYSFS_SET_RETURN(EIO);
+	r1 = exec_cmd_r1(
+				handle,
+				state->block_total > 1 ? SDSPI_CMD18_READ_MULTIPLE_BLOCK : SDSPI_CMD17_READ_SINGLE_BLOCK,
+				loc,
+				state->cmd
+				);
+	if( (result = check_r1(r1)) < 0 ){
+		return result;
 	}
 
 	assert_chip_select(handle);
@@ -267,7 +309,7 @@ int continue_spi_write(void * handle, const mcu_event_t * ignore){
 	uint16_t checksum;
 
 	//calculate and write the checksum
-	checksum = mcu_calc_crc16(0x0000,  0x1021, (const uint8_t*)state->buf, *(state->nbyte));
+	checksum = mcu_calc_crc16(0x0000,  0x1021, (const uint8_t*)get_block_buffer(state), BLOCK_SIZE);
 
 	//finish the write
 	state->cmd[0] = checksum >> 8;
@@ -276,41 +318,151 @@ int continue_spi_write(void * handle, const mcu_event_t * ignore){
 	state->cmd[3] = 0xFF;
 	state->cmd[4] = 0xFF;
 	spi_transfer(handle, state->cmd, state->cmd, 5); //send dummy CRC
-	deassert_chip_select(handle);
 
+	if( state->block_total == 1 ){
+		deassert_chip_select(handle);
+		if( (state->cmd[2] & 0x1F) == 0x05 ){
+			//data was accepted
+			state_callback(handle, 0, BLOCK_SIZE);
+		} else {
+			//data was not accepted
+			state_callback(handle, EIO, -1);
+		}
+		return 0;
+	}
 
 	if( (state->cmd[2] & 0x1F) == 0x05 ){
-		//data was accepted
-		state_callback(handle, 0, *(state->nbyte));
-	} else {
-		//data was not accepted
-		state_callback(handle, EIO, -1);
+		//the card holds the line low while it programs the block -- poll without blocking the interrupt
+		return start_busy_poll(handle, BUSY_ACTION_NEXT_BLOCK, 0, 0);
 	}
 
+	//data was not accepted -- end the transmission
+	complete_write(handle, EIO);
 	return 0;
 }
 
+int continue_spi_busy(void * handle, const mcu_event_t * ignore){
+	MCU_UNUSED_ARGUMENT(ignore);
+	drive_sdspi_state_t * state = ((const devfs_handle_t *)handle)->state;
 
-int drive_sdspi_write(const devfs_handle_t * handle, devfs_async_t * wop){
+	//the card drives 0x00 until it is done
+	if( state->cmd[CMD_FRAME_SIZE-1] != 0xFF ){
+		state->timeout++;
+		if( state->timeout > BUSY_TIMEOUT ){
+			deassert_chip_select(handle);
+			state_callback(handle, EIO, -1);
+			return 0;
+		}
+
+		if( mcu_spi_read(handle, &(state->op)) != 0 ){
+			deassert_chip_select(handle);
+			state_callback(handle, EIO, -1);
+			return 0;
+		}
+		return 1;
+	}
+
+	if( state->busy_action == BUSY_ACTION_COMPLETE ){
+		deassert_chip_select(handle);
+		state_callback(handle, state->busy_err, state->busy_nbyte);
+		return 0;
+	}
+
+	//the block has been programmed
+	state->block_count++;
+	if( state->block_count < state->block_total ){
+		if( start_block_write(handle) != 0 ){
+			complete_write(handle, EIO);
+		}
+		return 0;
+	}
+
+	complete_write(handle, 0);
+	return 0;
+}
+
+int start_busy_poll(const devfs_handle_t * handle, int action, int err, int nbyte){
 	drive_sdspi_state_t * state = handle->state;
-	drive_sdspi_r1_t r1;
-	u32 loc;
 
+	state->busy_action = action;
+	state->busy_err = err;
+	state->busy_nbyte = nbyte;
+	state->timeout = 0;
+
+	//each read completes in the SPI interrupt and is checked by continue_spi_busy()
+	memset(state->cmd, 0x00, CMD_FRAME_SIZE);
+	state->op.nbyte = CMD_FRAME_SIZE;
+	state->op.buf = state->cmd;
+	state->op.handler.context = (void*)handle;
+	state->op.handler.callback = continue_spi_busy;
+	if( mcu_spi_read(handle, &(state->op)) != 0 ){
+		deassert_chip_select(handle);
+		state_callback(handle, EIO, -1);
+		return 0;
+	}
+	return 1;
+}
+
+void complete_write(const devfs_handle_t * handle, int err){
+	drive_sdspi_state_t * state = handle->state;
+
+	//the stop token (multi-block only) is followed by another busy period
+	state->cmd[0] = SDSPI_STOP_TRAN_TOKEN;
+	state->cmd[1] = 0xFF;
+	spi_transfer(handle, state->cmd, 0, 2);
+	start_busy_poll(handle, BUSY_ACTION_COMPLETE, err, err ? -1 : (int)(state->block_count * BLOCK_SIZE));
+}
+
+int start_block_write(const devfs_handle_t * handle){
+	drive_sdspi_state_t * state = handle->state;
+
+	state->cmd[0] = 0xFF;  //busy byte
+	state->cmd[1] = state->block_total > 1 ? SDSPI_START_BLOCK_WRITE_MULTIPLE_TOKEN : SDSPI_START_BLOCK_TOKEN;
+	spi_transfer(handle, state->cmd, 0, 2);
+
+	state->op.nbyte = BLOCK_SIZE;
+	state->op.buf = get_block_buffer(state);
+	state->op.handler.context = (void*)handle;
+	state->op.handler.callback = continue_spi_write;
+
+	//with the DMA driver, each block is one DMA transfer chained from the completion callback
+	return mcu_spi_write(handle, &(state->op));
+}
 
-	if( wop->nbyte != BLOCK_SIZE ){
+int drive_sdspi_write(const devfs_handle_t * handle, devfs_async_t * wop){
+	drive_sdspi_state_t * state = handle->state;
+	int result;
+
+	if( (wop->nbyte < BLOCK_SIZE) || (wop->nbyte % BLOCK_SIZE) ){
 		return SYSFS_SET_RETURN(EINVAL);
 	}
 
-	//check to see if device is busy
-	if( is_busy(handle) != 0 ){
+	//blocks can be written between queued erases if they are outside the queued ranges
+	if( drive_erase_queue_is_queued(&state->erase_queue, wop->loc, wop->loc + wop->nbyte / BLOCK_SIZE - 1) ){
 		return SYSFS_SET_RETURN(EBUSY);
 	}
 
+	if( (result = begin_transfer(handle)) < 0 ){
+		return result;
+	}
+
+	return end_transfer(handle, start_write(handle, wop));
+}
+
+int start_write(const devfs_handle_t * handle, devfs_async_t * wop){
+	drive_sdspi_state_t * state = handle->state;
+	drive_sdspi_r1_t r1;
+	u32 loc;
+	int result;
+
 	state->handler.context = wop->handler.context;
 	state->handler.callback = wop->handler.callback;
 	state->nbyte = &(wop->nbyte);
 	state->buf = wop->buf;
 	state->timeout = 0;
+	state->op.tid = wop->tid;
+	state->block_count = 0;
+	state->block_total = wop->nbyte / BLOCK_SIZE;
 
 	if( is_sdsc(handle) ){
 		loc = wop->loc*BLOCK_SIZE;
@@ -318,7 +470,17 @@ int drive_sdspi_write(const devfs_handle_t * handle, devfs_async_t * wop){
 		loc = wop->loc;
 	}
 
-	r1 = exec_cmd_r1(handle, SDSPI_CMD24_WRITE_SINGLE_BLOCK, loc, state->cmd);
+	if( state->block_total > 1 ){
+		//pre-erase hint -- the card can erase all the blocks before the data arrives
+		r1 = exec_cmd_r1(handle, SDSPI_CMD55_APP_CMD, 0, state->cmd);
+		if( r1.u8 == 0x00 ){
+			exec_cmd_r1(handle, SDSPI_ACMD23_SET_WR_BLK_ERASE_COUNT, state->block_total, state->cmd);
+		}
+		r1 = exec_cmd_r1(handle, SDSPI_CMD25_WRITE_MULTIPLE_BLOCK, loc, state->cmd);
+	} else {
+		r1 = exec_cmd_r1(handle, SDSPI_CMD24_WRITE_SINGLE_BLOCK, loc, state->cmd);
+	}
+
 	if( r1.u8 != 0x00 ){
 		if( (r1.addr_error) || (r1.param_error) ){
 			return SYSFS_SET_RETURN(EINVAL);
@@ -327,23 +489,72 @@ int drive_sdspi_write(const devfs_handle_t * handle, devfs_async_t * wop){
 		return SYSFS_SET_RETURN(EIO);
 	}
 
-	state->cmd[0] = 0xFF;  //busy byte
-	state->cmd[1] = SDSPI_START_BLOCK_TOKEN;
-
 	assert_chip_select(handle);
 	cortexm_delay_us(LONG_DELAY);
-	spi_transfer(handle, state->cmd, 0, 2);
 
-	state->op.nbyte = wop->nbyte;
-	state->op.buf = wop->buf;
-	state->op.handler.context = (void*)handle;
-	state->op.handler.callback = continue_spi_write;
-	state->op.tid = wop->tid;
+	if( (result = start_block_write(handle)) < 0 ){
+		deassert_chip_select(handle);
+	}
+	return result;
+}
 
+char * get_block_buffer(drive_sdspi_state_t * state){
+	return (char*)state->buf + state->block_count * BLOCK_SIZE;
+}
 
-	return mcu_spi_write(handle, &(state->op));
+int check_r1(drive_sdspi_r1_t r1){
+	if( r1.u8 != 0x00 ){
+		if( (r1.param_error) ){
+			return SYSFS_SET_RETURN(EINVAL);
+		}
+
+		if( (r1.addr_error) ){
+			return SYSFS_SET_RETURN(EINVAL);
+		}
+
+		if( (r1.erase_sequence_error) ){
+			return SYSFS_SET_RETURN(EINVAL);
+		}
+
+		if( (r1.crc_error) ){
+			return SYSFS_SET_RETURN(EINVAL);
+		}
+
+		if( (r1.illegal_command) ){
+			return SYSFS_SET_RETURN(EINVAL);
+		}
+
+		return SYSFS_SET_RETURN(EIO);
+	}
+	return 0;
+}
+
+void stop_transmission(const devfs_handle_t * handle){
+	drive_sdspi_state_t * state = handle->state;
+	int i;
+
+	//CMD12 is sent while chip select is still asserted (no delays needed mid-transfer)
+	memset(state->cmd, 0xFF, CMD_FRAME_SIZE);
+	state->cmd[0] = 0x40 | SDSPI_CMD12_STOP_TRANSMISSION;
+	state->cmd[1] = 0;
+	state->cmd[2] = 0;
+	state->cmd[3] = 0;
+	state->cmd[4] = 0;
+	state->cmd[5] = mcu_calc_crc7(0, 0x09, state->cmd, 5);
+	spi_transfer(handle, state->cmd, 0, 6);
+
+	//skip the stuff byte then wait for the R1 response
+	mcu_spi_swap(handle, (void*)0xFF);
+	for(i=0; i < CMD_FRAME_SIZE; i++){
+		if( (mcu_spi_swap(handle, (void*)0xFF) & 0x80) == 0 ){
+			break;
+		}
+	}
+
+	//the caller polls for the end of the busy signal with start_busy_poll()
 }
 
+
 int drive_sdspi_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 	drive_sdspi_state_t * state = (drive_sdspi_state_t*)handle->state;
 	const drive_sdspi_config_t * config = handle->config;
@@ -368,10 +579,19 @@ int drive_sdspi_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 					return SYSFS_SET_RETURN(EROFS);
 				}
 
+				if( (o_flags & DRIVE_FLAG_ERASE_BLOCKS) && (o_flags & DRIVE_FLAG_ERASE_ASYNC) ){
+					int result = drive_erase_queue_push(&state->erase_queue, attr->start, attr->end);
+					if( result < 0 ){
+						return result;
+					}
+					result = service_erase(handle);
+					return result < 0 ? result : 0;
+				}
+
 				if( o_flags & DRIVE_FLAG_ERASE_BLOCKS ){
 
 					//erase blocks in a sequence
-					if( is_busy(handle) != 0 ){
+					if( (service_erase(handle) != 0) || (is_busy(handle) != 0) ){
 						return SYSFS_SET_RETURN(EBUSY);
 					}
 					int result = erase_blocks(handle, attr->start, attr->end);
@@ -384,6 +604,8 @@ int drive_sdspi_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 
 			if( o_flags & DRIVE_FLAG_INIT ){
 				state->flags = 0;
+				//the config has no room for an erase timer -- queued erases continue when transfers complete
+				drive_erase_queue_init(&state->erase_queue, handle, erase_queued_blocks, is_erase_busy, 0);
 
 				memcpy(spi_config, &(config->spi), config->spi_config_size);
 				spi_attr_p->freq = 400000;
@@ -495,7 +717,18 @@ int drive_sdspi_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 
 			break;
 
+		case I_DRIVE_SETACTION:
+			drive_erase_queue_set_action(&state->erase_queue, ctl);
+			return 0;
+
 		case I_DRIVE_ISBUSY:
+			{
+				//this also starts the next queued erase
+				int result = service_erase(handle);
+				if( result != 0 ){
+					return result;
+				}
+			}
 			return is_busy(handle);
 
 		case I_DRIVE_GETINFO:
@@ -509,7 +742,7 @@ int drive_sdspi_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 			spi_transfer(handle, 0, 0, CMD_FRAME_SIZE);
 			deassert_chip_select(handle);
 
-			info->o_flags = DRIVE_FLAG_ERASE_BLOCKS|DRIVE_FLAG_INIT;
+			info->o_flags = DRIVE_FLAG_ERASE_BLOCKS|DRIVE_FLAG_ERASE_ASYNC|DRIVE_FLAG_INIT;
 
 			//Write block size and address are fixed to BLOCK_SIZE
 			info->addressable_size = BLOCK_SIZE;
@@ -596,6 +829,49 @@ int erase_blocks(const devfs_handle_t * handle, uint32_t block_num, uint32_t end
 	return 0;
 }
 
+int erase_queued_blocks(const devfs_handle_t * handle, u32 block_num, u32 end_block){
+	//the card erases the whole range with one command
+	if( erase_blocks(handle, block_num, end_block) < 0 ){
+		return SYSFS_SET_RETURN(EIO);
+	}
+	return end_block - block_num + 1;
+}
+
+int service_erase(const devfs_handle_t * handle){
+	drive_sdspi_state_t * state = handle->state;
+	return drive_erase_queue_service(&state->erase_queue);
+}
+
+int begin_transfer(const devfs_handle_t * handle){
+	drive_sdspi_state_t * state = handle->state;
+	if( drive_erase_queue_pause(&state->erase_queue) != 0 ){
+		return SYSFS_SET_RETURN(EBUSY);
+	}
+	if( is_busy(handle) != 0 ){
+		drive_erase_queue_resume(&state->erase_queue);
+		return SYSFS_SET_RETURN(EBUSY);
+	}
+	return 0;
+}
+
+int end_transfer(const devfs_handle_t * handle, int result){
+	drive_sdspi_state_t * state = handle->state;
+	if( result != 0 ){
+		//failed or finished without waiting for the SPI -- let the erase queue continue
+		drive_erase_queue_resume(&state->erase_queue);
+	}
+	return result;
+}
+
+int is_erase_busy(const devfs_handle_t * handle){
+	uint8_t c;
+	//the erase queue checks from interrupts -- the card holds DO low while it is busy so no delay is needed
+	assert_chip_select(handle);
+	c = mcu_spi_swap(handle, (void*)0xFF);
+	deassert_chip_select(handle);
+	return (c == 0x00);
+}
+
 int is_busy(const devfs_handle_t * handle){
 	uint8_t c;
 	assert_chip_select(handle);
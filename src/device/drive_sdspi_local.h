@@ -47,6 +47,7 @@
 #define SDSPI_CMD38_ERASE 38
 
 
+#define SDSPI_ACMD23_SET_WR_BLK_ERASE_COUNT 23
 #define SDSPI_ACMD41_SD_SEND_OP_COND 41
 
 #define SDSPI_CMD55_APP_CMD 55
@@ -54,10 +54,17 @@ int ffifo_is_write_ok(ffifo_state_t * state, u16 count, int writeblock){
 	int ret = 1;
 	fifo_atomic_position_t atomic_postion;
 	atomic_postion.atomic_access = state->atomic_position.atomic_access; //cppcheck-suppress[unreadVariable]
-	if( atomic_postion.access.tail == count ){
+	if( state->o_flags & FIFO_FLAG_IS_WRITE_LENT ){
+		//the head frame is lent to a writer
+		ret = 0;
+	} else if( atomic_postion.access.tail == count ){
 		if( writeblock ){
 			//cannot write anymore data at this time
 			ret = 0;
+		} else if( state->o_flags & FIFO_FLAG_IS_READ_LENT ){
+			//the oldest frame is lent to a reader -- drop the new frame rather than overwrite it
+			ffifo_set_overflow(state, 1);
+			ret = 0;
 		} else {
 			//OK to write but it will cause an overflow
 			if( state->o_flags & FIFO_FLAG_IS_READ_BUSY ){
@@ -111,6 +118,12 @@ int ffifo_read_buffer(const ffifo_config_t * config, ffifo_state_t * state, char
 	char * frame;
 	fifo_atomic_position_t atomic_position;
 	int read_was_clobbered = 0;
+
+	if( state->o_flags & FIFO_FLAG_IS_READ_LENT ){
+		//the oldest frame is lent out and must be released first
+		return 0;
+	}
+
 	for(i=0; i < len; i += frame_size){
 
 		state->o_flags |= FIFO_FLAG_IS_READ_BUSY;
@@ -180,6 +193,8 @@ int ffifo_write_buffer(const ffifo_config_t * config, ffifo_state_t * state, con
 
 void ffifo_flush(ffifo_state_t * state){
 	state->atomic_position.atomic_access = 0;
+	//releasing a frame after a flush has no effect
+	state->o_flags &= ~(FIFO_FLAG_IS_READ_LENT | FIFO_FLAG_IS_WRITE_LENT);
 	ffifo_set_overflow(state, 0);
 }
 
@@ -219,6 +234,8 @@ void ffifo_data_received(const ffifo_config_t * handle, ffifo_state_t * state){
 						);
 		}
 	}
+
+	devfs_execute_poll_handler(&state->poll_handler, ffifo_get_poll_events(handle, state));
 }
 
 void ffifo_cancel_async_read(ffifo_state_t * state){
@@ -251,6 +268,120 @@ void ffifo_data_transmitted(const ffifo_config_t * config, ffifo_state_t * state
 						MCU_EVENT_FLAG_WRITE_COMPLETE);
 		}
 	}
+
+	devfs_execute_poll_handler(&state->poll_handler, ffifo_get_poll_events(config, state));
+}
+
+u32 ffifo_get_poll_events(const ffifo_config_t * config, ffifo_state_t * state){
+	u32 o_events = 0;
+	fifo_atomic_position_t atomic_position;
+	atomic_position.atomic_access = state->atomic_position.atomic_access; //cppcheck-suppress[unreadVariable]
+
+	//a frame that is lent or being copied isn't ready until the borrower is done with it
+	if( (atomic_position.access.head != atomic_position.access.tail) &&
+		 ((state->o_flags & (FIFO_FLAG_IS_READ_LENT | FIFO_FLAG_IS_READ_BUSY)) == 0) ){
+		o_events |= MCU_EVENT_FLAG_DATA_READY;
+	}
+
+	//the tail is set to frame_count when the buffer is full -- an overflow can't drop a lent frame
+	if( ((state->o_flags & (FIFO_FLAG_IS_WRITE_LENT | FIFO_FLAG_IS_WRITE_BUSY)) == 0) &&
+		 ((atomic_position.access.tail != config->frame_count) ||
+		  (!ffifo_is_writeblock(state) && ((state->o_flags & (FIFO_FLAG_IS_READ_LENT | FIFO_FLAG_IS_READ_BUSY)) == 0))) ){
+		o_events |= MCU_EVENT_FLAG_WRITE_COMPLETE;
+	}
+	return o_events;
+}
+
+int ffifo_lend_frame(const ffifo_config_t * config, ffifo_state_t * state, ffifo_frame_t * frame){
+	int ret = config->frame_size;
+	u16 count = config->frame_count;
+
+	frame->nbyte = config->frame_size;
+	if( (frame->o_flags & (FFIFO_FRAME_FLAG_READ | FFIFO_FRAME_FLAG_WRITE)) == 0 ){
+		//lets the caller check for support without borrowing a frame
+		return ret;
+	}
+
+	//the availability here must match ffifo_get_poll_events() so a borrower can wait for a frame
+	cortexm_disable_interrupts();
+	if( frame->o_flags & FFIFO_FRAME_FLAG_READ ){
+		if( state->o_flags & FIFO_FLAG_IS_READ_LENT ){
+			ret = SYSFS_SET_RETURN(EBUSY);
+		} else if( (state->atomic_position.access.head == state->atomic_position.access.tail) ||
+					  (state->o_flags & FIFO_FLAG_IS_READ_BUSY) ){
+			ret = SYSFS_SET_RETURN(EAGAIN);
+		} else {
+			if( state->atomic_position.access.tail == count ){
+				frame->buf = ffifo_get_frame(config, state->atomic_position.access.head);
+			} else {
+				frame->buf = ffifo_get_frame(config, state->atomic_position.access.tail);
+			}
+			state->o_flags |= FIFO_FLAG_IS_READ_LENT;
+		}
+	} else {
+		if( state->o_flags & FIFO_FLAG_IS_WRITE_LENT ){
+			ret = SYSFS_SET_RETURN(EBUSY);
+		} else if( state->o_flags & FIFO_FLAG_IS_WRITE_BUSY ){
+			ret = SYSFS_SET_RETURN(EAGAIN);
+		} else if( state->atomic_position.access.tail == count ){
+			if( ffifo_is_writeblock(state) ||
+				 (state->o_flags & (FIFO_FLAG_IS_READ_LENT | FIFO_FLAG_IS_READ_BUSY)) ){
+				ret = SYSFS_SET_RETURN(EAGAIN);
+			} else {
+				//drop the oldest frame to make room
+				state->atomic_position.access.tail = state->atomic_position.access.head;
+				ffifo_inc_tail(state, count);
+				ffifo_set_overflow(state, 1);
+			}
+		}
+
+		if( ret > 0 ){
+			frame->buf = ffifo_get_frame(config, state->atomic_position.access.head);
+			state->o_flags |= FIFO_FLAG_IS_WRITE_LENT;
+		}
+	}
+	cortexm_enable_interrupts();
+
+	return ret;
+}
+
+int ffifo_release_frame(const ffifo_config_t * config, ffifo_state_t * state, const ffifo_frame_t * frame){
+	u16 count = config->frame_count;
+	int is_released = 0;
+
+	cortexm_disable_interrupts();
+	if( frame->o_flags & FFIFO_FRAME_FLAG_READ ){
+		if( state->o_flags & FIFO_FLAG_IS_READ_LENT ){
+			state->o_flags &= ~FIFO_FLAG_IS_READ_LENT;
+			if( frame->nbyte ){
+				if( state->atomic_position.access.tail == count ){
+					state->atomic_position.access.tail = state->atomic_position.access.head;
+				}
+				ffifo_inc_tail(state, count);
+			}
+			is_released = 1;
+		}
+	} else if( frame->o_flags & FFIFO_FRAME_FLAG_WRITE ){
+		if( state->o_flags & FIFO_FLAG_IS_WRITE_LENT ){
+			state->o_flags &= ~FIFO_FLAG_IS_WRITE_LENT;
+			if( frame->nbyte ){
+				ffifo_inc_head(state, count);
+			}
+			is_released = 1;
+		}
+	}
+	cortexm_enable_interrupts();
+
+	if( is_released ){
+		if( frame->o_flags & FFIFO_FRAME_FLAG_READ ){
+			//something might be waiting to write the frame
+			ffifo_data_transmitted(config, state);
+		} else {
+			ffifo_data_received(config, state);
+		}
+	}
+
+	return 0;
 }
 
 
@@ -280,6 +411,39 @@ int ffifo_write(const devfs_handle_t * handle, devfs_async_t * wop){
 	return ffifo_write_local(config, state, wop, 1);
 }
 
+int ffifo_try_read(const devfs_handle_t * handle, devfs_async_t * async){
+	const ffifo_config_t * config = handle->config;
+	ffifo_state_t * state = handle->state;
+	int bytes_read;
+
+	if( state->transfer_handler.read || (async->nbyte % config->frame_size) ){
+		//ffifo_read() will report the error
+		return 0;
+	}
+
+	bytes_read = ffifo_read_buffer(config, state, async->buf, async->nbyte);
+	if( bytes_read > 0 ){
+		ffifo_data_transmitted(config, state);
+	}
+	return bytes_read;
+}
+
+int ffifo_try_write(const devfs_handle_t * handle, devfs_async_t * async){
+	const ffifo_config_t * config = handle->config;
+	ffifo_state_t * state = handle->state;
+	int bytes_written;
+
+	if( state->transfer_handler.write || (async->nbyte % config->frame_size) ){
+		return 0;
+	}
+
+	bytes_written = ffifo_write_buffer(config, state, async->buf_const, async->nbyte);
+	if( bytes_written > 0 ){
+		ffifo_data_received(config, state);
+	}
+	return bytes_written;
+}
+
 int ffifo_close(const devfs_handle_t * handle){
 	const ffifo_config_t * cfgp = handle->config;
 	ffifo_state_t * state = handle->state;
@@ -297,9 +461,15 @@ int ffifo_close_local(const ffifo_config_t * config, ffifo_state_t * state){
 int ffifo_ioctl_local(const ffifo_config_t * config, ffifo_state_t * state, int request, void * ctl){
 	ffifo_attr_t * attr = ctl;
 	ffifo_info_t * info = ctl;
+	ffifo_frame_t * frame = ctl;
 	mcu_action_t * action = ctl;
 	switch(request){
 		case I_MCU_SETACTION:
+			if( action->o_events & MCU_EVENT_FLAG_POLL ){
+				//readiness handlers don't affect ongoing transfers
+				return devfs_set_poll_handler(&state->poll_handler, action, ffifo_get_poll_events(config, state));
+			}
+
 			if( action->handler.callback == 0 ){
 				if( action->o_events & MCU_EVENT_FLAG_WRITE_COMPLETE ){
 					//cancel any ongoing operations
@@ -318,9 +488,15 @@ int ffifo_ioctl_local(const ffifo_config_t * config, ffifo_state_t * state, int
 		case I_FFIFO_GETINFO:
 			ffifo_getinfo(info, config, state);
 			return 0;
+		case I_FFIFO_FRAME:
+			if( frame->o_flags & FFIFO_FRAME_FLAG_RELEASE ){
+				return ffifo_release_frame(config, state, frame);
+			}
+			return ffifo_lend_frame(config, state, frame);
 		case I_FFIFO_INIT:
 			state->transfer_handler.read = NULL;
 			state->transfer_handler.write = NULL;
+			state->poll_handler.handler.callback = NULL;
 			/* no break */
 		case I_FFIFO_FLUSH:
 			ffifo_flush(state);
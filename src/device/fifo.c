@@ -20,6 +20,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <stddef.h>
+#include <sys/uio.h>
 #include "mcu/debug.h"
 #include "device/fifo.h"
 
@@ -195,6 +196,24 @@ void fifo_data_received(const fifo_config_t * config, fifo_state_t * state){
 						MCU_EVENT_FLAG_DATA_READY);
 		}
 	}
+
+	devfs_execute_poll_handler(&state->poll_handler, fifo_get_poll_events(config, state));
+}
+
+u32 fifo_get_poll_events(const fifo_config_t * config, fifo_state_t * state){
+	u32 o_events = 0;
+	fifo_atomic_position_t atomic_position;
+	atomic_position.atomic_access = state->atomic_position.atomic_access; //cppcheck-suppress[unreadVariable]
+
+	if( atomic_position.access.head != atomic_position.access.tail ){
+		o_events |= MCU_EVENT_FLAG_DATA_READY;
+	}
+
+	//the tail is set to size when the buffer is full
+	if( (atomic_position.access.tail != config->size) || !fifo_is_writeblock(state) ){
+		o_events |= MCU_EVENT_FLAG_WRITE_COMPLETE;
+	}
+	return o_events;
 }
 
 void fifo_cancel_async_read(fifo_state_t * state){
@@ -220,6 +239,7 @@ int fifo_data_transmitted(const fifo_config_t * cfgp, fifo_state_t * state){
 		}
 	}
 
+	devfs_execute_poll_handler(&state->poll_handler, fifo_get_poll_events(cfgp, state));
 	return 1; //leave the callback in place ??
 }
 
@@ -247,6 +267,92 @@ int fifo_read(const devfs_handle_t * handle, devfs_async_t * async){
 	return fifo_read_local(config, state, async, 1);
 }
 
+int fifo_try_read(const devfs_handle_t * handle, devfs_async_t * async){
+	const fifo_config_t * config = handle->config;
+	fifo_state_t * state = handle->state;
+	int bytes_read;
+
+	if( state->transfer_handler.read ){
+		//fifo_read() will report that the FIFO is busy
+		return 0;
+	}
+
+	bytes_read = fifo_read_buffer(config, state, async->buf, async->nbyte);
+	if( bytes_read > 0 ){
+		//see if anything needs to write the FIFO
+		fifo_data_transmitted(config, state);
+	}
+	return bytes_read;
+}
+
+int fifo_try_write(const devfs_handle_t * handle, devfs_async_t * async){
+	const fifo_config_t * config = handle->config;
+	fifo_state_t * state = handle->state;
+	int bytes_written;
+
+	if( state->transfer_handler.write ){
+		return 0;
+	}
+
+	bytes_written = fifo_write_buffer(config, state, async->buf_const, async->nbyte, (async->flags & O_NONBLOCK) != 0);
+	if( bytes_written > 0 ){
+		fifo_data_received(config, state);
+	}
+	return bytes_written;
+}
+
+int fifo_readv(const devfs_handle_t * handle, devfs_async_t * async, const struct iovec * iov, int iovcnt){
+	const fifo_config_t * config = handle->config;
+	fifo_state_t * state = handle->state;
+	int bytes_read;
+	int total = 0;
+	int i;
+
+	if( state->transfer_handler.read ){
+		return 0;
+	}
+
+	//fill each buffer before moving to the next one
+	for(i=0; i < iovcnt; i++){
+		bytes_read = fifo_read_buffer(config, state, iov[i].iov_base, iov[i].iov_len);
+		total += bytes_read;
+		if( bytes_read < (int)iov[i].iov_len ){
+			break;
+		}
+	}
+
+	if( total > 0 ){
+		fifo_data_transmitted(config, state);
+	}
+	return total;
+}
+
+int fifo_writev(const devfs_handle_t * handle, devfs_async_t * async, const struct iovec * iov, int iovcnt){
+	const fifo_config_t * config = handle->config;
+	fifo_state_t * state = handle->state;
+	int non_blocking = (async->flags & O_NONBLOCK) != 0;
+	int bytes_written;
+	int total = 0;
+	int i;
+
+	if( state->transfer_handler.write ){
+		return 0;
+	}
+
+	for(i=0; i < iovcnt; i++){
+		bytes_written = fifo_write_buffer(config, state, iov[i].iov_base, iov[i].iov_len, non_blocking);
+		total += bytes_written;
+		if( bytes_written < (int)iov[i].iov_len ){
+			break;
+		}
+	}
+
+	if( total > 0 ){
+		fifo_data_received(config, state);
+	}
+	return total;
+}
+
 int fifo_close(const devfs_handle_t * handle){
 	const fifo_config_t * config = handle->config;
 	fifo_state_t * state = handle->state;
@@ -271,6 +377,11 @@ int fifo_ioctl_local(const fifo_config_t * config, fifo_state_t * state, int req
 			return 0;
 		case I_MCU_SETACTION:
 
+			if( action->o_events & MCU_EVENT_FLAG_POLL ){
+				//readiness handlers don't affect ongoing transfers
+				return devfs_set_poll_handler(&state->poll_handler, action, fifo_get_poll_events(config, state));
+			}
+
 			if( action->handler.callback == 0 ){
 
 				if(action->o_events & MCU_EVENT_FLAG_WRITE_COMPLETE ){
@@ -289,6 +400,7 @@ int fifo_ioctl_local(const fifo_config_t * config, fifo_state_t * state, int req
 		case I_FIFO_INIT:
 			state->transfer_handler.read = NULL;
 			state->transfer_handler.write = NULL;
+			state->poll_handler.handler.callback = NULL;
 			/* no break */
 		case I_FIFO_FLUSH:
 			fifo_flush(state);
@@ -231,6 +231,11 @@ int i2s_ffifo_ioctl(const devfs_handle_t * handle, int request, void * ctl){
     case I_I2S_SETACTION:
     case I_MCU_SETACTION:
 
+        if( action->o_events & MCU_EVENT_FLAG_POLL ){
+            //the rx and tx fifos don't share a readiness handler
+            return SYSFS_SET_RETURN(ENOTSUP);
+        }
+
         //this needs to handle cancelling wop/rop of tx and rx fifos
         if( (action->o_events & MCU_EVENT_FLAG_DATA_READY) && (action->handler.callback == 0) ){
             //cancel the ffifo rx
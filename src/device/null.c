@@ -43,3 +43,11 @@ int null_close(const devfs_handle_t * handle){
 	return 0;
 }
 
+int null_try_read(const devfs_handle_t * handle, devfs_async_t * async){
+	return null_read(handle, async);
+}
+
+int null_try_write(const devfs_handle_t * handle, devfs_async_t * async){
+	return null_write(handle, async);
+}
+
@@ -21,7 +21,9 @@
 #include <errno.h>
 #include <stddef.h>
 #include "cortexm/task.h"
+#include "sos/fs/devfs.h"
 #include "device/switchboard.h"
+#include "sos/dev/ffifo.h"
 #include "mcu/debug.h"
 
 
@@ -36,6 +38,11 @@ static int get_terminal(const switchboard_config_t * config, const switchboard_s
 static int update_priority(const devfs_device_t * device, const switchboard_terminal_t * terminal, u32 o_events);
 static int handle_data_ready(void * context, const mcu_event_t * event);
 static int handle_write_complete(void * context, const mcu_event_t * event);
+static int handle_frame_ready(void * context, const mcu_event_t * event);
+static u32 negotiate_zero_copy(switchboard_state_t * state);
+static int lend_frame(switchboard_state_t * state, switchboard_state_terminal_t * terminal, u32 o_flags);
+static int request_frame(const switchboard_state_terminal_t * terminal, u32 o_flags, u32 nbyte);
+static void release_frames(switchboard_state_t * state);
 static int read_then_write_until_async(switchboard_state_t * state);
 static void complete_read(switchboard_state_t * state, int bytes_read);
 static void complete_write(switchboard_state_t * state);
@@ -66,7 +73,9 @@ int switchboard_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 		case I_SWITCHBOARD_GETINFO:
 			info->o_flags = SWITCHBOARD_FLAG_CONNECT |
 					SWITCHBOARD_FLAG_DISCONNECT |
-					SWITCHBOARD_FLAG_IS_PERSISTENT;
+					SWITCHBOARD_FLAG_IS_PERSISTENT |
+					SWITCHBOARD_FLAG_IS_ZERO_COPY_INPUT |
+					SWITCHBOARD_FLAG_IS_ZERO_COPY_OUTPUT;
 			info->connection_count = config->connection_count;
 			info->connection_buffer_size = config->connection_buffer_size;
 			info->transaction_limit = config->transaction_limit;
@@ -108,8 +117,10 @@ int switchboard_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 int switchboard_read(const devfs_handle_t * handle, devfs_async_t * async){
 	const switchboard_config_t * config = handle->config;
 	switchboard_state_t * state = handle->state;
-	if( (async->nbyte == sizeof(switchboard_connection_t)) && (async->loc % sizeof(switchboard_connection_t) == 0) ){
-		u32 id = async->loc / sizeof(switchboard_connection_t);
+	//older applications read the status without the counters (sizeof(switchboard_connection_t))
+	if( ((async->nbyte == sizeof(switchboard_status_t)) || (async->nbyte == sizeof(switchboard_connection_t))) &&
+		 (async->loc % async->nbyte == 0) ){
+		u32 id = async->loc / async->nbyte;
 		if( id < config->connection_count ){
 			switchboard_status_t * status = async->buf;
 
@@ -121,6 +132,10 @@ int switchboard_read(const devfs_handle_t * handle, devfs_async_t * async){
 				} else {
 					status->nbyte = state[id].nbyte;
 				}
+				if( async->nbyte == sizeof(switchboard_status_t) ){
+					status->transaction_count = state[id].transaction_count;
+					status->max_latency_cycles = state[id].max_latency_cycles;
+				}
 
 				if( get_terminal(config, &state[id].input, &status->input) < 0 ){
 					return SYSFS_SET_RETURN(EIO);
@@ -132,10 +147,10 @@ int switchboard_read(const devfs_handle_t * handle, devfs_async_t * async){
 
 			} else {
 				//connection is not used
-				memset(status, 0, sizeof(switchboard_connection_t));
+				memset(status, 0, async->nbyte);
 				status->id = id;
 			}
-			return sizeof(switchboard_connection_t);
+			return async->nbyte;
 
 		} else {
 			return SYSFS_RETURN_EOF;
@@ -278,6 +293,9 @@ int create_connection(const switchboard_config_t * config, switchboard_state_t *
 		return SYSFS_SET_RETURN(EIO);
 	}
 
+	//use the FFIFO frames in place of the connection buffers if possible
+	state[id].o_flags |= negotiate_zero_copy(state + id);
+
 	//start reading into the primary buffer -- mark it as used
 	int result;
 	mcu_debug_log_info(MCU_DEBUG_DEVICE, "%d (%p) Starting %s -> %s", id, state + id, state[id].input.device->name, state[id].output.device->name);
@@ -291,6 +309,7 @@ int create_connection(const switchboard_config_t * config, switchboard_state_t *
 }
 
 void abort_connection(switchboard_state_t * state){
+	release_frames(state);
 	if( (state->o_flags & SWITCHBOARD_FLAG_IS_ERROR) == 0 ){
 		close_terminal(&state->input);
 		close_terminal(&state->output);
@@ -327,6 +346,7 @@ int destroy_connection(const switchboard_config_t * config, switchboard_state_t
 }
 
 void close_connection(switchboard_state_t * state){
+	release_frames(state);
 	close_terminal(&state->input);
 	close_terminal(&state->output);
 
@@ -371,6 +391,108 @@ int get_terminal(const switchboard_config_t * config,
 	return devfs_lookup_name(config->devfs_list, state_terminal->device, terminal->name);
 }
 
+u32 negotiate_zero_copy(switchboard_state_t * state){
+	//frames have a fixed size and can't be filled if the input has no data
+	if( ((state->o_flags & SWITCHBOARD_FLAG_IS_PERSISTENT) == 0) ||
+		 (state->o_flags & (SWITCHBOARD_FLAG_IS_FILL_ZERO |
+								  SWITCHBOARD_FLAG_IS_FILL_LAST_8 |
+								  SWITCHBOARD_FLAG_IS_FILL_LAST_16 |
+								  SWITCHBOARD_FLAG_IS_FILL_LAST_32 |
+								  SWITCHBOARD_FLAG_IS_FILL_LAST_64)) ){
+		return 0;
+	}
+
+	//with o_flags set to zero, I_FFIFO_FRAME returns the frame size without lending a frame
+	if( request_frame(&state->input, 0, 0) == state->packet_size ){
+		return SWITCHBOARD_FLAG_IS_ZERO_COPY_INPUT;
+	}
+
+	//a non-blocking input would leave an empty frame in the output
+	if( ((state->o_flags & SWITCHBOARD_FLAG_IS_INPUT_NON_BLOCKING) == 0) &&
+		 (request_frame(&state->output, 0, 0) == state->packet_size) ){
+		return SWITCHBOARD_FLAG_IS_ZERO_COPY_OUTPUT;
+	}
+
+	return 0;
+}
+
+int lend_frame(switchboard_state_t * state, switchboard_state_terminal_t * terminal, u32 o_flags){
+	ffifo_frame_t frame;
+	mcu_action_t action;
+	int ret;
+
+	do {
+		memset(&frame, 0, sizeof(frame));
+		frame.o_flags = o_flags;
+		ret = terminal->device->driver.ioctl(&terminal->device->handle, I_FFIFO_FRAME, &frame);
+		if( ret > 0 ){
+			//both buffers point to the frame so the connection is single buffered
+			state->buffer[0] = frame.buf;
+			state->buffer[1] = frame.buf;
+			state->input.async.buf = frame.buf;
+			state->output.async.buf = frame.buf;
+			return ret;
+		}
+
+		if( SYSFS_GET_RETURN_ERRNO(ret) != EAGAIN ){
+			return ret;
+		}
+
+		//wait for the FFIFO to have a frame available
+		memset(&action, 0, sizeof(action));
+		action.handler.callback = handle_frame_ready;
+		action.handler.context = state;
+		action.channel = terminal->async.loc;
+		action.o_events = MCU_EVENT_FLAG_POLL;
+		if( o_flags & FFIFO_FRAME_FLAG_READ ){
+			action.o_events |= MCU_EVENT_FLAG_DATA_READY;
+		} else {
+			action.o_events |= MCU_EVENT_FLAG_WRITE_COMPLETE;
+		}
+
+		ret = terminal->device->driver.ioctl(&terminal->device->handle, I_MCU_SETACTION, &action);
+		if( ret < 0 ){
+			return ret;
+		}
+
+		//the handler isn't registered if a frame became available in the meantime
+	} while( ret & (MCU_EVENT_FLAG_DATA_READY | MCU_EVENT_FLAG_WRITE_COMPLETE) );
+
+	state->o_flags |= SWITCHBOARD_FLAG_IS_READING_ASYNC;
+	return 0;
+}
+
+int request_frame(const switchboard_state_terminal_t * terminal, u32 o_flags, u32 nbyte){
+	ffifo_frame_t frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.o_flags = o_flags;
+	frame.nbyte = nbyte;
+	return terminal->device->driver.ioctl(&terminal->device->handle, I_FFIFO_FRAME, &frame);
+}
+
+void release_frames(switchboard_state_t * state){
+	mcu_action_t action;
+	switchboard_state_terminal_t * terminal;
+	u32 o_flags;
+
+	if( state->o_flags & SWITCHBOARD_FLAG_IS_ZERO_COPY_INPUT ){
+		terminal = &state->input;
+		o_flags = FFIFO_FRAME_FLAG_READ;
+	} else if( state->o_flags & SWITCHBOARD_FLAG_IS_ZERO_COPY_OUTPUT ){
+		terminal = &state->output;
+		o_flags = FFIFO_FRAME_FLAG_WRITE;
+	} else {
+		return;
+	}
+
+	//stop waiting for a frame and give back any frame that is lent (without using it)
+	memset(&action, 0, sizeof(action));
+	action.channel = terminal->async.loc;
+	action.o_events = MCU_EVENT_FLAG_POLL;
+	terminal->device->driver.ioctl(&terminal->device->handle, I_MCU_SETACTION, &action);
+	request_frame(terminal, o_flags | FFIFO_FRAME_FLAG_RELEASE, 0);
+}
+
 //switch happens after data is read
 int is_ready_to_read_device(switchboard_state_t * state){
 
@@ -445,6 +567,11 @@ int is_ready_to_write_device(switchboard_state_t * state){
 }
 
 void complete_read(switchboard_state_t * state, int bytes_read){
+	if( state->input.async.buf == state->buffer[0] ){
+		state->ready_cycles[0] = (u32)task_root_get_cycles();
+	} else {
+		state->ready_cycles[1] = (u32)task_root_get_cycles();
+	}
 	update_bytes_transferred(state, &state->input);
 	switch_input_buffer(state, bytes_read);
 	if( state->input.async.nbyte > 0 ){
@@ -465,6 +592,22 @@ void update_bytes_transferred(switchboard_state_t * state, switchboard_state_ter
 }
 
 void complete_write(switchboard_state_t * state){
+	u32 latency;
+	if( state->output.async.buf == state->buffer[0] ){
+		latency = (u32)task_root_get_cycles() - state->ready_cycles[0];
+	} else {
+		latency = (u32)task_root_get_cycles() - state->ready_cycles[1];
+	}
+	if( latency > state->max_latency_cycles ){
+		state->max_latency_cycles = latency;
+	}
+	state->transaction_count++;
+
+	if( state->o_flags & SWITCHBOARD_FLAG_IS_ZERO_COPY_INPUT ){
+		//the frame has been written -- remove it from the input
+		request_frame(&state->input, FFIFO_FRAME_FLAG_READ | FFIFO_FRAME_FLAG_RELEASE, state->output.async.nbyte);
+	}
+
 	update_bytes_transferred(state, &state->output);
 
 	//switches and marks the buffer as unused (ready for read device to write to buffer)
@@ -477,7 +620,15 @@ int write_to_device(switchboard_state_t * state){
 	int ret = 0;
 
 	if( is_ready_to_write_device(state) ){ //is there a buffer with data that needs to be written?
-		ret = state->output.device->driver.write(&state->output.device->handle, &state->output.async);
+		if( state->o_flags & SWITCHBOARD_FLAG_IS_ZERO_COPY_OUTPUT ){
+			//the data is already in the frame -- releasing it adds it to the output
+			ret = request_frame(&state->output, FFIFO_FRAME_FLAG_WRITE | FFIFO_FRAME_FLAG_RELEASE, state->output.async.nbyte);
+			if( ret == 0 ){
+				ret = state->output.async.nbyte;
+			}
+		} else {
+			ret = state->output.device->driver.write(&state->output.device->handle, &state->output.async);
+		}
 		if( ret == 0 ){
 			//waiting for write
 			state->o_flags |= SWITCHBOARD_FLAG_IS_WRITING_ASYNC;
@@ -503,6 +654,28 @@ int read_from_device(switchboard_state_t * state){
 	int ret = 0;
 
 	if( is_ready_to_read_device(state) ){ //is there a buffer available
+		if( state->o_flags & SWITCHBOARD_FLAG_IS_ZERO_COPY_INPUT ){
+			//the lent frame already has the data
+			ret = lend_frame(state, &state->input, FFIFO_FRAME_FLAG_READ);
+			if( ret > 0 ){
+				complete_read(state, ret);
+			} else if( ret < 0 ){
+				state->nbyte = ret;
+			}
+			return ret;
+		}
+
+		if( state->o_flags & SWITCHBOARD_FLAG_IS_ZERO_COPY_OUTPUT ){
+			//read the input directly into a frame lent by the output
+			ret = lend_frame(state, &state->output, FFIFO_FRAME_FLAG_WRITE);
+			if( ret <= 0 ){
+				if( ret < 0 ){
+					state->nbyte = ret;
+				}
+				return ret;
+			}
+		}
+
 		ret = state->input.device->driver.read(&state->input.device->handle, &state->input.async);
 		if( ret == 0 ){
 			//the operation will happen asynchronously -- wait until it is done
@@ -630,6 +803,17 @@ int handle_data_ready(void * context, const mcu_event_t * event){
 	return 0;
 }
 
+int handle_frame_ready(void * context, const mcu_event_t * event){
+	switchboard_state_t * state = context;
+
+	//the FFIFO has a frame to lend -- not waiting anymore
+	state->o_flags &= ~SWITCHBOARD_FLAG_IS_READING_ASYNC;
+
+	read_then_write_until_async(state);
+
+	return 0;
+}
+
 int handle_write_complete(void * context, const mcu_event_t * event){
 	switchboard_state_t * state = context;
 	u32 o_events = event->o_events;
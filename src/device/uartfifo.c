@@ -99,6 +99,14 @@ int uartfifo_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 			break;
 		case I_MCU_SETACTION:
 		case I_UART_SETACTION:
+			if( action->o_events & MCU_EVENT_FLAG_POLL ){
+				//writes go directly to the UART so only reads can wait
+				return devfs_set_poll_handler(
+							&state->fifo.poll_handler,
+							action,
+							fifo_get_poll_events(&config->fifo, &state->fifo) | MCU_EVENT_FLAG_WRITE_COMPLETE);
+			}
+
 			if( action->handler.callback == 0 ){
 				//This needs to cancel an ongoing operation
 				fifo_cancel_async_read(&(state->fifo));
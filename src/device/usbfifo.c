@@ -118,6 +118,14 @@ int usbfifo_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 			break;
 		case I_USB_SETACTION:
 		case I_MCU_SETACTION:
+			if( action->o_events & MCU_EVENT_FLAG_POLL ){
+				//writes go directly to the USB hardware so only reads can wait
+				return devfs_set_poll_handler(
+							&state->fifo.poll_handler,
+							action,
+							fifo_get_poll_events(&config->fifo, &state->fifo) | MCU_EVENT_FLAG_WRITE_COMPLETE);
+			}
+
 			if( action->handler.callback == 0 ){
 				fifo_cancel_async_read(&(state->fifo));
 			} else {
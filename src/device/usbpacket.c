@@ -0,0 +1,328 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include <fcntl.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include "cortexm/cortexm.h"
+#include "cortexm/task.h"
+#include "device/usbpacket.h"
+#include "mcu/usb.h"
+#include "mcu/debug.h"
+
+static int start_read(const devfs_handle_t * handle);
+static void receive(const devfs_handle_t * handle, int nbyte);
+static int read_buffer(const devfs_handle_t * handle, char * dest, int nbyte);
+static void data_ready(const devfs_handle_t * handle);
+static void flush(const devfs_handle_t * handle);
+
+static int cancel_read_action(const devfs_handle_t * handle){
+	mcu_action_t action;
+	const usbpacket_config_t * config = handle->config;
+
+	action.handler.callback = 0;
+	action.handler.context = 0;
+	action.o_events = MCU_EVENT_FLAG_DATA_READY;
+	action.channel = config->endpoint;
+	action.prio = 0;
+	return mcu_usb_setaction(handle, &action);
+}
+
+static int data_received(void * context, const mcu_event_t * data){
+	const devfs_handle_t * handle = context;
+	usbpacket_state_t * state = handle->state;
+
+	receive(handle, state->async_read.nbyte);
+	start_read(handle);
+	data_ready(handle);
+	return 0; //done
+}
+
+int start_read(const devfs_handle_t * handle){
+	const usbpacket_config_t * config = handle->config;
+	usbpacket_state_t * state = handle->state;
+	int result;
+
+	do {
+		if( state->complete_count == config->buffer_count ){
+			//the host is NAK'd until the reader frees a buffer
+			state->is_stalled = 1;
+			return 0;
+		}
+
+		state->is_stalled = 0;
+		state->async_read.buf = config->buffer + state->head * config->buffer_size + state->head_nbyte;
+		state->async_read.nbyte = config->endpoint_size;
+
+		//if this returns > 0 then data is ready right now
+		result = mcu_usb_read(handle, &state->async_read);
+		if( result < 0 ){
+			//EAGAIN can happen if too much data arrives at one time
+			if( SYSFS_GET_RETURN_ERRNO(result) == EAGAIN ){
+				result = mcu_usb_read(handle, &state->async_read);
+			}
+
+			if( result < 0 ){
+				mcu_debug_log_error(
+							MCU_DEBUG_DEVICE,
+							"failed to read USB (%d, %d)",
+							SYSFS_GET_RETURN(result),
+							SYSFS_GET_RETURN_ERRNO(result)
+							);
+				return result;
+			}
+		}
+
+		if( result > 0 ){
+			receive(handle, result);
+		}
+
+	} while( result > 0 );
+
+	return 0;
+}
+
+void receive(const devfs_handle_t * handle, int nbyte){
+	const usbpacket_config_t * config = handle->config;
+	usbpacket_state_t * state = handle->state;
+
+	if( nbyte < 0 ){
+		return;
+	}
+
+	state->head_nbyte += nbyte;
+
+	//a short packet ends the transfer -- the buffer is also complete if another endpoint packet won't fit
+	if( (nbyte < config->endpoint_size) ||
+		 (state->head_nbyte + config->endpoint_size > config->buffer_size) ){
+		if( state->head_nbyte ){
+			state->length[state->head] = state->head_nbyte;
+			state->head_nbyte = 0;
+			state->head++;
+			if( state->head == config->buffer_count ){ state->head = 0; }
+			state->complete_count++;
+		}
+	}
+}
+
+int read_buffer(const devfs_handle_t * handle, char * dest, int nbyte){
+	const usbpacket_config_t * config = handle->config;
+	usbpacket_state_t * state = handle->state;
+	int bytes = 0;
+	int available;
+	int page_size;
+
+	while( bytes < nbyte ){
+		//data before head_nbyte is stable so it can be copied while the endpoint is receiving
+		cortexm_disable_interrupts();
+		if( state->complete_count ){
+			available = state->length[state->tail] - state->tail_offset;
+		} else {
+			available = state->head_nbyte - state->tail_offset;
+		}
+		cortexm_enable_interrupts();
+
+		if( available <= 0 ){
+			break;
+		}
+
+		page_size = nbyte - bytes;
+		if( page_size > available ){
+			page_size = available;
+		}
+
+		memcpy(dest + bytes, config->buffer + state->tail * config->buffer_size + state->tail_offset, page_size);
+		bytes += page_size;
+
+		cortexm_disable_interrupts();
+		state->tail_offset += page_size;
+		if( state->complete_count && (state->tail_offset == state->length[state->tail]) ){
+			state->tail_offset = 0;
+			state->tail++;
+			if( state->tail == config->buffer_count ){ state->tail = 0; }
+			state->complete_count--;
+			if( state->is_stalled ){
+				start_read(handle);
+			}
+		}
+		cortexm_enable_interrupts();
+	}
+
+	return bytes;
+}
+
+void data_ready(const devfs_handle_t * handle){
+	usbpacket_state_t * state = handle->state;
+	if( state->transfer_handler.read != 0 ){
+		int bytes_read;
+		if( (bytes_read = read_buffer(
+					 handle,
+					 state->transfer_handler.read->buf,
+					 state->transfer_handler.read->nbyte)) > 0 ){
+			devfs_execute_read_handler(
+						&state->transfer_handler,
+						0,
+						bytes_read,
+						MCU_EVENT_FLAG_DATA_READY);
+		}
+	}
+}
+
+void flush(const devfs_handle_t * handle){
+	usbpacket_state_t * state = handle->state;
+	cortexm_disable_interrupts();
+	state->tail = state->head;
+	state->tail_offset = state->head_nbyte;
+	state->complete_count = 0;
+	if( state->is_stalled ){
+		start_read(handle);
+	}
+	cortexm_enable_interrupts();
+}
+
+int usbpacket_open(const devfs_handle_t * handle){
+	const usbpacket_config_t * config = handle->config;
+
+	if( (config->buffer_count == 0) ||
+		 (config->buffer_count > USBPACKET_BUFFER_COUNT_MAX) ||
+		 (config->buffer_size < config->endpoint_size) ){
+		return SYSFS_SET_RETURN(EINVAL);
+	}
+
+	return mcu_usb_open(handle);
+}
+
+int usbpacket_ioctl(const devfs_handle_t * handle, int request, void * ctl){
+	fifo_info_t * info = ctl;
+	mcu_action_t * action = ctl;
+	const usbpacket_config_t * config = handle->config;
+	usbpacket_state_t * state = handle->state;
+	int result;
+	int count;
+	int i;
+	switch(request){
+		case I_FIFO_GETINFO:
+			memset(info, 0, sizeof(fifo_info_t));
+			info->size = config->buffer_count * config->buffer_size;
+			cortexm_disable_interrupts();
+			for(i=0; i < state->complete_count; i++){
+				info->size_ready += state->length[(state->tail + i) % config->buffer_count];
+			}
+			info->size_ready += state->head_nbyte;
+			info->size_ready -= state->tail_offset;
+			cortexm_enable_interrupts();
+			break;
+		case I_USB_SETACTION:
+		case I_MCU_SETACTION:
+			if( action->handler.callback == 0 ){
+				devfs_execute_read_handler(&state->transfer_handler, 0, -1, MCU_EVENT_FLAG_CANCELED);
+			} else {
+				return mcu_usb_setaction(handle, ctl);
+			}
+			return 0;
+		case I_FIFO_FLUSH:
+			flush(handle);
+			devfs_execute_read_handler(&state->transfer_handler, 0, -1, MCU_EVENT_FLAG_CANCELED);
+			break;
+		case I_USB_SETATTR:
+		{
+			usb_attr_t * attr = ctl;
+			if( attr->o_flags & USB_FLAG_SET_DEVICE ){
+				flush(handle);
+				devfs_execute_read_handler(&state->transfer_handler, 0, -1, MCU_EVENT_FLAG_CANCELED);
+			}
+		}
+
+			//setup the device to receive to the buffers when data arrives
+			result = mcu_usb_setattr(handle, ctl);
+			if( result < 0 ){ return result; }
+			/* no break */
+		case I_FIFO_INIT:
+			memset(state->length, 0, sizeof(state->length));
+			state->head = 0;
+			state->head_nbyte = 0;
+			state->tail = 0;
+			state->tail_offset = 0;
+			state->complete_count = 0;
+			state->is_stalled = 0;
+			state->async_read.tid = task_get_current();
+			state->async_read.flags = 0;
+			state->async_read.handler.callback = data_received;
+			state->async_read.handler.context = (void*)handle;
+			state->async_read.loc = config->endpoint;
+			state->async_read.buf = config->buffer;
+			state->async_read.nbyte = config->endpoint_size;
+
+			count = 0;
+			do {
+				//discard stale data and get an async call
+				result = mcu_usb_read(handle, &state->async_read);
+				state->async_read.nbyte = config->endpoint_size;
+				count++;
+			} while( (result > 0) && (count < 10) );
+			if ( result < 0 ){
+				return SYSFS_SET_RETURN(EIO);
+			}
+
+			break;
+		case I_FIFO_EXIT:
+			//clear the callback for the device
+			result = cancel_read_action(handle);
+			if( result < 0 ){ return SYSFS_SET_RETURN(EIO); }
+			return mcu_usb_close(handle);
+		default:
+			return mcu_usb_ioctl(handle, request, ctl);
+	}
+	return 0;
+}
+
+int usbpacket_read(const devfs_handle_t * handle, devfs_async_t * async){
+	usbpacket_state_t * state = handle->state;
+	int bytes_read;
+
+	DEVFS_DRIVER_IS_BUSY(state->transfer_handler.read, async);
+
+	bytes_read = read_buffer(handle, async->buf, async->nbyte);
+	if( (bytes_read == 0) && (async->flags & O_NONBLOCK) ){
+		bytes_read = SYSFS_SET_RETURN(EAGAIN);
+	}
+
+	if( bytes_read != 0 ){
+		state->transfer_handler.read = 0;
+	}
+
+	return bytes_read;
+}
+
+int usbpacket_write(const devfs_handle_t * handle, devfs_async_t * async){
+	const usbpacket_config_t * config = handle->config;
+	async->loc = 0x80 | config->endpoint;
+	//writes go directly to the USB hardware
+	if( mcu_usb_isconnected(handle, NULL) == 0 ){
+		return SYSFS_SET_RETURN(ENODEV);
+	}
+
+	return mcu_usb_write(handle, async);
+}
+
+int usbpacket_close(const devfs_handle_t * handle){
+	//use I_FIFO_EXIT to close the USB
+	return mcu_usb_close(handle);
+}
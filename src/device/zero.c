@@ -44,3 +44,11 @@ int zero_close(const devfs_handle_t * handle){
 	return 0;
 }
 
+int zero_try_read(const devfs_handle_t * handle, devfs_async_t * rop){
+	return zero_read(handle, rop);
+}
+
+int zero_try_write(const devfs_handle_t * handle, devfs_async_t * wop){
+	return zero_write(handle, wop);
+}
+
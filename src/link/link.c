@@ -24,6 +24,8 @@
 
 #define MAX_TRIES 2
 
+static int connected(link_transport_mdriver_t * driver);
+
 const link_transport_mdriver_t link_default_driver = {
 	.getname = link_phy_getname,
 	.lock = link_phy_lock,
@@ -42,7 +44,7 @@ const link_transport_mdriver_t link_default_driver = {
 	.transport_version = 0
 };
 
-int link_errno;
+LINK_THREAD_LOCAL int link_errno;
 
 void link_load_default_driver(link_transport_mdriver_t * driver){
 	link_debug(LINK_DEBUG_INFO, "Load default read driver");
@@ -103,25 +105,25 @@ int link_connect(link_transport_mdriver_t * driver, const char * sn){
 
 				if( (sn == NULL) || (strlen(sn) == 0) || (strcmp(sn, serialno) == 0) ){
 					link_debug(LINK_DEBUG_MESSAGE, "Open Anon at %p", driver->phy_driver.handle);
-					return 0;
+					return connected(driver);
 				}
 
 				if( (strcmp(sn, serialno) == 0) ){
 					link_debug(LINK_DEBUG_MESSAGE, "Open %s at %p", sn, driver->phy_driver.handle);
-					return 0;
+					return connected(driver);
 				}
 
 				//check for half the serial number for compatibility to old serial number format
 				len = strlen(sn);
 				if( strcmp(&(sn[len/2]), serialno) == 0 ){
 					link_debug(LINK_DEBUG_MESSAGE, "Open SN at %p", driver->phy_driver.handle);
-					return 0;
+					return connected(driver);
 				}
 
 				len = strlen(serialno);
 				if( strcmp(sn, &(serialno[len/2])) == 0 ){
 					link_debug(LINK_DEBUG_MESSAGE, "Open SN at %p", driver->phy_driver.handle);
-					return 0;
+					return connected(driver);
 				}
 			}
 			link_debug(LINK_DEBUG_MESSAGE, "Close Handle");
@@ -142,6 +144,47 @@ int link_connect(link_transport_mdriver_t * driver, const char * sn){
 }
 
 
+int connected(link_transport_mdriver_t * driver){
+	//older devices and the bootloader reject the command and stay at the default packet size
+	link_set_packet_size(driver, LINK2_PACKET_DATA_SIZE_MAX);
+	return 0;
+}
+
+int link_set_packet_size(link_transport_mdriver_t * driver, int size){
+	link_op_t op;
+	link_reply_t reply;
+	int err;
+
+	op.packet_size.cmd = LINK_CMD_SETPACKETSIZE;
+	op.packet_size.size = size;
+
+	link_debug(LINK_DEBUG_INFO, "request %d byte packets", size);
+	err = link_transport_masterwrite(driver, &op, sizeof(link_packet_size_t));
+	if ( err < 0 ){
+		link_error("failed to write op");
+		return link_handle_err(driver, err);
+	}
+
+	err = link_transport_masterread(driver, &reply, sizeof(reply));
+	if ( err < 0 ){
+		link_error("failed to read reply");
+		return link_handle_err(driver, err);
+	}
+
+	if( reply.err < 0 ){
+		link_errno = reply.err_number;
+		return reply.err;
+	}
+
+	//the slave has already switched to the size it replied with
+	if( driver->transport_version == 2 ){
+		link2_transport_set_packet_data_size(&driver->phy_driver, reply.err);
+	}
+
+	link_debug(LINK_DEBUG_MESSAGE, "using %d byte packets", link2_transport_get_packet_data_size(&driver->phy_driver));
+	return link2_transport_get_packet_data_size(&driver->phy_driver);
+}
+
 int link_readserialno(link_transport_mdriver_t * driver, char * serialno, int len){
 	link_op_t op;
 	link_reply_t reply;
@@ -0,0 +1,287 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sos/fs/drive_assetfs.h"
+#include "link_local.h"
+
+typedef struct {
+	u32 hash;
+	const link_assetfs_source_t * source;
+	drive_assetfs_dirent_t entry;
+	u8 * data;
+} pack_item_t;
+
+static int compare_items(const void * a, const void * b);
+static int load_file(const char * path, u8 ** data);
+static int write_padding(u32 size, FILE * out);
+
+int link_drive_assetfs_pack(const link_assetfs_source_t * sources, int count, FILE * out){
+	drive_assetfs_header_v2_t header;
+	pack_item_t * items;
+	u8 * compressed;
+	u32 offset;
+	int size;
+	int i;
+	int ret = -1;
+
+	if( count < 0 ){ return -1; }
+
+	items = calloc(count ? count : 1, sizeof(pack_item_t));
+	if( items == 0 ){
+		link_error("failed to allocate %d items", count);
+		return -1;
+	}
+
+	for(i=0; i < count; i++){
+		if( strnlen(sources[i].name, LINK_NAME_MAX) >= LINK_NAME_MAX ){
+			link_error("name %s is too long", sources[i].name);
+			goto pack_exit;
+		}
+		items[i].source = sources + i;
+		items[i].hash = drive_assetfs_hash(sources[i].name, LINK_NAME_MAX-1);
+		strncpy(items[i].entry.name, sources[i].name, LINK_NAME_MAX);
+		items[i].entry.uid = sources[i].uid;
+		items[i].entry.mode = sources[i].mode;
+
+		if( (size = load_file(sources[i].path, &items[i].data)) < 0 ){
+			link_error("failed to read %s", sources[i].path);
+			goto pack_exit;
+		}
+
+		if( sources[i].o_flags & LINK_ASSETFS_FLAG_COMPRESS ){
+			if( (size = link_assetfs_compress(items[i].data, size, &compressed)) < 0 ){
+				link_error("failed to compress %s", sources[i].path);
+				goto pack_exit;
+			}
+			free(items[i].data);
+			items[i].data = compressed;
+		}
+		items[i].entry.size = size;
+	}
+
+	//the device does a binary search on the hashes
+	qsort(items, count, sizeof(pack_item_t), compare_items);
+
+	for(i=1; i < count; i++){
+		if( strncmp(items[i].entry.name, items[i-1].entry.name, LINK_NAME_MAX) == 0 ){
+			link_error("duplicate name %s", items[i].entry.name);
+			goto pack_exit;
+		}
+	}
+
+	header.signature = DRIVE_ASSETFS_SIGNATURE_V2;
+	header.count = count;
+	header.hash_offset = sizeof(header);
+	header.entry_offset = header.hash_offset + count*sizeof(u32);
+
+	//file data is word aligned after the directory
+	offset = header.entry_offset + count*sizeof(drive_assetfs_dirent_t);
+	offset = (offset + 3) & ~3;
+	for(i=0; i < count; i++){
+		items[i].entry.start = offset;
+		offset = (offset + items[i].entry.size + 3) & ~3;
+	}
+
+	if( fwrite(&header, sizeof(header), 1, out) != 1 ){ goto pack_exit; }
+	for(i=0; i < count; i++){
+		if( fwrite(&items[i].hash, sizeof(u32), 1, out) != 1 ){ goto pack_exit; }
+	}
+	for(i=0; i < count; i++){
+		if( fwrite(&items[i].entry, sizeof(drive_assetfs_dirent_t), 1, out) != 1 ){ goto pack_exit; }
+	}
+
+	offset = header.entry_offset + count*sizeof(drive_assetfs_dirent_t);
+	for(i=0; i < count; i++){
+		if( write_padding(items[i].entry.start - offset, out) < 0 ){ goto pack_exit; }
+		if( items[i].entry.size &&
+			 (fwrite(items[i].data, items[i].entry.size, 1, out) != 1) ){
+			link_error("failed to write %s", items[i].entry.name);
+			goto pack_exit;
+		}
+		offset = items[i].entry.start + items[i].entry.size;
+	}
+
+	ret = offset;
+
+pack_exit:
+	for(i=0; i < count; i++){
+		free(items[i].data);
+	}
+	free(items);
+	return ret;
+}
+
+int link_assetfs_compress(const void * data, u32 size, u8 ** compressed){
+	assetfs_chunk_header_t header;
+	u8 check[ASSETFS_CHUNK_SIZE];
+	u8 scratch[ASSETFS_CHUNK_SIZE*2];
+	u32 * offset;
+	u8 * result;
+	u8 * op;
+	u32 chunk_length;
+	u32 table_size;
+	u32 i;
+	int length;
+
+	header.signature = ASSETFS_CHUNK_SIGNATURE;
+	header.size = size;
+	header.chunk_size = ASSETFS_CHUNK_SIZE;
+	header.chunk_count = (size + ASSETFS_CHUNK_SIZE - 1) / ASSETFS_CHUNK_SIZE;
+	table_size = (header.chunk_count + 1) * sizeof(u32);
+
+	//chunks never grow because incompressible ones are stored as is
+	result = malloc(sizeof(header) + table_size + size);
+	if( result == 0 ){ return -1; }
+
+	memcpy(result, &header, sizeof(header));
+	offset = (u32*)(result + sizeof(header));
+	op = result + sizeof(header) + table_size;
+
+	for(i=0; i < header.chunk_count; i++){
+		const u8 * chunk = (const u8*)data + i*ASSETFS_CHUNK_SIZE;
+		chunk_length = size - i*ASSETFS_CHUNK_SIZE;
+		if( chunk_length > ASSETFS_CHUNK_SIZE ){ chunk_length = ASSETFS_CHUNK_SIZE; }
+
+		offset[i] = op - result;
+		length = assetfs_chunk_compress(chunk, chunk_length, scratch);
+
+		//every chunk is decoded before it is accepted
+		if( (length < 0) ||
+			 (length >= (int)chunk_length) ||
+			 (assetfs_chunk_decompress(scratch, length, check, chunk_length) != (int)chunk_length) ||
+			 (memcmp(check, chunk, chunk_length) != 0) ){
+			memcpy(op, chunk, chunk_length);
+			length = chunk_length;
+		} else {
+			memcpy(op, scratch, length);
+		}
+		op += length;
+	}
+	offset[i] = op - result;
+
+	*compressed = result;
+	return op - result;
+}
+
+int link_assetfs_compress_file(const char * path, FILE * out){
+	u8 * data;
+	u8 * compressed;
+	int size;
+
+	if( (size = load_file(path, &data)) < 0 ){
+		link_error("failed to read %s", path);
+		return -1;
+	}
+
+	size = link_assetfs_compress(data, size, &compressed);
+	free(data);
+	if( size < 0 ){ return -1; }
+
+	if( fwrite(compressed, size, 1, out) != 1 ){
+		size = -1;
+	}
+	free(compressed);
+	return size;
+}
+
+int link_assetfs_decompress(const void * compressed, u32 size, u8 ** data){
+	const u8 * src = compressed;
+	assetfs_chunk_header_t header;
+	u32 offset[2];
+	u8 * result;
+	u32 chunk_length;
+	u32 i;
+
+	if( size < sizeof(header) ){ return -1; }
+	memcpy(&header, src, sizeof(header));
+	if( assetfs_chunk_is_valid(&header, size) == 0 ){
+		return -1;
+	}
+
+	result = malloc(header.size ? header.size : 1);
+	if( result == 0 ){ return -1; }
+
+	for(i=0; i < header.chunk_count; i++){
+		chunk_length = header.size - i*ASSETFS_CHUNK_SIZE;
+		if( chunk_length > ASSETFS_CHUNK_SIZE ){ chunk_length = ASSETFS_CHUNK_SIZE; }
+
+		memcpy(offset, src + sizeof(header) + i*sizeof(u32), sizeof(offset));
+		if( assetfs_chunk_is_valid_offset(&header, size, offset) == 0 ){
+			free(result);
+			return -1;
+		}
+
+		if( offset[1] - offset[0] == chunk_length ){
+			memcpy(result + i*ASSETFS_CHUNK_SIZE, src + offset[0], chunk_length);
+		} else if( assetfs_chunk_decompress(src + offset[0], offset[1] - offset[0],
+											 result + i*ASSETFS_CHUNK_SIZE, chunk_length) != (int)chunk_length ){
+			free(result);
+			return -1;
+		}
+	}
+
+	*data = result;
+	return header.size;
+}
+
+int compare_items(const void * a, const void * b){
+	const pack_item_t * item_a = a;
+	const pack_item_t * item_b = b;
+	if( item_a->hash < item_b->hash ){ return -1; }
+	if( item_a->hash > item_b->hash ){ return 1; }
+	return strncmp(item_a->entry.name, item_b->entry.name, LINK_NAME_MAX);
+}
+
+int load_file(const char * path, u8 ** data){
+	FILE * f;
+	long size;
+
+	f = fopen(path, "rb");
+	if( f == 0 ){ return -1; }
+	if( (fseek(f, 0, SEEK_END) != 0) || ((size = ftell(f)) < 0) || (fseek(f, 0, SEEK_SET) != 0) ){
+		fclose(f);
+		return -1;
+	}
+
+	*data = malloc(size ? size : 1);
+	if( *data == 0 ){
+		fclose(f);
+		return -1;
+	}
+
+	if( size && (fread(*data, size, 1, f) != 1) ){
+		free(*data);
+		*data = 0;
+		fclose(f);
+		return -1;
+	}
+
+	fclose(f);
+	return (int)size;
+}
+
+int write_padding(u32 size, FILE * out){
+	const u8 padding[4] = {0xff, 0xff, 0xff, 0xff};
+	if( size && (fwrite(padding, 1, size, out) != size) ){
+		return -1;
+	}
+	return 0;
+}
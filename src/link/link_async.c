@@ -0,0 +1,303 @@
+/* Copyright 2011-2016 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "link_local.h"
+
+//consecutive reads of adjacent locations are merged into one transfer up to this size
+#define MERGE_MAX (16*1024)
+#define BATCH_MAX 32
+
+typedef struct {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t request_cond;
+	pthread_cond_t complete_cond;
+	char * merge_buffer;
+} async_thread_t;
+
+static void * io_thread(void * args);
+static int take_batch(link_async_t * async, link_async_request_t ** batch);
+static void execute_batch(link_async_t * async, link_async_request_t ** batch, int count);
+static int execute_request(link_async_t * async, link_async_request_t * request);
+static int is_mergeable(const link_async_request_t * first, const link_async_request_t * last, const link_async_request_t * next, int nbyte);
+
+int link_async_start(link_async_t * async, link_transport_mdriver_t * driver){
+	async_thread_t * t;
+
+	memset(async, 0, sizeof(link_async_t));
+	t = malloc(sizeof(async_thread_t));
+	if( t == 0 ){
+		return -1;
+	}
+
+	t->merge_buffer = malloc(MERGE_MAX);
+	if( t->merge_buffer == 0 ){
+		free(t);
+		return -1;
+	}
+
+	pthread_mutex_init(&t->mutex, 0);
+	pthread_cond_init(&t->request_cond, 0);
+	pthread_cond_init(&t->complete_cond, 0);
+	async->driver = driver;
+	async->thread = t;
+
+	if( pthread_create(&t->thread, 0, io_thread, async) != 0 ){
+		link_error("failed to create async thread");
+		pthread_cond_destroy(&t->complete_cond);
+		pthread_cond_destroy(&t->request_cond);
+		pthread_mutex_destroy(&t->mutex);
+		free(t->merge_buffer);
+		free(t);
+		async->thread = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+void link_async_stop(link_async_t * async){
+	async_thread_t * t = async->thread;
+	if( t == 0 ){
+		return;
+	}
+
+	//requests that are already queued are executed before the thread exits
+	pthread_mutex_lock(&t->mutex);
+	async->is_stopping = 1;
+	pthread_cond_signal(&t->request_cond);
+	pthread_mutex_unlock(&t->mutex);
+
+	pthread_join(t->thread, 0);
+	pthread_cond_destroy(&t->complete_cond);
+	pthread_cond_destroy(&t->request_cond);
+	pthread_mutex_destroy(&t->mutex);
+	free(t->merge_buffer);
+	free(t);
+	async->thread = 0;
+}
+
+int link_async_submit(link_async_t * async, link_async_request_t * request){
+	async_thread_t * t = async->thread;
+	if( t == 0 ){
+		return -1;
+	}
+
+	request->result = 0;
+	request->err_number = 0;
+	request->is_complete = 0;
+	request->next = 0;
+
+	pthread_mutex_lock(&t->mutex);
+	if( async->is_stopping ){
+		pthread_mutex_unlock(&t->mutex);
+		return -1;
+	}
+	if( async->tail ){
+		async->tail->next = request;
+	} else {
+		async->head = request;
+	}
+	async->tail = request;
+	pthread_cond_signal(&t->request_cond);
+	pthread_mutex_unlock(&t->mutex);
+	return 0;
+}
+
+int link_async_read(link_async_t * async, link_async_request_t * request, int fildes, int loc, void * buf, int nbyte, link_async_callback_t callback, void * context){
+	request->op = LINK_ASYNC_OP_READ;
+	request->fildes = fildes;
+	request->loc = loc;
+	request->buf = buf;
+	request->nbyte = nbyte;
+	request->callback = callback;
+	request->context = context;
+	return link_async_submit(async, request);
+}
+
+int link_async_write(link_async_t * async, link_async_request_t * request, int fildes, int loc, const void * buf, int nbyte, link_async_callback_t callback, void * context){
+	request->op = LINK_ASYNC_OP_WRITE;
+	request->fildes = fildes;
+	request->loc = loc;
+	request->buf = (void*)buf;
+	request->nbyte = nbyte;
+	request->callback = callback;
+	request->context = context;
+	return link_async_submit(async, request);
+}
+
+int link_async_ioctl(link_async_t * async, link_async_request_t * request, int fildes, int request_number, void * ctl, link_async_callback_t callback, void * context){
+	request->op = LINK_ASYNC_OP_IOCTL;
+	request->fildes = fildes;
+	request->loc = -1;
+	request->buf = ctl;
+	request->nbyte = request_number;
+	request->callback = callback;
+	request->context = context;
+	return link_async_submit(async, request);
+}
+
+int link_async_wait(link_async_t * async, link_async_request_t * request){
+	async_thread_t * t = async->thread;
+	if( t == 0 ){
+		return -1;
+	}
+
+	pthread_mutex_lock(&t->mutex);
+	while( request->is_complete == 0 ){
+		pthread_cond_wait(&t->complete_cond, &t->mutex);
+	}
+	pthread_mutex_unlock(&t->mutex);
+
+	link_errno = request->err_number;
+	return request->result;
+}
+
+void * io_thread(void * args){
+	link_async_t * async = args;
+	link_async_request_t * batch[BATCH_MAX];
+	int count;
+
+	while( (count = take_batch(async, batch)) > 0 ){
+		execute_batch(async, batch, count);
+	}
+
+	return 0;
+}
+
+int take_batch(link_async_t * async, link_async_request_t ** batch){
+	async_thread_t * t = async->thread;
+	link_async_request_t * request;
+	int count;
+	int nbyte;
+
+	pthread_mutex_lock(&t->mutex);
+	while( (async->head == 0) && (async->is_stopping == 0) ){
+		pthread_cond_wait(&t->request_cond, &t->mutex);
+	}
+
+	count = 0;
+	request = async->head;
+	if( request ){
+		batch[count++] = request;
+		nbyte = request->nbyte;
+		while( (count < BATCH_MAX) &&
+				 is_mergeable(batch[0], batch[count-1], request->next, nbyte) ){
+			request = request->next;
+			batch[count++] = request;
+			nbyte += request->nbyte;
+		}
+
+		async->head = request->next;
+		if( async->head == 0 ){
+			async->tail = 0;
+		}
+	}
+	pthread_mutex_unlock(&t->mutex);
+	return count;
+}
+
+int is_mergeable(const link_async_request_t * first, const link_async_request_t * last, const link_async_request_t * next, int nbyte){
+	if( (next == 0) || (first->op != LINK_ASYNC_OP_READ) || (first->loc < 0) ){
+		return 0;
+	}
+
+	return (next->op == LINK_ASYNC_OP_READ) &&
+			(next->fildes == first->fildes) &&
+			(next->loc == last->loc + last->nbyte) &&
+			(nbyte + next->nbyte <= MERGE_MAX);
+}
+
+void execute_batch(link_async_t * async, link_async_request_t ** batch, int count){
+	async_thread_t * t = async->thread;
+	int i;
+
+	if( count == 1 ){
+		batch[0]->result = execute_request(async, batch[0]);
+		batch[0]->err_number = link_errno;
+	} else {
+		int total = 0;
+		int offset;
+		int result;
+
+		for(i=0; i < count; i++){
+			total += batch[i]->nbyte;
+		}
+
+		link_debug(LINK_DEBUG_INFO, "merge %d reads (%d bytes) at %d", count, total, batch[0]->loc);
+		result = link_lseek(async->driver, batch[0]->fildes, batch[0]->loc, LINK_SEEK_SET);
+		if( result >= 0 ){
+			result = link_read(async->driver, batch[0]->fildes, t->merge_buffer, total);
+		}
+
+		//a short read is split across the requests in order
+		offset = 0;
+		for(i=0; i < count; i++){
+			batch[i]->err_number = link_errno;
+			if( result < 0 ){
+				batch[i]->result = result;
+			} else {
+				int available = result - offset;
+				if( available < 0 ){ available = 0; }
+				if( available > batch[i]->nbyte ){ available = batch[i]->nbyte; }
+				memcpy(batch[i]->buf, t->merge_buffer + offset, available);
+				batch[i]->result = available;
+			}
+			offset += batch[i]->nbyte;
+		}
+	}
+
+	for(i=0; i < count; i++){
+		//the callback runs before the request is marked complete so the waiter can release it after
+		if( batch[i]->callback ){
+			batch[i]->callback(batch[i], batch[i]->context);
+		}
+
+		pthread_mutex_lock(&t->mutex);
+		batch[i]->is_complete = 1;
+		pthread_mutex_unlock(&t->mutex);
+	}
+
+	pthread_mutex_lock(&t->mutex);
+	pthread_cond_broadcast(&t->complete_cond);
+	pthread_mutex_unlock(&t->mutex);
+}
+
+int execute_request(link_async_t * async, link_async_request_t * request){
+	int result;
+
+	if( (request->op != LINK_ASYNC_OP_IOCTL) && (request->loc >= 0) ){
+		result = link_lseek(async->driver, request->fildes, request->loc, LINK_SEEK_SET);
+		if( result < 0 ){
+			return result;
+		}
+	}
+
+	switch(request->op){
+		case LINK_ASYNC_OP_READ:
+			return link_read(async->driver, request->fildes, request->buf, request->nbyte);
+		case LINK_ASYNC_OP_WRITE:
+			return link_write(async->driver, request->fildes, request->buf, request->nbyte);
+		case LINK_ASYNC_OP_IOCTL:
+			return link_ioctl(async->driver, request->fildes, request->nbyte, request->buf);
+	}
+
+	return LINK_PROT_ERROR;
+}
@@ -0,0 +1,199 @@
+/* Copyright 2011-2016 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include "link_local.h"
+
+#define DEFAULT_THREAD_COUNT 8
+#define MAX_THREAD_COUNT 64
+
+typedef struct {
+	const link_transport_mdriver_t * driver;
+	char (*names)[LINK_PHY_NAME_MAX];
+	int name_count;
+	int next /*! Index of the next name to probe */;
+	link_device_t * devices;
+	int max;
+	int count;
+	pthread_mutex_t mutex;
+} probe_t;
+
+static int get_names(const link_transport_mdriver_t * driver, char (**names)[LINK_PHY_NAME_MAX]);
+static int probe_name(const link_transport_mdriver_t * driver, const char * name, link_device_t * device);
+static void * probe_thread(void * args);
+static int compare_devices(const void * a, const void * b);
+
+int link_probe_devices(const link_transport_mdriver_t * driver, link_device_t * devices, int max, int thread_count){
+	pthread_t threads[MAX_THREAD_COUNT];
+	probe_t probe;
+	int i;
+	int started;
+
+	memset(&probe, 0, sizeof(probe));
+	probe.driver = driver;
+	probe.devices = devices;
+	probe.max = max;
+
+	probe.name_count = get_names(driver, &probe.names);
+	if( probe.name_count < 0 ){
+		return LINK_PHY_ERROR;
+	}
+
+	if( thread_count <= 0 ){ thread_count = DEFAULT_THREAD_COUNT; }
+	if( thread_count > MAX_THREAD_COUNT ){ thread_count = MAX_THREAD_COUNT; }
+	if( thread_count > probe.name_count ){ thread_count = probe.name_count; }
+
+	link_debug(LINK_DEBUG_MESSAGE, "Probe %d ports on %d threads", probe.name_count, thread_count);
+
+	pthread_mutex_init(&probe.mutex, 0);
+
+	//each port is opened and asked for its serial number on a worker thread
+	started = 0;
+	for(i=0; i < thread_count; i++){
+		if( pthread_create(threads + started, 0, probe_thread, &probe) == 0 ){
+			started++;
+		} else {
+			link_error("failed to create probe thread");
+		}
+	}
+
+	if( started == 0 ){
+		probe_thread(&probe);
+	}
+
+	for(i=0; i < started; i++){
+		pthread_join(threads[i], 0);
+	}
+
+	pthread_mutex_destroy(&probe.mutex);
+	free(probe.names);
+
+	//sorted by serial number for link_find_device()
+	qsort(devices, probe.count, sizeof(link_device_t), compare_devices);
+	return probe.count;
+}
+
+link_device_t * link_find_device(link_device_t * devices, int count, const char * serialno){
+	link_device_t key;
+	memset(key.serialno, 0, LINK_DEVICE_SERIALNO_SIZE);
+	strncpy(key.serialno, serialno, LINK_DEVICE_SERIALNO_SIZE-1);
+	return bsearch(&key, devices, count, sizeof(link_device_t), compare_devices);
+}
+
+void link_disconnect_devices(link_device_t * devices, int count){
+	int i;
+	for(i=0; i < count; i++){
+		link_disconnect(&devices[i].driver);
+	}
+}
+
+int get_names(const link_transport_mdriver_t * driver, char (**names)[LINK_PHY_NAME_MAX]){
+	char name[LINK_PHY_NAME_MAX];
+	char last[LINK_PHY_NAME_MAX];
+	char (*list)[LINK_PHY_NAME_MAX] = 0;
+	void * resized;
+	int count = 0;
+	int size = 0;
+
+	//enumerating names doesn't touch the devices so it is done before the threads start
+	memset(last, 0, LINK_PHY_NAME_MAX);
+	while( driver->getname(name, last, LINK_PHY_NAME_MAX) == 0 ){
+		name[LINK_PHY_NAME_MAX-1] = 0;
+		if( strcmp(name, last) == 0 ){ break; }
+
+		if( count == size ){
+			size = size ? size*2 : 16;
+			resized = realloc(list, size * LINK_PHY_NAME_MAX);
+			if( resized == 0 ){
+				free(list);
+				return -1;
+			}
+			list = resized;
+		}
+
+		strcpy(list[count++], name);
+		strcpy(last, name);
+	}
+
+	*names = list;
+	return count;
+}
+
+int probe_name(const link_transport_mdriver_t * driver, const char * name, link_device_t * device){
+	char serialno[LINK_MAX_SN_SIZE];
+
+	memcpy(&device->driver, driver, sizeof(link_transport_mdriver_t));
+	device->driver.transport_version = 0;
+	device->driver.phy_driver.handle = device->driver.phy_driver.open(name, driver->options);
+	if( device->driver.phy_driver.handle == LINK_PHY_OPEN_ERROR ){
+		link_debug(LINK_DEBUG_INFO, "Failed to open %s", name);
+		return -1;
+	}
+
+	memset(serialno, 0, LINK_MAX_SN_SIZE);
+	if( link_readserialno(&device->driver, serialno, LINK_MAX_SN_SIZE-1) == 0 ){
+		memset(device->serialno, 0, LINK_DEVICE_SERIALNO_SIZE);
+		strncpy(device->serialno, serialno, LINK_DEVICE_SERIALNO_SIZE-1);
+		memset(device->driver.dev_name, 0, LINK_PHY_NAME_MAX);
+		strncpy(device->driver.dev_name, name, LINK_PHY_NAME_MAX-1);
+		return 0;
+	}
+
+	link_disconnect(&device->driver);
+	return -1;
+}
+
+void * probe_thread(void * args){
+	probe_t * probe = args;
+	link_device_t device;
+	int is_stored;
+	int i;
+
+	for(;;){
+		pthread_mutex_lock(&probe->mutex);
+		i = probe->next++;
+		pthread_mutex_unlock(&probe->mutex);
+
+		if( i >= probe->name_count ){ break; }
+		if( probe_name(probe->driver, probe->names[i], &device) < 0 ){ continue; }
+
+		link_debug(LINK_DEBUG_MESSAGE, "Found %s at %s", device.serialno, device.driver.dev_name);
+		pthread_mutex_lock(&probe->mutex);
+		is_stored = probe->count < probe->max;
+		if( is_stored ){
+			memcpy(probe->devices + probe->count, &device, sizeof(link_device_t));
+			probe->count++;
+		}
+		pthread_mutex_unlock(&probe->mutex);
+
+		if( is_stored == 0 ){
+			//no room for this device
+			link_disconnect(&device.driver);
+		}
+	}
+
+	return 0;
+}
+
+int compare_devices(const void * a, const void * b){
+	const link_device_t * device_a = a;
+	const link_device_t * device_b = b;
+	return strcmp(device_a->serialno, device_b->serialno);
+}
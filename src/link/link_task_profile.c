@@ -0,0 +1,73 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include <string.h>
+#include "sos/dev/sys.h"
+#include "link_local.h"
+
+int link_get_task_profile(link_transport_mdriver_t * driver, sys_taskprofile_t * profile, int max){
+	int fd;
+	int err;
+	int count;
+
+	fd = link_open(driver, "/dev/sys", LINK_O_RDWR);
+	if( fd < 0 ){
+		link_error("failed to open /dev/sys");
+		return link_handle_err(driver, fd);
+	}
+
+	//read until the kernel runs out of tasks (or the caller runs out of space)
+	for(count = 0; count < max; count++){
+		memset(profile + count, 0, sizeof(sys_taskprofile_t));
+		profile[count].tid = count;
+		err = link_ioctl(driver, fd, I_SYS_GETTASKPROFILE, profile + count);
+		if( err == LINK_PHY_ERROR ){
+			link_error("failed to I_SYS_GETTASKPROFILE");
+			return err;
+		}
+
+		if( err < 0 ){
+			break;
+		}
+	}
+
+	if( link_close(driver, fd) < 0 ){
+		link_error("failed to close fd");
+		return LINK_PHY_ERROR;
+	}
+
+	return count;
+}
+
+void link_diff_task_profile(const sys_taskprofile_t * previous, const sys_taskprofile_t * current, sys_taskprofile_t * delta){
+	int i;
+
+	memcpy(delta, current, sizeof(sys_taskprofile_t));
+	if( (previous->is_enabled == 0) || (previous->pid != current->pid) ){
+		//the task slot was reused -- the current values are all new
+		return;
+	}
+
+	//unsigned subtraction handles the counters wrapping between samples
+	delta->run_cycles = current->run_cycles - previous->run_cycles;
+	delta->switch_count = current->switch_count - previous->switch_count;
+	for(i=0; i < SYS_TASKPROFILE_BLOCK_COUNT; i++){
+		delta->block_usec[i] = current->block_usec[i] - previous->block_usec[i];
+	}
+}
@@ -0,0 +1,156 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include <string.h>
+#include "sos/dev/sys.h"
+#include "link_local.h"
+
+static const char * get_event_name(u16 event_id);
+static void write_event(link_trace_decoder_t * decoder, FILE * out, const char * name, char phase, u32 tid, const char * args);
+
+int link_read_trace(link_transport_mdriver_t * driver, u32 o_flags, sys_trace_read_t * trace){
+	int fd;
+	int err;
+
+	fd = link_open(driver, "/dev/sys", LINK_O_RDWR);
+	if( fd < 0 ){
+		link_error("failed to open /dev/sys");
+		return link_handle_err(driver, fd);
+	}
+
+	memset(trace, 0, sizeof(sys_trace_read_t));
+	trace->o_flags = o_flags;
+	err = link_ioctl(driver, fd, I_SYS_READTRACE, trace);
+	if( err == LINK_PHY_ERROR ){
+		link_error("failed to I_SYS_READTRACE");
+		return err;
+	}
+
+	if( link_close(driver, fd) < 0 ){
+		link_error("failed to close fd");
+		return LINK_PHY_ERROR;
+	}
+
+	return err;
+}
+
+void link_trace_json_start(link_trace_decoder_t * decoder, FILE * out){
+	memset(decoder, 0, sizeof(link_trace_decoder_t));
+	decoder->current_tid = -1;
+	fprintf(out, "{\"traceEvents\":[\n");
+}
+
+int link_trace_json_write(link_trace_decoder_t * decoder, const sys_trace_read_t * trace, FILE * out){
+	u32 i;
+	char args[64];
+	const link_trace_record_t * record;
+
+	if( trace->frequency ){
+		decoder->frequency = trace->frequency;
+	}
+
+	if( trace->dropped ){
+		snprintf(args, sizeof(args), "{\"count\":%u}", trace->dropped);
+		write_event(decoder, out, "dropped", 'i', 0, args);
+	}
+
+	for(i=0; (i < trace->count) && (i < SYS_TRACE_READ_MAX); i++){
+		record = trace->record + i;
+
+		//the device only stores the low 32 bits of the cycle counter
+		if( decoder->record_count == 0 ){
+			decoder->cycles = record->timestamp;
+		} else {
+			decoder->cycles += (u32)(record->timestamp - decoder->last_timestamp);
+		}
+		decoder->last_timestamp = record->timestamp;
+		decoder->record_count++;
+
+		switch(record->event_id){
+			case LINK_TRACE_RECORD_SWITCH:
+				if( decoder->current_tid >= 0 ){
+					write_event(decoder, out, "run", 'E', decoder->current_tid, 0);
+				}
+				write_event(decoder, out, "run", 'B', record->tid, 0);
+				decoder->current_tid = record->tid;
+				break;
+
+			case LINK_TRACE_RECORD_READY:
+				write_event(decoder, out, "ready", 'i', record->value, 0);
+				break;
+
+			case LINK_TRACE_RECORD_BEGIN:
+			case LINK_TRACE_RECORD_END:
+				snprintf(args, sizeof(args), "{\"span\":%u}", record->value);
+				write_event(decoder, out, "span",
+								record->event_id == LINK_TRACE_RECORD_BEGIN ? 'B' : 'E',
+								record->tid, args);
+				break;
+
+			default:
+				snprintf(args, sizeof(args), "{\"id\":%u,\"value\":%u}", record->event_id, record->value);
+				write_event(decoder, out, get_event_name(record->event_id), 'i', record->tid, args);
+				break;
+		}
+	}
+
+	return trace->count;
+}
+
+void link_trace_json_finish(link_trace_decoder_t * decoder, FILE * out){
+	if( decoder->current_tid >= 0 ){
+		write_event(decoder, out, "run", 'E', decoder->current_tid, 0);
+		decoder->current_tid = -1;
+	}
+	fprintf(out, "\n]}\n");
+}
+
+void write_event(link_trace_decoder_t * decoder, FILE * out, const char * name, char phase, u32 tid, const char * args){
+	double usec = 0.0;
+
+	if( decoder->frequency ){
+		usec = (double)decoder->cycles * 1000000.0 / decoder->frequency;
+	}
+
+	fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":0,\"tid\":%u",
+			  decoder->event_count ? ",\n" : "",
+			  name, phase, usec, tid);
+
+	if( phase == 'i' ){
+		fprintf(out, ",\"s\":\"%c\"", (strcmp(name, "dropped") == 0) ? 'g' : 't');
+	}
+
+	if( args ){
+		fprintf(out, ",\"args\":%s", args);
+	}
+
+	fprintf(out, "}");
+	decoder->event_count++;
+}
+
+const char * get_event_name(u16 event_id){
+	switch(event_id){
+		case LINK_POSIX_TRACE_MESSAGE: return "message";
+		case LINK_POSIX_TRACE_WARNING: return "warning";
+		case LINK_POSIX_TRACE_CRITICAL: return "critical";
+		case LINK_POSIX_TRACE_FATAL: return "fatal";
+		case LINK_POSIX_TRACE_ERROR: return "error";
+	}
+	return "event";
+}
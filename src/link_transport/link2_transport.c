@@ -26,7 +26,7 @@ void link2_transport_insert_checksum(link2_pkt_t * pkt){
 
 bool link2_transport_checksum_isok(link2_pkt_t * pkt){
 	u16 checksum;
-	if( pkt->size <= LINK2_PACKET_DATA_SIZE ){
+	if( pkt->size <= LINK2_PACKET_DATA_SIZE_MAX ){
 		checksum = pkt->data[pkt->size];
 	} else {
 		return false;
@@ -73,7 +73,9 @@ int link2_transport_wait_packet(link_transport_driver_t * driver, link2_pkt_t *
 	int bytes;
 	int count;
 	int page_size;
+	int data_size;
 
+	data_size = link2_transport_get_packet_data_size(driver);
 	p = ((char*)pkt) + 1; //start received after start
 	count = 0;
 	bytes = 0;
@@ -95,7 +97,7 @@ int link2_transport_wait_packet(link_transport_driver_t * driver, link2_pkt_t *
 		}
 
 		if( bytes_read > 0 ){
-			if( pkt->size > LINK2_PACKET_DATA_SIZE ){
+			if( pkt->size > data_size ){
 				//this is erroneous data
 				return LINK_PROT_ERROR;
 			}
@@ -115,3 +117,36 @@ int link2_transport_wait_packet(link_transport_driver_t * driver, link2_pkt_t *
 
 	return 0;
 }
+
+int link2_transport_get_packet_data_size(const link_transport_driver_t * driver){
+	if( driver->packet_data_size > LINK2_PACKET_DATA_SIZE ){
+		return driver->packet_data_size;
+	}
+	return LINK2_PACKET_DATA_SIZE;
+}
+
+int link2_transport_set_packet_data_size(link_transport_driver_t * driver, int size){
+	int max;
+
+#if defined __link
+	max = LINK2_PACKET_DATA_SIZE_MAX;
+#else
+	//the slave needs storage from the board config for anything larger than the default
+	if( driver->packet_buffer != 0 ){
+		max = driver->packet_buffer_size - LINK2_PACKET_HEADER_SIZE;
+	} else {
+		max = LINK2_PACKET_DATA_SIZE;
+	}
+#endif
+
+	if( max > LINK2_PACKET_DATA_SIZE_MAX ){ max = LINK2_PACKET_DATA_SIZE_MAX; }
+	if( size > max ){ size = max; }
+
+	if( size <= LINK2_PACKET_DATA_SIZE ){
+		driver->packet_data_size = 0;
+		return LINK2_PACKET_DATA_SIZE;
+	}
+
+	driver->packet_data_size = size;
+	return size;
+}
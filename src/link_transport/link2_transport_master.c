@@ -15,6 +15,13 @@
 
 #define pkt_checksum(pktp) ((pktp)->data[(pktp)->size])
 
+/* The master driver is copied by value (see link_probe_devices()) so
+ * packets use per-thread storage sized for the largest negotiable
+ * packet rather than a buffer owned by the driver.
+ *
+ */
+static LINK_THREAD_LOCAL u32 m_packet_buffer[LINK2_PACKET_BUFFER_SIZE(LINK2_PACKET_DATA_SIZE_MAX)/sizeof(u32) + 1];
+
 static int wait_ack(
 		link_transport_mdriver_t * driver,
 		u8 checksum,
@@ -30,94 +37,98 @@ void link2_transport_mastersettimeout(link_transport_mdriver_t * driver, int t){
 }
 
 int link2_transport_masterread(link_transport_mdriver_t * driver, void * buf, int nbyte){
-	link2_pkt_t pkt;
+	link2_pkt_t * pkt = (link2_pkt_t*)m_packet_buffer;
 	char * p;
 	int bytes;
 	int err;
+	int data_size;
 
+	data_size = link2_transport_get_packet_data_size(&driver->phy_driver);
 	bytes = 0;
 	p = buf;
 	do {
 
-		if( (err = link2_transport_wait_start(&driver->phy_driver, &pkt, driver->phy_driver.timeout)) < 0 ){
+		if( (err = link2_transport_wait_start(&driver->phy_driver, pkt, driver->phy_driver.timeout)) < 0 ){
 			//printf("\nerror %s():%d result:%d\n", __FUNCTION__, __LINE__, err);
 			driver->phy_driver.flush(driver->phy_driver.handle);
 			return err;
 		}
 
-		if( (err = link2_transport_wait_packet(&driver->phy_driver, &pkt, driver->phy_driver.timeout)) < 0 ){
+		if( (err = link2_transport_wait_packet(&driver->phy_driver, pkt, driver->phy_driver.timeout)) < 0 ){
 			driver->phy_driver.flush(driver->phy_driver.handle);
 			return err;
 		}
 
 		if( driver->phy_driver.o_flags & LINK2_FLAG_IS_CHECKSUM ){
 			//a packet has arrived -- checksum it
-			if( link2_transport_checksum_isok(&pkt) == false ){
+			if( link2_transport_checksum_isok(pkt) == false ){
 				return SYSFS_SET_RETURN(1);
 			}
 		}
 
 		//callback to handle incoming data as it arrives
 		//copy the valid data to the buffer
-		if( pkt.size + bytes > nbyte ){
+		if( pkt->size + bytes > nbyte ){
 			//if the target device has a bug, this will prevent a seg fault
-			pkt.size = nbyte - bytes;
+			pkt->size = nbyte - bytes;
 		}
-		memcpy(p, pkt.data, pkt.size);
-		bytes += pkt.size;
-		p += pkt.size;
+		memcpy(p, pkt->data, pkt->size);
+		bytes += pkt->size;
+		p += pkt->size;
 
-	} while( (bytes < nbyte) && (pkt.size == LINK2_PACKET_DATA_SIZE));
+	} while( (bytes < nbyte) && (pkt->size == data_size));
 
 	return bytes;
 }
 
 int link2_transport_masterwrite(link_transport_mdriver_t * driver, const void * buf, int nbyte){
-	link2_pkt_t pkt;
+	link2_pkt_t * pkt = (link2_pkt_t*)m_packet_buffer;
 	char * p;
 	int bytes;
 	int err;
+	int data_size;
 
 	if( driver == 0 ){
 		return -1;
 	}
 
+	data_size = link2_transport_get_packet_data_size(&driver->phy_driver);
 	bytes = 0;
 	p = (void*)buf;
-	memset(&pkt, 0, sizeof(pkt));
-	pkt.start = LINK2_PACKET_START;
-	pkt.o_flags = driver->phy_driver.o_flags;
+	memset(pkt, 0, LINK2_PACKET_HEADER_SIZE);
+	pkt->start = LINK2_PACKET_START;
+	pkt->o_flags = driver->phy_driver.o_flags;
 
 	do {
 
-		if( (nbyte - bytes) > LINK2_PACKET_DATA_SIZE ){
-			pkt.size = LINK2_PACKET_DATA_SIZE;
+		if( (nbyte - bytes) > data_size ){
+			pkt->size = data_size;
 		} else {
-			pkt.size = nbyte - bytes;
+			pkt->size = nbyte - bytes;
 		}
 
-		memcpy(pkt.data, p, pkt.size);
+		memcpy(pkt->data, p, pkt->size);
 
 		if( driver->phy_driver.o_flags & LINK2_FLAG_IS_CHECKSUM ){
-			link2_transport_insert_checksum(&pkt);
+			link2_transport_insert_checksum(pkt);
 		} else {
 			//checksum is set to zero
-			pkt_checksum(&pkt) = 0;
+			pkt_checksum(pkt) = 0;
 		}
 
 		//send packet
 		if( driver->phy_driver.write(
 				 driver->phy_driver.handle,
-				 &pkt,
-				 pkt.size + LINK2_PACKET_HEADER_SIZE
-				 ) != (pkt.size + LINK2_PACKET_HEADER_SIZE) ){
+				 pkt,
+				 pkt->size + LINK2_PACKET_HEADER_SIZE
+				 ) != (pkt->size + LINK2_PACKET_HEADER_SIZE) ){
 			return SYSFS_SET_RETURN(1);
 		}
 
 		//received ack of the checksum
 		if( (err = wait_ack(
 					driver,
-					pkt_checksum(&pkt),
+					pkt_checksum(pkt),
 					driver->phy_driver.timeout
 					)) < 0 ){
 			driver->phy_driver.flush(driver->phy_driver.handle);
@@ -136,10 +147,10 @@ int link2_transport_masterwrite(link_transport_mdriver_t * driver, const void *
 			return SYSFS_SET_RETURN(1);
 		}
 
-		bytes += pkt.size;
-		p += pkt.size;
+		bytes += pkt->size;
+		p += pkt->size;
 
-	} while( (bytes < nbyte) && (pkt.size == LINK2_PACKET_DATA_SIZE) );
+	} while( (bytes < nbyte) && (pkt->size == data_size) );
 
 	return bytes;
 }
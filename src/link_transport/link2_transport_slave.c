@@ -3,6 +3,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include "sos/link/types.h"
 #include "sos/link/transport.h"
 
 #include "mcu/core.h"
@@ -12,6 +13,7 @@
 #define pkt_checksum(pktp) ((pktp)->data[(pktp)->size])
 
 static int send_ack(link_transport_driver_t * driver, u8 ack, u8 checksum);
+static link2_pkt_t * get_packet(link_transport_driver_t * driver, link2_pkt_t * default_pkt);
 
 int link2_transport_slaveread(
 		link_transport_driver_t * driver,
@@ -23,28 +25,37 @@ int link2_transport_slaveread(
 	char * p = 0;
 	int bytes = 0;
 	u16 checksum;
-	link2_pkt_t pkt;
-	memset(&pkt, 0, sizeof(pkt));
+	int data_size;
+	int result;
+	link2_pkt_t default_pkt;
+	link2_pkt_t * pkt;
 
+	data_size = link2_transport_get_packet_data_size(driver);
+	pkt = get_packet(driver, &default_pkt);
+	memset(pkt, 0, LINK2_PACKET_HEADER_SIZE);
 
 	bytes = 0;
 	p = buf;
 	do {
 
-		if( link2_transport_wait_start(driver, &pkt, driver->timeout) < 0 ){
+		if( (result = link2_transport_wait_start(driver, pkt, driver->timeout)) < 0 ){
+			if( (result == LINK_PROT_ERROR) && (pkt->start == LINK_PACKET_START) ){
+				//a LINK1 packet is the master resolving the protocol on a new connection -- start over with the default packet size
+				link2_transport_set_packet_data_size(driver, 0);
+			}
 			driver->flush(driver->handle);
 			send_ack(driver, LINK2_PACKET_NACK, 0);
 			return -1 * __LINE__;
 		}
 
-		if( link2_transport_wait_packet(driver, &pkt, driver->timeout) < 0 ){
+		if( link2_transport_wait_packet(driver, pkt, driver->timeout) < 0 ){
 			driver->flush(driver->handle);
 			send_ack(driver, LINK2_PACKET_NACK, 0);
 			return -1 * __LINE__;
 		}
 
 
-		if( pkt.start != LINK2_PACKET_START ){
+		if( pkt->start != LINK2_PACKET_START ){
 			//if packet does not start with the start byte then it is not a packet
 			driver->flush(driver->handle);
 			send_ack(driver, LINK2_PACKET_NACK, 0);
@@ -53,8 +64,8 @@ int link2_transport_slaveread(
 
 		//a packet has arrived -- checksum it
 		if( driver->o_flags & LINK2_FLAG_IS_CHECKSUM ){
-			checksum = pkt_checksum(&pkt);
-			if( link2_transport_checksum_isok(&pkt) == false ){
+			checksum = pkt_checksum(pkt);
+			if( link2_transport_checksum_isok(pkt) == false ){
 				//bad checksum on packet -- treat as a non-packet
 				driver->flush(driver->handle);
 				send_ack(driver, LINK2_PACKET_NACK, checksum);
@@ -67,24 +78,23 @@ int link2_transport_slaveread(
 		//callback to handle incoming data as it arrives
 		if( callback == NULL ){
 			//copy the valid data to the buffer
-			memcpy(p, pkt.data, pkt.size);
-			bytes += pkt.size;
-			p += pkt.size;
+			memcpy(p, pkt->data, pkt->size);
+			bytes += pkt->size;
+			p += pkt->size;
 			send_ack(driver, LINK2_PACKET_ACK, checksum);
 		} else {
-			int result;
-			if( (result = callback(context, pkt.data, pkt.size)) < 0 ){
+			if( (result = callback(context, pkt->data, pkt->size)) < 0 ){
 				send_ack(driver, LINK2_PACKET_NACK, checksum);
 				return result;
 			} else {
-				bytes += pkt.size;
+				bytes += pkt->size;
 				if( send_ack(driver, LINK2_PACKET_ACK, checksum) < 0 ){
 					return -1 * __LINE__;
 				}
 			}
 		}
 
-	} while( (bytes < nbyte) && (pkt.size == LINK2_PACKET_DATA_SIZE) );
+	} while( (bytes < nbyte) && (pkt->size == data_size) );
 
 	if( bytes == 0 ){
 		driver->flush(driver->handle);
@@ -103,52 +113,59 @@ int link2_transport_slavewrite(
 	char * p = 0;
 	int bytes = 0;
 	int ret = 0;
-	link2_pkt_t pkt;
-	memset(&pkt, 0, sizeof(pkt));
+	int data_size;
+	link2_pkt_t default_pkt;
+	link2_pkt_t * pkt;
+
+	data_size = link2_transport_get_packet_data_size(driver);
+	pkt = get_packet(driver, &default_pkt);
+	memset(pkt, 0, LINK2_PACKET_HEADER_SIZE);
 
 	bytes = 0;
 	p = (void*)buf;
-	pkt.start = LINK2_PACKET_START;
-	pkt.o_flags = driver->o_flags;
+	pkt->start = LINK2_PACKET_START;
+	pkt->o_flags = driver->o_flags;
 
 	do {
 
-		if( (nbyte - bytes) > LINK2_PACKET_DATA_SIZE ){
-			pkt.size = LINK2_PACKET_DATA_SIZE;
+		if( (nbyte - bytes) > data_size ){
+			pkt->size = data_size;
 		} else {
-			pkt.size = nbyte - bytes;
+			pkt->size = nbyte - bytes;
 		}
 
 		if( callback != NULL ){
-			if( (ret = callback(context, pkt.data, pkt.size)) < 0 ){
+			if( (ret = callback(context, pkt->data, pkt->size)) < 0 ){
 				//could not get the desired data
-				pkt.size = 0;
+				pkt->size = 0;
 			} else {
-				pkt.size = ret;
+				pkt->size = ret;
 			}
 		} else {
 			//copy data from buf
-			memcpy(pkt.data, p, pkt.size);
+			memcpy(pkt->data, p, pkt->size);
 		}
 
 		if( driver->o_flags & LINK2_FLAG_IS_CHECKSUM ){
-			link2_transport_insert_checksum(&pkt);
+			link2_transport_insert_checksum(pkt);
+		} else {
+			pkt_checksum(pkt) = 0;
 		}
 
 		//send packet
 		if( driver->write(
 					driver->handle,
-					&pkt,
-					pkt.size + LINK2_PACKET_HEADER_SIZE
-					) != (pkt.size + LINK2_PACKET_HEADER_SIZE)
+					pkt,
+					pkt->size + LINK2_PACKET_HEADER_SIZE
+					) != (pkt->size + LINK2_PACKET_HEADER_SIZE)
 				){
 			return -1 * __LINE__;
 		}
 
-		bytes += pkt.size;
-		p += pkt.size;
+		bytes += pkt->size;
+		p += pkt->size;
 
-	} while( (bytes < nbyte) && (pkt.size == LINK2_PACKET_DATA_SIZE) );
+	} while( (bytes < nbyte) && (pkt->size == data_size) );
 
 	if( callback && (bytes == 0) ){
 		bytes = ret;
@@ -164,3 +181,11 @@ int send_ack(link_transport_driver_t * driver, u8 ack, u8 checksum){
 	return driver->write(driver->handle, &ack_pkt, sizeof(ack_pkt));
 }
 
+link2_pkt_t * get_packet(link_transport_driver_t * driver, link2_pkt_t * default_pkt){
+	if( driver->packet_data_size > LINK2_PACKET_DATA_SIZE ){
+		//set only when packet_buffer can hold the negotiated size
+		return driver->packet_buffer;
+	}
+	return default_pkt;
+}
+
@@ -85,6 +85,9 @@ int resolve_protocol(link_transport_mdriver_t * driver){
 	}
 
 	if( driver->transport_version == 0 ){
+		//the slave goes back to the default packet size when it sees the link1 packet
+		driver->phy_driver.packet_data_size = 0;
+
 		//need to do protocol resolution starting with link1
 		int result = link1_transport_masterwrite(driver, 0, 0);
 		if( result == 0 ){
@@ -33,21 +33,49 @@
 #include "../scheduler/scheduler_local.h"
 #include "../unistd/unistd_local.h"
 #include "../signal/sig_local.h"
+#include "../sysfs/devfs_local.h"
 
 
 /*! \cond */
 static void svcall_suspend(void * args) MCU_ROOT_EXEC_CODE;
 static int suspend(struct aiocb *const list[], int nent, const struct timespec * timeout, u8 block_on_all);
 static int data_transfer(struct aiocb * aiocbp);
+static const devfs_device_t * get_device(struct aiocb * aiocbp);
+static const devfs_device_t * get_fildes_device(int fildes);
+
+typedef struct {
+	struct aiocb * const * list;
+	int nent;
+} root_listio_t;
+
+static void svcall_listio(void * args) MCU_ROOT_EXEC_CODE;
 /*! \endcond */
 
 
-/*! \details This function is not supported this version.
+/*! \details This function cancels AIO requests on \a fildes. Requests
+ * that are queued behind another transfer on a device are removed and
+ * complete with ECANCELED. A request the device has already started
+ * is passed to the driver using I_MCU_SETACTION. If \a aiocbp is NULL,
+ * the calling process's queued requests on \a fildes are cancelled.
  *
- * \return -1 with errno set to ENOTSUP
+ * \return AIO_CANCELED, AIO_NOTCANCELED if a request is still in progress,
+ * AIO_ALLDONE if there was nothing to cancel or the result of the ioctl
  */
 int aio_cancel(int fildes /*! the file descriptor */,
 					struct aiocb * aiocbp /*! a pointer to the AIO data structure */){
+	const devfs_device_t * device;
+	int result;
+
+	//requests waiting behind another transfer on the device are removed from the devfs queue
+	device = get_fildes_device(fildes);
+	if( device != 0 ){
+		result = devfs_aio_cancel(device, aiocbp);
+		if( (result == AIO_CANCELED) || (aiocbp == NULL) ){
+			return result;
+		}
+	} else if( aiocbp == NULL ){
+		return AIO_NOTCANCELED;
+	}
 
 	//this needs a special ioctl request to cancel current operations -- use MCU_SET_ACTION
 	mcu_action_t action;
@@ -178,6 +206,7 @@ int lio_listio(int mode /*! The mode:  \a LIO_WAIT or \a LIO_NOWAIT */,
 					int nent /*! The number of transfers in \a list */,
 					struct sigevent * sig /*! The sigevent structure */){
 	int i;
+	int count;
 
 	switch(mode){
 		case LIO_NOWAIT:
@@ -198,13 +227,25 @@ int lio_listio(int mode /*! The mode:  \a LIO_WAIT or \a LIO_NOWAIT */,
 			return -1;
 	}
 
+	count = 0;
 	for(i=0; i < nent; i++){
 		//start all of the operations in the list
 		if( list[i] != NULL ){  //ignore NULL entries
-			data_transfer(list[i]);
+			if( get_device(list[i]) != 0 ){
+				count++; //devices are started below using one svcall for the whole list
+			} else {
+				data_transfer(list[i]);
+			}
 		}
 	}
 
+	if( count ){
+		root_listio_t args;
+		args.list = list;
+		args.nent = nent;
+		cortexm_svcall(svcall_listio, &args);
+	}
+
 	if ( mode == LIO_WAIT ){
 		return suspend(list, nent, NULL, 1);
 	}
@@ -228,6 +269,53 @@ int data_transfer(struct aiocb * aiocbp){
 	return sysfs_file_aio(file, aiocbp);
 }
 
+const devfs_device_t * get_device(struct aiocb * aiocbp){
+	int fildes;
+
+	fildes = u_fildes_is_bad(aiocbp->aio_fildes);
+	if ( fildes < 0 ){
+		return 0;
+	}
+	aiocbp->aio_fildes = fildes;
+	return get_fildes_device(fildes);
+}
+
+const devfs_device_t * get_fildes_device(int fildes){
+	sysfs_file_t * file;
+
+	fildes = u_fildes_is_bad(fildes);
+	if ( fildes < 0 ){
+		return 0;
+	}
+	file = get_open_file(fildes);
+	if( file->fs->aio != devfs_aio ){
+		return 0;
+	}
+	return file->handle;
+}
+
+void svcall_listio(void * args){
+	CORTEXM_SVCALL_ENTER();
+	root_listio_t * p = (root_listio_t*)args;
+	const devfs_device_t * device;
+	int result;
+	int i;
+
+	for(i=0; i < p->nent; i++){
+		if( (p->list[i] != NULL) && ((device = get_device(p->list[i])) != 0) ){
+			//requests for a busy device are queued and started when the earlier ones complete
+			result = devfs_aio_root_data_transfer(device, p->list[i]);
+			if( result < 0 ){
+				//complete the request with the error so LIO_WAIT does not block on it
+				p->list[i]->async.nbyte = result;
+				sysfs_aio_data_transfer_callback(p->list[i], 0);
+			}
+		}
+	}
+
+	sos_sched_block_object[task_get_current()] = NULL;
+}
+
 
 void svcall_suspend(void * args){
 	CORTEXM_SVCALL_ENTER();
@@ -292,7 +380,7 @@ int sysfs_aio_data_transfer_callback(void * context, const mcu_event_t * event){
 
 	if( task_enabled(tid) ){ //if task is no longer enabled (don't do anything)
 		if ( scheduler_aiosuspend_asserted(tid) ){
-			sysfs_aio_suspend_t * p = (sysfs_aio_suspend_t*)sos_sched_table[tid].block_object;
+			sysfs_aio_suspend_t * p = (sysfs_aio_suspend_t*)sos_sched_block_object[tid];
 
 			if ( p->block_on_all == 0 ){
 				for(int i=0; i < p->nent; i++){
@@ -25,6 +25,7 @@
 //#include "config.h"
 
 #include <stdbool.h>
+#include <stdlib.h>
 #include <sys/fcntl.h> //Defines the flags
 #include <errno.h>
 #include <dirent.h>
@@ -51,6 +52,53 @@
  */
 #define BETWEEN_LINK_WRITE_DELAY() usleep(1000)
 
+/* Incoming write packets are copied to one of these buffers
+ * and ACK'd right away. A separate thread writes the buffers
+ * to the file so flash programming overlaps the next packet.
+ * Set to zero to write each packet before it is ACK'd.
+ *
+ */
+#if !defined SOS_LINK_WRITE_BUFFER_COUNT
+#define SOS_LINK_WRITE_BUFFER_COUNT 2
+#endif
+
+/* Largest LINK2 packet the link thread accepts when the host asks
+ * for a larger size (LINK_CMD_SETPACKETSIZE). The packet buffer is
+ * allocated when the thread starts unless the board's transport
+ * driver already provides one. Set to LINK2_PACKET_DATA_SIZE to only
+ * use the default size.
+ *
+ */
+#if !defined SOS_LINK_PACKET_DATA_SIZE
+#define SOS_LINK_PACKET_DATA_SIZE (4*1024)
+#endif
+
+#if SOS_LINK_WRITE_BUFFER_COUNT > 0
+typedef struct {
+	int nbyte;
+	char data[LINK2_PACKET_DATA_SIZE];
+} write_buffer_t;
+
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int is_started;
+	int fildes;
+	u8 head /*! Next buffer to fill */;
+	u8 tail /*! Next buffer to write */;
+	u8 count /*! Number of filled buffers */;
+	int bytes /*! Bytes written so far */;
+	int result /*! First error reported by write() */;
+	int err_number;
+	write_buffer_t buffer[SOS_LINK_WRITE_BUFFER_COUNT];
+} write_queue_t;
+
+static write_queue_t m_write_queue;
+static void start_write_queue();
+static void * write_queue_thread(void * args);
+static int write_queue_callback(void * context, void * buf, int nbyte);
+#endif
+
 static int read_device(link_transport_driver_t * driver, int fildes, int size);
 static int write_device(link_transport_driver_t * driver, int fildes, int size);
 static int read_device_callback(void * context, void * buf, int nbyte);
@@ -84,6 +132,7 @@ static void link_cmd_chown(link_transport_driver_t * driver, link_data_t * args)
 static void link_cmd_chmod(link_transport_driver_t * driver, link_data_t * args);
 static void link_cmd_exec(link_transport_driver_t * driver, link_data_t * args);
 static void link_cmd_mkfs(link_transport_driver_t * driver, link_data_t * args);
+static void link_cmd_setpacketsize(link_transport_driver_t * driver, link_data_t * args);
 
 
 void (* const link_cmd_func_table[LINK_CMD_TOTAL])(link_transport_driver_t *, link_data_t*) = {
@@ -108,7 +157,8 @@ void (* const link_cmd_func_table[LINK_CMD_TOTAL])(link_transport_driver_t *, li
 		link_cmd_chown,
 		link_cmd_chmod,
 		link_cmd_exec,
-		link_cmd_mkfs
+		link_cmd_mkfs,
+		link_cmd_setpacketsize
 		};
 
 
@@ -124,6 +174,22 @@ void * link_update(void * arg){
 		return 0;
 	}
 
+#if SOS_LINK_PACKET_DATA_SIZE > LINK2_PACKET_DATA_SIZE
+	if( driver->packet_buffer == 0 ){
+		//without the buffer the link stays at the default packet size
+		driver->packet_buffer = malloc(LINK2_PACKET_BUFFER_SIZE(SOS_LINK_PACKET_DATA_SIZE));
+		if( driver->packet_buffer != 0 ){
+			driver->packet_buffer_size = LINK2_PACKET_BUFFER_SIZE(SOS_LINK_PACKET_DATA_SIZE);
+		} else {
+			mcu_debug_log_warning(MCU_DEBUG_LINK, "no memory for the packet buffer");
+		}
+	}
+#endif
+
+#if SOS_LINK_WRITE_BUFFER_COUNT > 0
+	start_write_queue();
+#endif
+
 	mcu_debug_log_info(MCU_DEBUG_LINK, "start link update");
 	while(1){
 
@@ -601,6 +667,12 @@ void link_cmd_mkfs(link_transport_driver_t * driver, link_data_t * args){
 	}
 }
 
+void link_cmd_setpacketsize(link_transport_driver_t * driver, link_data_t * args){
+	//the reply is small enough to fit in one packet of any size
+	args->reply.err = link2_transport_set_packet_data_size(driver, args->op.packet_size.size);
+	mcu_debug_log_info(MCU_DEBUG_LINK, "packet size %ld", args->reply.err);
+}
+
 int read_device_callback(void * context, void * buf, int nbyte){
 	int * fildes;
 	int ret;
@@ -622,9 +694,139 @@ int read_device(link_transport_driver_t * driver, int fildes, int nbyte){
 }
 
 int write_device(link_transport_driver_t * driver, int fildes, int nbyte){
+#if SOS_LINK_WRITE_BUFFER_COUNT > 0
+	write_queue_t * queue = &m_write_queue;
+	int result;
+
+	if( queue->is_started ){
+		pthread_mutex_lock(&queue->mutex);
+		queue->fildes = fildes;
+		queue->bytes = 0;
+		queue->result = 0;
+		queue->err_number = 0;
+		pthread_mutex_unlock(&queue->mutex);
+
+		result = link_transport_slaveread(driver, NULL, nbyte, write_queue_callback, queue);
+
+		//the final reply is not sent until all the data has been written
+		pthread_mutex_lock(&queue->mutex);
+		while( queue->count ){
+			pthread_cond_wait(&queue->cond, &queue->mutex);
+		}
+		if( queue->result < 0 ){
+			result = queue->result;
+			errno = queue->err_number;
+		} else if( result >= 0 ){
+			result = queue->bytes;
+		}
+		pthread_mutex_unlock(&queue->mutex);
+		return result;
+	}
+#endif
 	return link_transport_slaveread(driver, NULL, nbyte, write_device_callback, &fildes);
 }
 
+#if SOS_LINK_WRITE_BUFFER_COUNT > 0
+void start_write_queue(){
+	write_queue_t * queue = &m_write_queue;
+	pthread_attr_t attr;
+	pthread_condattr_t cond_attr;
+	pthread_t thread;
+
+	memset(queue, 0, sizeof(write_queue_t));
+	pthread_condattr_init(&cond_attr);
+	if( (pthread_mutex_init(&queue->mutex, NULL) < 0) ||
+		 (pthread_cond_init(&queue->cond, &cond_attr) < 0) ){
+		return;
+	}
+
+	pthread_attr_init(&attr);
+	if( pthread_create(&thread, &attr, write_queue_thread, queue) < 0 ){
+		//writes are done synchronously in the link thread
+		mcu_debug_log_warning(MCU_DEBUG_LINK, "failed to start write queue");
+		return;
+	}
+
+	queue->is_started = 1;
+}
+
+void * write_queue_thread(void * args){
+	write_queue_t * queue = args;
+	write_buffer_t * buffer;
+	int is_discarded;
+	int result;
+
+	while(1){
+		pthread_mutex_lock(&queue->mutex);
+		while( queue->count == 0 ){
+			pthread_cond_wait(&queue->cond, &queue->mutex);
+		}
+		buffer = queue->buffer + queue->tail;
+		is_discarded = queue->result < 0;
+		pthread_mutex_unlock(&queue->mutex);
+
+		//the mutex is not held here so the link thread can receive the next packet
+		if( is_discarded ){
+			result = 0;
+		} else {
+			result = write(queue->fildes, buffer->data, buffer->nbyte);
+		}
+
+		pthread_mutex_lock(&queue->mutex);
+		if( result < 0 ){
+			queue->result = result;
+			queue->err_number = errno;
+		} else {
+			queue->bytes += result;
+		}
+		queue->tail = (queue->tail + 1) % SOS_LINK_WRITE_BUFFER_COUNT;
+		queue->count--;
+		pthread_cond_broadcast(&queue->cond);
+		pthread_mutex_unlock(&queue->mutex);
+	}
+
+	return NULL;
+}
+
+int write_queue_callback(void * context, void * buf, int nbyte){
+	write_queue_t * queue = context;
+	write_buffer_t * buffer;
+	const char * p = buf;
+	int bytes = 0;
+	int page_size;
+
+	//negotiated packets can be larger than a buffer so they are split across buffers
+	pthread_mutex_lock(&queue->mutex);
+	while( bytes < nbyte ){
+		while( (queue->count == SOS_LINK_WRITE_BUFFER_COUNT) && (queue->result == 0) ){
+			pthread_cond_wait(&queue->cond, &queue->mutex);
+		}
+
+		if( queue->result < 0 ){
+			//NACK the rest of the transfer -- the error is sent in the final reply
+			bytes = queue->result;
+			pthread_mutex_unlock(&queue->mutex);
+			return bytes;
+		}
+
+		page_size = nbyte - bytes;
+		if( page_size > LINK2_PACKET_DATA_SIZE ){
+			page_size = LINK2_PACKET_DATA_SIZE;
+		}
+
+		buffer = queue->buffer + queue->head;
+		memcpy(buffer->data, p + bytes, page_size);
+		buffer->nbyte = page_size;
+		queue->head = (queue->head + 1) % SOS_LINK_WRITE_BUFFER_COUNT;
+		queue->count++;
+		pthread_cond_broadcast(&queue->cond);
+		bytes += page_size;
+	}
+	pthread_mutex_unlock(&queue->mutex);
+	return nbyte;
+}
+#endif
+
 void translate_link_stat(struct link_stat * dest, struct stat * src){
 	dest->st_dev = src->st_dev;
 	dest->st_ino = src->st_ino;
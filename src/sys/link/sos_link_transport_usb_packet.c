@@ -0,0 +1,46 @@
+/*
+
+Copyright 2011-2018 Tyler Gilbert
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+		http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+ */
+
+#include "sos/link.h"
+#include "sos/link/transport_usb.h"
+
+/* This is kept apart from sos_link_transport_usb.c so the buffers
+ * are only linked in when a board uses the packet device for link-phy-usb.
+ *
+ */
+
+#if !defined SOS_LINK_TRANSPORT_USB_PACKET_BUFFER_COUNT
+#define SOS_LINK_TRANSPORT_USB_PACKET_BUFFER_COUNT 2
+#endif
+
+//must be a multiple of the endpoint size -- the default holds a full default-size LINK2 packet
+#if !defined SOS_LINK_TRANSPORT_USB_PACKET_BUFFER_SIZE
+#define SOS_LINK_TRANSPORT_USB_PACKET_BUFFER_SIZE \
+	(((LINK2_MAX_PACKET_SIZE + SOS_LINK_TRANSPORT_USB_BULK_ENDPOINT_SIZE - 1) / SOS_LINK_TRANSPORT_USB_BULK_ENDPOINT_SIZE) * SOS_LINK_TRANSPORT_USB_BULK_ENDPOINT_SIZE)
+#endif
+
+static char usb0_packet_buffer[SOS_LINK_TRANSPORT_USB_PACKET_BUFFER_COUNT * SOS_LINK_TRANSPORT_USB_PACKET_BUFFER_SIZE] MCU_ALIGN(32);
+const usbpacket_config_t sos_link_transport_usb_packet_cfg = {
+	.endpoint = SOS_LINK_TRANSPORT_USB_BULK_ENDPOINT,
+	.endpoint_size = SOS_LINK_TRANSPORT_USB_BULK_ENDPOINT_SIZE,
+	.buffer_count = SOS_LINK_TRANSPORT_USB_PACKET_BUFFER_COUNT,
+	.buffer_size = SOS_LINK_TRANSPORT_USB_PACKET_BUFFER_SIZE,
+	.buffer = usb0_packet_buffer
+};
+
+usbpacket_state_t sos_link_transport_usb_packet_state MCU_SYS_MEM;
@@ -941,7 +941,7 @@ int mq_trysend(mqd_t mqdes, const char * msg_ptr, size_t msg_len, unsigned msg_p
 void svcall_block_on_mq(void * args){
 	CORTEXM_SVCALL_ENTER();
 	root_block_on_mq_t * argsp = (root_block_on_mq_t*)args;
-	scheduler_timing_root_timedblock(argsp->block, &argsp->abs_timeout);
+	scheduler_wait_root_timedblock(argsp->block, &argsp->abs_timeout, 0);
 }
 
 int block_on_mq(void * block, const struct timespec * abs_timeout){
@@ -964,19 +964,16 @@ int block_on_mq(void * block, const struct timespec * abs_timeout){
 
 void svcall_wake_blocked(void * args){
 	CORTEXM_SVCALL_ENTER();
-	int * task = (int*)args;
-	int id = *task;
-	scheduler_root_assert_active(id, SCHEDULER_UNBLOCK_MQ);
-	scheduler_root_update_on_wake(id, task_get_priority(id));
+	int id = scheduler_root_get_highest_priority_blocked(args);
+	if( id != -1 ){
+		scheduler_root_assert_active(id, SCHEDULER_UNBLOCK_MQ);
+		scheduler_root_update_on_wake(id, task_get_priority(id));
+	}
 }
 
 void check_for_blocked_task(void * block){
-	int new_thread;
-	new_thread = scheduler_get_highest_priority_blocked(block);
-	if ( new_thread != -1 ){
-		cortexm_svcall(svcall_wake_blocked, &new_thread);
-	} else {
-		//See if any tasks need to be notified if a message was just sent
+	if ( scheduler_wait_is_empty(block) == 0 ){
+		cortexm_svcall(svcall_wake_blocked, block);
 	}
 }
 /*! \endcond */
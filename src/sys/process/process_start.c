@@ -34,7 +34,34 @@
 #include "../scheduler/scheduler_local.h"
 #include "../sysfs/appfs_local.h"
 
+//recently launched programs skip the access check and header read
+#if !defined PROCESS_START_CACHE_COUNT
+#define PROCESS_START_CACHE_COUNT 4
+#endif
+#define PROCESS_START_CACHE_PATH_MAX LINK_PATH_MAX
+
+typedef struct {
+	char path[PROCESS_START_CACHE_PATH_MAX];
+	appfs_exec_t exec;
+	u8 is_valid;
+	u8 is_authenticated /*! Caller was authenticated when access was checked */;
+} launch_cache_entry_t;
+
+typedef struct {
+	const char * path;
+	appfs_exec_t * exec;
+	u32 generation;
+	int result;
+} launch_cache_args_t;
+
+static launch_cache_entry_t m_launch_cache[PROCESS_START_CACHE_COUNT] MCU_SYS_MEM;
+static u32 m_launch_cache_generation MCU_SYS_MEM;
+static u8 m_launch_cache_next MCU_SYS_MEM;
+
 static int reent_is_free(struct _reent * reent);
+static int read_startup(const char * path, appfs_file_t * startup);
+static void svcall_lookup_launch_cache(void * args) MCU_ROOT_EXEC_CODE;
+static void svcall_insert_launch_cache(void * args) MCU_ROOT_EXEC_CODE;
 
 #if defined UNIQUE_PROCESS_NAMES
 static uint8_t launch_count = 0;
@@ -45,7 +72,6 @@ int process_start(
 		const char *path_arg,
 		char *const envp[]
 		){
-	int fd;
 	int err;
 	appfs_file_t startup;
 	task_memories_t mem;
@@ -68,36 +94,18 @@ int process_start(
 
 	len = strlen(path_arg);
 
-	if ( access(path, X_OK) < 0 ){
-		mcu_debug_log_warning(MCU_DEBUG_SYS, "no exec access:%s", path);
-		return -1;
-	}
-
-	//Open the program
-	mcu_debug_log_info(MCU_DEBUG_SYS, "process_start:%s", path);
-#if MCU_DEBUG
-	usleep(10*1000);
-#endif
-	fd = open(path, O_RDONLY);
-	if ( fd < 0 ){
-		//The open() call set the errno already
-		return -1;
-	}
+	launch_cache_args_t cache_args;
+	cache_args.path = path;
+	cache_args.exec = &startup.exec;
+	cortexm_svcall(svcall_lookup_launch_cache, &cache_args);
 
-	//Read the program header
-	err = read(fd, &startup, sizeof(appfs_file_t));
-	if ( err != sizeof(appfs_file_t) ){
-		//The read() function sets the errno already
-		close(fd);
-		mcu_debug_log_error(MCU_DEBUG_SYS, "failed to read program header");
-		return -1;
-	}
+	if( cache_args.result < 0 ){
+		if( read_startup(path, &startup) < 0 ){
+			return -1;
+		}
 
-	//verify the signature
-	if( appfs_util_is_executable(&startup) == 0 ){
-		errno = ENOEXEC;
-		mcu_debug_log_error(MCU_DEBUG_SYS, "not executable");
-		return -1;
+		//generation changes if appfs is modified in the meantime
+		cortexm_svcall(svcall_insert_launch_cache, &cache_args);
 	}
 
 	mem.code.address = (void*)startup.exec.code_start;
@@ -108,14 +116,10 @@ int process_start(
 	//check to see if the process is already running
 	if( !reent_is_free((void*)startup.exec.ram_start) ){
 		errno = ENOTSUP;
-		close(fd);
 		mcu_debug_log_error(MCU_DEBUG_SYS, "already running");
 		return -1;
 	}
 
-	//The program is loaded and ready to execute
-	close(fd);
-
 	//this gets freed in crt_sys.c by the process that is launched
 	process_path = _malloc_r(sos_task_table[0].global_reent, len+1);
 	if( process_path == 0 ){
@@ -158,6 +162,94 @@ int process_start(
 	return err;
 }
 
+int read_startup(const char * path, appfs_file_t * startup){
+	int fd;
+	int err;
+
+	if ( access(path, X_OK) < 0 ){
+		mcu_debug_log_warning(MCU_DEBUG_SYS, "no exec access:%s", path);
+		return -1;
+	}
+
+	//Open the program
+	mcu_debug_log_info(MCU_DEBUG_SYS, "process_start:%s", path);
+#if MCU_DEBUG
+	usleep(10*1000);
+#endif
+	fd = open(path, O_RDONLY);
+	if ( fd < 0 ){
+		//The open() call set the errno already
+		return -1;
+	}
+
+	//Read the program header
+	err = read(fd, startup, sizeof(appfs_file_t));
+	close(fd);
+	if ( err != sizeof(appfs_file_t) ){
+		//The read() function sets the errno already
+		mcu_debug_log_error(MCU_DEBUG_SYS, "failed to read program header");
+		return -1;
+	}
+
+	//verify the signature
+	if( appfs_util_is_executable(startup) == 0 ){
+		errno = ENOEXEC;
+		mcu_debug_log_error(MCU_DEBUG_SYS, "not executable");
+		return -1;
+	}
+
+	return 0;
+}
+
+void svcall_lookup_launch_cache(void * args){
+	CORTEXM_SVCALL_ENTER();
+	launch_cache_args_t * p = args;
+	u8 is_authenticated = scheduler_authenticated_asserted(task_get_current()) != 0;
+	int i;
+
+	p->generation = m_launch_cache_generation;
+	p->result = -1;
+	for(i=0; i < PROCESS_START_CACHE_COUNT; i++){
+		if( m_launch_cache[i].is_valid &&
+			 (m_launch_cache[i].is_authenticated == is_authenticated) &&
+			 (strncmp(m_launch_cache[i].path, p->path, PROCESS_START_CACHE_PATH_MAX) == 0) ){
+			memcpy(p->exec, &m_launch_cache[i].exec, sizeof(appfs_exec_t));
+			p->result = 0;
+			return;
+		}
+	}
+}
+
+void svcall_insert_launch_cache(void * args){
+	CORTEXM_SVCALL_ENTER();
+	launch_cache_args_t * p = args;
+	launch_cache_entry_t * entry;
+
+	if( (p->generation != m_launch_cache_generation) ||
+		 (strnlen(p->path, PROCESS_START_CACHE_PATH_MAX) == PROCESS_START_CACHE_PATH_MAX) ){
+		return;
+	}
+
+	entry = m_launch_cache + m_launch_cache_next;
+	m_launch_cache_next++;
+	if( m_launch_cache_next == PROCESS_START_CACHE_COUNT ){
+		m_launch_cache_next = 0;
+	}
+
+	strncpy(entry->path, p->path, PROCESS_START_CACHE_PATH_MAX);
+	memcpy(&entry->exec, p->exec, sizeof(appfs_exec_t));
+	entry->is_authenticated = scheduler_authenticated_asserted(task_get_current()) != 0;
+	entry->is_valid = 1;
+}
+
+void process_start_root_invalidate_cache(){
+	int i;
+	for(i=0; i < PROCESS_START_CACHE_COUNT; i++){
+		m_launch_cache[i].is_valid = 0;
+	}
+	m_launch_cache_generation++;
+}
+
 int reent_is_free(struct _reent * reent){
 	int i;
 	for(i=0; i < task_get_total(); i++){
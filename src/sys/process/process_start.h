@@ -32,6 +32,7 @@
 #include <unistd.h>
 
 int process_start(const char *path, char *const envp[]);
+void process_start_root_invalidate_cache();
 
 #endif /* SYSCALLS_PROCESS_H_ */
 
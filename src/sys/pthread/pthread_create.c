@@ -150,7 +150,7 @@ int pthread_join(pthread_t thread, void ** value_ptr){
 
 
 			//See if the thread is joined to this thread
-			if ( (sos_sched_table[thread].block_object == (void*)&sos_sched_table[task_get_current()]) ||
+			if ( (sos_sched_block_object[thread] == (void*)&sos_sched_table[task_get_current()]) ||
 				  (thread == task_get_current()) ){
 				errno = EDEADLK;
 				return -1;
@@ -188,9 +188,9 @@ void svcall_join_thread(void * args){
 	int id = *p;
 
 	if ( task_enabled(id) ){
-		sos_sched_table[task_get_current()].block_object = (void*)&sos_sched_table[id]; //block on the thread to be joined
+		sos_sched_block_object[task_get_current()] = (void*)&sos_sched_table[id]; //block on the thread to be joined
 		//If the thread is waiting to be joined, it needs to be activated
-		if ( sos_sched_table[id].block_object == (void*)&sos_sched_table[id].block_object ){
+		if ( sos_sched_block_object[id] == (void*)&sos_sched_block_object[id] ){
 			scheduler_root_assert_active(id, SCHEDULER_UNBLOCK_PTHREAD_JOINED);
 		}
 		scheduler_root_update_on_sleep();
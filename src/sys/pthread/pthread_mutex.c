@@ -354,9 +354,9 @@ int pthread_mutex_force_unlock(pthread_mutex_t *mutex){
 }
 
 void root_mutex_block(svcall_mutex_trylock_t *args){
-	//block the calling mutex
-	sos_sched_table[ args->id ].block_object = args->mutex; //Elevate the priority of the task based on prio_ceiling
-	scheduler_timing_root_timedblock(args->mutex, &args->abs_timeout);
+	//the owner inherits the priority of the blocked task until it unlocks the mutex
+	scheduler_wait_root_inherit_priority(args->mutex, task_get_priority(args->id));
+	scheduler_wait_root_timedblock(args->mutex, &args->abs_timeout, 1);
 }
 
 void svcall_mutex_unblocked(svcall_mutex_trylock_t *args){
@@ -404,12 +404,10 @@ void svcall_mutex_unlock(svcall_mutex_unlock_t * args){
 	CORTEXM_SVCALL_ENTER();
 	int new_thread;
 
-	//Restore the priority to the task that is unlocking the mutex
-	task_set_priority(args->id, sos_sched_table[args->id].attr.schedparam.sched_priority);
-	sos_sched_table[args->id].block_object = NULL;
+	sos_sched_block_object[args->id] = NULL;
 
 	//check to see if another task is waiting for the mutex
-	new_thread = scheduler_get_highest_priority_blocked(args->mutex);
+	new_thread = scheduler_root_get_highest_priority_blocked(args->mutex);
 
 	if ( new_thread > 0 ){
 		args->mutex->pthread = new_thread;
@@ -418,15 +416,23 @@ void svcall_mutex_unlock(svcall_mutex_unlock_t * args){
 		if( args->mutex->prio_ceiling > task_get_priority(new_thread) ){
 			task_set_priority(new_thread, args->mutex->prio_ceiling);
 		}
-		scheduler_root_assert_active(new_thread, SCHEDULER_UNBLOCK_MUTEX);
-		scheduler_root_update_on_wake(new_thread, task_get_priority(new_thread));
-
 	} else {
 		args->mutex->lock = 0;
 		args->mutex->pthread = -1; //The mutex is up for grabs
-		if( task_get_priority(args->id) < task_get_current_priority() ){
-			scheduler_root_update_on_stopped();
-		}
+	}
+
+	//Restore the priority to the task that is unlocking the mutex (keep what is inherited from other mutexes)
+	task_set_priority(args->id, scheduler_wait_root_get_inherited_priority(args->id));
+
+	if ( new_thread > 0 ){
+		scheduler_root_assert_active(new_thread, SCHEDULER_UNBLOCK_MUTEX);
+	}
+
+	if( task_get_priority(args->id) < task_get_current_priority() ){
+		//the priority dropped -- switch to the highest priority ready task
+		scheduler_root_update_on_stopped();
+	} else if( new_thread > 0 ){
+		scheduler_root_update_on_wake(new_thread, task_get_priority(new_thread));
 	}
 }
 
@@ -125,6 +125,7 @@ void svcall_set_scheduling_param(void * args){
 
 		//Issue #161 -- need to set the effective priority -- not just the prio ceiling
 		task_set_priority(id, sos_sched_table[id].attr.schedparam.sched_priority);
+		scheduler_wait_root_update_priority(id);
 
 		if ( p->policy == SCHED_FIFO ){
 			task_assert_fifo(id);
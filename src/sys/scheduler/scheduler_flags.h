@@ -22,17 +22,17 @@
 
 #include "scheduler_root.h"
 
-static inline int scheduler_cancel_asserted(int id){ return sos_sched_table[id].flags & (1<< SCHEDULER_TASK_FLAG_CANCEL); }
-static inline int scheduler_cancel_enable_asserted(int id){ return sos_sched_table[id].flags & (1<< SCHEDULER_TASK_FLAG_CANCEL_ENABLE); }
-static inline int scheduler_cancel_asynchronous_asserted(int id){ return sos_sched_table[id].flags & (1<< SCHEDULER_TASK_FLAG_CANCEL_ASYNCHRONOUS); }
-static inline int scheduler_listiosuspend_asserted(int id){ return sos_sched_table[id].flags & (1<< SCHEDULER_TASK_FLAG_LISTIOSUSPEND); }
-static inline int scheduler_waitchild_asserted(int id){ return sos_sched_table[id].flags & (1<< SCHEDULER_TASK_FLAG_WAITCHILD); }
-
-static inline int scheduler_inuse_asserted(int id){ return sos_sched_table[id].flags & (1<< SCHEDULER_TASK_FLAG_INUSE); }
-static inline int scheduler_sigcaught_asserted(int id){ return sos_sched_table[id].flags & (1<< SCHEDULER_TASK_FLAG_SIGCAUGHT); }
-static inline int scheduler_aiosuspend_asserted(int id){ return sos_sched_table[id].flags & (1<< SCHEDULER_TASK_FLAG_AIOSUSPEND); }
-static inline int scheduler_zombie_asserted(int id){ return sos_sched_table[id].flags & (1<< SCHEDULER_TASK_FLAG_ZOMBIE); }
-static inline int scheduler_authenticated_asserted(int id){ return sos_sched_table[id].flags & (1<< SCHEDULER_TASK_FLAG_AUTHENTICATED); }
+static inline int scheduler_cancel_asserted(int id){ return sos_sched_flags[id] & (1<< SCHEDULER_TASK_FLAG_CANCEL); }
+static inline int scheduler_cancel_enable_asserted(int id){ return sos_sched_flags[id] & (1<< SCHEDULER_TASK_FLAG_CANCEL_ENABLE); }
+static inline int scheduler_cancel_asynchronous_asserted(int id){ return sos_sched_flags[id] & (1<< SCHEDULER_TASK_FLAG_CANCEL_ASYNCHRONOUS); }
+static inline int scheduler_listiosuspend_asserted(int id){ return sos_sched_flags[id] & (1<< SCHEDULER_TASK_FLAG_LISTIOSUSPEND); }
+static inline int scheduler_waitchild_asserted(int id){ return sos_sched_flags[id] & (1<< SCHEDULER_TASK_FLAG_WAITCHILD); }
+
+static inline int scheduler_inuse_asserted(int id){ return sos_sched_flags[id] & (1<< SCHEDULER_TASK_FLAG_INUSE); }
+static inline int scheduler_sigcaught_asserted(int id){ return sos_sched_flags[id] & (1<< SCHEDULER_TASK_FLAG_SIGCAUGHT); }
+static inline int scheduler_aiosuspend_asserted(int id){ return sos_sched_flags[id] & (1<< SCHEDULER_TASK_FLAG_AIOSUSPEND); }
+static inline int scheduler_zombie_asserted(int id){ return sos_sched_flags[id] & (1<< SCHEDULER_TASK_FLAG_ZOMBIE); }
+static inline int scheduler_authenticated_asserted(int id){ return sos_sched_flags[id] & (1<< SCHEDULER_TASK_FLAG_AUTHENTICATED); }
 
 static inline void scheduler_root_assert_waitchild(int id){ scheduler_root_assert(id, SCHEDULER_TASK_FLAG_WAITCHILD); }
 static inline void scheduler_root_deassert_waitchild(int id){ scheduler_root_deassert(id, SCHEDULER_TASK_FLAG_WAITCHILD); }
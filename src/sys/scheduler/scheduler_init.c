@@ -39,6 +39,10 @@ volatile scheduler_fault_t m_scheduler_fault MCU_SYS_MEM;
 int scheduler_init(){
 	memset((void*)sos_task_table, 0, sizeof(task_t) * sos_board_config.task_total);
 	memset((void*)sos_sched_table, 0, sizeof(sched_task_t) * sos_board_config.task_total);
+	memset((void*)sos_sched_flags, 0, sizeof(u32) * sos_board_config.task_total);
+	memset((void*)sos_sched_wake, 0, sizeof(struct mcu_timeval) * sos_board_config.task_total);
+	memset((void*)sos_sched_block_object, 0, sizeof(void*) * sos_board_config.task_total);
+	scheduler_wait_init();
 
 	//Do basic init of task 0 so that memory allocation can happen before the scheduler starts
 	sos_task_table[0].reent = _impure_ptr;
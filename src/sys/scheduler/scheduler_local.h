@@ -38,6 +38,7 @@
 #include "scheduler_flags.h"
 #include "scheduler_timing.h"
 #include "scheduler_fault.h"
+#include "scheduler_wait.h"
 #include "scheduler.h"
 
 
@@ -68,7 +69,6 @@ int scheduler_create_process(void (*p)(char *),
 		void * reent, int parent_id, int is_root);
 
 int scheduler_switch_context(void * args);
-int scheduler_get_highest_priority_blocked(void * block_object);
 
 u32 scheduler_calculate_heap_end(u32 task_id);
 
@@ -83,7 +83,10 @@ void svcall_init_sched_task(init_sched_task_t * task){
 	struct _reent * reent;
 	int id = task->tid;
 
+	scheduler_wait_root_remove(id);
 	memset((void*)&sos_sched_table[id], 0, sizeof(sched_task_t));
+	sos_sched_flags[id] = 0;
+	sos_sched_block_object[id] = NULL;
 
 	PTHREAD_ATTR_SET_IS_INITIALIZED((&(sos_sched_table[id].attr)), 1);
 	PTHREAD_ATTR_SET_SCHED_POLICY((&(sos_sched_table[id].attr)), SCHED_OTHER);
@@ -104,8 +107,8 @@ void svcall_init_sched_task(init_sched_task_t * task){
 
 	scheduler_timing_root_process_timer_initialize(id);
 
-	sos_sched_table[id].wake.tv_sec = SCHEDULER_TIMEVAL_SEC_INVALID;
-	sos_sched_table[id].wake.tv_usec = 0;
+	sos_sched_wake[id].tv_sec = SCHEDULER_TIMEVAL_SEC_INVALID;
+	sos_sched_wake[id].tv_usec = 0;
 	scheduler_root_assert_active(id, 0);
 	scheduler_root_assert_inuse(id);
 	scheduler_root_update_on_wake(id, task_get_priority(id));
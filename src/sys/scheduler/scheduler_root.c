@@ -37,18 +37,25 @@ void scheduler_root_set_trace_id(int tid, trace_id_t id){
 }
 
 void scheduler_root_assert_active(int id, int unblock_type){
+	if( sos_sched_profile[id].block_start ){
+		//cycles are converted to microseconds when the profile is read (no division here)
+		sos_sched_profile[id].block_cycles[unblock_type & SCHEDULER_TASK_FLAG_UNBLOCK_MASK] += task_root_get_cycles() - sos_sched_profile[id].block_start;
+		sos_sched_profile[id].block_start = 0;
+	}
 	task_assert_active(id);
 	scheduler_root_set_unblock_type(id, unblock_type);
 	scheduler_root_deassert_aiosuspend(id);
 	//Remove all blocks (mutex, timing, etc)
-	sos_sched_table[id].block_object = NULL;
-	sos_sched_table[id].wake.tv_sec = SCHEDULER_TIMEVAL_SEC_INVALID;
-	sos_sched_table[id].wake.tv_usec = 0;
+	sos_sched_block_object[id] = NULL;
+	sos_sched_wake[id].tv_sec = SCHEDULER_TIMEVAL_SEC_INVALID;
+	sos_sched_wake[id].tv_usec = 0;
 }
 
 void scheduler_root_deassert_active(int id){
-	task_deassert_active(id);
-	task_deassert_exec(id);  //stop executing the task
+	task_deassert_active(id); //removes the task from the ready queue
+	if( sos_sched_profile[id].block_start == 0 ){
+		sos_sched_profile[id].block_start = task_root_get_cycles();
+	}
 }
 
 void scheduler_root_stop_task(int id){
@@ -60,11 +67,11 @@ void scheulder_root_start_task(int id){
 }
 
 void scheduler_root_assert(int id, int flag){
-	sos_sched_table[id].flags |= (1<<flag);
+	sos_sched_flags[id] |= (1<<flag);
 
 }
 void scheduler_root_deassert(int id, int flag){
-	sos_sched_table[id].flags &= ~(1<<flag);
+	sos_sched_flags[id] &= ~(1<<flag);
 }
 
 
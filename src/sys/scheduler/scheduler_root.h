@@ -65,19 +65,20 @@ void scheduler_root_deassert_active(int id);
 void scheduler_root_set_trace_id(int tid, trace_id_t id);
 void scheduler_root_assert_sync(void * args) MCU_ROOT_CODE;
 int scheduler_root_unblock_all(void * block_object, int unblock_type);
+int scheduler_root_get_highest_priority_blocked(void * block_object);
 void scheduler_svcall_set_delaymutex(void * args) MCU_ROOT_EXEC_CODE;
 
 void scheduler_root_stop_task(int id);
 void scheulder_root_start_task(int id);
 
 static inline volatile int scheduler_unblock_type(int id) MCU_ALWAYS_INLINE;
-volatile int scheduler_unblock_type(int id){ return sos_sched_table[id].flags & SCHEDULER_TASK_FLAG_UNBLOCK_MASK; }
+volatile int scheduler_unblock_type(int id){ return sos_sched_flags[id] & SCHEDULER_TASK_FLAG_UNBLOCK_MASK; }
 
 
 static inline void scheduler_root_set_unblock_type(int id, scheduler_unblock_type_t unblock_type) MCU_ALWAYS_INLINE;
 void scheduler_root_set_unblock_type(int id, scheduler_unblock_type_t unblock_type){
-	sos_sched_table[id].flags &= ~SCHEDULER_TASK_FLAG_UNBLOCK_MASK;
-	sos_sched_table[id].flags |= unblock_type;
+	sos_sched_flags[id] &= ~SCHEDULER_TASK_FLAG_UNBLOCK_MASK;
+	sos_sched_flags[id] |= unblock_type;
 };
 
 
@@ -111,7 +111,10 @@ void svcall_activate_thread(svcall_activate_thread_t * args){
 	struct _reent * reent;
 
 
+	scheduler_wait_root_remove(id);
 	memset( (void*)&sos_sched_table[id], 0, sizeof(sched_task_t));
+	sos_sched_flags[id] = 0;
+	sos_sched_block_object[id] = NULL;
 	memcpy( (void*)&(sos_sched_table[id].attr), args->attr, sizeof(pthread_attr_t));
 
 	//Items inherited from parent thread
@@ -127,8 +130,8 @@ void svcall_activate_thread(svcall_activate_thread_t * args){
 	}
 
 	scheduler_timing_root_process_timer_initialize(id);
-	sos_sched_table[id].wake.tv_sec = SCHEDULER_TIMEVAL_SEC_INVALID;
-	sos_sched_table[id].wake.tv_usec = 0;
+	sos_sched_wake[id].tv_sec = SCHEDULER_TIMEVAL_SEC_INVALID;
+	sos_sched_wake[id].tv_usec = 0;
 	scheduler_root_assert_active(id, 0);
 	scheduler_root_assert_inuse(id);
 	if( scheduler_authenticated_asserted(task_get_current()) ){
@@ -208,7 +211,7 @@ void svcall_wait_joined(void * args){
 	//wait until the thread has been joined to free the resources
 	for(joined=1; joined < task_get_total(); joined++){
 		//check to see if any threads are blocked on this thread
-		if ( sos_sched_table[joined].block_object == &sos_sched_table[task_get_current()] ){
+		if ( sos_sched_block_object[joined] == &sos_sched_table[task_get_current()] ){
 			//This thread is joined to the current thread
 			p->joined = joined;
 			//the thread can continue when one thread has been joined
@@ -217,7 +220,7 @@ void svcall_wait_joined(void * args){
 	}
 
 	if ( p->joined == 0 ){
-		sos_sched_table[task_get_current()].block_object = (void*)&sos_sched_table[task_get_current()].block_object; //block on self
+		sos_sched_block_object[task_get_current()] = (void*)&sos_sched_block_object[task_get_current()]; //block on self
 		scheduler_root_update_on_sleep();
 	} else {
 		sos_sched_table[task_get_current()].exit_status = p->status;
@@ -231,14 +234,14 @@ void svcall_cleanup(void * args){
 	//notify all joined threads of termination
 	for(joined=1; joined < task_get_total(); joined++){
 		//check to see if any threads are blocked on this thread
-		if ( sos_sched_table[joined].block_object == &sos_sched_table[task_get_current()] ){
+		if ( sos_sched_block_object[joined] == &sos_sched_table[task_get_current()] ){
 			//This thread is joined to the current thread
 			sos_sched_table[joined].exit_status = sos_sched_table[task_get_current()].exit_status;
 			scheduler_root_assert_active(joined, SCHEDULER_UNBLOCK_PTHREAD_JOINED_THREAD_COMPLETE);
 		}
 	}
 
-	sos_sched_table[task_get_current()].flags = 0;
+	sos_sched_flags[task_get_current()] = 0;
 	task_root_delete(task_get_current());
 	scheduler_root_update_on_sleep();
 }
@@ -402,13 +402,13 @@ void scheduler_timing_root_timedblock(void * block_object, struct mcu_timeval *
 
 	//Initialization
 	id = task_get_current();
-	sos_sched_table[id].block_object = block_object;
+	sos_sched_block_object[id] = block_object;
 	is_time_to_sleep = 0;
 
 	if (abs_time->tv_sec >= sched_usecond_counter){
 
-		sos_sched_table[id].wake.tv_sec = abs_time->tv_sec;
-		sos_sched_table[id].wake.tv_usec = abs_time->tv_usec;
+		sos_sched_wake[id].tv_sec = abs_time->tv_sec;
+		sos_sched_wake[id].tv_usec = abs_time->tv_usec;
 
 		if(abs_time->tv_sec == sched_usecond_counter){
 
@@ -551,11 +551,11 @@ int root_handle_usecond_match_event(void * context, const mcu_event_t * data){
 	for(i=1; i < task_get_total(); i++){
 
 		if( task_enabled_not_active(i) ){
-			tmp = sos_sched_table[i].wake.tv_usec;
+			tmp = sos_sched_wake[i].tv_usec;
 
 			//compare the current clock to the wake time
-			if ( (sos_sched_table[i].wake.tv_sec < sched_usecond_counter) ||
-					 ( (sos_sched_table[i].wake.tv_sec == sched_usecond_counter) && (tmp <= now) )
+			if ( (sos_sched_wake[i].tv_sec < sched_usecond_counter) ||
+					 ( (sos_sched_wake[i].tv_sec == sched_usecond_counter) && (tmp <= now) )
 					 ){
 				//wake this task
 				scheduler_root_assert_active(i, SCHEDULER_UNBLOCK_SLEEP);
@@ -563,7 +563,7 @@ int root_handle_usecond_match_event(void * context, const mcu_event_t * data){
 					new_priority = scheduler_priority(i);
 				}
 
-			} else if ( (sos_sched_table[i].wake.tv_sec == sched_usecond_counter) && (tmp < next) ) {
+			} else if ( (sos_sched_wake[i].tv_sec == sched_usecond_counter) && (tmp < next) ) {
 				//see if this is the next event to wake up
 				next = tmp;
 			}
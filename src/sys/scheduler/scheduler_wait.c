@@ -0,0 +1,310 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+/*! \addtogroup SCHED
+ * @{
+ *
+ */
+
+/*! \file */
+
+#include <string.h>
+#include "scheduler_local.h"
+
+/* Tasks blocked on a mutex, semaphore, condition or message queue are kept
+ * in wait lists. The block objects are in application memory so the lists
+ * are kept here and each object is hashed to one of the lists.
+ *
+ * Each list is ordered by task priority (highest first). Tasks of the same
+ * priority are in the order they blocked. The first task in the list that
+ * is blocked on an object is the next one to wake.
+ *
+ * The lists are only changed in SVCall context. Timeouts and signals wake
+ * tasks from interrupts without touching the lists so an entry for a task
+ * that is no longer blocked is removed the next time its list is walked.
+ * Each entry records the object it was added for. If the task is blocked
+ * on anything else (even an object that hashes to the same list), the
+ * entry is stale.
+ *
+ * Objects that hash to the same list share it. Waking one task walks the
+ * list until the first task blocked on the object, so it is O(1) only
+ * when the object has the list to itself. Waking all tasks walks the
+ * whole list. scheduler_wait_root_get_inherited_priority() doesn't know
+ * which mutexes a task owns so it walks every list. That only happens
+ * when a task that inherited a priority unlocks a mutex.
+ *
+ */
+
+//circular wait list per hash (0 is empty because task 0 never waits on a block object)
+static volatile u8 m_scheduler_wait_head[SCHEDULER_WAIT_LIST_COUNT] MCU_SYS_MEM;
+static volatile u8 m_scheduler_wait_count[SCHEDULER_WAIT_LIST_COUNT] MCU_SYS_MEM;
+
+static int get_list(const void * block_object);
+static int is_stale(int id);
+static int is_waiting_on_mutex(int id);
+static void prune_list(int list);
+static void list_insert(int id, const void * block_object, int is_mutex);
+static void list_remove(int id);
+
+void scheduler_wait_init(){
+	memset((void*)m_scheduler_wait_head, 0, sizeof(m_scheduler_wait_head));
+	memset((void*)m_scheduler_wait_count, 0, sizeof(m_scheduler_wait_count));
+}
+
+void scheduler_wait_root_insert(int id, void * block_object, int is_mutex){
+	if( sos_sched_table[id].wait_list ){
+		list_remove(id);
+	}
+	sos_sched_block_object[id] = block_object;
+	list_insert(id, block_object, is_mutex);
+}
+
+void scheduler_wait_root_remove(int id){
+	if( sos_sched_table[id].wait_list ){
+		list_remove(id);
+	}
+}
+
+//called when the priority of a waiting task changes
+void scheduler_wait_root_update_priority(int id){
+	const void * block_object;
+	int is_mutex;
+	if( sos_sched_table[id].wait_list && !is_stale(id) ){
+		block_object = sos_sched_table[id].wait_object;
+		is_mutex = sos_sched_table[id].wait_is_mutex;
+		list_remove(id);
+		list_insert(id, block_object, is_mutex);
+	}
+}
+
+void scheduler_wait_root_timedblock(void * block_object, struct mcu_timeval * abs_time, int is_mutex){
+	int id = task_get_current();
+	scheduler_wait_root_insert(id, block_object, is_mutex);
+	scheduler_timing_root_timedblock(block_object, abs_time);
+	if( task_active_asserted(id) && sos_sched_table[id].wait_list ){
+		//abs_time has already passed so the task didn't block
+		list_remove(id);
+	}
+}
+
+//the caller must wake the task that is returned
+int scheduler_root_get_highest_priority_blocked(void * block_object){
+	int list = get_list(block_object);
+	int count = m_scheduler_wait_count[list];
+	int current = m_scheduler_wait_head[list];
+	int next;
+	int i;
+
+	for(i=0; i < count; i++){
+		next = sos_sched_table[current].wait_next;
+		if( is_stale(current) ){
+			list_remove(current);
+		} else if( (sos_sched_block_object[current] == block_object) && !task_stopped_asserted(current) ){
+			list_remove(current);
+			return current;
+		}
+		current = next;
+	}
+
+	return -1;
+}
+
+//This is only called from SVcall so it is always synchronous -- no re-entrancy issues with it
+int scheduler_root_unblock_all(void * block_object, int unblock_type){
+	int list = get_list(block_object);
+	int count = m_scheduler_wait_count[list];
+	int current = m_scheduler_wait_head[list];
+	int next;
+	int priority;
+	int i;
+
+	priority = SCHED_LOWEST_PRIORITY - 1;
+	for(i=0; i < count; i++){
+		next = sos_sched_table[current].wait_next;
+		if( is_stale(current) ){
+			list_remove(current);
+		} else if( sos_sched_block_object[current] == block_object ){
+			list_remove(current);
+			scheduler_root_assert_active(current, unblock_type);
+			if( !task_stopped_asserted(current) && (task_get_priority(current) > priority) ){
+				priority = task_get_priority(current);
+			}
+		}
+		current = next;
+	}
+	return priority;
+}
+
+//called when a task blocks on mutex -- the owner runs at priority until it unlocks
+void scheduler_wait_root_inherit_priority(pthread_mutex_t * mutex, int priority){
+	int owner;
+	int i;
+
+	//follow the chain of owners (the limit stops at a deadlock cycle)
+	for(i=0; i < task_get_total(); i++){
+		owner = mutex->pthread;
+		if( (owner <= 0) || (owner >= task_get_total()) || !task_enabled(owner) ){
+			return;
+		}
+
+		if( task_get_priority(owner) >= priority ){
+			return;
+		}
+
+		task_set_priority(owner, priority);
+		if( is_waiting_on_mutex(owner) == 0 ){
+			return;
+		}
+
+		//the owner is also waiting on a mutex -- keep its list in order and elevate that owner
+		scheduler_wait_root_update_priority(owner);
+		mutex = (pthread_mutex_t*)sos_sched_block_object[owner];
+	}
+}
+
+//the priority a task should have after it unlocks a mutex
+int scheduler_wait_root_get_inherited_priority(int id){
+	int priority = sos_sched_table[id].attr.schedparam.sched_priority;
+	int list;
+	int count;
+	int current;
+	int i;
+
+	if( task_get_priority(id) <= priority ){
+		//nothing was inherited
+		return priority;
+	}
+
+	//the highest priority task waiting on a mutex the task still owns
+	for(list=0; list < SCHEDULER_WAIT_LIST_COUNT; list++){
+		count = m_scheduler_wait_count[list];
+		current = m_scheduler_wait_head[list];
+		for(i=0; i < count; i++){
+			if( !is_stale(current) &&
+				 sos_sched_table[current].wait_is_mutex &&
+				 (((pthread_mutex_t*)sos_sched_block_object[current])->pthread == id) &&
+				 (task_get_priority(current) > priority) ){
+				priority = task_get_priority(current);
+			}
+			current = sos_sched_table[current].wait_next;
+		}
+	}
+
+	return priority;
+}
+
+//this is called from user space to skip the kernel call when nothing can be waiting
+int scheduler_wait_is_empty(const void * block_object){
+	return m_scheduler_wait_head[get_list(block_object)] == 0;
+}
+
+int get_list(const void * block_object){
+	u32 value = (u32)block_object;
+	//block objects are word aligned
+	return ((value >> 2) ^ (value >> 8)) % SCHEDULER_WAIT_LIST_COUNT;
+}
+
+int is_stale(int id){
+	//the task was woken (timeout, signal or exit) without being removed from the list
+	return !task_enabled(id) ||
+			task_active_asserted(id) ||
+			(sos_sched_block_object[id] != sos_sched_table[id].wait_object);
+}
+
+int is_waiting_on_mutex(int id){
+	return sos_sched_table[id].wait_list && sos_sched_table[id].wait_is_mutex && !is_stale(id);
+}
+
+void prune_list(int list){
+	int count = m_scheduler_wait_count[list];
+	int current = m_scheduler_wait_head[list];
+	int next;
+	int i;
+	for(i=0; i < count; i++){
+		next = sos_sched_table[current].wait_next;
+		if( is_stale(current) ){
+			list_remove(current);
+		}
+		current = next;
+	}
+}
+
+void list_insert(int id, const void * block_object, int is_mutex){
+	int list = get_list(block_object);
+	int priority = task_get_priority(id);
+	int head;
+	int current;
+	int prev;
+
+	//stale entries would break the order
+	prune_list(list);
+
+	head = m_scheduler_wait_head[list];
+	if( head == 0 ){
+		sos_sched_table[id].wait_next = id;
+		sos_sched_table[id].wait_prev = id;
+		m_scheduler_wait_head[list] = id;
+	} else {
+		//insert after all tasks of the same or higher priority
+		current = head;
+		do {
+			if( task_get_priority(current) < priority ){
+				break;
+			}
+			current = sos_sched_table[current].wait_next;
+		} while( current != head );
+
+		prev = sos_sched_table[current].wait_prev;
+		sos_sched_table[id].wait_next = current;
+		sos_sched_table[id].wait_prev = prev;
+		sos_sched_table[prev].wait_next = id;
+		sos_sched_table[current].wait_prev = id;
+		if( (current == head) && (task_get_priority(head) < priority) ){
+			m_scheduler_wait_head[list] = id;
+		}
+	}
+
+	m_scheduler_wait_count[list]++;
+	sos_sched_table[id].wait_list = list + 1;
+	sos_sched_table[id].wait_object = block_object;
+	sos_sched_table[id].wait_is_mutex = is_mutex != 0;
+}
+
+void list_remove(int id){
+	int list = sos_sched_table[id].wait_list - 1;
+	int next = sos_sched_table[id].wait_next;
+	int prev = sos_sched_table[id].wait_prev;
+
+	if( next == id ){
+		m_scheduler_wait_head[list] = 0;
+	} else {
+		sos_sched_table[prev].wait_next = next;
+		sos_sched_table[next].wait_prev = prev;
+		if( m_scheduler_wait_head[list] == id ){
+			m_scheduler_wait_head[list] = next;
+		}
+	}
+
+	m_scheduler_wait_count[list]--;
+	sos_sched_table[id].wait_list = 0;
+	sos_sched_table[id].wait_object = NULL;
+	sos_sched_table[id].wait_is_mutex = 0;
+}
+
+/*! @} */
@@ -0,0 +1,44 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef SCHEDULER_SCHEDULER_WAIT_H_
+#define SCHEDULER_SCHEDULER_WAIT_H_
+
+#include <pthread.h>
+#include "mcu/types.h"
+#include "sos/sos.h"
+
+//number of wait lists that block objects are hashed to
+#if !defined SCHEDULER_WAIT_LIST_COUNT
+#define SCHEDULER_WAIT_LIST_COUNT 16
+#endif
+
+void scheduler_wait_init();
+
+void scheduler_wait_root_insert(int id, void * block_object, int is_mutex);
+void scheduler_wait_root_remove(int id);
+void scheduler_wait_root_update_priority(int id);
+void scheduler_wait_root_timedblock(void * block_object, struct mcu_timeval * abs_time, int is_mutex);
+
+void scheduler_wait_root_inherit_priority(pthread_mutex_t * mutex, int priority);
+int scheduler_wait_root_get_inherited_priority(int id);
+
+int scheduler_wait_is_empty(const void * block_object);
+
+#endif /* SCHEDULER_SCHEDULER_WAIT_H_ */
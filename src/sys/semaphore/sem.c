@@ -298,8 +298,6 @@ int sem_close(sem_t *sem){
  *
  */
 int sem_post(sem_t *sem){
-	int new_thread;
-
 	if ( check_initialized(sem) < 0 ){
 		return -1;
 	}
@@ -308,10 +306,8 @@ int sem_post(sem_t *sem){
 	sem->value++;
 
 	//see if any tasks are blocked on this semaphore
-	new_thread = scheduler_get_highest_priority_blocked(sem);
-
-	if ( new_thread != -1 ){
-		cortexm_svcall(svcall_sem_post, &new_thread);
+	if ( scheduler_wait_is_empty(sem) == 0 ){
+		cortexm_svcall(svcall_sem_post, sem);
 	}
 
 	return 0;
@@ -461,10 +457,11 @@ int sem_wait(sem_t *sem){
 
 void svcall_sem_post(void * args){
 	CORTEXM_SVCALL_ENTER();
-	int id = *((int*)args);
-	sos_sched_table[id].block_object = NULL;
-	scheduler_root_assert_active(id, SCHEDULER_UNBLOCK_SEMAPHORE);
-	scheduler_root_update_on_wake(id, task_get_priority(id));
+	int id = scheduler_root_get_highest_priority_blocked(args);
+	if( id != -1 ){
+		scheduler_root_assert_active(id, SCHEDULER_UNBLOCK_SEMAPHORE);
+		scheduler_root_update_on_wake(id, task_get_priority(id));
+	}
 }
 
 void svcall_sem_timedwait(void * args){
@@ -472,7 +469,7 @@ void svcall_sem_timedwait(void * args){
 	root_sem_args_t * p = (root_sem_args_t*)args;
 
 	if ( p->sem->value <= 0 ){
-		scheduler_timing_root_timedblock(p->sem, &p->interval);
+		scheduler_wait_root_timedblock(p->sem, &p->interval, 0);
 		p->result = -1;
 	} else {
 		p->result = 0;
@@ -497,10 +494,11 @@ void svcall_sem_wait(void * args){
 	CORTEXM_SVCALL_ENTER();
 	root_sem_args_t * p = args;
 
-	sos_sched_table[ task_get_current() ].block_object = p->sem;
+	sos_sched_block_object[ task_get_current() ] = p->sem;
 
 	if ( p->sem->value <= 0){
 		//task must be blocked until the semaphore is available
+		scheduler_wait_root_insert(task_get_current(), p->sem, 0);
 		scheduler_root_update_on_sleep();
 		p->result = -1; //didn't get the semaphore
 	} else {
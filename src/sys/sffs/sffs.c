@@ -458,6 +458,31 @@ int sffs_write(const void * cfg, void * handle, int flags, int loc, const void *
 	return ret;
 }
 
+static int execute_aio(const void * cfg, void * handle, struct aiocb * aio){
+	int ret;
+	//hold the lock for the whole transfer so queued requests don't interleave on the handle
+	lock_sffs(cfg);
+	if( aio->aio_lio_opcode == LIO_READ ){
+		ret = sffs_read(cfg, handle, 0, aio->async.loc, aio->async.buf, aio->async.nbyte);
+	} else {
+		ret = sffs_write(cfg, handle, 0, aio->async.loc, aio->async.buf_const, aio->async.nbyte);
+	}
+	unlock_sffs(cfg);
+	return ret;
+}
+
+int sffs_aio(const void * cfg, void * handle, struct aiocb * aio){
+	cl_handle_t * h = (cl_handle_t*)handle;
+	int amode = (aio->aio_lio_opcode == LIO_READ) ? R_OK : W_OK;
+
+	if ( (h->amode & amode) == 0 ){
+		return SYSFS_SET_RETURN(EACCES);
+	}
+
+	//segments are saved and blocks are written by a worker thread so the caller keeps running
+	return sysfs_aio_submit(cfg, handle, aio, execute_aio);
+}
+
 int sffs_close(const void * cfg, void ** handle){
 	int ret;
 	void * h;
@@ -530,6 +555,15 @@ sffs_readdir_unlock:
 }
 
 
+int sffs_fsync(const void * cfg, void * handle){
+	int ret;
+	MCU_UNUSED_ARGUMENT(handle);
+	lock_sffs(cfg);
+	ret = sffs_dev_fsync(cfg);
+	unlock_sffs(cfg);
+	return ret;
+}
+
 int sffs_closedir(const void * cfg, void ** handle){
 	MCU_UNUSED_ARGUMENT(cfg);
 	if ( *handle != OPENDIR_HANDLE ){
@@ -214,6 +214,10 @@ int sffs_dev_erasesection(const void * cfg, int loc){
 	return 0;
 }
 
+int sffs_dev_fsync(const void * cfg){
+	return sysfs_shared_fsync(SFFS_DRIVE(cfg));
+}
+
 int sffs_dev_close(const void * cfg){
 	return sysfs_shared_close(SFFS_DRIVE(cfg));
 }
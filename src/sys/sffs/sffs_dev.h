@@ -47,6 +47,7 @@ int sffs_dev_open(const void * cfg);
 int sffs_dev_write(const void * cfg, int loc, const void * buf, int nbyte);
 int sffs_dev_read(const void * cfg, int loc, void * buf, int nbyte);
 int sffs_dev_close(const void * cfg);
+int sffs_dev_fsync(const void * cfg);
 
 static inline int sffs_dev_getsize(const void * cfg){
 	return SFFS_STATE(cfg)->dattr.num_write_blocks * SFFS_STATE(cfg)->dattr.write_block_size;
@@ -180,6 +180,10 @@ int sffs_dev_read(const void * cfg, int loc, void * buf, int nbyte){
 	return nbyte;
 }
 
+int sffs_dev_fsync(const void * cfg){
+	return 0;
+}
+
 int sffs_dev_close(const void * cfg){
 	return 0;
 }
@@ -171,6 +171,11 @@ int sysfs_access(int file_mode, int file_uid, int file_gid, int amode){
 
 
 
+//AIO is tested on the host with the kernel's sysfs_aio.c (see test/sys/test_sysfs_aio.c)
+int sysfs_aio_submit(const void * config, void * handle, struct aiocb * aio, sysfs_aio_execute_t execute){
+	return SYSFS_SET_RETURN(ENOTSUP);
+}
+
 int sysfs_notsup(){
 	errno = ENOTSUP;
 	return -1;
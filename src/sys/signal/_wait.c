@@ -133,7 +133,7 @@ void svcall_check_for_zombie_child(void * args){
 							if( num_zombies == 0 ){
 								p->tid = i;
 								p->status = sos_sched_table[i].exit_status;
-								sos_sched_table[i].flags = 0;
+								sos_sched_flags[i] = 0;
 								task_root_delete(i);
 							}
 							num_zombies++;
@@ -160,15 +160,6 @@ int socket(int domain, int type, int protocol){
 }
 
 
-int writev(int s, const struct iovec *iov, int iovcnt){
-	if( FILDES_IS_SOCKET(s) ){
-		return sos_board_config.socket_api->writev(s & ~FILDES_SOCKET_FLAG, iov, iovcnt);
-	}
-	errno = ENOTSOCK;
-	return -1;
-}
-
-
 int select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset, struct timeval *timeout){
 	return sos_board_config.socket_api->select(maxfdp1, readset, writeset, exceptset, timeout);
 }
@@ -34,6 +34,7 @@
 #include "symbols.h"
 
 static int read_task(sys_taskattr_t * task);
+static int read_task_profile(sys_taskprofile_t * profile);
 static int sys_setattr(const devfs_handle_t * handle, void * ctl);
 
 
@@ -79,6 +80,9 @@ int sys_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 		case I_SYS_GETTASK:
 			return read_task(ctl);
 
+		case I_SYS_GETTASKPROFILE:
+			return read_task_profile(ctl);
+
 		case I_SYS_GETID:
 			memcpy(id->id, sos_board_config.sys_id, PATH_MAX-1);
 			return 0;
@@ -151,6 +155,37 @@ int sys_ioctl(const devfs_handle_t * handle, int request, void * ctl){
 			}
 			return SYSFS_SET_RETURN(EPERM);
 
+		case I_SYS_GETFPUSTATS:
+		{
+			sys_fpu_stats_t * stats = ctl;
+			memset(stats, 0, sizeof(sys_fpu_stats_t));
+			stats->save_count = task_get_fpu_save_count();
+			stats->restore_count = task_get_fpu_restore_count();
+			stats->owner_tid = task_get_fpu_owner();
+			return 0;
+		}
+
+		case I_SYS_READTRACE:
+		{
+			sys_trace_read_t * trace = ctl;
+			u32 dropped;
+			if( trace->o_flags & SYS_TRACE_FLAG_DISABLE ){
+				sos_trace_root_set_enabled(0);
+			}
+			if( trace->o_flags & SYS_TRACE_FLAG_FLUSH ){
+				sos_trace_root_flush();
+			}
+			if( trace->o_flags & SYS_TRACE_FLAG_ENABLE ){
+				sos_trace_root_set_enabled(1);
+			}
+			memset(trace, 0, sizeof(sys_trace_read_t));
+			trace->count = sos_trace_root_read_records(trace->record, SYS_TRACE_READ_MAX, &dropped);
+			trace->dropped = dropped;
+			trace->frequency = mcu_board_config.core_cpu_freq;
+			trace->is_enabled = sos_trace_is_enabled();
+			return trace->count;
+		}
+
 		default:
 			break;
 	}
@@ -216,6 +251,39 @@ int read_task(sys_taskattr_t * task){
 	return ret;
 }
 
+int read_task_profile(sys_taskprofile_t * profile){
+	u32 tid = profile->tid;
+	u32 stack_top;
+	int i;
+
+	if( tid >= task_get_total() ){
+		return SYSFS_SET_RETURN_WITH_VALUE(ESRCH, 1);
+	}
+
+	memset(profile, 0, sizeof(sys_taskprofile_t));
+	profile->tid = tid;
+	if( task_enabled(tid) == 0 ){
+		return 0;
+	}
+
+	profile->is_enabled = 1;
+	profile->pid = task_get_pid(tid);
+	profile->run_cycles = task_root_gettime(tid);
+	profile->switch_count = sos_task_table[tid].switch_count;
+	profile->max_latency_cycles = sos_task_table[tid].max_latency;
+
+	//threads and processes both keep the top of the stack at the end of attr memory
+	stack_top = (u32)sos_sched_table[tid].attr.stackaddr + sos_sched_table[tid].attr.stacksize;
+	if( sos_task_table[tid].min_sp && (sos_task_table[tid].min_sp < stack_top) ){
+		profile->max_stack_size = stack_top - sos_task_table[tid].min_sp;
+	}
+
+	for(i=0; i < SYS_TASKPROFILE_BLOCK_COUNT; i++){
+		profile->block_usec[i] = sos_sched_profile[tid].block_cycles[i] / SCHEDULER_CLOCK_USEC_MULT;
+	}
+	return 1;
+}
+
 int sys_setattr(const devfs_handle_t * handle, void * ctl){
 	const sys_attr_t * attr = ctl;
 
@@ -31,6 +31,7 @@
 #include "cortexm/mpu.h"
 #include "mcu/debug.h"
 #include "appfs_local.h"
+#include "../process/process_start.h"
 #include "sos/fs/sysfs.h"
 #include "../scheduler/scheduler_local.h"
 
@@ -638,6 +639,7 @@ void svcall_ioctl(void * args){
 			} else {
 				a->result = appfs_util_root_writeinstall(a->cfg, h, attr);
 				mcu_core_invalidate_instruction_cache();
+				process_start_root_invalidate_cache();
 			}
 			break;
 
@@ -646,6 +648,7 @@ void svcall_ioctl(void * args){
 				a->result = SYSFS_SET_RETURN(ENOTSUP);
 			} else {
 				a->result = appfs_util_root_create(a->cfg, h, attr);
+				process_start_root_invalidate_cache();
 			}
 			break;
 
@@ -20,6 +20,7 @@
 #include "sos/sos.h"
 #include "cortexm/mpu.h"
 #include "appfs_local.h"
+#include "../process/process_start.h"
 
 static void set_page_usage(u32 * usage, u32 page, int type);
 static int get_page_usage(u32 * usage, u32 page);
@@ -54,6 +55,8 @@ void appfs_ram_svcall_set(void * args){
 	u32 pages;
 	mem_info_t info;
 	appfs_ram_t * p = args;
+	//programs using this RAM may have been removed or replaced
+	process_start_root_invalidate_cache();
 	p->device->driver.ioctl(&p->device->handle, I_MEM_GETINFO, &info);
 
 	pages = (p->size + MCU_RAM_PAGE_SIZE - 1) / MCU_RAM_PAGE_SIZE;
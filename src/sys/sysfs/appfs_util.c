@@ -29,6 +29,7 @@
 #include "cortexm/task.h"
 #include "mcu/core.h"
 #include "appfs_local.h"
+#include "../process/process_start.h"
 #include "mcu/debug.h"
 #include "mcu/wdt.h"
 
@@ -73,6 +74,8 @@ int is_flash_blank(u32 address, u32 size){
 
 int appfs_util_root_erase_pages(const devfs_device_t * dev, int start_page, int end_page){
 	int i;
+	//erased programs must not be launched from the cached header
+	process_start_root_invalidate_cache();
 	for(i=start_page; i <= end_page; i++){
 		mcu_wdt_reset();
 		int result = dev->driver.ioctl(&(dev->handle), I_MEM_ERASE_PAGE, (void*)i);
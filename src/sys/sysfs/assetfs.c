@@ -18,6 +18,7 @@
  */
 
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include "dirent.h"
@@ -34,18 +35,28 @@ typedef struct {
 	int ino;
 	const void * data;
 	u32 size;
+	u32 is_compressed;
+	assetfs_chunk_reader_t reader;
 	u32 checksum;
 } assetfs_handle_t;
 
+//compressed assets on every assetfs mount share one decode buffer
+static assetfs_chunk_cache_t m_assetfs_chunk_cache;
+
 int assetfs_init(const void* cfg){
-	//nothing to initialize
-	return 0;
+	MCU_UNUSED_ARGUMENT(cfg);
+	if( m_assetfs_chunk_cache.users ){
+		//already initialized by another mount
+		return 0;
+	}
+	return assetfs_chunk_init_cache(&m_assetfs_chunk_cache);
 }
 
 
 static int get_directory_entry(const void * cfg, int loc, const assetfs_dirent_t ** entry);
 static const assetfs_dirent_t * find_file(const void * cfg, const char * path, int * ino);
 static void assign_stat(int ino, const assetfs_dirent_t * entry, struct stat * st);
+static const assetfs_chunk_header_t * get_chunk_header(const assetfs_dirent_t * entry);
 
 int assetfs_startup(const void* cfg){
 	//check for any applications that are embedded and start them?
@@ -61,6 +72,10 @@ int assetfs_open(const void* cfg, void ** handle, const char * path, int flags,
 	const assetfs_dirent_t * directory_entry =
 			find_file(cfg, path, &ino);
 
+	if( directory_entry == 0 ){
+		return SYSFS_SET_RETURN(ENOENT);
+	}
+
 	if( sysfs_is_r_ok(
 			 directory_entry->mode,
 			 directory_entry->uid,
@@ -77,6 +92,20 @@ int assetfs_open(const void* cfg, void ** handle, const char * path, int flags,
 	h->ino = ino;
 	h->data = (const void*)(directory_entry->start);
 	h->size = directory_entry->end - directory_entry->start;
+	h->is_compressed = 0;
+
+	const assetfs_chunk_header_t * chunk_header = get_chunk_header(directory_entry);
+	if( chunk_header ){
+		//compressed chunks are decoded straight from flash
+		int result = assetfs_chunk_open_reader(&h->reader, &m_assetfs_chunk_cache, chunk_header, h->size, h->data);
+		if( result < 0 ){
+			free(h);
+			return result;
+		}
+		h->is_compressed = 1;
+		h->size = chunk_header->size;
+	}
+
 	cortexm_assign_zero_sum32(h, sizeof(assetfs_handle_t) / sizeof(u32));
 
 	*handle = h;
@@ -90,6 +119,9 @@ int assetfs_read(const void * cfg, void * handle, int flags, int loc, void * buf
 		return SYSFS_SET_RETURN(EINVAL);
 	}
 	if( loc < 0 ){ return SYSFS_SET_RETURN(EINVAL); }
+	if( h->is_compressed ){
+		return assetfs_chunk_read(&h->reader, loc, buf, nbyte);
+	}
 	int bytes_ready = h->size - loc;
 	if( bytes_ready > nbyte ){ bytes_ready = nbyte; }
 	if( bytes_ready <= 0 ){ return 0; }
@@ -119,7 +151,11 @@ int assetfs_close(const void* cfg, void ** handle){
 		if( cortexm_verify_zero_sum32(*handle, sizeof(assetfs_handle_t) / sizeof(u32)) == 0 ){
 			return SYSFS_SET_RETURN(EINVAL);
 		}
-		free(*handle);
+		assetfs_handle_t * h = *handle;
+		if( h->is_compressed ){
+			assetfs_chunk_close_reader(&h->reader);
+		}
+		free(h);
 		*handle = 0;
 	}
 	return 0;
@@ -154,8 +190,9 @@ int assetfs_stat(const void* cfg, const char * path, struct stat * st){
 }
 
 void assign_stat(int ino, const assetfs_dirent_t * entry, struct stat * st){
+	const assetfs_chunk_header_t * chunk_header = get_chunk_header(entry);
 	memset(st, 0, sizeof(struct stat));
-	st->st_size = entry->end - entry->start;
+	st->st_size = chunk_header ? chunk_header->size : entry->end - entry->start;
 	st->st_ino = ino;
 	st->st_mode = entry->mode | S_IFREG;
 	st->st_uid = entry->uid;
@@ -214,3 +251,13 @@ int get_directory_entry(const void * cfg, int loc, const assetfs_dirent_t ** ent
 	return 0;
 
 }
+
+const assetfs_chunk_header_t * get_chunk_header(const assetfs_dirent_t * entry){
+	const assetfs_chunk_header_t * header = (const assetfs_chunk_header_t*)entry->start;
+	u32 stored_size = entry->end - entry->start;
+	if( (stored_size >= sizeof(assetfs_chunk_header_t)) &&
+		 assetfs_chunk_is_valid(header, stored_size) ){
+		return header;
+	}
+	return 0;
+}
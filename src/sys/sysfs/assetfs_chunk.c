@@ -0,0 +1,180 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sos/fs/sysfs.h"
+#include "sos/fs/assetfs.h"
+
+static int read_stored(assetfs_chunk_reader_t * reader, u32 offset, void * buf, int nbyte);
+
+int assetfs_chunk_init_cache(assetfs_chunk_cache_t * cache){
+	pthread_mutexattr_t mutexattr;
+
+	memset(cache, 0, sizeof(assetfs_chunk_cache_t));
+	if( pthread_mutexattr_init(&mutexattr) < 0 ){
+		return SYSFS_SET_RETURN(errno);
+	}
+
+	//readers in any process share the buffer
+	pthread_mutexattr_setpshared(&mutexattr, true);
+	if( pthread_mutex_init(&cache->mutex, &mutexattr) < 0 ){
+		return SYSFS_SET_RETURN(errno);
+	}
+	return 0;
+}
+
+int assetfs_chunk_open_reader(assetfs_chunk_reader_t * reader, assetfs_chunk_cache_t * cache, const assetfs_chunk_header_t * header, u32 stored_size, const u8 * base){
+	int result = 0;
+
+	memset(reader, 0, sizeof(assetfs_chunk_reader_t));
+	reader->base = base;
+	reader->size = header->size;
+	reader->stored_size = stored_size;
+	reader->chunk_count = header->chunk_count;
+	reader->cache = cache;
+
+	pthread_mutex_lock(&cache->mutex);
+	if( cache->users == 0 ){
+		//stored chunks need a place to land if they can't be decoded in place
+		cache->data = malloc(ASSETFS_CHUNK_SIZE * (base ? 1 : 2));
+		if( cache->data == 0 ){
+			result = SYSFS_SET_RETURN(ENOMEM);
+		} else {
+			cache->compressed = base ? 0 : cache->data + ASSETFS_CHUNK_SIZE;
+			cache->owner = 0;
+		}
+	}
+
+	if( result == 0 ){
+		cache->users++;
+	}
+	pthread_mutex_unlock(&cache->mutex);
+	return result;
+}
+
+void assetfs_chunk_close_reader(assetfs_chunk_reader_t * reader){
+	assetfs_chunk_cache_t * cache = reader->cache;
+
+	pthread_mutex_lock(&cache->mutex);
+	if( cache->owner == reader ){
+		cache->owner = 0;
+	}
+
+	if( cache->users && (--cache->users == 0) ){
+		free(cache->data);
+		cache->data = 0;
+		cache->compressed = 0;
+	}
+	pthread_mutex_unlock(&cache->mutex);
+}
+
+int assetfs_chunk_read(assetfs_chunk_reader_t * reader, int loc, void * buf, int nbyte){
+	assetfs_chunk_cache_t * cache = reader->cache;
+	assetfs_chunk_header_t header;
+	int bytes_read = 0;
+	u32 offset[2];
+	u32 chunk;
+	u32 chunk_loc;
+	u32 chunk_length;
+	u32 stored_length;
+	int page;
+	int result = 0;
+
+	if( loc < 0 ){ return SYSFS_SET_RETURN(EINVAL); }
+	if( (u32)loc >= reader->size ){ return 0; }
+	if( nbyte > (int)(reader->size - loc) ){ nbyte = reader->size - loc; }
+
+	header.chunk_count = reader->chunk_count;
+
+	pthread_mutex_lock(&cache->mutex);
+	while( bytes_read < nbyte ){
+		chunk = (u32)loc / ASSETFS_CHUNK_SIZE;
+		chunk_loc = (u32)loc % ASSETFS_CHUNK_SIZE;
+		chunk_length = reader->size - chunk*ASSETFS_CHUNK_SIZE;
+		if( chunk_length > ASSETFS_CHUNK_SIZE ){ chunk_length = ASSETFS_CHUNK_SIZE; }
+		page = chunk_length - chunk_loc;
+		if( page > nbyte - bytes_read ){ page = nbyte - bytes_read; }
+
+		if( (cache->owner != reader) || (chunk != cache->chunk) ){
+			result = read_stored(reader,
+										sizeof(assetfs_chunk_header_t) + chunk*sizeof(u32),
+										offset,
+										sizeof(offset));
+			if( result < 0 ){ break; }
+			if( assetfs_chunk_is_valid_offset(&header, reader->stored_size, offset) == 0 ){
+				result = SYSFS_SET_RETURN(EIO);
+				break;
+			}
+			stored_length = offset[1] - offset[0];
+
+			if( stored_length == chunk_length ){
+				//stored without compression -- copy only what was asked for
+				result = read_stored(reader, offset[0] + chunk_loc, (u8*)buf + bytes_read, page);
+				if( result < 0 ){ break; }
+				bytes_read += page;
+				loc += page;
+				continue;
+			}
+
+			//the buffer is shared by every reader on the filesystem
+			cache->owner = 0;
+			if( reader->base ){
+				result = assetfs_chunk_decompress(
+							reader->base + offset[0], stored_length,
+							cache->data, chunk_length);
+			} else {
+				result = read_stored(reader, offset[0], cache->compressed, stored_length);
+				if( result < 0 ){ break; }
+				result = assetfs_chunk_decompress(
+							cache->compressed, stored_length,
+							cache->data, chunk_length);
+			}
+
+			if( result != (int)chunk_length ){
+				result = SYSFS_SET_RETURN(EIO);
+				break;
+			}
+			cache->owner = reader;
+			cache->chunk = chunk;
+		}
+
+		memcpy((u8*)buf + bytes_read, cache->data + chunk_loc, page);
+		bytes_read += page;
+		loc += page;
+	}
+	pthread_mutex_unlock(&cache->mutex);
+
+	if( result < 0 ){ return result; }
+	return bytes_read;
+}
+
+int read_stored(assetfs_chunk_reader_t * reader, u32 offset, void * buf, int nbyte){
+	int result;
+	if( reader->base ){
+		memcpy(buf, reader->base + offset, nbyte);
+		return nbyte;
+	}
+
+	result = reader->read(reader->context, offset, buf, nbyte);
+	if( result < 0 ){ return result; }
+	if( result != nbyte ){ return SYSFS_SET_RETURN(EIO); }
+	return result;
+}
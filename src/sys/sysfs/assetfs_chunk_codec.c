@@ -0,0 +1,205 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+/* The chunk format and LZ4 block codec are shared by the kernel
+ * (assetfs and drive_assetfs) and the link library (the packer) so
+ * both sides always agree on the format.
+ */
+
+#include <string.h>
+#include "sos/fs/sysfs.h"
+#include "sos/fs/assetfs.h"
+
+#define HASH_BITS 12
+#define MIN_MATCH 4
+#define LAST_LITERALS 5 //LZ4 blocks end with at least this many literals
+#define MATCH_LIMIT 12 //no match may start this close to the end
+#define MAX_OFFSET 65535
+
+static u8 * write_length(u8 * op, u32 length);
+
+int assetfs_chunk_is_valid(const assetfs_chunk_header_t * header, u32 stored_size){
+	if( (header->signature != ASSETFS_CHUNK_SIGNATURE) ||
+		 (header->chunk_size != ASSETFS_CHUNK_SIZE) ){
+		return 0;
+	}
+
+	//a raw asset could start with the signature -- make sure the rest adds up
+	if( header->chunk_count != (header->size + ASSETFS_CHUNK_SIZE - 1) / ASSETFS_CHUNK_SIZE ){
+		return 0;
+	}
+
+	if( sizeof(assetfs_chunk_header_t) + (u64)(header->chunk_count+1)*sizeof(u32) > stored_size ){
+		return 0;
+	}
+
+	return 1;
+}
+
+int assetfs_chunk_is_valid_offset(const assetfs_chunk_header_t * header, u32 stored_size, const u32 offset[2]){
+	//chunks are stored after the offset table and inside the asset
+	u32 data_offset = sizeof(assetfs_chunk_header_t) + (header->chunk_count+1)*sizeof(u32);
+	return (offset[0] >= data_offset) &&
+			(offset[1] >= offset[0]) &&
+			(offset[1] <= stored_size) &&
+			(offset[1] - offset[0] <= ASSETFS_CHUNK_SIZE);
+}
+
+int assetfs_chunk_compress(const u8 * src, int size, u8 * dest){
+	u16 table[1<<HASH_BITS];
+	const u8 * ip = src;
+	const u8 * anchor = src;
+	const u8 * const match_limit = src + size - MATCH_LIMIT;
+	const u8 * const match_end = src + size - LAST_LITERALS;
+	const u8 * match;
+	u8 * op = dest;
+	u8 * token;
+	u32 sequence;
+	u32 hash;
+	u32 literal_length;
+	u32 match_length;
+
+	memset(table, 0, sizeof(table));
+
+	//greedy LZ4 -- find a 4 byte match using a hash of the previous positions
+	while( ip < match_limit ){
+		memcpy(&sequence, ip, sizeof(u32));
+		hash = (sequence * 2654435761U) >> (32 - HASH_BITS);
+		match = src + table[hash];
+		table[hash] = ip - src;
+
+		if( (match >= ip) || (ip - match > MAX_OFFSET) || memcmp(match, ip, MIN_MATCH) ){
+			ip++;
+			continue;
+		}
+
+		match_length = MIN_MATCH;
+		while( (ip + match_length < match_end) && (match[match_length] == ip[match_length]) ){
+			match_length++;
+		}
+
+		literal_length = ip - anchor;
+		token = op++;
+		*token = (literal_length >= 15 ? 15 : literal_length) << 4;
+		if( literal_length >= 15 ){ op = write_length(op, literal_length - 15); }
+		memcpy(op, anchor, literal_length);
+		op += literal_length;
+
+		*op++ = (ip - match) & 0xff;
+		*op++ = (ip - match) >> 8;
+
+		match_length -= MIN_MATCH;
+		*token |= match_length >= 15 ? 15 : match_length;
+		if( match_length >= 15 ){ op = write_length(op, match_length - 15); }
+
+		ip += match_length + MIN_MATCH;
+		anchor = ip;
+
+		if( op - dest >= size ){
+			//not worth it -- the caller stores the chunk as is
+			return -1;
+		}
+	}
+
+	literal_length = src + size - anchor;
+	token = op++;
+	*token = (literal_length >= 15 ? 15 : literal_length) << 4;
+	if( literal_length >= 15 ){ op = write_length(op, literal_length - 15); }
+	if( (op - dest) + literal_length >= (u32)size ){
+		return -1;
+	}
+	memcpy(op, anchor, literal_length);
+	op += literal_length;
+
+	return op - dest;
+}
+
+u8 * write_length(u8 * op, u32 length){
+	while( length >= 255 ){
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = length;
+	return op;
+}
+
+int assetfs_chunk_decompress(const u8 * src, int src_size, u8 * dest, int dest_size){
+	const u8 * ip = src;
+	const u8 * const ip_end = src + src_size;
+	u8 * op = dest;
+	u8 * const op_end = dest + dest_size;
+	const u8 * match;
+	u32 length;
+	u32 match_offset;
+	u8 token;
+	u8 value;
+
+	//LZ4 block format: token, literals, 16-bit offset, match length
+	while( ip < ip_end ){
+		token = *ip++;
+
+		length = token >> 4;
+		if( length == 15 ){
+			do {
+				if( ip >= ip_end ){ return -1; }
+				value = *ip++;
+				length += value;
+			} while( value == 255 );
+		}
+
+		if( (length > (u32)(ip_end - ip)) || (length > (u32)(op_end - op)) ){
+			return -1;
+		}
+		memcpy(op, ip, length);
+		op += length;
+		ip += length;
+
+		if( ip == ip_end ){
+			//the last sequence is only literals
+			break;
+		}
+
+		if( ip_end - ip < 2 ){ return -1; }
+		match_offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if( (match_offset == 0) || (match_offset > (u32)(op - dest)) ){
+			return -1;
+		}
+
+		length = token & 0x0f;
+		if( length == 15 ){
+			do {
+				if( ip >= ip_end ){ return -1; }
+				value = *ip++;
+				length += value;
+			} while( value == 255 );
+		}
+		length += MIN_MATCH;
+
+		if( length > (u32)(op_end - op) ){ return -1; }
+
+		//the match may overlap the output so copy a byte at a time
+		match = op - match_offset;
+		while( length-- ){
+			*op++ = *match++;
+		}
+	}
+
+	return op - dest;
+}
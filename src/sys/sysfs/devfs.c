@@ -212,6 +212,22 @@ int devfs_write(const void * cfg, void * handle, int flags, int loc, const void
 	return devfs_data_transfer(cfg, handle, flags, loc, (void*)buf, nbyte, 0);
 }
 
+int devfs_readv(const void * config, void * handle, int flags, int loc, const struct iovec * iov, int iovcnt){
+	const devfs_device_t * device = handle;
+	if( device->driver.readv == 0 ){
+		return SYSFS_SET_RETURN(ENOTSUP);
+	}
+	return devfs_data_transfer_vector(config, device, flags, loc, iov, iovcnt, 1);
+}
+
+int devfs_writev(const void * config, void * handle, int flags, int loc, const struct iovec * iov, int iovcnt){
+	const devfs_device_t * device = handle;
+	if( device->driver.writev == 0 ){
+		return SYSFS_SET_RETURN(ENOTSUP);
+	}
+	return devfs_data_transfer_vector(config, device, flags, loc, iov, iovcnt, 0);
+}
+
 int devfs_aio(const void * config, void * handle, struct aiocb * aio){
 	return devfs_aio_data_transfer(handle, aio);
 }
@@ -19,64 +19,353 @@
 
 #include "devfs_local.h"
 
+//number of devices that can have AIO requests queued at the same time
+#if !defined DEVFS_AIO_QUEUE_COUNT
+#define DEVFS_AIO_QUEUE_COUNT 8
+#endif
+
+//number of AIO requests (in progress or waiting) the queues can hold
+#if !defined DEVFS_AIO_ENTRY_COUNT
+#define DEVFS_AIO_ENTRY_COUNT 16
+#endif
+
+/*
+ * struct aiocb belongs to the application ABI so the links between
+ * queued requests are kept here rather than in the aiocb.
+ *
+ */
+typedef struct aio_entry {
+	struct aiocb * aiocbp;
+	struct aio_entry * next;
+	int pid;
+} aio_entry_t;
+
+typedef struct {
+	aio_entry_t * head;
+	aio_entry_t * tail;
+} aio_list_t;
+
+typedef struct {
+	const devfs_device_t * device;
+	aio_list_t read;
+	aio_list_t write;
+} aio_queue_t;
+
 typedef struct {
 	const devfs_device_t * device;
 	struct aiocb * aiocbp;
-	int read;
 	int result;
 } root_aio_transfer_t;
 
-//static int data_transfer_callback(struct aiocb * aiocbp, const void * ignore);
-static void svcall_device_data_transfer(void * args);
+static aio_queue_t m_aio_queue[DEVFS_AIO_QUEUE_COUNT] MCU_SYS_MEM;
+static aio_entry_t m_aio_entry[DEVFS_AIO_ENTRY_COUNT] MCU_SYS_MEM;
 
-void svcall_device_data_transfer(void * args){
-	CORTEXM_SVCALL_ENTER();
-	root_aio_transfer_t * p = (root_aio_transfer_t*)args;
+static void svcall_device_data_transfer(void * args) MCU_ROOT_EXEC_CODE;
+static void svcall_cancel(void * args) MCU_ROOT_EXEC_CODE;
+static void svcall_cancel_pid(void * args) MCU_ROOT_EXEC_CODE;
+static int queue_callback(void * context, const mcu_event_t * event);
+static aio_queue_t * get_queue(const devfs_device_t * device);
+static aio_list_t * get_list(aio_queue_t * queue, const struct aiocb * aiocbp);
+static void release_queue(aio_queue_t * queue);
+static aio_entry_t * get_entry(struct aiocb * aiocbp);
+static struct aiocb * pop_entry(aio_list_t * list);
+static int remove_entries(aio_list_t * list, const struct aiocb * aiocbp, int pid, int result);
+static int start_transfer(const devfs_device_t * device, struct aiocb * aiocbp);
+static void complete_transfer(struct aiocb * aiocbp, int result);
+static void run_queue(aio_queue_t * queue, aio_list_t * list);
+
+aio_queue_t * get_queue(const devfs_device_t * device){
+	aio_queue_t * available = 0;
+	int i;
+	for(i=0; i < DEVFS_AIO_QUEUE_COUNT; i++){
+		if( m_aio_queue[i].device == device ){
+			return m_aio_queue + i;
+		}
+		if( (available == 0) && (m_aio_queue[i].device == 0) ){
+			available = m_aio_queue + i;
+		}
+	}
+
+	if( available ){
+		available->device = device;
+	}
+	return available;
+}
+
+aio_list_t * get_list(aio_queue_t * queue, const struct aiocb * aiocbp){
+	if( aiocbp->aio_lio_opcode == LIO_READ ){
+		return &queue->read;
+	}
+	return &queue->write;
+}
+
+void release_queue(aio_queue_t * queue){
+	//the entry can be used by another device once both directions are idle
+	if( (queue->read.head == 0) && (queue->write.head == 0) ){
+		queue->device = 0;
+	}
+}
+
+aio_entry_t * get_entry(struct aiocb * aiocbp){
+	int i;
+	for(i=0; i < DEVFS_AIO_ENTRY_COUNT; i++){
+		if( m_aio_entry[i].aiocbp == 0 ){
+			m_aio_entry[i].aiocbp = aiocbp;
+			m_aio_entry[i].next = 0;
+			m_aio_entry[i].pid = task_get_pid(task_get_current());
+			return m_aio_entry + i;
+		}
+	}
+	return 0;
+}
+
+struct aiocb * pop_entry(aio_list_t * list){
+	aio_entry_t * entry = list->head;
+	struct aiocb * aiocbp = entry->aiocbp;
+	list->head = entry->next;
+	entry->aiocbp = 0;
+	return aiocbp;
+}
+
+int remove_entries(aio_list_t * list, const struct aiocb * aiocbp, int pid, int result){
+	aio_entry_t * prev;
+	aio_entry_t * entry;
+	struct aiocb * removed;
+	int count = 0;
+
+	if( list->head == 0 ){
+		return 0;
+	}
+
+	//the head is in progress on the device -- only the requests behind it are removed
+	prev = list->head;
+	while( (entry = prev->next) != 0 ){
+		if( (entry->aiocbp == aiocbp) || ((aiocbp == 0) && (entry->pid == pid)) ){
+			removed = entry->aiocbp;
+			prev->next = entry->next;
+			if( list->tail == entry ){
+				list->tail = prev;
+			}
+			entry->aiocbp = 0;
+			count++;
+			if( result != 0 ){
+				complete_transfer(removed, result);
+			}
+		} else {
+			prev = entry;
+		}
+	}
+	return count;
+}
+
+int start_transfer(const devfs_device_t * device, struct aiocb * aiocbp){
+	if( aiocbp->aio_lio_opcode == LIO_READ ){
+		return device->driver.read(&device->handle, &aiocbp->async);
+	}
+	return device->driver.write(&device->handle, &aiocbp->async);
+}
+
+void complete_transfer(struct aiocb * aiocbp, int result){
+	aiocbp->async.nbyte = result;
+	sysfs_aio_data_transfer_callback(aiocbp, 0);
+}
+
+void run_queue(aio_queue_t * queue, aio_list_t * list){
+	struct aiocb * aiocbp;
+	int result;
+
+	//requests the driver finishes (or rejects) right away are completed here
+	while( list->head != 0 ){
+		aiocbp = list->head->aiocbp;
+		result = 0;
+		if( aiocbp->async.nbyte != 0 ){
+			result = start_transfer(queue->device, aiocbp);
+			if( result == 0 ){
+				return; //in progress -- queue_callback() starts the next one
+			}
+		}
+		pop_entry(list);
+		complete_transfer(aiocbp, result);
+	}
+}
 
-    cortexm_disable_interrupts(); //no switching until the transfer is started -- does Issue #130 change this
-	//set the device callback for the read/write op
-	if ( p->read == 1 ){
-		//Read operation
-        p->result = p->device->driver.read(&p->device->handle, (devfs_async_t*)&p->aiocbp->async);
-	} else {
-        p->result = p->device->driver.write(&p->device->handle, (devfs_async_t*)&p->aiocbp->async);
+int queue_callback(void * context, const mcu_event_t * event){
+	struct aiocb * aiocbp = context;
+	int i;
+
+	//called by the driver (usually in an ISR) when the request at the head of a list completes
+	for(i=0; i < DEVFS_AIO_QUEUE_COUNT; i++){
+		aio_queue_t * queue = m_aio_queue + i;
+		aio_list_t * list = get_list(queue, aiocbp);
+		if( (queue->device != 0) && (list->head != 0) && (list->head->aiocbp == aiocbp) ){
+			pop_entry(list);
+			sysfs_aio_data_transfer_callback(aiocbp, event);
+			run_queue(queue, list);
+			release_queue(queue);
+			return 0;
+		}
 	}
 
-	sos_sched_table[task_get_current()].block_object = NULL;
+	return sysfs_aio_data_transfer_callback(aiocbp, event);
+}
 
-    cortexm_enable_interrupts();
+int devfs_aio_root_data_transfer(const devfs_device_t * device, struct aiocb * aiocbp){
+	aio_queue_t * queue;
+	aio_list_t * list;
+	aio_entry_t * entry;
+	int result;
+
+	aiocbp->async.loc = aiocbp->aio_offset;
+	aiocbp->async.flags = 0; //this is never a blocking call
+	aiocbp->async.nbyte = aiocbp->aio_nbytes;
+	aiocbp->async.buf = (void*)aiocbp->aio_buf;
+	aiocbp->async.tid = task_get_current();
+	aiocbp->async.handler.callback = queue_callback;
+	aiocbp->async.handler.context = aiocbp;
+	aiocbp->aio_nbytes = -1; //means status is in progress
+
+	cortexm_disable_interrupts(); //no switching until the transfer is started -- does Issue #130 change this
+	entry = 0;
+	queue = get_queue(device);
+	if( queue != 0 ){
+		entry = get_entry(aiocbp);
+		if( entry == 0 ){
+			release_queue(queue);
+		}
+	}
+
+	if( entry == 0 ){
+		//every queue (or entry) is in use -- start the transfer directly (the driver returns EBUSY if it is busy)
+		aiocbp->async.handler.callback = sysfs_aio_data_transfer_callback;
+		result = start_transfer(device, aiocbp);
+		if( result > 0 ){
+			//The transfer happened synchronously -- call the callback manually
+			complete_transfer(aiocbp, result);
+			result = 0;
+		}
+		cortexm_enable_interrupts();
+		return result;
+	}
+
+	list = get_list(queue, aiocbp);
+	if( list->head ){
+		//the device is busy with an earlier request -- this one starts when that one completes
+		list->tail->next = entry;
+		list->tail = entry;
+		cortexm_enable_interrupts();
+		return 0;
+	}
 
-	if ( p->result == 0 ){
-		if( p->aiocbp->async.nbyte > 0 ){
+	list->head = entry;
+	list->tail = entry;
+	result = 0;
+	if( aiocbp->async.nbyte != 0 ){
+		result = start_transfer(device, aiocbp);
+		if( result == 0 ){
 			//AIO is in progress
+			cortexm_enable_interrupts();
+			return 0;
+		}
+	}
+
+	pop_entry(list);
+	release_queue(queue);
+	if( result >= 0 ){
+		//The transfer happened synchronously (or was empty) -- call the callback manually
+		complete_transfer(aiocbp, result);
+		result = 0;
+	}
+	//else AIO was not started -- errno is set by the driver
+
+	cortexm_enable_interrupts();
+	return result;
+}
+
+int devfs_aio_root_cancel(const devfs_device_t * device, struct aiocb * aiocbp){
+	int pid = task_get_pid(task_get_current());
+	int canceled = 0;
+	int in_progress = 0;
+	int i;
+
+	cortexm_disable_interrupts();
+	for(i=0; i < DEVFS_AIO_QUEUE_COUNT; i++){
+		aio_queue_t * queue = m_aio_queue + i;
+		if( (queue->device != 0) && (queue->device == device) ){
+			canceled += remove_entries(&queue->read, aiocbp, pid, SYSFS_SET_RETURN(ECANCELED));
+			canceled += remove_entries(&queue->write, aiocbp, pid, SYSFS_SET_RETURN(ECANCELED));
+
+			//a request that has been started can only be stopped by the driver
+			if( (queue->read.head != 0) &&
+					((queue->read.head->aiocbp == aiocbp) || ((aiocbp == 0) && (queue->read.head->pid == pid))) ){
+				in_progress++;
+			}
+			if( (queue->write.head != 0) &&
+					((queue->write.head->aiocbp == aiocbp) || ((aiocbp == 0) && (queue->write.head->pid == pid))) ){
+				in_progress++;
+			}
+		}
+	}
+	cortexm_enable_interrupts();
+
+	if( in_progress ){
+		return AIO_NOTCANCELED;
+	}
+
+	if( canceled ){
+		return AIO_CANCELED;
+	}
+
+	return AIO_ALLDONE;
+}
+
+void devfs_aio_root_cancel_pid(int pid){
+	int i;
+
+	//the process is exiting -- nothing waits on its requests so they are dropped without completing
+	cortexm_disable_interrupts();
+	for(i=0; i < DEVFS_AIO_QUEUE_COUNT; i++){
+		if( m_aio_queue[i].device != 0 ){
+			remove_entries(&m_aio_queue[i].read, 0, pid, 0);
+			remove_entries(&m_aio_queue[i].write, 0, pid, 0);
 		}
-	} else if ( p->result < 0 ){
-		//AIO was not started -- errno is set by the driver
-        //p->ret = -1;
-	} else if ( p->result > 0 ){
-		//The transfer happened synchronously -- call the callback manually
-		sysfs_aio_data_transfer_callback(p->aiocbp, 0);
-		p->result = 0;
 	}
+	cortexm_enable_interrupts();
+}
+
+void svcall_device_data_transfer(void * args){
+	CORTEXM_SVCALL_ENTER();
+	root_aio_transfer_t * p = (root_aio_transfer_t*)args;
+	p->result = devfs_aio_root_data_transfer(p->device, p->aiocbp);
+	sos_sched_block_object[task_get_current()] = NULL;
 }
 
 int devfs_aio_data_transfer(const devfs_device_t * device, struct aiocb * aiocbp){
 	root_aio_transfer_t args;
 	args.device = device;
 	args.aiocbp = aiocbp;
-	if ( aiocbp->aio_lio_opcode == LIO_READ ){
-		args.read = 1;
-	} else {
-		args.read = 0;
-	}
-	args.aiocbp->async.loc = aiocbp->aio_offset;
-	args.aiocbp->async.flags = 0; //this is never a blocking call
-	args.aiocbp->async.nbyte = aiocbp->aio_nbytes;
-	args.aiocbp->async.buf = (void*)aiocbp->aio_buf;
-	args.aiocbp->async.tid = task_get_current();
-	args.aiocbp->async.handler.callback = sysfs_aio_data_transfer_callback;
-	args.aiocbp->async.handler.context = aiocbp;
-	args.aiocbp->aio_nbytes = -1; //means status is in progress
 	cortexm_svcall(svcall_device_data_transfer, &args);
 	return args.result;
 }
+
+void svcall_cancel(void * args){
+	CORTEXM_SVCALL_ENTER();
+	root_aio_transfer_t * p = (root_aio_transfer_t*)args;
+	p->result = devfs_aio_root_cancel(p->device, p->aiocbp);
+}
+
+int devfs_aio_cancel(const devfs_device_t * device, struct aiocb * aiocbp){
+	root_aio_transfer_t args;
+	args.device = device;
+	args.aiocbp = aiocbp;
+	cortexm_svcall(svcall_cancel, &args);
+	return args.result;
+}
+
+void svcall_cancel_pid(void * args){
+	CORTEXM_SVCALL_ENTER();
+	devfs_aio_root_cancel_pid(*(int*)args);
+}
+
+void devfs_aio_cancel_pid(int pid){
+	cortexm_svcall(svcall_cancel_pid, &pid);
+}
@@ -21,6 +21,7 @@
 #include <reent.h>
 #include <stdarg.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include "mcu/debug.h"
 
@@ -38,6 +39,8 @@
 typedef struct {
 	const void * device;
 	devfs_async_t async;
+	const struct iovec * iov;
+	int iovcnt;
 	volatile int transfer_type;
 	int result;
 } svcall_device_data_transfer_t;
@@ -46,8 +49,23 @@ typedef struct {
 //static void svcall_check_op_complete(void * args);
 static void root_check_op_complete(void * args);
 static void svcall_device_data_transfer(void * args) MCU_ROOT_EXEC_CODE;
+static int try_data_transfer(svcall_device_data_transfer_t * p) MCU_ROOT_CODE;
+static int is_permitted(svcall_device_data_transfer_t * p) MCU_ROOT_CODE;
 static int root_data_transfer_callback(void * context, const mcu_event_t * data) MCU_ROOT_CODE;
 static void clear_device_action(const void * config, const devfs_device_t * device, int loc, int is_read);
+static int copy_vector(struct iovec * dest, const struct iovec * iov, int iovcnt) MCU_ROOT_CODE;
+static int vector_data_transfer(svcall_device_data_transfer_t * p, const struct iovec * iov) MCU_ROOT_CODE;
+static int data_transfer(
+		const void * config,
+		const devfs_device_t * device,
+		int flags,
+		int loc,
+		void * buf,
+		int nbyte,
+		const struct iovec * iov,
+		int iovcnt,
+		int is_read
+		);
 
 int root_data_transfer_callback(void * context, const mcu_event_t * event){
 	//activate all tasks that are blocked on this signal
@@ -80,7 +98,7 @@ int root_data_transfer_callback(void * context, const mcu_event_t * event){
 #if 0
 	for(i = 1; i < task_get_total(); i++){
 		if ( task_enabled(i) && scheduler_inuse_asserted(i) ){
-			if ( sos_sched_table[i].block_object == (args->device + args->transfer_type) ){
+			if ( sos_sched_block_object[i] == (args->device + args->transfer_type) ){
 				scheduler_root_assert_active(i, SCHEDULER_UNBLOCK_TRANSFER);
 				if( !task_stopped_asserted(i) && (task_get_priority(i) > new_priority) ){
 					new_priority = task_get_priority(i);
@@ -101,30 +119,38 @@ void svcall_device_data_transfer(void * args){
 	CORTEXM_SVCALL_ENTER();
 	svcall_device_data_transfer_t * p = (svcall_device_data_transfer_t*)args;
 	const devfs_device_t * dev = p->device;
+	struct iovec iov[IOV_MAX];
 
-	//check permissions on this device
-	if( p->transfer_type == ARGS_TRANSFER_READ ){
-		if( sysfs_is_r_ok(dev->mode, dev->uid, SYSFS_GROUP) == 0 ){
-			p->result = SYSFS_SET_RETURN(EPERM);
-			return;
-		}
-	} else {
-		if( sysfs_is_w_ok(dev->mode, dev->uid, SYSFS_GROUP) == 0 ){
+	//check async.buf and async.nbyte to ensure if belongs to the process
+	//EPERM if it fails Issue #127
+	if( p->iov ){
+		//the list is copied first so it can't change after it is validated
+		if( copy_vector(iov, p->iov, p->iovcnt) < 0 ){
 			p->result = SYSFS_SET_RETURN(EPERM);
 			return;
 		}
+	} else if( task_validate_memory(p->async.buf, p->async.nbyte) < 0 ){
+		p->result = SYSFS_SET_RETURN(EPERM);
+		return;
 	}
 
-
-	//check async.buf and async.nbyte to ensure if belongs to the process
-	//EPERM if it fails Issue #127
-	if( task_validate_memory(p->async.buf, p->async.nbyte) < 0 ){
+	//check permissions on this device before any of the driver entries (vector, try or regular) is used
+	if( is_permitted(p) == 0 ){
 		p->result = SYSFS_SET_RETURN(EPERM);
 		return;
 	}
 
+	if( p->iov && vector_data_transfer(p, iov) ){
+		return;
+	}
+
+	if( try_data_transfer(p) ){
+		//completed synchronously -- the scheduler isn't involved
+		return;
+	}
+
 	//assume the operation is going to block
-	sos_sched_table[ task_get_current() ].block_object = (u8*)p->device + p->transfer_type;
+	sos_sched_block_object[ task_get_current() ] = (u8*)p->device + p->transfer_type;
 	if ( p->transfer_type == ARGS_TRANSFER_READ ){
 		p->result = dev->driver.read(&(dev->handle), &(p->async));
 	} else {
@@ -134,6 +160,38 @@ void svcall_device_data_transfer(void * args){
 	root_check_op_complete(args);
 }
 
+int is_permitted(svcall_device_data_transfer_t * p){
+	const devfs_device_t * dev = p->device;
+	if( p->transfer_type == ARGS_TRANSFER_READ ){
+		return sysfs_is_r_ok(dev->mode, dev->uid, SYSFS_GROUP);
+	}
+	return sysfs_is_w_ok(dev->mode, dev->uid, SYSFS_GROUP);
+}
+
+int try_data_transfer(svcall_device_data_transfer_t * p){
+	const devfs_device_t * dev = p->device;
+	devfs_read_t try_transfer;
+
+	if( p->transfer_type == ARGS_TRANSFER_READ ){
+		try_transfer = dev->driver.try_read;
+	} else {
+		try_transfer = dev->driver.try_write;
+	}
+
+	if( try_transfer == 0 ){
+		return 0;
+	}
+
+	p->result = try_transfer(&(dev->handle), &(p->async));
+	if( p->result == 0 ){
+		//the driver would block -- use the regular read or write
+		return 0;
+	}
+
+	p->transfer_type = ARGS_TRANSFER_DONE;
+	return 1;
+}
+
 //void svcall_check_op_complete(void * args){
 //	CORTEXM_SVCALL_ENTER();
 //	root_check_op_complete(args);
@@ -151,7 +209,7 @@ void root_check_op_complete(void * args){
 			cortexm_disable_interrupts();
 			//Block waiting for the operation to complete or new data to be ready
 			//if the interrupt has already fired the block_object will be zero already
-			if( sos_sched_table[ task_get_current() ].block_object != 0 ){;
+			if( sos_sched_block_object[ task_get_current() ] != 0 ){;
 				//switch tasks until a signal becomes available
 				scheduler_root_update_on_sleep();
 			}
@@ -159,7 +217,7 @@ void root_check_op_complete(void * args){
 		} else {
 			//p->result is not zero OR nbyte is less than zero-> means:
 			//operation happened sychronously -- no need to block
-			sos_sched_table[ task_get_current() ].block_object = 0;
+			sos_sched_block_object[ task_get_current() ] = 0;
 			p->transfer_type = ARGS_TRANSFER_DONE;
 		}
 	}
@@ -179,6 +237,55 @@ void clear_device_action(const void * config, const devfs_device_t * device, int
 }
 
 
+int copy_vector(struct iovec * dest, const struct iovec * iov, int iovcnt){
+	int i;
+	if( (iovcnt <= 0) || (iovcnt > IOV_MAX) ){
+		return -1;
+	}
+
+	if( task_validate_memory((void*)iov, iovcnt * sizeof(struct iovec)) < 0 ){
+		return -1;
+	}
+
+	memcpy(dest, iov, iovcnt * sizeof(struct iovec));
+	for(i=0; i < iovcnt; i++){
+		if( task_validate_memory(dest[i].iov_base, dest[i].iov_len) < 0 ){
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int vector_data_transfer(svcall_device_data_transfer_t * p, const struct iovec * iov){
+	const devfs_device_t * dev = p->device;
+	int i;
+
+	//the driver only uses the list during the call -- it completes synchronously or returns 0
+	if( p->transfer_type == ARGS_TRANSFER_READ ){
+		p->result = dev->driver.readv(&(dev->handle), &(p->async), iov, p->iovcnt);
+	} else {
+		p->result = dev->driver.writev(&(dev->handle), &(p->async), iov, p->iovcnt);
+	}
+
+	if( p->result != 0 ){
+		p->transfer_type = ARGS_TRANSFER_DONE;
+		return 1;
+	}
+
+	//nothing could be transferred without blocking -- wait on the first buffer (readv()/writev() can be partial)
+	for(i=0; i < p->iovcnt; i++){
+		if( iov[i].iov_len ){
+			p->async.buf = iov[i].iov_base;
+			p->async.nbyte = iov[i].iov_len;
+			return 0;
+		}
+	}
+
+	p->result = SYSFS_SET_RETURN(EINVAL);
+	p->transfer_type = ARGS_TRANSFER_DONE;
+	return 1;
+}
+
 int devfs_data_transfer(
 		const void * config,
 		const devfs_device_t * device,
@@ -188,6 +295,44 @@ int devfs_data_transfer(
 		int nbyte,
 		int is_read
 		){
+	return data_transfer(config, device, flags, loc, buf, nbyte, 0, 0, is_read);
+}
+
+int devfs_data_transfer_vector(
+		const void * config,
+		const devfs_device_t * device,
+		int flags,
+		int loc,
+		const struct iovec * iov,
+		int iovcnt,
+		int is_read
+		){
+	int i;
+	int nbyte = 0;
+
+	if( (iovcnt <= 0) || (iovcnt > IOV_MAX) ){
+		return SYSFS_SET_RETURN(EINVAL);
+	}
+
+	for(i=0; i < iovcnt; i++){
+		nbyte += iov[i].iov_len;
+	}
+
+	//the whole list is passed to the driver in one kernel entry
+	return data_transfer(config, device, flags, loc, 0, nbyte, iov, iovcnt, is_read);
+}
+
+int data_transfer(
+		const void * config,
+		const devfs_device_t * device,
+		int flags,
+		int loc,
+		void * buf,
+		int nbyte,
+		const struct iovec * iov,
+		int iovcnt,
+		int is_read
+		){
 	volatile svcall_device_data_transfer_t args;
 
 	if ( nbyte == 0 ){
@@ -199,6 +344,8 @@ int devfs_data_transfer(
 	args.async.loc = loc;
 	args.async.flags = flags;
 	args.async.buf = buf;
+	args.iov = iov;
+	args.iovcnt = iovcnt;
 	args.async.handler.callback = root_data_transfer_callback;
 	args.async.handler.context = (void*)&args;
 	args.async.tid = task_get_current();
@@ -218,6 +365,11 @@ int devfs_data_transfer(
 		//This transfers the data
 		cortexm_svcall(svcall_device_data_transfer, (void*)&args);
 
+		if( args.result > 0 ){
+			//completed synchronously
+			return args.result;
+		}
+
 		//We arrive here if
 		//the data is done transferring
 		//OR there is no data to transfer and O_NONBLOCK is set
@@ -283,66 +435,3 @@ int devfs_data_transfer(
 
 	return args.result;
 }
-
-//used to execute any handler
-int devfs_execute_event_handler(mcu_event_handler_t * handler, u32 o_events, void * data){
-	int ret = 0;
-	mcu_event_t event;
-	if( handler->callback ){
-		event.o_events = o_events;
-		event.data = data;
-		ret = handler->callback(handler->context, &event);
-	}
-	return ret;
-}
-
-void devfs_execute_cancel_handler(
-		devfs_transfer_handler_t * transfer_handler,
-		void * data,
-		int nbyte,
-		u32 o_flags
-		){
-	devfs_execute_read_handler(transfer_handler, data, nbyte, o_flags | MCU_EVENT_FLAG_CANCELED);
-	devfs_execute_write_handler(transfer_handler, data, nbyte, o_flags | MCU_EVENT_FLAG_CANCELED);
-}
-
-//this should be called when a read completes
-int devfs_execute_read_handler(
-		devfs_transfer_handler_t * transfer_handler,
-		void * data, int nbyte,
-		u32 o_flags
-		){
-	if( transfer_handler->read ){
-		devfs_async_t * async = transfer_handler->read;
-		transfer_handler->read = 0;
-		if( nbyte ){ async->nbyte = nbyte; }
-		return devfs_execute_event_handler(
-					&async->handler,
-					o_flags,
-					data
-					);
-	}
-	return 0;
-}
-
-//this should be called when a write completes
-int devfs_execute_write_handler(
-		devfs_transfer_handler_t * transfer_handler,
-		void * data,
-		int nbyte,
-		u32 o_flags
-		){
-	if( transfer_handler->write ){
-		devfs_async_t * async = transfer_handler->write;
-		transfer_handler->write = 0;
-		if( nbyte ){ async->nbyte = nbyte; }
-		return devfs_execute_event_handler(
-					&async->handler,
-					o_flags,
-					data
-					);
-	}
-	return 0;
-}
-
-
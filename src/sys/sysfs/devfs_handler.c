@@ -0,0 +1,120 @@
+/* Copyright 2011-2018 Tyler Gilbert; 
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "sos/fs/devfs.h"
+
+//used to execute any handler
+int devfs_execute_event_handler(mcu_event_handler_t * handler, u32 o_events, void * data){
+	int ret = 0;
+	mcu_event_t event;
+	if( handler->callback ){
+		event.o_events = o_events;
+		event.data = data;
+		ret = handler->callback(handler->context, &event);
+	}
+	return ret;
+}
+
+void devfs_execute_cancel_handler(
+		devfs_transfer_handler_t * transfer_handler,
+		void * data,
+		int nbyte,
+		u32 o_flags
+		){
+	devfs_execute_read_handler(transfer_handler, data, nbyte, o_flags | MCU_EVENT_FLAG_CANCELED);
+	devfs_execute_write_handler(transfer_handler, data, nbyte, o_flags | MCU_EVENT_FLAG_CANCELED);
+}
+
+int devfs_set_poll_handler(
+		devfs_poll_handler_t * poll_handler,
+		const mcu_action_t * action,
+		u32 o_ready
+		){
+	u32 o_events = action->o_events & (MCU_EVENT_FLAG_DATA_READY | MCU_EVENT_FLAG_WRITE_COMPLETE);
+	poll_handler->handler.callback = 0;
+	if( (action->handler.callback == 0) || (o_events & o_ready) ){
+		//the caller doesn't need to wait if the events are already ready
+		return MCU_EVENT_FLAG_POLL | (o_events & o_ready);
+	}
+
+	poll_handler->o_events = o_events;
+	poll_handler->handler.context = action->handler.context;
+	//assign the callback last so an interrupt never sees a partial handler
+	poll_handler->handler.callback = action->handler.callback;
+	return MCU_EVENT_FLAG_POLL;
+}
+
+//this should be called when a device becomes ready to read or write
+int devfs_execute_poll_handler(
+		devfs_poll_handler_t * poll_handler,
+		u32 o_ready
+		){
+	u32 o_events = poll_handler->o_events & o_ready;
+	if( poll_handler->handler.callback && o_events ){
+		mcu_event_handler_t handler = poll_handler->handler;
+		poll_handler->handler.callback = 0;
+		return devfs_execute_event_handler(
+					&handler,
+					MCU_EVENT_FLAG_POLL | o_events,
+					0
+					);
+	}
+	return 0;
+}
+
+//this should be called when a read completes
+int devfs_execute_read_handler(
+		devfs_transfer_handler_t * transfer_handler,
+		void * data, int nbyte,
+		u32 o_flags
+		){
+	if( transfer_handler->read ){
+		devfs_async_t * async = transfer_handler->read;
+		transfer_handler->read = 0;
+		if( nbyte ){ async->nbyte = nbyte; }
+		return devfs_execute_event_handler(
+					&async->handler,
+					o_flags,
+					data
+					);
+	}
+	return 0;
+}
+
+//this should be called when a write completes
+int devfs_execute_write_handler(
+		devfs_transfer_handler_t * transfer_handler,
+		void * data,
+		int nbyte,
+		u32 o_flags
+		){
+	if( transfer_handler->write ){
+		devfs_async_t * async = transfer_handler->write;
+		transfer_handler->write = 0;
+		if( nbyte ){ async->nbyte = nbyte; }
+		return devfs_execute_event_handler(
+					&async->handler,
+					o_flags,
+					data
+					);
+	}
+	return 0;
+}
+
+
@@ -17,6 +17,12 @@
 
 
 int devfs_data_transfer(const void * config, const devfs_device_t * device, int flags, int loc, void * buf, int nbyte, int is_read);
+int devfs_data_transfer_vector(const void * config, const devfs_device_t * device, int flags, int loc, const struct iovec * iov, int iovcnt, int is_read);
 int devfs_aio_data_transfer(const devfs_device_t * device, struct aiocb * aiocbp);
+int devfs_aio_root_data_transfer(const devfs_device_t * device, struct aiocb * aiocbp) MCU_ROOT_CODE;
+int devfs_aio_cancel(const devfs_device_t * device, struct aiocb * aiocbp);
+int devfs_aio_root_cancel(const devfs_device_t * device, struct aiocb * aiocbp) MCU_ROOT_CODE;
+void devfs_aio_cancel_pid(int pid);
+void devfs_aio_root_cancel_pid(int pid) MCU_ROOT_CODE;
 
 #endif /* SYSFS_DEVFS_LOCAL_H_ */
@@ -18,6 +18,7 @@
  */
 
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include "dirent.h"
@@ -35,6 +36,9 @@ typedef struct {
 	int ino;
 	u32 data;
 	u32 size;
+	const void * config;
+	u32 is_compressed;
+	assetfs_chunk_reader_t reader;
 	u32 checksum;
 } drive_assetfs_handle_t;
 
@@ -45,9 +49,12 @@ typedef struct {
 #define ASSETFS_DRIVE_MUTEX(cfg) &(((drive_assetfs_config_t*)cfg)->drive.state->mutex)
 
 static int read_drive(const void * cfg, int loc, void * buf, int nbyte);
+static int load_directory(const void * cfg);
 static int get_directory_entry(const void * cfg, int loc, drive_assetfs_dirent_t * entry);
 static int find_file(const void * cfg, const char * path, int * ino, drive_assetfs_dirent_t * entry);
-static void assign_stat(int ino, const drive_assetfs_dirent_t * entry, struct stat * st);
+static void assign_stat(int ino, const drive_assetfs_dirent_t * entry, u32 size, struct stat * st);
+static int get_chunk_header(const void * cfg, const drive_assetfs_dirent_t * entry, assetfs_chunk_header_t * header);
+static int read_chunk_data(const void * context, u32 offset, void * buf, int nbyte);
 
 
 int drive_assetfs_init(const void* cfg){
@@ -65,24 +72,36 @@ int drive_assetfs_init(const void* cfg){
 	}
 
 	int result;
+	if( (ASSETFS_STATE(cfg)->chunk_cache.users == 0) &&
+		 ((result = assetfs_chunk_init_cache(&ASSETFS_STATE(cfg)->chunk_cache)) < 0) ){
+		return result;
+	}
+
 	if( (result = sysfs_shared_open(ASSETFS_DRIVE(cfg))) < 0 ){
 		return result;
 	}
 
 	drive_attr_t attr;
 	attr.o_flags = DRIVE_FLAG_INIT;
-	return sysfs_shared_ioctl(ASSETFS_DRIVE(cfg), I_DRIVE_SETATTR, &attr);
+	if( (result = sysfs_shared_ioctl(ASSETFS_DRIVE(cfg), I_DRIVE_SETATTR, &attr)) < 0 ){
+		return result;
+	}
+
+	return load_directory(cfg);
 }
 
 int drive_assetfs_exit(const void * cfg){
-	if( ASSETFS_STATE(cfg)->drive.file.handle != 0 ){
-		//already initialized
+	if( ASSETFS_STATE(cfg)->drive.file.handle == 0 ){
+		//not initialized
 		return SYSFS_RETURN_SUCCESS;
 	}
 
 	int result = sysfs_shared_close(ASSETFS_DRIVE(cfg));
 
 	ASSETFS_STATE(cfg)->drive.file.handle = NULL;
+	free(ASSETFS_STATE(cfg)->hash_table);
+	ASSETFS_STATE(cfg)->hash_table = 0;
+	ASSETFS_STATE(cfg)->count = 0;
 
 	return result;
 }
@@ -120,6 +139,22 @@ int drive_assetfs_open(const void* cfg, void ** handle, const char * path, int f
 	h->ino = ino;
 	h->data = directory_entry.start;
 	h->size = directory_entry.size;
+	h->config = cfg;
+	h->is_compressed = 0;
+
+	assetfs_chunk_header_t chunk_header;
+	if( get_chunk_header(cfg, &directory_entry, &chunk_header) ){
+		//only the chunks that are read come off the drive
+		int result = assetfs_chunk_open_reader(&h->reader, &ASSETFS_STATE(cfg)->chunk_cache, &chunk_header, h->size, 0);
+		if( result < 0 ){
+			free(h);
+			return result;
+		}
+		h->reader.context = h;
+		h->reader.read = read_chunk_data;
+		h->is_compressed = 1;
+		h->size = chunk_header.size;
+	}
 
 	cortexm_assign_zero_sum32(h, sizeof(drive_assetfs_handle_t) / sizeof(u32));
 
@@ -134,6 +169,9 @@ int drive_assetfs_read(const void * cfg, void * handle, int flags, int loc, void
 		return SYSFS_SET_RETURN(EINVAL);
 	}
 	if( loc < 0 ){ return SYSFS_SET_RETURN(EINVAL); }
+	if( h->is_compressed ){
+		return assetfs_chunk_read(&h->reader, loc, buf, nbyte);
+	}
 	int bytes_ready = h->size - loc;
 	if( bytes_ready > nbyte ){ bytes_ready = nbyte; }
 	if( bytes_ready <= 0 ){ return 0; }
@@ -162,7 +200,11 @@ int drive_assetfs_close(const void* cfg, void ** handle){
 		if( cortexm_verify_zero_sum32(*handle, sizeof(drive_assetfs_handle_t) / sizeof(u32)) == 0 ){
 			return SYSFS_SET_RETURN(EINVAL);
 		}
-		free(*handle);
+		drive_assetfs_handle_t * h = *handle;
+		if( h->is_compressed ){
+			assetfs_chunk_close_reader(&h->reader);
+		}
+		free(h);
 		*handle = 0;
 	}
 	return 0;
@@ -177,7 +219,7 @@ int drive_assetfs_fstat(const void* cfg, void * handle, struct stat * st){
 
 	drive_assetfs_dirent_t directory_entry;
 	get_directory_entry(cfg, h->ino, &directory_entry);
-	assign_stat(h->ino, &directory_entry, st);
+	assign_stat(h->ino, &directory_entry, h->size, st);
 	return 0;
 
 }
@@ -189,13 +231,17 @@ int drive_assetfs_stat(const void* cfg, const char * path, struct stat * st){
 		return SYSFS_SET_RETURN(ENOENT);
 	}
 
-	assign_stat(ino, &directory_entry, st);
+	assetfs_chunk_header_t chunk_header;
+	assign_stat(ino,
+					&directory_entry,
+					get_chunk_header(cfg, &directory_entry, &chunk_header) ? chunk_header.size : directory_entry.size,
+					st);
 	return 0;
 }
 
-void assign_stat(int ino, const drive_assetfs_dirent_t * entry, struct stat * st){
+void assign_stat(int ino, const drive_assetfs_dirent_t * entry, u32 size, struct stat * st){
 	memset(st, 0, sizeof(struct stat));
-	st->st_size = entry->size;
+	st->st_size = size;
 	st->st_ino = ino;
 	st->st_mode = entry->mode | S_IFREG;
 	st->st_uid = entry->uid;
@@ -230,8 +276,36 @@ int drive_assetfs_closedir(const void* cfg, void ** handle){
 }
 
 int find_file(const void * cfg, const char * path, int * ino, drive_assetfs_dirent_t * directory_entry){
+	const u32 * hash_table = ASSETFS_STATE(cfg)->hash_table;
 	int loc = 0;
 
+	if( hash_table ){
+		u32 hash = drive_assetfs_hash(path, NAME_MAX-1);
+		int high = ASSETFS_STATE(cfg)->count;
+		int middle;
+
+		//find the first entry with a matching hash
+		while( loc < high ){
+			middle = (loc + high) / 2;
+			if( hash_table[middle] < hash ){
+				loc = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+
+		//names that collide are adjacent
+		while( (loc < ASSETFS_STATE(cfg)->count) && (hash_table[loc] == hash) ){
+			if( (get_directory_entry(cfg, loc, directory_entry) == 0) &&
+				 (strncmp(path, directory_entry->name, NAME_MAX-1) == 0) ){
+				*ino = loc;
+				return 0;
+			}
+			loc++;
+		}
+		return -1;
+	}
+
 	while( get_directory_entry(cfg, loc, directory_entry) == 0){
 		if( strncmp(path, directory_entry->name, NAME_MAX-1) == 0 ){
 			*ino = loc;
@@ -244,18 +318,72 @@ int find_file(const void * cfg, const char * path, int * ino, drive_assetfs_dire
 }
 
 int get_directory_entry(const void * cfg, int loc, drive_assetfs_dirent_t * entry){
-	u32 count;
-	read_drive(cfg, 0, &count, sizeof(u32));
-	if( count == 0xffffffff ){
-		count = 0;
-	}
 	if( loc < 0 ){ return SYSFS_SET_RETURN(EINVAL);	}
-	if( loc >= count ){ return SYSFS_SET_RETURN(ENOENT); }
-	//count plus number of entries in
-	read_drive(cfg,loc*sizeof(drive_assetfs_dirent_t) + sizeof(u32), entry, sizeof(*entry));
+	if( loc >= ASSETFS_STATE(cfg)->count ){ return SYSFS_SET_RETURN(ENOENT); }
+	if( read_drive(cfg,
+						ASSETFS_STATE(cfg)->entry_offset + loc*sizeof(drive_assetfs_dirent_t),
+						entry,
+						sizeof(*entry)) != sizeof(*entry) ){
+		return SYSFS_SET_RETURN(EIO);
+	}
+	return 0;
+}
+
+int load_directory(const void * cfg){
+	drive_assetfs_state_t * state = ASSETFS_STATE(cfg);
+	drive_assetfs_header_v2_t header;
+	int result;
+
+	free(state->hash_table);
+	state->hash_table = 0;
+	state->count = 0;
+	state->entry_offset = sizeof(u32);
+
+	result = read_drive(cfg, 0, &header, sizeof(header));
+	if( result < (int)sizeof(u32) ){
+		return result < 0 ? result : SYSFS_SET_RETURN(EIO);
+	}
+
+	if( header.signature != DRIVE_ASSETFS_SIGNATURE_V2 ){
+		//version 1 -- the image starts with the count
+		state->count = header.signature == 0xffffffff ? 0 : header.signature;
+		return 0;
+	}
+
+	if( result != sizeof(header) ){ return SYSFS_SET_RETURN(EIO); }
+
+	state->entry_offset = header.entry_offset;
+	if( header.count == 0 ){ return 0; }
+
+	state->hash_table = malloc(header.count * sizeof(u32));
+	if( state->hash_table == 0 ){
+		return SYSFS_SET_RETURN(ENOMEM);
+	}
+
+	result = read_drive(cfg, header.hash_offset, state->hash_table, header.count * sizeof(u32));
+	if( result != (int)(header.count * sizeof(u32)) ){
+		free(state->hash_table);
+		state->hash_table = 0;
+		return result < 0 ? result : SYSFS_SET_RETURN(EIO);
+	}
+
+	state->count = header.count;
 	return 0;
 }
 
+int get_chunk_header(const void * cfg, const drive_assetfs_dirent_t * entry, assetfs_chunk_header_t * header){
+	if( entry->size < sizeof(assetfs_chunk_header_t) ){ return 0; }
+	if( read_drive(cfg, entry->start, header, sizeof(assetfs_chunk_header_t)) != sizeof(assetfs_chunk_header_t) ){
+		return 0;
+	}
+	return assetfs_chunk_is_valid(header, entry->size);
+}
+
+int read_chunk_data(const void * context, u32 offset, void * buf, int nbyte){
+	const drive_assetfs_handle_t * h = context;
+	return read_drive(h->config, h->data + offset, buf, nbyte);
+}
+
 int read_drive(const void * cfg, int loc, void * buf, int nbyte){
 	return sysfs_shared_read(
 				ASSETFS_DRIVE(cfg),
@@ -0,0 +1,304 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "cortexm/cortexm.h"
+#include "cortexm/task.h"
+#include "mcu/debug.h"
+#include "sos/fs/sysfs.h"
+
+//stack used by the threads that execute filesystem AIO requests
+#if !defined SYSFS_AIO_THREAD_STACK_SIZE
+#define SYSFS_AIO_THREAD_STACK_SIZE 2048
+#endif
+
+//number of threads that can execute requests at the same time (each one serves a single process)
+#if !defined SYSFS_AIO_WORKER_COUNT
+#define SYSFS_AIO_WORKER_COUNT 2
+#endif
+
+//number of requests that can be waiting for a worker
+#if !defined SYSFS_AIO_REQUEST_COUNT
+#define SYSFS_AIO_REQUEST_COUNT 8
+#endif
+
+typedef struct aio_request {
+	const void * config;
+	void * handle;
+	struct aiocb * aiocbp;
+	sysfs_aio_execute_t execute;
+	int pid;
+	struct aio_request * next;
+} aio_request_t;
+
+typedef struct {
+	int pid;
+	int is_running;
+} aio_worker_t;
+
+typedef struct {
+	aio_request_t request;
+	int result;
+} root_aio_submit_t;
+
+typedef struct {
+	int worker;
+	aio_request_t request;
+	int result;
+} root_aio_next_t;
+
+/*
+ * Requests wait in one list in the order they were submitted. A
+ * worker is a thread created in the process that submitted the
+ * request (so it can access the handle and the buffer just like a
+ * blocking read() or write() would). It executes that process's
+ * requests one at a time and exits when there are none left.
+ *
+ */
+static aio_request_t m_aio_request[SYSFS_AIO_REQUEST_COUNT] MCU_SYS_MEM;
+static aio_request_t * m_aio_head MCU_SYS_MEM;
+static aio_worker_t m_aio_worker[SYSFS_AIO_WORKER_COUNT] MCU_SYS_MEM;
+
+static void * aio_worker(void * args);
+static int start_worker(int worker);
+static void svcall_submit(void * args) MCU_ROOT_EXEC_CODE;
+static void svcall_next(void * args) MCU_ROOT_EXEC_CODE;
+static void svcall_stop_worker(void * args) MCU_ROOT_EXEC_CODE;
+static void svcall_complete(void * args) MCU_ROOT_EXEC_CODE;
+static void append_request(aio_request_t * request);
+static aio_request_t * remove_request(int pid);
+static void complete(struct aiocb * aiocbp, int result);
+
+void append_request(aio_request_t * request){
+	aio_request_t ** p = &m_aio_head;
+	while( *p != 0 ){
+		p = &(*p)->next;
+	}
+	request->next = 0;
+	*p = request;
+}
+
+aio_request_t * remove_request(int pid){
+	aio_request_t ** p = &m_aio_head;
+	aio_request_t * request;
+	while( (request = *p) != 0 ){
+		if( request->pid == pid ){
+			*p = request->next;
+			return request;
+		}
+		p = &request->next;
+	}
+	return 0;
+}
+
+void complete(struct aiocb * aiocbp, int result){
+	cortexm_disable_interrupts(); //completion is otherwise reported from an ISR
+	aiocbp->async.nbyte = result;
+	sysfs_aio_data_transfer_callback(aiocbp, 0);
+	cortexm_enable_interrupts();
+}
+
+void svcall_submit(void * args){
+	CORTEXM_SVCALL_ENTER();
+	root_aio_submit_t * p = args;
+	aio_request_t * request = 0;
+	int available = -1;
+	int i;
+
+	for(i=0; i < SYSFS_AIO_REQUEST_COUNT; i++){
+		if( m_aio_request[i].aiocbp == 0 ){
+			request = m_aio_request + i;
+			break;
+		}
+	}
+
+	if( request == 0 ){
+		p->result = SYSFS_SET_RETURN(EAGAIN);
+		return;
+	}
+
+	for(i=0; i < SYSFS_AIO_WORKER_COUNT; i++){
+		if( m_aio_worker[i].is_running ){
+			if( m_aio_worker[i].pid == p->request.pid ){
+				//the process's worker executes the request after the ones before it
+				*request = p->request;
+				append_request(request);
+				p->result = 0;
+				return;
+			}
+		} else if( available < 0 ){
+			available = i;
+		}
+	}
+
+	if( available < 0 ){
+		//every worker is busy with another process
+		p->result = SYSFS_SET_RETURN(EAGAIN);
+		return;
+	}
+
+	*request = p->request;
+	append_request(request);
+	m_aio_worker[available].pid = p->request.pid;
+	m_aio_worker[available].is_running = 1;
+	p->result = available + 1; //the caller starts the thread
+}
+
+void svcall_next(void * args){
+	CORTEXM_SVCALL_ENTER();
+	root_aio_next_t * p = args;
+	aio_worker_t * worker = m_aio_worker + p->worker;
+	aio_request_t * request;
+
+	p->result = 0;
+	if( worker->is_running == 0 ){
+		return;
+	}
+
+	request = remove_request(worker->pid);
+	if( request == 0 ){
+		//a request submitted after this sees the worker is gone and starts another one
+		worker->is_running = 0;
+		return;
+	}
+
+	p->request = *request;
+	request->aiocbp = 0;
+	p->result = 1;
+}
+
+void svcall_stop_worker(void * args){
+	CORTEXM_SVCALL_ENTER();
+	root_aio_next_t * p = args;
+	aio_worker_t * worker = m_aio_worker + p->worker;
+	aio_request_t * request;
+
+	//the thread didn't start -- the caller gets the error and requests queued since then fail
+	while( (request = remove_request(worker->pid)) != 0 ){
+		if( request->aiocbp != p->request.aiocbp ){
+			complete(request->aiocbp, SYSFS_SET_RETURN(EAGAIN));
+		}
+		request->aiocbp = 0;
+	}
+	worker->is_running = 0;
+}
+
+void svcall_complete(void * args){
+	CORTEXM_SVCALL_ENTER();
+	root_aio_next_t * p = args;
+	complete(p->request.aiocbp, p->result);
+}
+
+void * aio_worker(void * args){
+	root_aio_next_t next;
+	int result;
+
+	next.worker = (int)(long)args;
+	for(;;){
+		cortexm_svcall(svcall_next, &next);
+		if( next.result == 0 ){
+			return 0;
+		}
+
+		result = next.request.execute(next.request.config, next.request.handle, next.request.aiocbp);
+		if( result == -1 ){
+			result = SYSFS_SET_RETURN(errno);
+		}
+
+		next.result = result;
+		cortexm_svcall(svcall_complete, &next);
+	}
+}
+
+int start_worker(int worker){
+	pthread_attr_t attr;
+	struct sched_param param;
+	pthread_t thread;
+	int policy;
+	int result;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	pthread_attr_setstacksize(&attr, SYSFS_AIO_THREAD_STACK_SIZE);
+
+	//the transfers run at the priority of the caller
+	if( pthread_getschedparam(pthread_self(), &policy, &param) == 0 ){
+		pthread_attr_setschedpolicy(&attr, policy);
+		pthread_attr_setschedparam(&attr, &param);
+	}
+
+	result = pthread_create(&thread, &attr, aio_worker, (void*)(long)worker);
+	pthread_attr_destroy(&attr);
+	return result;
+}
+
+int sysfs_aio_submit(const void * config, void * handle, struct aiocb * aiocbp, sysfs_aio_execute_t execute){
+	root_aio_submit_t args;
+
+	aiocbp->async.loc = aiocbp->aio_offset;
+	aiocbp->async.flags = 0;
+	aiocbp->async.nbyte = aiocbp->aio_nbytes;
+	aiocbp->async.buf = (void*)aiocbp->aio_buf;
+	aiocbp->async.tid = task_get_current();
+	aiocbp->async.handler.callback = 0;
+	aiocbp->async.handler.context = aiocbp;
+	aiocbp->aio_nbytes = -1; //means status is in progress
+
+	args.request.config = config;
+	args.request.handle = handle;
+	args.request.aiocbp = aiocbp;
+	args.request.execute = execute;
+	args.request.pid = task_get_pid(task_get_current());
+	cortexm_svcall(svcall_submit, &args);
+
+	if( args.result > 0 ){
+		root_aio_next_t stop;
+		stop.worker = args.result - 1;
+		if( start_worker(stop.worker) == 0 ){
+			return 0;
+		}
+		mcu_debug_log_warning(MCU_DEBUG_FILESYSTEM, "failed to start AIO worker");
+		stop.request.aiocbp = aiocbp;
+		cortexm_svcall(svcall_stop_worker, &stop);
+		args.result = SYSFS_SET_RETURN(EAGAIN);
+	}
+
+	if( args.result < 0 ){
+		aiocbp->async.buf = 0;
+	}
+	return args.result;
+}
+
+void sysfs_aio_root_cancel_pid(int pid){
+	aio_request_t * request;
+	int i;
+
+	//the process has exited (its workers are gone) -- nothing waits on its requests
+	while( (request = remove_request(pid)) != 0 ){
+		request->aiocbp = 0;
+	}
+
+	for(i=0; i < SYSFS_AIO_WORKER_COUNT; i++){
+		if( m_aio_worker[i].pid == pid ){
+			m_aio_worker[i].is_running = 0;
+		}
+	}
+}
@@ -0,0 +1,282 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "sos/fs/sysfs.h"
+
+static sysfs_cache_line_t * find_line(sysfs_cache_t * cache, u32 address);
+static int load_line(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive, u32 address, int is_fill, sysfs_cache_line_t ** result);
+static int allocate_line(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive, sysfs_cache_line_t ** result);
+static int write_back_line(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive, sysfs_cache_line_t * line);
+static void read_ahead(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive, u32 address);
+static int count_uncached(sysfs_cache_t * cache, u32 address, int nbyte);
+static int read_drive(const sysfs_cache_drive_t * drive, u32 address, void * buf, int nbyte);
+static int write_drive(const sysfs_cache_drive_t * drive, u32 address, const void * buf, int nbyte);
+
+static inline u8 * get_line_data(sysfs_cache_t * cache, sysfs_cache_line_t * line){
+	return cache->data + (line - cache->lines) * cache->line_size;
+}
+
+int sysfs_cache_read(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive, u32 address, void * buf, int nbyte){
+	int bytes_read = 0;
+	int is_sequential;
+	u32 line_address;
+	u32 offset;
+	int chunk;
+	int result;
+	sysfs_cache_line_t * line;
+
+	is_sequential = (address == cache->next_address);
+	cache->next_address = address + nbyte;
+
+	while( bytes_read < nbyte ){
+		offset = address % cache->line_size;
+		line_address = address - offset;
+		chunk = cache->line_size - offset;
+		if( chunk > nbyte - bytes_read ){ chunk = nbyte - bytes_read; }
+
+		line = find_line(cache, line_address);
+		if( line == 0 ){
+			cache->miss_count++;
+
+			//large aligned reads go straight to the drive rather than thrashing the cache
+			if( (offset == 0) && (nbyte - bytes_read >= (int)cache->line_size*2) ){
+				chunk = count_uncached(cache, address, nbyte - bytes_read);
+				cache->miss_count += chunk / cache->line_size - 1;
+				cache->bypass_count += chunk / cache->line_size;
+				result = read_drive(drive, address, (u8*)buf + bytes_read, chunk);
+				if( result < 0 ){ return result; }
+				bytes_read += result;
+				address += result;
+				if( result < chunk ){ break; }
+				continue;
+			}
+
+			result = load_line(cache, drive, line_address, 1, &line);
+			if( result < 0 ){ return result; }
+		} else {
+			cache->hit_count++;
+		}
+
+		line->o_flags |= SYSFS_CACHE_LINE_FLAG_REFERENCED;
+		memcpy((u8*)buf + bytes_read, get_line_data(cache, line) + offset, chunk);
+		bytes_read += chunk;
+		address += chunk;
+	}
+
+	if( is_sequential && (bytes_read == nbyte) ){
+		//start at the first line after the read
+		read_ahead(cache, drive, (address + cache->line_size - 1) / cache->line_size * cache->line_size);
+	}
+
+	return bytes_read;
+}
+
+int sysfs_cache_write(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive, u32 address, const void * buf, int nbyte){
+	int bytes_written = 0;
+	u32 line_address;
+	u32 offset;
+	int chunk;
+	int result;
+	sysfs_cache_line_t * line;
+
+	while( bytes_written < nbyte ){
+		offset = address % cache->line_size;
+		line_address = address - offset;
+		chunk = cache->line_size - offset;
+		if( chunk > nbyte - bytes_written ){ chunk = nbyte - bytes_written; }
+
+		line = find_line(cache, line_address);
+		if( line == 0 ){
+			cache->miss_count++;
+
+			//large aligned writes are written through
+			if( (offset == 0) && (nbyte - bytes_written >= (int)cache->line_size*2) ){
+				chunk = count_uncached(cache, address, nbyte - bytes_written);
+				cache->miss_count += chunk / cache->line_size - 1;
+				cache->bypass_count += chunk / cache->line_size;
+				result = write_drive(drive, address, (const u8*)buf + bytes_written, chunk);
+				if( result < 0 ){ return result; }
+				bytes_written += result;
+				address += result;
+				if( result < chunk ){ break; }
+				continue;
+			}
+
+			//a partial line must be read before it is modified
+			result = load_line(cache, drive, line_address, (u32)chunk != cache->line_size, &line);
+			if( result < 0 ){ return result; }
+		} else {
+			cache->hit_count++;
+		}
+
+		memcpy(get_line_data(cache, line) + offset, (const u8*)buf + bytes_written, chunk);
+		line->o_flags |= SYSFS_CACHE_LINE_FLAG_DIRTY | SYSFS_CACHE_LINE_FLAG_REFERENCED;
+		bytes_written += chunk;
+		address += chunk;
+	}
+
+	return bytes_written;
+}
+
+int sysfs_cache_flush(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive){
+	int i;
+	int result;
+	int ret = 0;
+
+	for(i=0; i < cache->line_count; i++){
+		if( cache->lines[i].o_flags & SYSFS_CACHE_LINE_FLAG_DIRTY ){
+			result = write_back_line(cache, drive, cache->lines + i);
+			if( (result < 0) && (ret == 0) ){
+				//keep flushing the other lines but report the first error
+				ret = result;
+			}
+		}
+	}
+
+	return ret;
+}
+
+void sysfs_cache_invalidate(sysfs_cache_t * cache){
+	memset(cache->lines, 0, sizeof(sysfs_cache_line_t)*cache->line_count);
+	cache->hand = 0;
+	cache->next_address = 0;
+}
+
+sysfs_cache_line_t * find_line(sysfs_cache_t * cache, u32 address){
+	int i;
+	for(i=0; i < cache->line_count; i++){
+		if( (cache->lines[i].o_flags & SYSFS_CACHE_LINE_FLAG_VALID) &&
+			 (cache->lines[i].address == address) ){
+			return cache->lines + i;
+		}
+	}
+	return 0;
+}
+
+int count_uncached(sysfs_cache_t * cache, u32 address, int nbyte){
+	int count = cache->line_size;
+	//the run stops at the first line that is cached (it may be dirty)
+	while( (count + (int)cache->line_size <= nbyte) && (find_line(cache, address + count) == 0) ){
+		count += cache->line_size;
+	}
+	return count;
+}
+
+int allocate_line(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive, sysfs_cache_line_t ** result){
+	int i;
+	int ret;
+	sysfs_cache_line_t * line;
+
+	//CLOCK -- two sweeps are enough to clear every referenced bit
+	for(i=0; i < cache->line_count*2; i++){
+		line = cache->lines + cache->hand;
+		cache->hand++;
+		if( cache->hand == cache->line_count ){ cache->hand = 0; }
+
+		if( line->o_flags & SYSFS_CACHE_LINE_FLAG_REFERENCED ){
+			line->o_flags &= ~SYSFS_CACHE_LINE_FLAG_REFERENCED;
+			continue;
+		}
+
+		if( line->o_flags & SYSFS_CACHE_LINE_FLAG_DIRTY ){
+			ret = write_back_line(cache, drive, line);
+			if( ret < 0 ){ return ret; }
+		}
+
+		line->o_flags = 0;
+		*result = line;
+		return 0;
+	}
+
+	return SYSFS_SET_RETURN(EIO);
+}
+
+int load_line(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive, u32 address, int is_fill, sysfs_cache_line_t ** result){
+	int ret;
+	sysfs_cache_line_t * line;
+
+	ret = allocate_line(cache, drive, &line);
+	if( ret < 0 ){ return ret; }
+
+	if( is_fill ){
+		ret = read_drive(drive, address, get_line_data(cache, line), cache->line_size);
+		if( ret < 0 ){ return ret; }
+		if( ret < (int)cache->line_size ){
+			memset(get_line_data(cache, line) + ret, 0xff, cache->line_size - ret);
+		}
+	}
+
+	line->address = address;
+	line->o_flags = SYSFS_CACHE_LINE_FLAG_VALID;
+	*result = line;
+	return 0;
+}
+
+void read_ahead(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive, u32 address){
+	int i;
+	sysfs_cache_line_t * line;
+
+	//never prefetch over the lines that were just read
+	for(i=0; (i < cache->read_ahead) && (i < cache->line_count-1); i++){
+		if( find_line(cache, address) == 0 ){
+			if( load_line(cache, drive, address, 1, &line) < 0 ){
+				//most likely the end of the drive
+				return;
+			}
+			cache->read_ahead_count++;
+		}
+		address += cache->line_size;
+	}
+}
+
+int write_back_line(sysfs_cache_t * cache, const sysfs_cache_drive_t * drive, sysfs_cache_line_t * line){
+	int ret;
+	ret = write_drive(drive, line->address, get_line_data(cache, line), cache->line_size);
+	if( ret < 0 ){ return ret; }
+	line->o_flags &= ~SYSFS_CACHE_LINE_FLAG_DIRTY;
+	cache->write_back_count++;
+	return 0;
+}
+
+int read_drive(const sysfs_cache_drive_t * drive, u32 address, void * buf, int nbyte){
+	int bytes_read = 0;
+	int ret;
+	while( bytes_read < nbyte ){
+		ret = drive->read(drive->context, address + bytes_read, (u8*)buf + bytes_read, nbyte - bytes_read);
+		if( ret < 0 ){ return ret; }
+		if( ret == 0 ){ break; }
+		bytes_read += ret;
+	}
+	return bytes_read;
+}
+
+int write_drive(const sysfs_cache_drive_t * drive, u32 address, const void * buf, int nbyte){
+	int bytes_written = 0;
+	int ret;
+	while( bytes_written < nbyte ){
+		//drives may write less than requested (such as stopping at a page boundary)
+		ret = drive->write(drive->context, address + bytes_written, (const u8*)buf + bytes_written, nbyte - bytes_written);
+		if( ret < 0 ){ return ret; }
+		if( ret == 0 ){ return SYSFS_SET_RETURN(EIO); }
+		bytes_written += ret;
+	}
+	return bytes_written;
+}
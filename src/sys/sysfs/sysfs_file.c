@@ -19,11 +19,17 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/uio.h>
 #include "mcu/debug.h"
+#include "sos/dev/drive.h"
 #include "sos/fs/sysfs.h"
 
 extern int devfs_open(const void * cfg, void ** handle, const char * path, int flags, int mode);
 static void update_loc(sysfs_file_t * file, int adjust);
+static int transfer_vector(sysfs_file_t * file, const struct iovec * iov, int iovcnt, int is_read);
+static int shared_read_drive(const void * context, u32 address, void * buf, int nbyte);
+static int shared_write_drive(const void * context, u32 address, const void * buf, int nbyte);
+static int shared_flush(const sysfs_shared_config_t * config);
 
 int sysfs_file_open(sysfs_file_t * file, const char * name, int mode){
     int ret;
@@ -74,6 +80,92 @@ int sysfs_file_write(sysfs_file_t * file, const void * buf, int nbyte){
     return bytes;
 }
 
+int sysfs_file_readv(sysfs_file_t * file, const struct iovec * iov, int iovcnt){
+    const sysfs_t * fs = file->fs;
+    int bytes;
+    if( fs->readv ){
+        bytes = fs->readv(fs->config, file->handle, file->flags, file->loc, iov, iovcnt);
+    } else {
+        bytes = SYSFS_SET_RETURN(ENOTSUP);
+    }
+
+    if( (bytes < -1) && (SYSFS_GET_RETURN_ERRNO(bytes) == ENOTSUP) ){
+        //the filesystem (or device) can't do it in one call -- transfer one buffer at a time
+        return transfer_vector(file, iov, iovcnt, 1);
+    }
+    SYSFS_PROCESS_RETURN(bytes);
+    update_loc(file, bytes);
+    return bytes;
+}
+
+int sysfs_file_writev(sysfs_file_t * file, const struct iovec * iov, int iovcnt){
+    const sysfs_t * fs = file->fs;
+    int bytes;
+    if( fs->writev ){
+        bytes = fs->writev(fs->config, file->handle, file->flags, file->loc, iov, iovcnt);
+    } else {
+        bytes = SYSFS_SET_RETURN(ENOTSUP);
+    }
+
+    if( (bytes < -1) && (SYSFS_GET_RETURN_ERRNO(bytes) == ENOTSUP) ){
+        //the filesystem (or device) can't do it in one call -- transfer one buffer at a time
+        return transfer_vector(file, iov, iovcnt, 0);
+    }
+    SYSFS_PROCESS_RETURN(bytes);
+    update_loc(file, bytes);
+    return bytes;
+}
+
+int sysfs_file_pread(sysfs_file_t * file, void * buf, int nbyte, int loc){
+    const sysfs_t * fs = file->fs;
+    int bytes;
+    if( file->flags & O_CHAR ){
+        errno = ESPIPE;
+        return -1*__LINE__;
+    }
+    //the file offset is not used or updated
+    bytes = fs->read(fs->config, file->handle, file->flags, loc, buf, nbyte);
+    SYSFS_PROCESS_RETURN(bytes);
+    return bytes;
+}
+
+int sysfs_file_pwrite(sysfs_file_t * file, const void * buf, int nbyte, int loc){
+    const sysfs_t * fs = file->fs;
+    int bytes;
+    if( file->flags & O_CHAR ){
+        errno = ESPIPE;
+        return -1*__LINE__;
+    }
+    bytes = fs->write(fs->config, file->handle, file->flags, loc, buf, nbyte);
+    SYSFS_PROCESS_RETURN(bytes);
+    return bytes;
+}
+
+int transfer_vector(sysfs_file_t * file, const struct iovec * iov, int iovcnt, int is_read){
+    int i;
+    int bytes;
+    int total = 0;
+    for(i=0; i < iovcnt; i++){
+        if( iov[i].iov_len == 0 ){ continue; }
+        if( is_read ){
+            bytes = sysfs_file_read(file, iov[i].iov_base, iov[i].iov_len);
+        } else {
+            bytes = sysfs_file_write(file, iov[i].iov_base, iov[i].iov_len);
+        }
+
+        if( bytes < 0 ){
+            //report the partial transfer if some data has already moved
+            return total ? total : bytes;
+        }
+
+        total += bytes;
+        if( bytes < (int)iov[i].iov_len ){
+            break;
+        }
+    }
+    return total;
+}
+
 int sysfs_file_aio(sysfs_file_t * file, void * aiocbp){
     const sysfs_t * fs = file->fs;
     int ret =  fs->aio(fs->config, file->handle, aiocbp);
@@ -111,24 +203,56 @@ void update_loc(sysfs_file_t * file, int adjust){
 }
 
 int sysfs_shared_open(const sysfs_shared_config_t * config){
+	int result;
+	drive_info_t info;
     config->state->file.fs = config->devfs;
     config->state->file.flags = O_RDWR;
     config->state->file.loc = 0;
     config->state->file.handle = NULL;
-	 return sysfs_file_open(&(config->state->file), config->name, O_RDWR);
+	 config->state->address_size = 1;
+	 result = sysfs_file_open(&(config->state->file), config->name, O_RDWR);
+	 if( (result < 0) || (config->cache == 0) ){
+		 return result;
+	 }
+
+	 //the cache works in bytes -- loc is in units of the drive's address size
+	 if( (sysfs_file_ioctl(&(config->state->file), I_DRIVE_GETINFO, &info) >= 0) &&
+		  (info.addressable_size > 0) ){
+		 config->state->address_size = info.addressable_size;
+	 }
+	 sysfs_cache_invalidate(config->cache);
+	 return result;
 }
 
 int sysfs_shared_ioctl(const sysfs_shared_config_t * config, int request, void * ctl){
+	 int result;
     if( config->state->file.fs == 0 ){ return SYSFS_SET_RETURN(ENODEV); }
+	 if( config->cache && (request == I_DRIVE_SETATTR) ){
+		 const drive_attr_t * attr = ctl;
+		 if( attr->o_flags & (DRIVE_FLAG_ERASE_BLOCKS | DRIVE_FLAG_ERASE_DEVICE | DRIVE_FLAG_INIT | DRIVE_FLAG_RESET) ){
+			 //pending writes land before the erase and nothing stale survives it
+			 result = shared_flush(config);
+			 sysfs_cache_invalidate(config->cache);
+			 if( result < 0 ){ return result; }
+		 }
+	 }
 	 return sysfs_file_ioctl(&(config->state->file), request, ctl);
 }
 
 int sysfs_shared_fsync(const sysfs_shared_config_t * config){
-    return 0;
+    if( config->cache == 0 ){ return 0; }
+    if( config->state->file.fs == 0 ){ return SYSFS_SET_RETURN(ENODEV); }
+	 return shared_flush(config);
 }
 
 int sysfs_shared_read(const sysfs_shared_config_t * config, int loc, void * buf, int nbyte){
     if( config->state->file.fs == 0 ){ return SYSFS_SET_RETURN(ENODEV); }
+	 if( config->cache ){
+		 const sysfs_cache_drive_t drive = {
+			 .context = config, .read = shared_read_drive, .write = shared_write_drive
+		 };
+		 return sysfs_cache_read(config->cache, &drive, loc * config->state->address_size, buf, nbyte);
+	 }
     config->state->file.loc = loc;
 	 return sysfs_file_read(&(config->state->file), buf, nbyte);
 }
@@ -143,18 +267,57 @@ int sysfs_shared_unlock(const sysfs_shared_config_t * config){
 
 int sysfs_shared_write(const sysfs_shared_config_t * config, int loc, const void * buf, int nbyte){
     if( config->state->file.fs == 0 ){ return SYSFS_SET_RETURN(ENODEV); }
+	 if( config->cache ){
+		 const sysfs_cache_drive_t drive = {
+			 .context = config, .read = shared_read_drive, .write = shared_write_drive
+		 };
+		 return sysfs_cache_write(config->cache, &drive, loc * config->state->address_size, buf, nbyte);
+	 }
     config->state->file.loc = loc;
 	 return sysfs_file_write(&(config->state->file), buf, nbyte);
 }
 
 int sysfs_shared_aio(const sysfs_shared_config_t * config, void * aio){
     if( config->state->file.fs == 0 ){ return SYSFS_SET_RETURN(ENODEV); }
+	 if( config->cache ){
+		 //aio bypasses the cache so make sure the drive is current
+		 //if the flush fails the dirty lines are kept and the aio is not started
+		 int result = shared_flush(config);
+		 if( result < 0 ){ return result; }
+		 sysfs_cache_invalidate(config->cache);
+	 }
 	 return sysfs_file_aio(&(config->state->file), aio);
 }
 
 int sysfs_shared_close(const sysfs_shared_config_t * config){
+	 int result = 0;
     if( config->state->file.fs == 0 ){ return SYSFS_SET_RETURN(ENODEV); }
-	 return sysfs_file_close(&(config->state->file));
+	 if( config->cache ){
+		 result = shared_flush(config);
+		 sysfs_cache_invalidate(config->cache);
+	 }
+	 int close_result = sysfs_file_close(&(config->state->file));
+	 if( close_result < 0 ){ return close_result; }
+	 return result;
+}
+
+int shared_flush(const sysfs_shared_config_t * config){
+	const sysfs_cache_drive_t drive = {
+		.context = config, .read = shared_read_drive, .write = shared_write_drive
+	};
+	return sysfs_cache_flush(config->cache, &drive);
+}
+
+int shared_read_drive(const void * context, u32 address, void * buf, int nbyte){
+	const sysfs_shared_config_t * config = context;
+	config->state->file.loc = address / config->state->address_size;
+	return sysfs_file_read(&(config->state->file), buf, nbyte);
+}
+
+int shared_write_drive(const void * context, u32 address, const void * buf, int nbyte){
+	const sysfs_shared_config_t * config = context;
+	config->state->file.loc = address / config->state->address_size;
+	return sysfs_file_write(&(config->state->file), buf, nbyte);
 }
 
 
@@ -327,6 +327,11 @@ void posix_trace_event_addr(trace_event_id_t event_id, const void * data_ptr, si
 void posix_trace_event(trace_event_id_t event_id, const void * data_ptr, size_t data_len){
 	//MCU_CORE_DECLARE_CALLER_REGISTER(lr);
 	//posix_trace_event_addr(event_id, data_ptr, data_len, lr);
+	u32 value = 0;
+	if( data_ptr != 0 ){
+		memcpy(&value, data_ptr, data_len < sizeof(value) ? data_len : sizeof(value));
+	}
+	sos_trace_record(event_id, value);
 }
 
 int exec_trace_event(mqd_t mqdes, struct posix_trace_event_info * info, const void * data_ptr, size_t data_len){
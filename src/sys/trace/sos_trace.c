@@ -120,6 +120,17 @@ void sos_trace_event(
 		size_t data_len
 		){
 	register u32 lr asm("lr");
+	u32 value = 0;
+
+	if( sos_trace_is_enabled() ){
+		//the binary ring replaces the link notification -- keep the first word of data
+		if( data_ptr && data_len ){
+			memcpy(&value, data_ptr, data_len < sizeof(value) ? data_len : sizeof(value));
+		}
+		sos_trace_record(event_id, value);
+		return;
+	}
+
 	sos_trace_event_addr(event_id, data_ptr, data_len, lr);
 }
 
@@ -148,6 +159,12 @@ void sos_trace_event_addr_tid(
 	struct timespec spec;
 	link_trace_event_t event;
 
+	if( sos_trace_is_enabled() ){
+		//the binary ring replaces the link notification -- the address (fault PC or caller) is the payload
+		sos_trace_record_tid(event_id, tid, addr);
+		return;
+	}
+
 	if( sos_board_config.trace_event ){
 		//convert the address using the task memory location
 		//check if addr is part of kernel or app
@@ -0,0 +1,147 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include <string.h>
+
+#include "cortexm/cortexm.h"
+#include "cortexm/task.h"
+#include "sos/sos.h"
+
+//must be a power of two
+#if !defined SOS_TRACE_RING_SIZE
+#define SOS_TRACE_RING_SIZE 128
+#endif
+
+#define RING_MASK (SOS_TRACE_RING_SIZE-1)
+
+//o_flags holds the valid bit and the lap of the ring the record was written on
+#define RECORD_FLAG_VALID 0x80
+#define RECORD_TAG(index) (RECORD_FLAG_VALID | (((index) / SOS_TRACE_RING_SIZE) & 0x7F))
+
+static link_trace_record_t m_trace_ring[SOS_TRACE_RING_SIZE] MCU_SYS_MEM __attribute__((aligned(4)));
+static volatile u32 m_trace_ring_head MCU_SYS_MEM; //next record to write (only ever incremented)
+static volatile u32 m_trace_ring_tail MCU_SYS_MEM; //next record to read
+static volatile u8 m_trace_ring_enabled MCU_SYS_MEM;
+
+static void svcall_trace_record(void * args) MCU_ROOT_EXEC_CODE;
+
+void sos_trace_root_record(u16 event_id, u32 value){
+	sos_trace_root_record_tid(event_id, task_get_current(), value);
+}
+
+void sos_trace_root_record_tid(u16 event_id, int tid, u32 value){
+	u32 head;
+	link_trace_record_t * record;
+
+	if( m_trace_ring_enabled == 0 ){
+		return;
+	}
+
+	//reserve a slot -- the store fails if an interrupt reserved a slot in between
+	do {
+		head = __LDREXW((u32*)&m_trace_ring_head);
+	} while( __STREXW(head+1, (u32*)&m_trace_ring_head) );
+
+	record = m_trace_ring + (head & RING_MASK);
+	record->o_flags = 0;
+	record->timestamp = DWT->CYCCNT;
+	record->event_id = event_id;
+	record->tid = tid;
+	record->value = value;
+	__DMB();
+	record->o_flags = RECORD_TAG(head);
+}
+
+void svcall_trace_record(void * args){
+	CORTEXM_SVCALL_ENTER();
+	u32 * record = args;
+	sos_trace_root_record_tid(record[0], record[1], record[2]);
+}
+
+void sos_trace_record(u16 event_id, u32 value){
+	sos_trace_record_tid(event_id, task_get_current(), value);
+}
+
+void sos_trace_record_tid(u16 event_id, int tid, u32 value){
+	u32 record[3];
+
+	if( m_trace_ring_enabled == 0 ){
+		return;
+	}
+
+	//handlers and privileged threads can write the ring (and read DWT) directly
+	if( (__get_IPSR() != 0) || ((__get_CONTROL() & 0x01) == 0) ){
+		sos_trace_root_record_tid(event_id, tid, value);
+		return;
+	}
+
+	record[0] = event_id;
+	record[1] = tid;
+	record[2] = value;
+	cortexm_svcall(svcall_trace_record, record);
+}
+
+int sos_trace_root_read_records(link_trace_record_t * dest, int max, u32 * dropped){
+	u32 head = m_trace_ring_head;
+	u32 tail = m_trace_ring_tail;
+	u32 lost = 0;
+	int count = 0;
+	const link_trace_record_t * record;
+
+	if( head - tail > SOS_TRACE_RING_SIZE ){
+		//the writers lapped the reader
+		lost = head - tail - SOS_TRACE_RING_SIZE;
+		tail = head - SOS_TRACE_RING_SIZE;
+	}
+
+	while( (count < max) && (tail != head) ){
+		record = m_trace_ring + (tail & RING_MASK);
+		if( record->o_flags != RECORD_TAG(tail) ){
+			//a lower priority context is still writing this record -- read it next time
+			break;
+		}
+
+		memcpy(dest + count, record, sizeof(link_trace_record_t));
+
+		if( m_trace_ring_head - tail > SOS_TRACE_RING_SIZE ){
+			//overwritten while being copied
+			lost++;
+		} else {
+			dest[count].o_flags = 0;
+			count++;
+		}
+		tail++;
+	}
+
+	m_trace_ring_tail = tail;
+	*dropped = lost;
+	return count;
+}
+
+void sos_trace_root_flush(){
+	m_trace_ring_tail = m_trace_ring_head;
+}
+
+void sos_trace_root_set_enabled(int value){
+	m_trace_ring_enabled = (value != 0);
+}
+
+int sos_trace_is_enabled(){
+	return m_trace_ring_enabled;
+}
@@ -34,6 +34,7 @@
 #include "cortexm/mpu.h"
 #include "../scheduler/scheduler_local.h"
 #include "../signal/sig_local.h"
+#include "../sysfs/devfs_local.h"
 
 /*! \cond */
 static void svcall_stop_threads(int * send_signal) MCU_ROOT_EXEC_CODE;
@@ -56,7 +57,8 @@ void _exit(int __status){
 	// todo close named semaphores
 
 
-	// todo cancel any async IO
+	//drop any async IO the process still has waiting on devices
+	devfs_aio_cancel_pid(task_get_pid(task_get_current()));
 
 	//Make sure all open file descriptors are closed
 	for(i=0; i < OPEN_MAX; i++){
@@ -96,12 +98,15 @@ void svcall_stop_threads(int * send_signal){
 	for(i=1; i < task_get_total(); i++){
 		if ( task_get_pid(i) == tmp ){
 			if ( i != task_get_current() ){
-				sos_sched_table[i].flags = 0;
+				sos_sched_flags[i] = 0;
 				task_root_delete(i);
 			}
 		}
 	}
 
+	//the AIO workers were threads in this process
+	sysfs_aio_root_cancel_pid(tmp);
+
 	//now check for SA_NOCLDWAIT in parent process
 	tmp = task_get_parent( task_get_current() );
 	parent_reent = (struct _reent *)sos_task_table[tmp].global_reent;
@@ -134,7 +139,7 @@ void svcall_stop_threads(int * send_signal){
 		*send_signal = false;
 	} else if( *send_signal == true ){
 		//assert the zombie flags
-		sos_sched_table[task_get_current()].flags |= (1<< SCHEDULER_TASK_FLAG_ZOMBIE);
+		sos_sched_flags[task_get_current()] |= (1<< SCHEDULER_TASK_FLAG_ZOMBIE);
 
 		//send a signal to the parent process
 		tmp = task_get_pid( task_get_parent( task_get_current() ) );
@@ -176,7 +181,7 @@ void svcall_zombie_process(int * signal_sent){
 	CORTEXM_SVCALL_ENTER();
 	if ( *signal_sent == false ){
 		//discard this thread immediately
-		sos_sched_table[task_get_current()].flags = 0;
+		sos_sched_flags[task_get_current()] = 0;
 		task_root_delete(task_get_current());
 	} else {
 		//the parent is waiting -- set this thread to a zombie thread
@@ -0,0 +1,243 @@
+/* Copyright 2011-2018 Tyler Gilbert;
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+/*! \addtogroup unistd
+ * @{
+ */
+
+/*! \file */
+
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+#include "mcu/mcu.h"
+#include "sos/fs/devfs.h"
+#include "unistd_local.h"
+#include "../scheduler/scheduler_local.h"
+
+/*! \cond */
+typedef struct {
+	volatile int count;
+	int tid;
+	int timeout;
+} poll_t;
+
+typedef struct {
+	poll_t * poll;
+	struct pollfd * pfd;
+	sysfs_file_t * file;
+} poll_entry_t;
+
+static void svcall_poll(void * args) MCU_ROOT_EXEC_CODE;
+static int poll_callback(void * context, const mcu_event_t * event) MCU_ROOT_CODE;
+static int set_poll_action(poll_entry_t * entry, mcu_callback_t callback);
+/*! \endcond */
+
+/*! \details This function waits until one of the file descriptors in \a fds
+ * is ready to read (POLLIN) or write (POLLOUT).
+ *
+ * Devices are notified using I_MCU_SETACTION with MCU_EVENT_FLAG_POLL so
+ * that the calling thread sleeps until a device interrupt makes one of
+ * the descriptors ready. The FIFO drivers (fifo, ffifo, cfifo, devfifo,
+ * uartfifo and usbfifo) support this. Other devices report POLLERR. Files
+ * that are not devices are always ready.
+ *
+ * Each FIFO keeps one readiness handler so only one thread should poll
+ * a FIFO at a time. Sockets are polled using select().
+ *
+ * \param fds The list of file descriptors and events to wait for
+ * \param nfds The number of entries in \a fds
+ * \param timeout The maximum number of milliseconds to wait (-1 to wait forever)
+ *
+ * \return The number of entries in \a fds with revents set, zero if \a timeout
+ * expired or -1 with errno (see \ref errno) set to:
+ * - EINVAL: \a nfds is greater than OPEN_MAX
+ * - EINTR: a signal was received before any file descriptor was ready
+ *
+ */
+int poll(struct pollfd fds[], nfds_t nfds, int timeout){
+	poll_t p;
+	int count;
+	int result;
+	u32 i;
+
+	scheduler_check_cancellation();
+
+	if( nfds > OPEN_MAX ){
+		errno = EINVAL;
+		return -1;
+	}
+
+	poll_entry_t entry[nfds ? nfds : 1];
+	memset(&p, 0, sizeof(p));
+	p.tid = task_get_current();
+	p.timeout = timeout;
+
+	for(i=0; i < nfds; i++){
+		int fildes;
+		entry[i].poll = &p;
+		entry[i].pfd = fds + i;
+		entry[i].file = 0;
+		fds[i].revents = 0;
+
+		if( fds[i].fd < 0 ){
+			continue;
+		}
+
+		fildes = FILDES_IS_SOCKET(fds[i].fd) ? -1 : u_fildes_is_bad(fds[i].fd);
+		if( fildes < 0 ){
+			fds[i].revents = POLLNVAL;
+			continue;
+		}
+
+		if( get_fs(fildes)->aio != devfs_aio ){
+			//regular files never block
+			fds[i].revents = fds[i].events & (POLLIN | POLLOUT);
+			continue;
+		}
+
+		entry[i].file = get_open_file(fildes);
+		result = set_poll_action(entry + i, poll_callback);
+		if( (result < 0) || ((result & MCU_EVENT_FLAG_POLL) == 0) ){
+			//the driver doesn't support MCU_EVENT_FLAG_POLL -- make sure it doesn't keep the handler
+			if( result >= 0 ){
+				set_poll_action(entry + i, 0);
+			}
+			entry[i].file = 0;
+			fds[i].revents = POLLERR;
+			continue;
+		}
+
+		if( result & MCU_EVENT_FLAG_DATA_READY ){
+			fds[i].revents |= POLLIN;
+		}
+
+		if( result & MCU_EVENT_FLAG_WRITE_COMPLETE ){
+			fds[i].revents |= POLLOUT;
+		}
+
+		if( fds[i].revents ){
+			//the handler is only registered if nothing was ready
+			entry[i].file = 0;
+		}
+	}
+
+	for(i=0; i < nfds; i++){
+		if( fds[i].revents ){
+			p.count++;
+		}
+	}
+
+	if( (p.count == 0) && (timeout != 0) ){
+		cortexm_svcall(svcall_poll, &p);
+	}
+
+	//remove the handlers that haven't executed -- they point to this stack frame
+	for(i=0; i < nfds; i++){
+		if( entry[i].file ){
+			set_poll_action(entry + i, 0);
+		}
+	}
+
+	count = 0;
+	for(i=0; i < nfds; i++){
+		if( fds[i].revents ){
+			count++;
+		}
+	}
+
+	if( (count == 0) && (timeout != 0) &&
+		 (scheduler_unblock_type(task_get_current()) == SCHEDULER_UNBLOCK_SIGNAL) ){
+		errno = EINTR;
+		return -1;
+	}
+
+	return count;
+}
+
+/*! \cond */
+int set_poll_action(poll_entry_t * entry, mcu_callback_t callback){
+	mcu_action_t action;
+	memset(&action, 0, sizeof(action));
+	action.handler.callback = callback;
+	action.handler.context = entry;
+	action.o_events = MCU_EVENT_FLAG_POLL;
+	if( entry->pfd->events & POLLIN ){
+		action.o_events |= MCU_EVENT_FLAG_DATA_READY;
+	}
+	if( entry->pfd->events & POLLOUT ){
+		action.o_events |= MCU_EVENT_FLAG_WRITE_COMPLETE;
+	}
+	//cfifo uses the location to select the channel like it does for read() and write()
+	action.channel = entry->file->loc;
+	return sysfs_file_ioctl(entry->file, I_MCU_SETACTION, &action);
+}
+
+int poll_callback(void * context, const mcu_event_t * event){
+	poll_entry_t * entry = context;
+	poll_t * p = entry->poll;
+
+	if( event->o_events & MCU_EVENT_FLAG_DATA_READY ){
+		entry->pfd->revents |= POLLIN;
+	}
+
+	if( event->o_events & MCU_EVENT_FLAG_WRITE_COMPLETE ){
+		entry->pfd->revents |= POLLOUT;
+	}
+
+	p->count++;
+
+	//wake the thread if it is blocked in poll()
+	if( (sos_sched_block_object[p->tid] == p) && !task_active_asserted(p->tid) ){
+		scheduler_root_assert_active(p->tid, SCHEDULER_UNBLOCK_TRANSFER);
+		scheduler_root_update_on_wake(p->tid, task_get_priority(p->tid));
+	}
+
+	return 0;
+}
+
+void svcall_poll(void * args){
+	CORTEXM_SVCALL_ENTER();
+	poll_t * p = args;
+	struct mcu_timeval abs_timeout;
+
+	if( p->timeout < 0 ){
+		scheduler_timing_convert_timespec(&abs_timeout, 0);
+	} else {
+		struct timespec interval;
+		struct mcu_timeval mcu_interval;
+		struct mcu_timeval now;
+		interval.tv_sec = p->timeout / 1000;
+		interval.tv_nsec = (p->timeout % 1000) * 1000000UL;
+		scheduler_timing_convert_timespec(&mcu_interval, &interval);
+		scheduler_timing_svcall_get_realtime(&now);
+		abs_timeout = scheduler_timing_add_mcu_timeval(&now, &mcu_interval);
+	}
+
+	//no switching until the thread is blocked -- a device might become ready first
+	cortexm_disable_interrupts();
+	if( p->count == 0 ){
+		scheduler_timing_root_timedblock(p, &abs_timeout);
+	}
+	cortexm_enable_interrupts();
+}
+/*! \endcond */
+
+/*! @} */
+
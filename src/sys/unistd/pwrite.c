@@ -0,0 +1,75 @@
+/* Copyright 2011-2018 Tyler Gilbert; 
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * 
+ */
+
+/*! \addtogroup unistd
+ * @{
+ */
+
+/*! \file */
+
+#include <errno.h>
+#include "unistd_local.h"
+#include "unistd_fs.h"
+#include "sos/sos.h"
+
+/*! \details This function works like write() but transfers data
+ * to \a offset in the file. The file offset of \a fildes is not used
+ * or changed, so threads sharing a descriptor don't need to
+ * serialize lseek()/write() pairs.
+ *
+ * \param fildes The file descriptor returned by \ref open()
+ * \param buf A pointer to the data
+ * \param nbyte The number of bytes to write
+ * \param offset The location in the file
+ *
+ * \return The number of bytes transferred or -1 with errno (see \ref errno) set to:
+ * - EBADF:  \a fildes is bad
+ * - EACCES:  \a fildes is in O_RDONLY mode
+ * - EINVAL:  \a offset is negative
+ * - ESPIPE:  \a fildes is a socket or character device
+ * - EIO:  IO error
+ *
+ */
+ssize_t pwrite(int fildes, const void * buf, size_t nbyte, off_t offset){
+
+	if( FILDES_IS_SOCKET(fildes) ){
+		errno = ESPIPE;
+		return -1;
+	}
+
+	fildes = u_fildes_is_bad(fildes);
+	if ( fildes < 0 ){
+		errno = EBADF;
+		return -1;
+	}
+
+	if ( (get_flags(fildes) & O_ACCMODE) == O_RDONLY ){
+		errno = EACCES;
+		return -1;
+	}
+
+	if( offset < 0 ){
+		errno = EINVAL;
+		return -1;
+	}
+
+	return sysfs_file_pwrite(get_open_file(fildes), buf, nbyte, offset);
+}
+
+/*! @} */
@@ -0,0 +1,80 @@
+/* Copyright 2011-2018 Tyler Gilbert; 
+ * This file is part of Stratify OS.
+ *
+ * Stratify OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Stratify OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Stratify OS.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ * 
+ */
+
+/*! \addtogroup unistd
+ * @{
+ */
+
+/*! \file */
+
+#include <errno.h>
+#include <sys/uio.h>
+#include "unistd_local.h"
+#include "unistd_fs.h"
+#include "sos/sos.h"
+
+/*! \details This function writes the \a iovcnt buffers described
+ * by \a iov to \a fildes in order.
+ *
+ * If the device driver supports gather writes, the whole list is
+ * transferred with one kernel entry. Otherwise, the buffers are
+ * written one at a time.
+ *
+ * \param fildes The file descriptor returned by \ref open()
+ * \param iov A pointer to the list of buffers
+ * \param iovcnt The number of entries in \a iov (up to IOV_MAX)
+ *
+ * \return The number of bytes actually written or -1 with errno (see \ref errno) set to:
+ * - EBADF:  \a fildes is bad
+ * - EACCES:  \a fildes is on in O_RDONLY mode
+ * - EINVAL:  \a iovcnt is less than 1 or greater than IOV_MAX
+ * - EIO:  IO error
+ * - EAGAIN:  O_NONBLOCK is set for \a fildes and the device is busy
+ *
+ */
+ssize_t writev(int fildes, const struct iovec * iov, int iovcnt){
+
+	if( (iovcnt <= 0) || (iovcnt > IOV_MAX) ){
+		errno = EINVAL;
+		return -1;
+	}
+
+	if( FILDES_IS_SOCKET(fildes) ){
+		if( sos_board_config.socket_api != 0 ){
+			return sos_board_config.socket_api->writev(fildes & ~FILDES_SOCKET_FLAG, iov, iovcnt);
+		}
+		errno = EBADF;
+		return -1;
+	}
+
+	fildes = u_fildes_is_bad(fildes);
+	if ( fildes < 0 ){
+		errno = EBADF;
+		return -1;
+	}
+
+	if ( (get_flags(fildes) & O_ACCMODE) == O_RDONLY ){
+		errno = EACCES;
+		return -1;
+	}
+
+	return sysfs_file_writev(get_open_file(fildes), iov, iovcnt);
+}
+
+/*! @} */
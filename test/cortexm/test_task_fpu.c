@@ -0,0 +1,146 @@
+/* Host model of the FPU register ownership in src/cortexm/task_fpu.c
+ *
+ * The FPU registers are an array that the save and load functions copy
+ * to and from the task table like the vstm/vldm in task.c. A context
+ * switch enables access only for the owner (fpu_update_access()). A task
+ * without access claims the registers before its first floating point
+ * instruction like the NOCP fault does.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include "../../src/cortexm/task_local.h"
+#include "sos/sos.h"
+
+#define TOTAL 5
+
+volatile task_t sos_task_table[TOTAL];
+volatile int m_task_current;
+
+static u32 m_fp[32];
+static u32 m_fpscr;
+static int m_is_access;
+
+void task_root_fpu_save(int id){
+	memcpy((void*)sos_task_table[id].fp, m_fp, sizeof(m_fp));
+	sos_task_table[id].fpscr = m_fpscr;
+}
+
+void task_root_fpu_load(int id){
+	memcpy(m_fp, (void*)sos_task_table[id].fp, sizeof(m_fp));
+	m_fpscr = sos_task_table[id].fpscr;
+}
+
+static void reset(){
+	memset((void*)sos_task_table, 0, sizeof(sos_task_table));
+	memset(m_fp, 0, sizeof(m_fp));
+	m_fpscr = 0;
+	m_task_current = 0;
+	m_is_access = 1;
+	task_fpu_init();
+}
+
+//switch_contexts()
+static void switch_to(int id){
+	m_task_current = id;
+	m_is_access = task_fpu_is_owner(id);
+}
+
+//a floating point instruction in the current task (or an interrupt handler)
+static int fp_write(int is_handler_mode, u32 value){
+	if( m_is_access == 0 ){
+		if( task_root_fpu_claim(m_task_current, is_handler_mode) < 0 ){
+			return -1;
+		}
+		m_is_access = 1;
+	}
+	m_fp[0] = value;
+	m_fpscr = value + 1;
+	return 0;
+}
+
+static u32 fp_read(){
+	assert(m_is_access);
+	return m_fp[0];
+}
+
+static void test_fpu_and_integer_tasks(){
+	reset();
+
+	//task 1 uses the FPU -- the scheduler's registers are saved
+	switch_to(1);
+	assert(m_is_access == 0);
+	assert(fp_write(0, 100) == 0);
+	assert(task_get_fpu_owner() == 1);
+	assert(task_get_fpu_save_count() == 1 && task_get_fpu_restore_count() == 1);
+
+	//task 2 is integer only -- switching to it and back costs nothing
+	switch_to(2);
+	assert(m_is_access == 0);
+	switch_to(1);
+	assert(m_is_access == 1 && fp_read() == 100);
+	switch_to(2);
+	switch_to(1);
+	assert(task_get_fpu_save_count() == 1 && task_get_fpu_restore_count() == 1);
+
+	//task 3 uses the FPU -- the registers change owners
+	switch_to(3);
+	assert(fp_write(0, 300) == 0);
+	assert(sos_task_table[1].fp[0] == 100 && sos_task_table[1].fpscr == 101);
+	switch_to(1);
+	assert(fp_write(0, 110) == 0);
+	assert(sos_task_table[3].fp[0] == 300);
+	assert(task_get_fpu_save_count() == 3 && task_get_fpu_restore_count() == 3);
+	switch_to(3);
+	assert(fp_write(0, 310) == 0);
+	assert(sos_task_table[1].fp[0] == 110 && m_fp[0] == 310);
+	switch_to(1);
+	assert(fp_write(0, 120) == 0 && m_fpscr == 121);
+	printf("fpu and integer tasks ok\n");
+}
+
+static void test_interrupt(){
+	reset();
+	switch_to(1);
+	assert(fp_write(0, 100) == 0);
+
+	//an interrupt handler in an integer task can't take the registers from task 1
+	switch_to(2);
+	assert(fp_write(1, 200) < 0);
+	assert(task_get_fpu_owner() == 1);
+	assert(task_get_fpu_save_count() == 1 && task_get_fpu_restore_count() == 1);
+	switch_to(1);
+	assert(fp_read() == 100);
+
+	//task 2 itself can
+	switch_to(2);
+	assert(fp_write(0, 200) == 0);
+	assert(task_get_fpu_owner() == 2 && sos_task_table[1].fp[0] == 100);
+	printf("interrupt ok\n");
+}
+
+static void test_delete(){
+	reset();
+	switch_to(1);
+	assert(fp_write(0, 100) == 0);
+
+	//the owner exits -- its registers aren't saved over the next task
+	task_root_fpu_release(1);
+	assert(task_get_fpu_owner() == -1);
+	task_root_fpu_release(2);
+	switch_to(3);
+	assert(fp_write(0, 300) == 0);
+	assert(task_get_fpu_save_count() == 1 && task_get_fpu_restore_count() == 2);
+	assert(sos_task_table[1].fp[0] == 0);
+	printf("delete ok\n");
+}
+
+int main(){
+	test_fpu_and_integer_tasks();
+	test_interrupt();
+	test_delete();
+	return 0;
+}
@@ -0,0 +1,148 @@
+/* Host model of the scheduler ready queues in src/cortexm/task_ready.c
+ *
+ * The scheduler is modeled the way the kernel drives it: the executing
+ * priority is set like scheduler_root_update_on_stopped() (or held by the
+ * caller), then the next task is picked like select_next_task().
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include "../../src/cortexm/task_local.h"
+#include "sos/sos.h"
+
+#define TOTAL 8
+
+volatile task_t sos_task_table[TOTAL];
+volatile int m_task_current;
+volatile s8 m_task_current_priority;
+
+u64 task_root_get_cycles(){ return 0; }
+s8 task_get_current_priority(){ return m_task_current_priority; }
+void sos_trace_root_record(u16 event_id, u32 value){}
+
+static void reset(){
+	memset((void*)sos_task_table, 0, sizeof(sos_task_table));
+	m_task_current = 0;
+	m_task_current_priority = 0;
+	task_ready_init();
+}
+
+static void make_ready(int id, int priority){
+	sos_task_table[id].priority = priority;
+	sos_task_table[id].flags |= TASK_FLAGS_USED | TASK_FLAGS_ACTIVE;
+	task_root_update_ready(id);
+}
+
+static void block(int id){
+	task_deassert_active(id);
+}
+
+static void wake(int id){
+	task_assert_active(id);
+}
+
+//scheduler_root_update_on_stopped()
+static void update_priority(){
+	s8 priority = task_get_ready_priority();
+	m_task_current_priority = priority < 0 ? 0 : priority;
+}
+
+//select_next_task()
+static int next(){
+	m_task_current = task_root_ready_select(m_task_current, task_get_current_priority());
+	return m_task_current;
+}
+
+static void test_round_robin(){
+	reset();
+	make_ready(1, 5); make_ready(2, 5); make_ready(3, 5);
+	make_ready(4, 2); //lower priority never runs
+	update_priority();
+	assert(task_get_ready_count(5) == 3);
+
+	//task 0 runs between passes
+	assert(next() == 1); assert(next() == 2); assert(next() == 3); assert(next() == 0);
+	assert(next() == 1); assert(next() == 2); assert(next() == 3); assert(next() == 0);
+	printf("round robin ok\n");
+}
+
+static void test_fifo(){
+	reset();
+	make_ready(1, 3); make_ready(2, 3); make_ready(3, 3);
+	sos_task_table[2].flags |= TASK_FLAGS_FIFO;
+	update_priority();
+
+	//FIFO tasks run until they block -- when they wake they go to the end of the queue
+	assert(next() == 1);
+	assert(next() == 2);
+	block(2);
+	assert(next() == 3); //the pass continues after the task that blocked
+	wake(2);
+	assert(next() == 2); assert(next() == 0);
+	assert(next() == 1); assert(next() == 3); assert(next() == 2); assert(next() == 0);
+
+	//the last task of a pass blocks
+	assert(next() == 1); assert(next() == 3); assert(next() == 2);
+	block(2);
+	assert(next() == 0);
+	assert(next() == 1);
+	printf("fifo ok\n");
+}
+
+static void test_preempt(){
+	reset();
+	make_ready(1, 4); make_ready(2, 4);
+	update_priority();
+	assert(next() == 1);
+
+	//a higher priority task wakes -- it runs until it blocks
+	make_ready(5, 9);
+	update_priority();
+	assert(task_get_current_priority() == 9);
+	assert(next() == 5); assert(next() == 0); assert(next() == 5);
+	block(5);
+	update_priority();
+	assert(task_get_current_priority() == 4);
+	assert(next() == 1); assert(next() == 2); assert(next() == 0);
+
+	//the priority changes while the task is queued
+	sos_task_table[2].priority = 6;
+	task_root_update_ready(2);
+	update_priority();
+	assert(task_get_ready_count(4) == 1);
+	assert(next() == 2);
+	printf("preempt ok\n");
+}
+
+static void test_held_priority(){
+	reset();
+	make_ready(1, 4); make_ready(2, 4);
+	update_priority();
+	assert(next() == 1);
+
+	//hibernate holds the executing priority above every task (SCHED_HIGHEST_PRIORITY+1)
+	m_task_current_priority = TASK_PRIORITY_COUNT;
+	make_ready(3, 7);
+	assert(task_get_ready_count(task_get_current_priority()) == 0);
+	assert(!task_exec_asserted(1) && !task_exec_asserted(3));
+	assert(next() == 0);
+
+	//the priority isn't overwritten until the scheduler restores it
+	assert(task_get_current_priority() == TASK_PRIORITY_COUNT);
+	m_task_current_priority = 4;
+	assert(task_exec_asserted(1) && !task_exec_asserted(3));
+	update_priority();
+	assert(next() == 3);
+	printf("held priority ok\n");
+}
+
+int main(){
+	test_round_robin();
+	test_fifo();
+	test_preempt();
+	test_held_priority();
+	return 0;
+}
@@ -0,0 +1,134 @@
+/* Host tests for the cfifo driver in src/device/cfifo.c */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+
+#include "device/cfifo.h"
+
+#define CHANNEL_COUNT 4
+#define CHANNEL_SIZE 16
+#define READY_CHANNEL_MAX 32
+
+int task_validate_memory(void * target, int size){ return 0; }
+
+static char m_buffer[CHANNEL_COUNT+READY_CHANNEL_MAX][CHANNEL_SIZE];
+static fifo_state_t m_fifo_state[CHANNEL_COUNT+READY_CHANNEL_MAX];
+static fifo_config_t m_fifo_config[CHANNEL_COUNT+READY_CHANNEL_MAX];
+static cfifo_state_t m_state = { .fifo_state_array = m_fifo_state };
+static cfifo_config_t m_config = { .count = CHANNEL_COUNT, .size = CHANNEL_SIZE, .fifo_config_array = m_fifo_config };
+static const devfs_handle_t m_handle = { .config = &m_config, .state = &m_state };
+
+static int m_ready_count;
+static int m_poll_count;
+
+static int ready_complete(void * context, const mcu_event_t * event){
+	m_ready_count++;
+	return 0;
+}
+
+static int poll_complete(void * context, const mcu_event_t * event){
+	m_poll_count++;
+	return 0;
+}
+
+static void reset(int count){
+	int i;
+	memset(m_fifo_state, 0, sizeof(m_fifo_state));
+	memset(&m_state.transfer_handler, 0, sizeof(m_state.transfer_handler));
+	for(i=0; i < CHANNEL_COUNT+READY_CHANNEL_MAX; i++){
+		m_fifo_config[i].size = CHANNEL_SIZE;
+		m_fifo_config[i].buffer = m_buffer[i];
+	}
+	m_config.count = count;
+	m_ready_count = 0;
+	m_poll_count = 0;
+}
+
+static void write_channel(int channel, const char * data){
+	devfs_async_t async;
+	memset(&async, 0, sizeof(async));
+	async.loc = channel;
+	async.buf_const = data;
+	async.nbyte = strlen(data);
+	assert(cfifo_write(&m_handle, &async) == (int)strlen(data));
+}
+
+static int read_ready(devfs_async_t * async, u32 * o_wait){
+	memset(async, 0, sizeof(devfs_async_t));
+	async->loc = CFIFO_LOC_READY;
+	async->buf = o_wait;
+	async->nbyte = sizeof(u32);
+	async->handler.callback = ready_complete;
+	return cfifo_read(&m_handle, async);
+}
+
+static int set_poll(int channel, mcu_callback_t callback){
+	mcu_action_t action;
+	memset(&action, 0, sizeof(action));
+	action.channel = channel;
+	action.handler.callback = callback;
+	action.o_events = MCU_EVENT_FLAG_POLL | MCU_EVENT_FLAG_DATA_READY;
+	return cfifo_ioctl(&m_handle, I_MCU_SETACTION, &action);
+}
+
+static void test_ready_and_poll(){
+	devfs_async_t async;
+	u32 o_wait;
+
+	reset(CHANNEL_COUNT);
+
+	//poll() is waiting on channel 2 -- the ready read can't use it
+	assert(set_poll(2, poll_complete) == MCU_EVENT_FLAG_POLL);
+	o_wait = 0;
+	assert(SYSFS_GET_RETURN_ERRNO(read_ready(&async, &o_wait)) == EBUSY);
+	assert(m_state.transfer_handler.read == 0);
+
+	//other channels can be waited on and poll() keeps its handler
+	o_wait = 0x3;
+	assert(read_ready(&async, &o_wait) == 0);
+	assert(SYSFS_GET_RETURN_ERRNO(set_poll(1, poll_complete)) == EBUSY);
+	write_channel(2, "abc");
+	assert(m_poll_count == 1 && m_ready_count == 0);
+	write_channel(1, "abc");
+	assert(m_ready_count == 1 && o_wait == 0x2);
+
+	//the handlers are free again once the read completes
+	assert(set_poll(1, poll_complete) == (MCU_EVENT_FLAG_POLL | MCU_EVENT_FLAG_DATA_READY));
+	assert(set_poll(3, poll_complete) == MCU_EVENT_FLAG_POLL);
+	assert(set_poll(3, 0) == MCU_EVENT_FLAG_POLL);
+	o_wait = 0x8;
+	assert(read_ready(&async, &o_wait) == 0);
+	write_channel(3, "abc");
+	assert(m_ready_count == 2 && o_wait == 0x8 && m_poll_count == 1);
+	printf("ready and poll ok\n");
+}
+
+static void test_channel_limit(){
+	devfs_async_t async;
+	cfifo_info_t info;
+	u32 o_wait;
+
+	//the ready mask holds 32 channels
+	reset(READY_CHANNEL_MAX);
+	write_channel(READY_CHANNEL_MAX-1, "abc");
+	o_wait = 0;
+	assert(read_ready(&async, &o_wait) == sizeof(u32));
+	assert(o_wait == ((u32)1 << (READY_CHANNEL_MAX-1)));
+
+	//more channels than that can't be waited on
+	reset(READY_CHANNEL_MAX+1);
+	write_channel(READY_CHANNEL_MAX, "abc");
+	o_wait = 0;
+	assert(SYSFS_GET_RETURN_ERRNO(read_ready(&async, &o_wait)) == EINVAL);
+	assert(cfifo_ioctl(&m_handle, I_CFIFO_GETINFO, &info) == 0);
+	assert(info.o_ready == 0);
+	printf("channel limit ok\n");
+}
+
+int main(){
+	test_ready_and_poll();
+	test_channel_limit();
+	return 0;
+}
@@ -0,0 +1,400 @@
+/* Host tests for src/device/drive_cfi_spi.c and drive_cfi_qspi.c
+ *
+ * The SPI flash answers one byte for every byte the driver clocks and
+ * stays busy for a number of status reads after each page program.
+ * Asynchronous transfers complete when the test runs the "interrupt" so
+ * the test can check how much SPI traffic each interrupt generates.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include "mcu/spi.h"
+#include "mcu/qspi.h"
+#include "mcu/pio.h"
+#include "device/drive_cfi.h"
+#include "../../src/device/drive_cfi_local.h"
+
+#define FLASH_SIZE (16*1024)
+#define PAGE_SIZE 256
+#define PAGE_BUSY_READS 40
+#define SFDP_TABLE 0x30
+
+typedef struct {
+	u8 memory[FLASH_SIZE];
+	u8 sfdp[SFDP_TABLE + DRIVE_CFI_SFDP_BASIC_TABLE_WORDS*4];
+	u8 page[PAGE_SIZE];
+	int is_selected;
+	int count; //bytes clocked since CS was asserted
+	u8 opcode;
+	u32 address;
+	int is_write_enabled;
+	int busy;
+	int stuck;
+	int page_count;
+} flash_t;
+
+static flash_t m_flash;
+
+static void put_word(u8 * p, u32 value){
+	p[0] = value; p[1] = value >> 8; p[2] = value >> 16; p[3] = value >> 24;
+}
+
+static void flash_reset(){
+	memset(&m_flash, 0, sizeof(m_flash));
+	memset(m_flash.memory, 0xff, sizeof(m_flash.memory));
+
+	//SFDP header, basic parameter header (11 dwords at SFDP_TABLE) and the table
+	u8 * sfdp = m_flash.sfdp;
+	memset(sfdp, 0xff, sizeof(m_flash.sfdp));
+	put_word(sfdp, DRIVE_CFI_SFDP_SIGNATURE);
+	sfdp[4] = 0x06; sfdp[5] = 0x01; sfdp[6] = 0x00; sfdp[7] = 0xff;
+	sfdp[8] = 0x00; sfdp[9] = 0x06; sfdp[10] = 0x01; sfdp[11] = DRIVE_CFI_SFDP_BASIC_TABLE_WORDS;
+	sfdp[12] = SFDP_TABLE; sfdp[13] = 0; sfdp[14] = 0; sfdp[15] = 0xff;
+	u8 * table = sfdp + SFDP_TABLE;
+	//4KB erase with 0x20, 1-1-2, 1-2-2, 1-4-4 and 1-1-4 reads, 3 byte address
+	put_word(table + 0*4, 0x01 | (0x20 << 8) | (1<<16) | (1<<20) | (1<<21) | (1<<22));
+	put_word(table + 1*4, FLASH_SIZE*8 - 1);
+	//1-4-4: 0xEB with 2 mode clocks and 4 wait states, 1-1-4: 0x6B with 8 wait states
+	put_word(table + 2*4, ((0xEB << 8) | (2<<5) | 4) | (((0x6B << 8) | 8) << 16));
+	//1-1-2: 0x3B with 8 wait states, 1-2-2: 0xBB with 4 mode clocks
+	put_word(table + 3*4, ((0x3B << 8) | 8) | (((0xBB << 8) | (4<<5)) << 16));
+	put_word(table + 4*4, 0);
+	put_word(table + 5*4, 0);
+	put_word(table + 6*4, 0);
+	put_word(table + 7*4, 0x520F200C);
+	put_word(table + 8*4, 0x0000D810);
+	put_word(table + 9*4, 0);
+	put_word(table + 10*4, 8 << 4);
+}
+
+static void flash_select(int value){
+	if( value == 0 && m_flash.is_selected ){
+		//CS goes high -- a page program starts
+		if( (m_flash.opcode == 0x02) && (m_flash.count > 4) && m_flash.is_write_enabled ){
+			u32 page = m_flash.address & ~(PAGE_SIZE-1);
+			int i;
+			for(i=0; i < PAGE_SIZE; i++){
+				m_flash.memory[page + i] &= m_flash.page[i];
+			}
+			m_flash.busy = PAGE_BUSY_READS;
+			m_flash.is_write_enabled = 0;
+			m_flash.page_count++;
+		}
+	}
+	if( value ){
+		m_flash.count = 0;
+		if( m_flash.opcode == 0x02 ){ m_flash.opcode = 0; }
+		memset(m_flash.page, 0xff, sizeof(m_flash.page));
+	}
+	m_flash.is_selected = value;
+}
+
+static u8 flash_swap(u8 value){
+	u8 result = 0xff;
+	int count = m_flash.count++;
+
+	assert(m_flash.is_selected);
+
+	if( count == 0 ){
+		m_flash.opcode = value;
+		m_flash.address = 0;
+		//nothing but status reads are accepted while the device is busy
+		assert(m_flash.busy == 0 || value == 0x05);
+		if( value == 0x06 ){ m_flash.is_write_enabled = 1; }
+		return result;
+	}
+
+	switch(m_flash.opcode){
+		case 0x05:
+			result = m_flash.busy ? 0x03 : 0x00;
+			if( m_flash.busy && (m_flash.stuck == 0) ){ m_flash.busy--; }
+			break;
+		case 0x02:
+			if( count < 4 ){
+				m_flash.address = (m_flash.address << 8) | value;
+			} else {
+				u32 offset = (m_flash.address + count - 4) & (PAGE_SIZE-1);
+				m_flash.page[offset] = value;
+			}
+			break;
+		case 0x0B:
+		case 0x5A:
+			if( count < 4 ){
+				m_flash.address = (m_flash.address << 8) | value;
+			} else if( count > 4 ){
+				//the fifth byte is the dummy byte
+				const u8 * source = m_flash.opcode == 0x0B ? m_flash.memory : m_flash.sfdp;
+				u32 size = m_flash.opcode == 0x0B ? sizeof(m_flash.memory) : sizeof(m_flash.sfdp);
+				u32 address = m_flash.address + count - 5;
+				result = address < size ? source[address] : 0xff;
+			}
+			break;
+	}
+	return result;
+}
+
+//SPI driver -- asynchronous transfers complete in run_interrupts()
+static devfs_async_t * m_spi_pending;
+static int m_spi_pending_is_read;
+static int m_swap_count;
+
+static int spi_open(const devfs_handle_t * handle){ return 0; }
+static int spi_close(const devfs_handle_t * handle){ return 0; }
+
+static int spi_ioctl(const devfs_handle_t * handle, int request, void * ctl){
+	//the request codes are size_t on the host
+	if( request == (int)I_SPI_SWAP ){
+		m_swap_count++;
+		return flash_swap((u8)(ssize_t)ctl);
+	}
+	return 0;
+}
+
+static int spi_read(const devfs_handle_t * handle, devfs_async_t * async){
+	assert(m_spi_pending == 0);
+	m_spi_pending = async;
+	m_spi_pending_is_read = 1;
+	return 0;
+}
+
+static int spi_write(const devfs_handle_t * handle, devfs_async_t * async){
+	assert(m_spi_pending == 0);
+	m_spi_pending = async;
+	m_spi_pending_is_read = 0;
+	return 0;
+}
+
+int mcu_spi_close(const devfs_handle_t * handle){ return 0; }
+int mcu_pio_setmask(const devfs_handle_t * handle, void * ctl){ flash_select(0); return 0; }
+int mcu_pio_clrmask(const devfs_handle_t * handle, void * ctl){ flash_select(1); return 0; }
+int mcu_pio_setattr(const devfs_handle_t * handle, void * ctl){ return 0; }
+
+//returns the number of interrupts it took to finish
+static int run_interrupts(int * max_swaps){
+	mcu_event_t event;
+	int count = 0;
+	int i;
+	*max_swaps = 0;
+	while( m_spi_pending ){
+		devfs_async_t * async = m_spi_pending;
+		u8 * buf = async->buf;
+		m_spi_pending = 0;
+		for(i=0; i < async->nbyte; i++){
+			if( m_spi_pending_is_read ){
+				buf[i] = flash_swap(0xFF);
+			} else {
+				flash_swap(((const u8*)async->buf_const)[i]);
+			}
+		}
+
+		m_swap_count = 0;
+		event.o_events = m_spi_pending_is_read ? MCU_EVENT_FLAG_DATA_READY : MCU_EVENT_FLAG_WRITE_COMPLETE;
+		event.data = 0;
+		async->handler.callback(async->handler.context, &event);
+		if( m_swap_count > *max_swaps ){
+			*max_swaps = m_swap_count;
+		}
+		count++;
+		assert(count < 1000000);
+	}
+	return count;
+}
+
+static const devfs_device_t m_spi_device = {
+	.driver = { .open = spi_open, .close = spi_close, .ioctl = spi_ioctl, .read = spi_read, .write = spi_write }
+};
+
+static drive_cfi_state_t m_state;
+static const drive_cfi_config_t m_config = {
+	.serial_device = &m_spi_device,
+	.info = { .addressable_size = 1, .write_block_size = 1, .num_write_blocks = FLASH_SIZE },
+	.opcode = {
+		.write_enable = 0x06,
+		.page_program = 0x02,
+		.read_busy_status = 0x05,
+		.busy_status_mask = 0x01,
+		.unprotect = 0x98
+	},
+	.cs = { .port = 0, .pin = 1 }
+};
+static const devfs_handle_t m_handle = { .config = &m_config, .state = &m_state };
+
+static int m_complete;
+
+static int transfer_complete(void * context, const mcu_event_t * event){
+	m_complete++;
+	return 0;
+}
+
+static void start(devfs_async_t * async, void * buf, int loc, int nbyte){
+	memset(async, 0, sizeof(devfs_async_t));
+	async->buf = buf;
+	async->loc = loc;
+	async->nbyte = nbyte;
+	async->handler.callback = transfer_complete;
+	m_complete = 0;
+}
+
+static void test_spi_sfdp(){
+	flash_reset();
+	memset(&m_state, 0, sizeof(m_state));
+	assert(drive_cfi_spi_open(&m_handle) == 0);
+	assert(m_state.sfdp.o_flags & DRIVE_CFI_SFDP_FLAG_IS_VALID);
+	assert(m_state.sfdp.o_flags & DRIVE_CFI_SFDP_FLAG_IS_FAST_READ_144);
+	assert(m_state.sfdp.size == FLASH_SIZE);
+	assert(m_state.page_program_size == PAGE_SIZE);
+	assert(m_state.block_erase_opcode == 0x20);
+	assert(m_state.block_erase_size == 4096);
+	//a single data line only allows 1-1-1
+	assert(m_state.fast_read_opcode == 0x0B);
+	printf("spi sfdp ok\n");
+}
+
+static void test_spi_write_read(){
+	devfs_async_t async;
+	u8 out[1000];
+	u8 in[sizeof(out)];
+	int interrupts;
+	int max_swaps;
+	int i;
+
+	for(i=0; i < (int)sizeof(out); i++){ out[i] = i*7 + 3; }
+
+	//five pages -- the status register is polled from the interrupt between pages
+	start(&async, out, 100, sizeof(out));
+	assert(drive_cfi_spi_write(&m_handle, &async) == 0);
+	interrupts = run_interrupts(&max_swaps);
+	assert(m_complete == 1);
+	assert(async.nbyte == (int)sizeof(out));
+	assert(async.handler.callback == transfer_complete);
+	assert(m_flash.page_count == 5);
+	assert(memcmp(m_flash.memory + 100, out, sizeof(out)) == 0);
+	assert(interrupts > 4*PAGE_BUSY_READS);
+	//no interrupt spins on the status register
+	assert(max_swaps <= 6);
+	printf("multi-page write ok (%d interrupts, %d swaps max)\n", interrupts, max_swaps);
+
+	while( m_flash.busy ){ m_flash.busy--; }
+	start(&async, in, 100, sizeof(in));
+	assert(drive_cfi_spi_read(&m_handle, &async) == 0);
+	run_interrupts(&max_swaps);
+	assert(m_complete == 1);
+	assert(memcmp(in, out, sizeof(in)) == 0);
+	printf("read ok\n");
+}
+
+static void test_spi_busy_timeout(){
+	devfs_async_t async;
+	u8 out[600];
+	int max_swaps;
+
+	memset(out, 0x5A, sizeof(out));
+	memset(m_flash.memory, 0xff, sizeof(m_flash.memory));
+
+	//the device never finishes the first page
+	m_flash.stuck = 1;
+	start(&async, out, 0, sizeof(out));
+	assert(drive_cfi_spi_write(&m_handle, &async) == 0);
+	run_interrupts(&max_swaps);
+	assert(m_complete == 1);
+	//the page that was programmed is reported
+	assert(async.nbyte == PAGE_SIZE);
+	assert(max_swaps <= 6);
+	assert(m_flash.is_selected == 0);
+	m_flash.stuck = 0;
+	m_flash.busy = 0;
+	assert(drive_cfi_spi_close(&m_handle) == 0);
+	printf("busy timeout ok\n");
+}
+
+//QSPI driver -- commands go through I_QSPI_EXECCOMMAND
+static qspi_command_t m_last_command;
+
+static int qspi_ioctl(const devfs_handle_t * handle, int request, void * ctl){
+	if( request == (int)I_QSPI_EXECCOMMAND ){
+		qspi_command_t * command = ctl;
+		if( command->opcode == CFI_COMMAND_READ_SFDP ){
+			assert(command->dummy_cycles == 8);
+			assert(command->data_size <= sizeof(command->data));
+			assert(command->address + command->data_size <= sizeof(m_flash.sfdp));
+			memcpy(command->data, m_flash.sfdp + command->address, command->data_size);
+		}
+		m_last_command = *command;
+	}
+	return 0;
+}
+
+static int qspi_read(const devfs_handle_t * handle, devfs_async_t * async){ return async->nbyte; }
+
+static const devfs_device_t m_qspi_device = {
+	.driver = { .open = spi_open, .close = spi_close, .ioctl = qspi_ioctl, .read = qspi_read, .write = spi_write }
+};
+
+static void open_qspi(drive_cfi_config_t * config, u32 qspi_flags, u8 fast_read){
+	memset(config, 0, sizeof(drive_cfi_config_t));
+	config->serial_device = &m_qspi_device;
+	config->info.addressable_size = 1;
+	config->info.num_write_blocks = FLASH_SIZE;
+	config->opcode.fast_read = fast_read;
+	config->opcode.read_dummy_cycles = 8;
+	config->qspi_flags = qspi_flags;
+	memset(&m_state, 0, sizeof(m_state));
+	devfs_handle_t handle = { .config = config, .state = &m_state };
+	assert(drive_cfi_qspi_open(&handle) == 0);
+}
+
+static void test_qspi_fast_read(){
+	drive_cfi_config_t config;
+	devfs_handle_t handle = { .config = &config, .state = &m_state };
+	devfs_async_t async;
+	u8 buf[64];
+
+	flash_reset();
+
+	//four data lines -- 1-4-4 with the mode clocks sent as dummy cycles
+	open_qspi(&config, QSPI_FLAG_IS_DATA_QUAD, 0);
+	assert(m_state.page_program_size == PAGE_SIZE);
+	assert(m_state.fast_read_opcode == 0xEB);
+	assert(m_state.read_dummy_cycles == 6);
+	start(&async, buf, 0x100, sizeof(buf));
+	assert(drive_cfi_qspi_read(&handle, &async) == sizeof(buf));
+	assert(m_last_command.opcode == 0xEB);
+	assert(m_last_command.dummy_cycles == 6);
+	assert(m_last_command.address == 0x100);
+	assert(m_last_command.o_flags & QSPI_FLAG_IS_ADDRESS_QUAD);
+	assert(m_last_command.o_flags & QSPI_FLAG_IS_DATA_QUAD);
+
+	//two data lines -- 1-2-2
+	open_qspi(&config, QSPI_FLAG_IS_DATA_DUAL, 0);
+	assert(m_state.fast_read_opcode == 0xBB);
+	assert(m_state.read_dummy_cycles == 4);
+	assert(drive_cfi_qspi_read(&handle, &async) == sizeof(buf));
+	assert((m_last_command.o_flags & (QSPI_FLAG_IS_DATA_DUAL | QSPI_FLAG_IS_DATA_QUAD)) == QSPI_FLAG_IS_DATA_DUAL);
+
+	//the board config takes precedence
+	open_qspi(&config, QSPI_FLAG_IS_DATA_QUAD, 0x6B);
+	assert(m_state.fast_read_opcode == 0x6B);
+	assert(m_state.read_dummy_cycles == 8);
+	assert(drive_cfi_qspi_read(&handle, &async) == sizeof(buf));
+	assert(m_last_command.opcode == 0x6B);
+	assert((m_last_command.o_flags & QSPI_FLAG_IS_ADDRESS_QUAD) == 0);
+
+	//no SFDP -- the single line fast read
+	memset(m_flash.sfdp, 0xff, sizeof(m_flash.sfdp));
+	open_qspi(&config, QSPI_FLAG_IS_DATA_QUAD, 0);
+	assert((m_state.sfdp.o_flags & DRIVE_CFI_SFDP_FLAG_IS_VALID) == 0);
+	assert(m_state.fast_read_opcode == CFI_COMMAND_FAST_READ);
+	assert(m_state.page_program_size == 256);
+	printf("qspi fast read ok\n");
+}
+
+int main(){
+	test_spi_sfdp();
+	test_spi_write_read();
+	test_spi_busy_timeout();
+	test_qspi_fast_read();
+	return 0;
+}
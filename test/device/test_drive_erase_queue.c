@@ -0,0 +1,215 @@
+/* Host tests for src/device/drive_erase_queue.c
+ *
+ * The drive erases one sector per call and stays busy for a number of
+ * checks. The timer device keeps the last action so the test can run
+ * the match interrupt without calling the driver.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+
+#include "sos/dev/tmr.h"
+#include "device/drive_erase_queue.h"
+
+#define SECTOR_SIZE 4096
+#define ERASE_BUSY_CHECKS 10
+
+static int m_busy;
+static int m_erase_count;
+static int m_erase_error;
+static u32 m_erase_start[16];
+
+static int drive_erase(const devfs_handle_t * handle, u32 start, u32 end){
+	assert(m_busy == 0);
+	if( m_erase_error ){ return SYSFS_SET_RETURN(EIO); }
+	assert(m_erase_count < 16);
+	m_erase_start[m_erase_count++] = start;
+	m_busy = ERASE_BUSY_CHECKS;
+	return SECTOR_SIZE;
+}
+
+static int drive_is_busy(const devfs_handle_t * handle){
+	if( m_busy ){
+		m_busy--;
+		return 1;
+	}
+	return 0;
+}
+
+//timer -- the match action runs in fire_timer()
+static mcu_action_t m_timer_action;
+static int m_timer_armed;
+static u32 m_timer_match;
+
+static int tmr_ioctl(const devfs_handle_t * handle, int request, void * ctl){
+	//the request codes are size_t on the host
+	if( request == (int)I_TMR_GET ){
+		*(u32*)ctl = 990;
+	} else if( request == (int)I_TMR_SETCHANNEL ){
+		const mcu_channel_t * channel = ctl;
+		assert(channel->loc == 2);
+		m_timer_match = channel->value;
+	} else if( request == (int)I_TMR_SETACTION ){
+		m_timer_action = *(const mcu_action_t*)ctl;
+		assert(m_timer_action.o_events == MCU_EVENT_FLAG_MATCH);
+		m_timer_armed = 1;
+	}
+	return 0;
+}
+
+static const devfs_device_t m_tmr_device = {
+	.driver = { .ioctl = tmr_ioctl }
+};
+
+static const drive_erase_queue_timer_config_t m_timer = {
+	.device = &m_tmr_device, .interval = 20, .period = 1000, .channel = 2
+};
+
+static int fire_timer(){
+	mcu_event_t event = { .o_events = MCU_EVENT_FLAG_MATCH };
+	if( m_timer_armed == 0 ){ return 0; }
+	m_timer_armed = 0;
+	if( m_timer_action.handler.callback(m_timer_action.handler.context, &event) == 0 ){
+		return 0;
+	}
+	//the handler keeps the action
+	m_timer_armed = 1;
+	return 1;
+}
+
+static int m_complete;
+static u32 m_complete_events;
+
+static int queue_complete(void * context, const mcu_event_t * event){
+	m_complete++;
+	m_complete_events = event->o_events;
+	return 0;
+}
+
+static drive_erase_queue_t m_queue;
+static const devfs_handle_t m_handle;
+
+static void reset(const drive_erase_queue_timer_config_t * timer){
+	mcu_action_t action;
+	memset(&m_queue, 0xaa, sizeof(m_queue));
+	drive_erase_queue_init(&m_queue, &m_handle, drive_erase, drive_is_busy, timer);
+	memset(&action, 0, sizeof(action));
+	action.handler.callback = queue_complete;
+	drive_erase_queue_set_action(&m_queue, &action);
+	m_busy = 0;
+	m_erase_count = 0;
+	m_erase_error = 0;
+	m_timer_armed = 0;
+	m_complete = 0;
+}
+
+static void test_timer(){
+	int ticks = 0;
+
+	reset(&m_timer);
+	assert(drive_erase_queue_is_active(&m_queue) == 0);
+	assert(drive_erase_queue_push(&m_queue, 0, 2*SECTOR_SIZE-1) == 0);
+	assert(drive_erase_queue_push(&m_queue, 8*SECTOR_SIZE, 9*SECTOR_SIZE-1) == 0);
+
+	//the first erase starts from the ioctl -- the timer does the rest
+	assert(drive_erase_queue_service(&m_queue) == 1);
+	assert(m_erase_count == 1);
+	assert(m_timer_armed);
+	assert(m_timer_match == 10);
+
+	while( fire_timer() ){ ticks++; }
+	assert(m_erase_count == 3);
+	assert(m_erase_start[1] == SECTOR_SIZE);
+	assert(m_erase_start[2] == 8*SECTOR_SIZE);
+	assert(m_complete == 1);
+	assert(m_complete_events == MCU_EVENT_FLAG_WRITE_COMPLETE);
+	assert(drive_erase_queue_is_active(&m_queue) == 0);
+	assert(ticks >= 3*ERASE_BUSY_CHECKS);
+	printf("timer ok (%d ticks)\n", ticks);
+}
+
+static void test_read_between_erases(){
+	int i;
+
+	reset(&m_timer);
+	assert(drive_erase_queue_push(&m_queue, 0, 3*SECTOR_SIZE-1) == 0);
+	assert(drive_erase_queue_service(&m_queue) == 1);
+	assert(m_erase_count == 1);
+
+	//the drive is erasing -- the read has to wait but the next erase is held
+	assert(drive_erase_queue_pause(&m_queue) != 0);
+	while( m_busy ){ fire_timer(); }
+	for(i=0; i < DRIVE_ERASE_QUEUE_YIELD_COUNT-1; i++){ fire_timer(); }
+	assert(m_erase_count == 1);
+
+	//the read uses the drive and the timer leaves it alone
+	assert(drive_erase_queue_pause(&m_queue) == 0);
+	for(i=0; i < 10; i++){ assert(fire_timer()); }
+	assert(m_erase_count == 1);
+
+	//the transfer completes and the queue continues
+	drive_erase_queue_resume(&m_queue);
+	assert(m_erase_count == 2);
+	while( fire_timer() ){}
+	assert(m_erase_count == 3);
+	assert(m_complete == 1);
+
+	//the yield is bounded -- the next erase starts even if the read never retries
+	reset(&m_timer);
+	assert(drive_erase_queue_push(&m_queue, 0, 2*SECTOR_SIZE-1) == 0);
+	assert(drive_erase_queue_service(&m_queue) == 1);
+	assert(drive_erase_queue_pause(&m_queue) != 0);
+	while( fire_timer() ){}
+	assert(m_erase_count == 2);
+	assert(m_complete == 1);
+	printf("read between erases ok\n");
+}
+
+static void test_queued_range(){
+	reset(0);
+	assert(drive_erase_queue_push(&m_queue, SECTOR_SIZE, 3*SECTOR_SIZE-1) == 0);
+	assert(drive_erase_queue_is_queued(&m_queue, 0, SECTOR_SIZE-1) == 0);
+	assert(drive_erase_queue_is_queued(&m_queue, SECTOR_SIZE-1, SECTOR_SIZE) == 1);
+	assert(drive_erase_queue_is_queued(&m_queue, 3*SECTOR_SIZE-1, 3*SECTOR_SIZE) == 1);
+	assert(drive_erase_queue_is_queued(&m_queue, 3*SECTOR_SIZE, 4*SECTOR_SIZE) == 0);
+
+	//the part of the range that was erased can be written
+	assert(drive_erase_queue_service(&m_queue) == 1);
+	assert(drive_erase_queue_is_queued(&m_queue, SECTOR_SIZE, 2*SECTOR_SIZE-1) == 0);
+	assert(drive_erase_queue_is_queued(&m_queue, 2*SECTOR_SIZE, 2*SECTOR_SIZE) == 1);
+
+	//without a timer the queue only advances when the driver calls it
+	assert(m_timer_armed == 0);
+	while( drive_erase_queue_service(&m_queue) > 0 ){}
+	assert(m_erase_count == 2);
+	assert(m_complete == 1);
+	printf("queued range ok\n");
+}
+
+static void test_errors(){
+	reset(&m_timer);
+	assert(SYSFS_GET_RETURN_ERRNO(drive_erase_queue_push(&m_queue, 10, 9)) == EINVAL);
+	assert(drive_erase_queue_push(&m_queue, 0, SECTOR_SIZE-1) == 0);
+	m_erase_error = 1;
+	assert(SYSFS_GET_RETURN_ERRNO(drive_erase_queue_service(&m_queue)) == EIO);
+	assert(m_complete == 1);
+	assert(m_complete_events == MCU_EVENT_FLAG_ERROR);
+	assert(drive_erase_queue_is_active(&m_queue) == 0);
+	assert(m_timer_armed == 0);
+
+	//a driver that has not been initialized can't queue erases
+	memset(&m_queue, 0, sizeof(m_queue));
+	assert(SYSFS_GET_RETURN_ERRNO(drive_erase_queue_push(&m_queue, 0, SECTOR_SIZE-1)) == EIO);
+	printf("errors ok\n");
+}
+
+int main(){
+	test_timer();
+	test_read_between_erases();
+	test_queued_range();
+	test_errors();
+	return 0;
+}
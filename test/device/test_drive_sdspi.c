@@ -0,0 +1,337 @@
+/* Host tests for src/device/drive_sdspi.c against a simulated SD card
+ *
+ * The card answers one byte for every byte the driver clocks. Asynchronous
+ * SPI transfers complete when the test runs the "interrupt", so the test can
+ * check how much SPI traffic the driver generates in each interrupt.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include "mcu/spi.h"
+#include "mcu/pio.h"
+#include "mcu/crc.h"
+#include "mcu/wdt.h"
+#include "cortexm/task.h"
+#include "device/drive_sdspi.h"
+#include "../../src/device/drive_sdspi_local.h"
+
+#define BLOCK_SIZE 512
+#define BLOCK_COUNT 8
+#define CARD_BUSY_BYTES 300
+
+enum {
+	CARD_IDLE,
+	CARD_COMMAND,
+	CARD_READ,
+	CARD_WRITE_TOKEN,
+	CARD_WRITE_DATA
+};
+
+typedef struct {
+	int state;
+	u8 command[6];
+	int command_count;
+	u8 out[BLOCK_SIZE+64];
+	int out_head;
+	int out_count;
+	int busy;
+	int multiple;
+	u32 block;
+	int data_count;
+	u8 data[BLOCK_SIZE+2];
+	u8 memory[BLOCK_COUNT][BLOCK_SIZE];
+	int stop_count;
+	int stuck;
+} card_t;
+
+static card_t m_card;
+
+static u16 crc16(const u8 * buffer, u32 nbyte){
+	u16 crc = 0;
+	u32 i;
+	int j;
+	for(i=0; i < nbyte; i++){
+		crc ^= (u16)buffer[i] << 8;
+		for(j=0; j < 8; j++){
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+		}
+	}
+	return crc;
+}
+
+u16 mcu_calc_crc16(u16 seed, u16 polynomial, const u8 * buffer, u32 nbyte){ return crc16(buffer, nbyte); }
+u8 mcu_calc_crc7(u8 seed, u8 polynomial, const u8 * chr, u32 len){ return 0x95; }
+
+static void card_push(u8 value){
+	m_card.out[(m_card.out_head + m_card.out_count) % sizeof(m_card.out)] = value;
+	m_card.out_count++;
+}
+
+static void card_queue_block(){
+	u16 crc;
+	int i;
+	for(i=0; i < 20; i++){ card_push(0xFF); } //access time
+	card_push(SDSPI_START_BLOCK_TOKEN);
+	for(i=0; i < BLOCK_SIZE; i++){ card_push(m_card.memory[m_card.block][i]); }
+	crc = crc16(m_card.memory[m_card.block], BLOCK_SIZE);
+	card_push(crc >> 8);
+	card_push(crc);
+	m_card.block++;
+}
+
+static void card_execute(){
+	u8 cmd = m_card.command[0] & 0x3F;
+	u32 arg = (m_card.command[1] << 24) | (m_card.command[2] << 16) | (m_card.command[3] << 8) | m_card.command[4];
+
+	m_card.out_count = 0;
+	m_card.state = CARD_IDLE;
+	card_push(0xFF);
+	card_push(0x00); //R1
+
+	switch(cmd){
+		case SDSPI_CMD17_READ_SINGLE_BLOCK:
+		case SDSPI_CMD18_READ_MULTIPLE_BLOCK:
+			m_card.block = arg;
+			m_card.multiple = (cmd == SDSPI_CMD18_READ_MULTIPLE_BLOCK);
+			m_card.state = CARD_READ;
+			card_queue_block();
+			break;
+		case SDSPI_CMD24_WRITE_SINGLE_BLOCK:
+		case SDSPI_CMD25_WRITE_MULTIPLE_BLOCK:
+			m_card.block = arg;
+			m_card.multiple = (cmd == SDSPI_CMD25_WRITE_MULTIPLE_BLOCK);
+			m_card.state = CARD_WRITE_TOKEN;
+			break;
+		case SDSPI_CMD12_STOP_TRANSMISSION:
+			m_card.stop_count++;
+			m_card.busy = CARD_BUSY_BYTES;
+			break;
+	}
+}
+
+static u8 card_swap(u8 value){
+	u8 result = 0xFF;
+
+	if( m_card.out_count ){
+		result = m_card.out[m_card.out_head];
+		m_card.out_head = (m_card.out_head + 1) % sizeof(m_card.out);
+		m_card.out_count--;
+	} else if( m_card.busy ){
+		if( m_card.stuck == 0 ){
+			m_card.busy--;
+		}
+		result = 0x00;
+	}
+
+	switch(m_card.state){
+		case CARD_IDLE:
+		case CARD_READ:
+			if( (value & 0xC0) == 0x40 ){
+				m_card.command[0] = value;
+				m_card.command_count = 1;
+				m_card.state = CARD_COMMAND;
+			} else if( (m_card.state == CARD_READ) && (m_card.out_count == 0) && m_card.multiple ){
+				card_queue_block();
+			}
+			break;
+		case CARD_COMMAND:
+			m_card.command[m_card.command_count++] = value;
+			if( m_card.command_count == 6 ){
+				card_execute();
+			}
+			break;
+		case CARD_WRITE_TOKEN:
+			if( m_card.busy ){
+				break;
+			}
+			if( (value == SDSPI_START_BLOCK_TOKEN) || (value == SDSPI_START_BLOCK_WRITE_MULTIPLE_TOKEN) ){
+				m_card.state = CARD_WRITE_DATA;
+				m_card.data_count = 0;
+			} else if( value == SDSPI_STOP_TRAN_TOKEN ){
+				m_card.stop_count++;
+				m_card.busy = CARD_BUSY_BYTES;
+				m_card.state = CARD_IDLE;
+			}
+			break;
+		case CARD_WRITE_DATA:
+			m_card.data[m_card.data_count++] = value;
+			if( m_card.data_count == BLOCK_SIZE + 2 ){
+				u16 crc = (m_card.data[BLOCK_SIZE] << 8) | m_card.data[BLOCK_SIZE+1];
+				card_push(crc == crc16(m_card.data, BLOCK_SIZE) ? 0x05 : 0x0B);
+				memcpy(m_card.memory[m_card.block++], m_card.data, BLOCK_SIZE);
+				m_card.busy = CARD_BUSY_BYTES;
+				m_card.state = m_card.multiple ? CARD_WRITE_TOKEN : CARD_IDLE;
+			}
+			break;
+	}
+	return result;
+}
+
+//SPI driver -- asynchronous transfers complete in run_interrupts()
+static devfs_async_t * m_spi_pending;
+static int m_spi_pending_is_read;
+static int m_swap_count;
+
+int mcu_spi_open(const devfs_handle_t * handle){ return 0; }
+int mcu_spi_close(const devfs_handle_t * handle){ return 0; }
+int mcu_spi_ioctl(const devfs_handle_t * handle, int request, void * ctl){ return 0; }
+int mcu_spi_setattr(const devfs_handle_t * handle, void * ctl){ return 0; }
+
+int mcu_spi_swap(const devfs_handle_t * handle, void * ctl){
+	m_swap_count++;
+	return card_swap((u8)(ssize_t)ctl);
+}
+
+int mcu_spi_read(const devfs_handle_t * handle, devfs_async_t * async){
+	assert(m_spi_pending == 0);
+	m_spi_pending = async;
+	m_spi_pending_is_read = 1;
+	return 0;
+}
+
+int mcu_spi_write(const devfs_handle_t * handle, devfs_async_t * async){
+	assert(m_spi_pending == 0);
+	m_spi_pending = async;
+	m_spi_pending_is_read = 0;
+	return 0;
+}
+
+int mcu_pio_setmask(const devfs_handle_t * handle, void * ctl){ return 0; }
+int mcu_pio_clrmask(const devfs_handle_t * handle, void * ctl){ return 0; }
+int mcu_pio_setattr(const devfs_handle_t * handle, void * ctl){ return 0; }
+void mcu_wdt_root_reset(void * args){}
+void cortexm_delay_us(u32 us){}
+void cortexm_delay_ms(u32 ms){}
+
+static struct _reent m_reent;
+volatile task_t sos_task_table[1] = { { .reent = &m_reent } };
+
+//returns the number of interrupts it took to finish
+static int run_interrupts(int * max_swaps){
+	int count = 0;
+	int i;
+	*max_swaps = 0;
+	while( m_spi_pending ){
+		devfs_async_t * async = m_spi_pending;
+		u8 * buf = async->buf;
+		m_spi_pending = 0;
+		for(i=0; i < async->nbyte; i++){
+			if( m_spi_pending_is_read ){
+				buf[i] = card_swap(0xFF);
+			} else {
+				card_swap(((const u8*)async->buf_const)[i]);
+			}
+		}
+
+		m_swap_count = 0;
+		async->handler.callback(async->handler.context, 0);
+		if( m_swap_count > *max_swaps ){
+			*max_swaps = m_swap_count;
+		}
+		count++;
+		assert(count < 100000);
+	}
+	return count;
+}
+
+static drive_sdspi_state_t m_state;
+static const drive_sdspi_config_t m_config = { .spi_config_size = sizeof(spi_config_t) };
+static const devfs_handle_t m_handle = { .config = &m_config, .state = &m_state };
+
+static int m_nbyte;
+static int m_complete;
+
+static int transfer_complete(void * context, const mcu_event_t * event){
+	m_complete++;
+	return 0;
+}
+
+static void start(devfs_async_t * async, void * buf, int loc, int nbyte){
+	memset(async, 0, sizeof(devfs_async_t));
+	async->buf = buf;
+	async->loc = loc;
+	async->nbyte = nbyte;
+	async->handler.callback = transfer_complete;
+	m_complete = 0;
+}
+
+static void test_write_read(){
+	devfs_async_t async;
+	char out[BLOCK_SIZE*3];
+	char in[BLOCK_SIZE*3];
+	int interrupts;
+	int max_swaps;
+	int i;
+
+	memset(&m_card, 0, sizeof(m_card));
+	memset(&m_state, 0, sizeof(m_state));
+	for(i=0; i < (int)sizeof(out); i++){ out[i] = i*7 + 3; }
+
+	//multi-block write -- every busy period is polled from the interrupt, one frame at a time
+	start(&async, out, 2, sizeof(out));
+	assert(drive_sdspi_write(&m_handle, &async) == 0);
+	interrupts = run_interrupts(&max_swaps);
+	assert(m_complete == 1);
+	assert(async.nbyte == (int)sizeof(out));
+	assert(m_card.stop_count == 1);
+	assert(memcmp(m_card.memory[2], out, sizeof(out)) == 0);
+	//each block and the stop token have a busy period that takes several interrupts
+	assert(interrupts > 4*(CARD_BUSY_BYTES/16));
+	//no interrupt spins on the busy signal
+	assert(max_swaps < 16);
+	printf("multi-block write ok (%d interrupts, %d swaps max)\n", interrupts, max_swaps);
+
+	//wait for the card to finish
+	while( m_card.busy ){ card_swap(0xFF); }
+
+	//multi-block read stops with CMD12 and waits for busy in the interrupt too
+	start(&async, in, 2, sizeof(in));
+	assert(drive_sdspi_read(&m_handle, &async) == 0);
+	interrupts = run_interrupts(&max_swaps);
+	assert(m_complete == 1);
+	assert(async.nbyte == (int)sizeof(in));
+	assert(memcmp(in, out, sizeof(in)) == 0);
+	assert(m_card.stop_count == 2);
+	assert(max_swaps < 32);
+	printf("multi-block read ok (%d interrupts, %d swaps max)\n", interrupts, max_swaps);
+
+	//single block
+	while( m_card.busy ){ card_swap(0xFF); }
+	start(&async, in, 3, BLOCK_SIZE);
+	assert(drive_sdspi_read(&m_handle, &async) == 0);
+	run_interrupts(&max_swaps);
+	assert(m_complete == 1);
+	assert(async.nbyte == BLOCK_SIZE);
+	assert(memcmp(in, out + BLOCK_SIZE, BLOCK_SIZE) == 0);
+	printf("single-block read ok\n");
+}
+
+static void test_busy_timeout(){
+	devfs_async_t async;
+	char out[BLOCK_SIZE*2];
+	int max_swaps;
+
+	memset(&m_card, 0, sizeof(m_card));
+	memset(&m_state, 0, sizeof(m_state));
+	memset(out, 0x5A, sizeof(out));
+
+	//the card never finishes programming the first block
+	m_card.stuck = 1;
+	start(&async, out, 0, sizeof(out));
+	assert(drive_sdspi_write(&m_handle, &async) == 0);
+	run_interrupts(&max_swaps);
+	assert(m_complete == 1);
+	assert(async.nbyte < 0);
+	assert(m_reent._errno == EIO);
+	assert(max_swaps < 16);
+	printf("busy timeout ok\n");
+}
+
+int main(){
+	test_write_read();
+	test_busy_timeout();
+	return 0;
+}
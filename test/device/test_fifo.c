@@ -0,0 +1,145 @@
+/* Host tests for the fifo driver in src/device/fifo.c */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+
+#include "device/fifo.h"
+
+static char m_buffer[16];
+static fifo_state_t m_state;
+static const fifo_config_t m_config = { .size = sizeof(m_buffer), .buffer = m_buffer };
+static const devfs_handle_t m_handle = { .config = &m_config, .state = &m_state };
+
+static int m_read_complete;
+static int m_write_complete;
+
+static int read_complete(void * context, const mcu_event_t * event){
+	m_read_complete++;
+	return 0;
+}
+
+static int write_complete(void * context, const mcu_event_t * event){
+	m_write_complete++;
+	return 0;
+}
+
+static void reset(){
+	memset(&m_state, 0, sizeof(m_state));
+	fifo_open(&m_handle);
+	fifo_ioctl(&m_handle, I_FIFO_INIT, 0);
+	m_read_complete = 0;
+	m_write_complete = 0;
+}
+
+static void test_vector(){
+	devfs_async_t async;
+	char a[4], b[6], c[8];
+	struct iovec iov[3];
+
+	reset();
+	memset(&async, 0, sizeof(async));
+
+	//nothing to read -- devfs falls back to a blocking read
+	iov[0].iov_base = a; iov[0].iov_len = sizeof(a);
+	assert(fifo_readv(&m_handle, &async, iov, 1) == 0);
+
+	//gather write fills the FIFO in order
+	iov[0].iov_base = "abc"; iov[0].iov_len = 3;
+	iov[1].iov_base = ""; iov[1].iov_len = 0;
+	iov[2].iov_base = "defghij"; iov[2].iov_len = 7;
+	assert(fifo_writev(&m_handle, &async, iov, 3) == 10);
+
+	//scatter read fills each buffer before the next one and stops when the FIFO is empty
+	iov[0].iov_base = a; iov[0].iov_len = sizeof(a);
+	iov[1].iov_base = b; iov[1].iov_len = sizeof(b);
+	iov[2].iov_base = c; iov[2].iov_len = sizeof(c);
+	assert(fifo_readv(&m_handle, &async, iov, 3) == 10);
+	assert(memcmp(a, "abcd", 4) == 0);
+	assert(memcmp(b, "efghij", 6) == 0);
+
+	//partial write when the FIFO fills (write block is on)
+	fifo_set_writeblock(&m_state, 1);
+	iov[0].iov_base = "0123456789"; iov[0].iov_len = 10;
+	iov[1].iov_base = "0123456789"; iov[1].iov_len = 10;
+	assert(fifo_writev(&m_handle, &async, iov, 2) == 16);
+	assert(fifo_writev(&m_handle, &async, iov, 2) == 0);
+
+	//a pending read gets the data first
+	reset();
+	devfs_async_t pending;
+	memset(&pending, 0, sizeof(pending));
+	pending.buf = c; pending.nbyte = 4;
+	pending.handler.callback = read_complete;
+	assert(fifo_read(&m_handle, &pending) == 0);
+	iov[0].iov_base = a; iov[0].iov_len = sizeof(a);
+	assert(fifo_readv(&m_handle, &async, iov, 1) == 0);
+	iov[0].iov_base = "wxyz"; iov[0].iov_len = 4;
+	assert(fifo_writev(&m_handle, &async, iov, 1) == 4);
+	assert(m_read_complete == 1);
+	assert(memcmp(c, "wxyz", 4) == 0);
+
+	printf("vector ok\n");
+}
+
+static void test_try(){
+	devfs_async_t async;
+	devfs_async_t pending;
+	char a[8], b[4];
+
+	reset();
+	memset(&async, 0, sizeof(async));
+
+	//nothing to read -- the kernel uses fifo_read() and no callback is registered
+	async.buf = a; async.nbyte = sizeof(a);
+	assert(fifo_try_read(&m_handle, &async) == 0);
+	assert(m_state.transfer_handler.read == 0);
+
+	async.buf_const = "abcdef"; async.nbyte = 6;
+	assert(fifo_try_write(&m_handle, &async) == 6);
+	async.buf = a; async.nbyte = sizeof(a);
+	assert(fifo_try_read(&m_handle, &async) == 6);
+	assert(memcmp(a, "abcdef", 6) == 0);
+
+	//the FIFO is full (write block is on) -- the kernel uses fifo_write()
+	fifo_set_writeblock(&m_state, 1);
+	async.buf_const = "0123456789abcdef"; async.nbyte = 16;
+	assert(fifo_try_write(&m_handle, &async) == 16);
+	assert(fifo_try_write(&m_handle, &async) == 0);
+	assert(m_state.transfer_handler.write == 0);
+
+	//a blocked write gets the space a try read makes
+	memset(&pending, 0, sizeof(pending));
+	pending.buf_const = "wxyz"; pending.nbyte = 4;
+	pending.handler.callback = write_complete;
+	assert(fifo_write(&m_handle, &pending) == 0);
+	async.buf = b; async.nbyte = sizeof(b);
+	assert(fifo_try_read(&m_handle, &async) == 4);
+	assert(m_write_complete == 1);
+
+	//a blocked read gets the data first
+	reset();
+	memset(&pending, 0, sizeof(pending));
+	pending.buf = b; pending.nbyte = sizeof(b);
+	pending.handler.callback = read_complete;
+	assert(fifo_read(&m_handle, &pending) == 0);
+	async.buf_const = "abcd"; async.nbyte = 4;
+	assert(fifo_try_write(&m_handle, &async) == 4);
+	assert(m_read_complete == 1 && memcmp(b, "abcd", 4) == 0);
+	async.buf_const = "efgh"; async.nbyte = 4;
+	assert(fifo_try_write(&m_handle, &async) == 4);
+	assert(fifo_read(&m_handle, &pending) == 4);
+	assert(fifo_read(&m_handle, &pending) == 0);
+	async.buf = a; async.nbyte = sizeof(a);
+	assert(fifo_try_read(&m_handle, &async) == 0);
+
+	printf("try ok\n");
+}
+
+int main(){
+	test_vector();
+	test_try();
+	return 0;
+}
@@ -0,0 +1,247 @@
+/* Host tests for the zero-copy switchboard connections in
+ * src/device/switchboard.c and the frame lending in src/device/ffifo.c
+ *
+ * The fake device starts a transfer and keeps it pending until the
+ * test completes it with complete_read() or complete_write(), the way
+ * the driver's interrupt would. The test sets the cycle count the
+ * switchboard uses to measure latency.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "cortexm/task.h"
+#include "device/ffifo.h"
+#include "device/switchboard.h"
+
+#define FRAME_COUNT 4
+#define FRAME_SIZE 8
+
+volatile int m_task_current;
+volatile task_t sos_task_table[1];
+
+static u64 m_cycles;
+u64 task_root_get_cycles(){ return m_cycles; }
+
+int mcu_execute_event_handler(mcu_event_handler_t * handler, u32 o_events, void * data){
+	int result = devfs_execute_event_handler(handler, o_events, data);
+	handler->callback = 0;
+	return result;
+}
+
+typedef struct {
+	devfs_async_t * read;
+	devfs_async_t * write;
+	char last[FRAME_SIZE];
+	int write_count;
+} fake_state_t;
+
+static int fake_open(const devfs_handle_t * handle){ return 0; }
+static int fake_close(const devfs_handle_t * handle){ return 0; }
+static int fake_ioctl(const devfs_handle_t * handle, int request, void * ctl){ return SYSFS_SET_RETURN(EINVAL); }
+static int fake_read(const devfs_handle_t * handle, devfs_async_t * async){
+	((fake_state_t*)handle->state)->read = async;
+	return 0;
+}
+static int fake_write(const devfs_handle_t * handle, devfs_async_t * async){
+	((fake_state_t*)handle->state)->write = async;
+	return 0;
+}
+
+FFIFO_DECLARE_CONFIG_STATE(m_ffifo, FRAME_COUNT, FRAME_SIZE);
+static fake_state_t m_fake;
+
+static const devfs_device_t m_devices[] = {
+	DEVFS_DEVICE("ffifo0", ffifo, 0, &m_ffifo_config, &m_ffifo_state, 0666, 0, S_IFCHR),
+	DEVFS_DEVICE("usb0", fake, 0, 0, &m_fake, 0666, 0, S_IFCHR),
+	DEVFS_TERMINATOR
+};
+
+const devfs_device_t * devfs_lookup_device(const devfs_device_t * list, const char * device_name){
+	int i;
+	for(i=0; !devfs_is_terminator(list + i); i++){
+		if( strcmp(list[i].name, device_name) == 0 ){ return list + i; }
+	}
+	return 0;
+}
+
+int devfs_lookup_name(const devfs_device_t * list, const devfs_device_t * device, char name[NAME_MAX]){
+	strcpy(name, device->name);
+	return 0;
+}
+
+SWITCHBOARD_DECLARE_CONFIG_STATE(m_switchboard, m_devices, 2, 32, 100);
+static const devfs_handle_t m_handle = { .config = &m_switchboard_config, .state = m_switchboard_state };
+static const devfs_handle_t * m_ffifo = &m_devices[0].handle;
+
+static void complete_write(){
+	devfs_async_t * async = m_fake.write;
+	assert(async != 0);
+	m_fake.write = 0;
+	memcpy(m_fake.last, async->buf, FRAME_SIZE);
+	m_fake.write_count++;
+	devfs_execute_event_handler(&async->handler, MCU_EVENT_FLAG_WRITE_COMPLETE, 0);
+}
+
+static void complete_read(char value){
+	devfs_async_t * async = m_fake.read;
+	assert(async != 0);
+	m_fake.read = 0;
+	memset(async->buf, value, async->nbyte);
+	devfs_execute_event_handler(&async->handler, MCU_EVENT_FLAG_DATA_READY, 0);
+}
+
+static int is_ffifo_frame(const void * buf){
+	return ((const char*)buf >= m_ffifo_buffer) && ((const char*)buf < m_ffifo_buffer + sizeof(m_ffifo_buffer));
+}
+
+static int write_frame(char value){
+	char frame[FRAME_SIZE];
+	devfs_async_t async;
+	memset(frame, value, FRAME_SIZE);
+	memset(&async, 0, sizeof(async));
+	async.buf = frame;
+	async.nbyte = FRAME_SIZE;
+	async.flags = O_NONBLOCK;
+	return ffifo_write_local(&m_ffifo_config, &m_ffifo_state, &async, 1);
+}
+
+static int read_frame(char * frame){
+	devfs_async_t async;
+	memset(&async, 0, sizeof(async));
+	async.buf = frame;
+	async.nbyte = FRAME_SIZE;
+	async.flags = O_NONBLOCK;
+	return ffifo_read_local(&m_ffifo_config, &m_ffifo_state, &async, 1);
+}
+
+static void reset(u32 o_flags){
+	ffifo_attr_t attr;
+	memset(&m_fake, 0, sizeof(m_fake));
+	ffifo_ioctl(m_ffifo, I_FFIFO_INIT, 0);
+	memset(&attr, 0, sizeof(attr));
+	attr.o_flags = o_flags;
+	ffifo_ioctl(m_ffifo, I_FFIFO_SETATTR, &attr);
+}
+
+static int connect(const char * input, const char * output, int nbyte){
+	switchboard_attr_t attr;
+	memset(&attr, 0, sizeof(attr));
+	strcpy(attr.input.name, input);
+	strcpy(attr.output.name, output);
+	attr.o_flags = SWITCHBOARD_FLAG_CONNECT | SWITCHBOARD_FLAG_IS_PERSISTENT;
+	attr.nbyte = nbyte;
+	return switchboard_ioctl(&m_handle, I_SWITCHBOARD_SETATTR, &attr);
+}
+
+static void disconnect(){
+	switchboard_attr_t attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.o_flags = SWITCHBOARD_FLAG_DISCONNECT;
+	switchboard_ioctl(&m_handle, I_SWITCHBOARD_SETATTR, &attr);
+}
+
+static int read_status(void * status, int nbyte, int id){
+	devfs_async_t async;
+	memset(&async, 0, sizeof(async));
+	async.buf = status;
+	async.nbyte = nbyte;
+	async.loc = id*nbyte;
+	return switchboard_read(&m_handle, &async);
+}
+
+static void test_zero_copy_input(){
+	switchboard_status_t status;
+	char value;
+
+	//ffifo0 -> usb0 -- usb0 is written directly from the ffifo frames
+	reset(FIFO_FLAG_IS_OVERFLOW);
+	assert(connect("ffifo0", "usb0", FRAME_SIZE) == 0);
+	assert(m_switchboard_state[0].o_flags & SWITCHBOARD_FLAG_IS_ZERO_COPY_INPUT);
+
+	m_cycles = 100;
+	assert(write_frame('a') == FRAME_SIZE);
+	assert(m_fake.write && is_ffifo_frame(m_fake.write->buf));
+
+	//the ffifo fills up -- an overflowing write can't overwrite the lent frame
+	for(value = 'b'; value <= 'e'; value++){ write_frame(value); }
+	assert(((char*)m_fake.write->buf)[0] == 'a');
+
+	m_cycles = 350;
+	complete_write();
+	assert(m_fake.last[0] == 'a' && ((char*)m_fake.write->buf)[0] == 'b');
+	m_cycles = 400; complete_write();
+	m_cycles = 450; complete_write();
+	m_cycles = 500; complete_write();
+	assert(m_fake.write == 0 && m_fake.write_count == 4);
+
+	//the ffifo is empty -- the switchboard waits for a frame
+	assert(read_status(&status, sizeof(status), 0) == sizeof(status));
+	assert(status.transaction_count == 4 && status.max_latency_cycles == 250);
+	assert(write_frame('f') == FRAME_SIZE);
+	assert(m_fake.write && ((char*)m_fake.write->buf)[0] == 'f');
+
+	//the lent frame is released when the connection goes away
+	disconnect();
+	complete_write();
+	assert(m_switchboard_state[0].o_flags == 0);
+	assert((m_ffifo_state.o_flags & FIFO_FLAG_IS_READ_LENT) == 0);
+	printf("zero copy input ok\n");
+}
+
+static void test_zero_copy_output(){
+	char frame[FRAME_SIZE];
+
+	//usb0 -> ffifo0 -- usb0 is read directly into the ffifo frames
+	reset(FIFO_FLAG_SET_WRITEBLOCK);
+	assert(connect("usb0", "ffifo0", FRAME_SIZE) == 0);
+	assert(m_switchboard_state[0].o_flags & SWITCHBOARD_FLAG_IS_ZERO_COPY_OUTPUT);
+	assert(m_fake.read && is_ffifo_frame(m_fake.read->buf));
+	complete_read('x');
+	complete_read('y');
+	complete_read('z');
+	complete_read('w');
+
+	//the ffifo is full -- the switchboard waits for space
+	assert(m_fake.read == 0);
+	assert(m_ffifo_state.poll_handler.handler.callback != 0);
+	assert(read_frame(frame) == FRAME_SIZE && frame[0] == 'x');
+	assert(m_fake.read != 0);
+
+	disconnect();
+	complete_read('q');
+	assert((m_ffifo_state.o_flags & FIFO_FLAG_IS_WRITE_LENT) == 0);
+	printf("zero copy output ok\n");
+}
+
+static void test_copy(){
+	switchboard_status_t status;
+	switchboard_connection_t connection;
+
+	//a packet size that doesn't match the frames uses the connection buffers
+	reset(0);
+	assert(connect("usb0", "ffifo0", 2*FRAME_SIZE) == 0);
+	assert((m_switchboard_state[0].o_flags & (SWITCHBOARD_FLAG_IS_ZERO_COPY_INPUT | SWITCHBOARD_FLAG_IS_ZERO_COPY_OUTPUT)) == 0);
+	assert(m_fake.read && !is_ffifo_frame(m_fake.read->buf));
+
+	//the status without the counters is still supported
+	assert(read_status(&connection, sizeof(connection), 0) == sizeof(connection));
+	assert(read_status(&status, sizeof(status), 0) == sizeof(status));
+	assert(connection.o_flags == status.o_flags && connection.nbyte == 2*FRAME_SIZE);
+	assert(read_status(&connection, sizeof(connection), 1) == sizeof(connection) && connection.id == 1);
+	assert(SYSFS_GET_RETURN_ERRNO(read_status(&status, sizeof(status) - 1, 0)) == EINVAL);
+	disconnect();
+	printf("copy ok\n");
+}
+
+int main(){
+	test_zero_copy_input();
+	test_zero_copy_output();
+	test_copy();
+	return 0;
+}
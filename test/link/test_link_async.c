@@ -0,0 +1,241 @@
+/* Loopback benchmark for src/link/link_async.c
+ *
+ * The device is a thread on the other end of a pair of pipes. It runs
+ * the LINK2 slave transport and serves LINK_CMD_LSEEK, LINK_CMD_READ and
+ * LINK_CMD_IOCTL from a memory file. Every command waits a fixed time
+ * like a USB round trip. The benchmark reads the same 512 byte blocks
+ * with queued async requests (adjacent reads are merged up to 16KB) and
+ * with one link_lseek() plus link_read() per block.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "sos/link.h"
+
+#define FILE_SIZE (40*1024)
+#define BLOCK_SIZE 512
+#define BLOCK_COUNT (FILE_SIZE/BLOCK_SIZE)
+#define MERGE_MAX (16*1024)
+#define COMMAND_LATENCY_US 500
+#define DEVICE_FILDES 3
+
+typedef struct {
+	int read_fd;
+	int write_fd;
+} pipe_phy_t;
+
+static pipe_phy_t m_host;
+static pipe_phy_t m_device;
+static u8 m_file[FILE_SIZE];
+static volatile int m_command_count;
+static volatile int m_read_count;
+
+static int read_pipe(int fd, void * buf, int nbyte, int timeout){
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	int result;
+	if( poll(&pfd, 1, timeout) <= 0 ){ return 0; }
+	result = read(fd, buf, nbyte);
+	return result < 0 ? -1 : result;
+}
+
+//the handle points to a pipe_phy_t on both sides
+static int phy_read(link_transport_phy_t handle, void * buf, int nbyte){ return read_pipe(((pipe_phy_t*)handle)->read_fd, buf, nbyte, 1); }
+static int phy_write(link_transport_phy_t handle, const void * buf, int nbyte){ return write(((pipe_phy_t*)handle)->write_fd, buf, nbyte); }
+static int phy_close(link_transport_phy_t * handle){ *handle = LINK_PHY_OPEN_ERROR; return 0; }
+static void phy_wait(int msec){ usleep(msec*1000); }
+static void phy_flush(link_transport_phy_t handle){
+	char buf[256];
+	while( read_pipe(((pipe_phy_t*)handle)->read_fd, buf, sizeof(buf), 0) > 0 ){}
+}
+
+//device side
+static int m_offset;
+
+static int read_file(void * context, void * buf, int nbyte){
+	int available = FILE_SIZE - m_offset;
+	if( available < 0 ){ available = 0; }
+	if( nbyte > available ){ nbyte = available; }
+	memcpy(buf, m_file + m_offset, nbyte);
+	m_offset += nbyte;
+	return nbyte;
+}
+
+static void * device_thread(void * args){
+	link_transport_driver_t driver = {
+		.handle = &m_device,
+		.read = phy_read,
+		.write = phy_write,
+		.flush = phy_flush,
+		.wait = phy_wait,
+		.timeout = 100,
+		.o_flags = LINK2_FLAG_IS_CHECKSUM
+	};
+	link_op_t op;
+	link_reply_t reply;
+	struct pollfd pfd = { .fd = m_device.read_fd, .events = POLLIN };
+
+	for(;;){
+		if( poll(&pfd, 1, -1) <= 0 ){ continue; }
+		if( link2_transport_slaveread(&driver, &op, sizeof(op), 0, 0) <= 0 ){ continue; }
+
+		usleep(COMMAND_LATENCY_US);
+		m_command_count++;
+		reply.err_number = 0;
+		switch(op.cmd){
+			case LINK_CMD_LSEEK:
+				assert(op.lseek.whence == LINK_SEEK_SET);
+				m_offset = op.lseek.offset;
+				reply.err = m_offset;
+				break;
+			case LINK_CMD_READ:
+				assert(op.read.fildes == DEVICE_FILDES);
+				assert(op.read.nbyte <= MERGE_MAX);
+				m_read_count++;
+				reply.err = link2_transport_slavewrite(&driver, 0, op.read.nbyte, read_file, 0);
+				break;
+			case LINK_CMD_IOCTL:
+				reply.err = op.ioctl.request;
+				break;
+			default:
+				reply.err = -1;
+				reply.err_number = 22;
+				break;
+		}
+		link2_transport_slavewrite(&driver, &reply, sizeof(reply), 0, 0);
+	}
+	return 0;
+}
+
+static int elapsed_us(const struct timespec * start){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec)*1000000 + (now.tv_nsec - start->tv_nsec)/1000;
+}
+
+static void check_block(const u8 * buf, int block, int nbyte){
+	assert(memcmp(buf, m_file + block*BLOCK_SIZE, nbyte) == 0);
+}
+
+static int m_callback_count;
+
+static void read_complete(link_async_request_t * request, void * context){
+	m_callback_count++;
+}
+
+static void benchmark(link_transport_mdriver_t * driver){
+	static u8 buf[BLOCK_COUNT][BLOCK_SIZE];
+	link_async_request_t request[BLOCK_COUNT+1];
+	link_async_t async;
+	struct timespec start;
+	int async_us;
+	int async_commands;
+	int async_reads;
+	int sequential_us;
+	int sequential_commands;
+	int i;
+
+	//queued -- adjacent reads go out as one lseek plus read of up to 16KB
+	memset(buf, 0, sizeof(buf));
+	m_callback_count = 0;
+	m_command_count = 0;
+	m_read_count = 0;
+	assert(link_async_start(&async, driver) == 0);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i=0; i < BLOCK_COUNT; i++){
+		assert(link_async_read(&async, request + i, DEVICE_FILDES, i*BLOCK_SIZE, buf[i], BLOCK_SIZE, read_complete, 0) == 0);
+	}
+	//an ioctl ends the run of reads
+	assert(link_async_ioctl(&async, request + BLOCK_COUNT, DEVICE_FILDES, 77, 0, 0, 0) == 0);
+	for(i=0; i < BLOCK_COUNT; i++){
+		assert(link_async_wait(&async, request + i) == BLOCK_SIZE);
+		check_block(buf[i], i, BLOCK_SIZE);
+	}
+	assert(link_async_wait(&async, request + BLOCK_COUNT) == 77);
+	async_us = elapsed_us(&start);
+	async_commands = m_command_count;
+	async_reads = m_read_count;
+	link_async_stop(&async);
+	assert(m_callback_count == BLOCK_COUNT);
+
+	//one request at a time
+	memset(buf, 0, sizeof(buf));
+	m_command_count = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i=0; i < BLOCK_COUNT; i++){
+		assert(link_lseek(driver, DEVICE_FILDES, i*BLOCK_SIZE, LINK_SEEK_SET) == i*BLOCK_SIZE);
+		assert(link_read(driver, DEVICE_FILDES, buf[i], BLOCK_SIZE) == BLOCK_SIZE);
+		check_block(buf[i], i, BLOCK_SIZE);
+	}
+	sequential_us = elapsed_us(&start);
+	sequential_commands = m_command_count;
+
+	printf("%d reads of %d bytes: queued %d commands (%d reads) in %d us, sequential %d commands in %d us\n",
+			 BLOCK_COUNT, BLOCK_SIZE,
+			 async_commands, async_reads, async_us,
+			 sequential_commands, sequential_us);
+
+	assert(sequential_commands == 2*BLOCK_COUNT);
+	//at least FILE_SIZE/MERGE_MAX reads -- the first request can go out before the rest are queued
+	assert(async_reads >= (FILE_SIZE + MERGE_MAX - 1)/MERGE_MAX);
+	assert(async_commands < sequential_commands/4);
+}
+
+static void test_short_read(link_transport_mdriver_t * driver){
+	u8 buf[4][BLOCK_SIZE];
+	link_async_request_t request[4];
+	link_async_t async;
+	int i;
+
+	//the last block and a half are past the end of the file
+	assert(link_async_start(&async, driver) == 0);
+	for(i=0; i < 4; i++){
+		assert(link_async_read(&async, request + i, DEVICE_FILDES, FILE_SIZE - 2*BLOCK_SIZE - BLOCK_SIZE/2 + i*BLOCK_SIZE, buf[i], BLOCK_SIZE, 0, 0) == 0);
+	}
+	assert(link_async_wait(&async, request + 0) == BLOCK_SIZE);
+	assert(link_async_wait(&async, request + 1) == BLOCK_SIZE);
+	assert(link_async_wait(&async, request + 2) == BLOCK_SIZE/2);
+	assert(link_async_wait(&async, request + 3) == 0);
+	assert(memcmp(buf[2], m_file + FILE_SIZE - BLOCK_SIZE/2, BLOCK_SIZE/2) == 0);
+	link_async_stop(&async);
+	printf("short read ok\n");
+}
+
+int main(){
+	link_transport_mdriver_t driver;
+	pthread_t thread;
+	int fd[2];
+	int i;
+
+	for(i=0; i < FILE_SIZE; i++){ m_file[i] = i*13 + (i >> 9); }
+
+	assert(pipe(fd) == 0);
+	m_host.read_fd = fd[0];
+	m_device.write_fd = fd[1];
+	assert(pipe(fd) == 0);
+	m_device.read_fd = fd[0];
+	m_host.write_fd = fd[1];
+	pthread_create(&thread, 0, device_thread, 0);
+	pthread_detach(thread);
+
+	link_load_default_driver(&driver);
+	driver.phy_driver.handle = &m_host;
+	driver.phy_driver.read = phy_read;
+	driver.phy_driver.write = phy_write;
+	driver.phy_driver.close = phy_close;
+	driver.phy_driver.wait = phy_wait;
+	driver.phy_driver.flush = phy_flush;
+	driver.phy_driver.o_flags = LINK2_FLAG_IS_CHECKSUM;
+	driver.transport_version = 2;
+
+	benchmark(&driver);
+	test_short_read(&driver);
+	return 0;
+}
@@ -0,0 +1,203 @@
+/* Host tests for src/link/link_device.c
+ *
+ * Each fake phy is a pair of pipes. A thread on the other end runs
+ * the LINK2 slave transport and answers LINK_CMD_READSERIALNO after a
+ * delay like a slow USB device. One port fails to open and
+ * one port has no device behind it.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "sos/link.h"
+
+#define PORT_COUNT 12
+#define PORT_OPEN_ERROR 5
+#define PORT_NO_DEVICE 7
+#define DEVICE_COUNT (PORT_COUNT-2)
+#define SERIALNO_LATENCY_US 20000
+
+typedef struct {
+	int read_fd;
+	int write_fd;
+} pipe_phy_t;
+
+static pipe_phy_t m_host[PORT_COUNT];
+static pipe_phy_t m_device[PORT_COUNT];
+static char m_serialno[PORT_COUNT][32];
+
+static int read_pipe(int fd, void * buf, int nbyte, int timeout){
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	int result;
+	if( poll(&pfd, 1, timeout) <= 0 ){ return 0; }
+	result = read(fd, buf, nbyte);
+	return result < 0 ? -1 : result;
+}
+
+static void flush_pipe(int fd){
+	char buf[256];
+	while( read_pipe(fd, buf, sizeof(buf), 0) > 0 ){}
+}
+
+static int phy_getname(char * dest, const char * last, int len){
+	int port = 0;
+	if( strlen(last) ){ port = atoi(last + 4) + 1; }
+	if( port >= PORT_COUNT ){ return -1; }
+	snprintf(dest, len, "fake%d", port);
+	return 0;
+}
+
+static link_transport_phy_t phy_open(const char * name, const void * options){
+	int port = atoi(name + 4);
+	if( port == PORT_OPEN_ERROR ){ return LINK_PHY_OPEN_ERROR; }
+	return m_host + port;
+}
+
+//the handle points to a pipe_phy_t on both sides
+static int phy_read(link_transport_phy_t handle, void * buf, int nbyte){ return read_pipe(((pipe_phy_t*)handle)->read_fd, buf, nbyte, 1); }
+static int phy_write(link_transport_phy_t handle, const void * buf, int nbyte){ return write(((pipe_phy_t*)handle)->write_fd, buf, nbyte); }
+static int phy_close(link_transport_phy_t * handle){ *handle = LINK_PHY_OPEN_ERROR; return 0; }
+static void phy_wait(int msec){ usleep(msec*1000); }
+static void phy_flush(link_transport_phy_t handle){ flush_pipe(((pipe_phy_t*)handle)->read_fd); }
+static int phy_lock(link_transport_phy_t handle){ return 0; }
+static int phy_status(link_transport_phy_t handle){ return 0; }
+
+//device side
+static void * device_thread(void * args){
+	long port = (long)args;
+	link_transport_driver_t driver = {
+		.handle = m_device + port,
+		.read = phy_read,
+		.write = phy_write,
+		.flush = phy_flush,
+		.wait = phy_wait,
+		.timeout = 100,
+		.o_flags = LINK2_FLAG_IS_CHECKSUM
+	};
+	link_op_t op;
+	link_reply_t reply;
+	struct pollfd pfd = { .fd = m_device[port].read_fd, .events = POLLIN };
+
+	for(;;){
+		if( poll(&pfd, 1, -1) <= 0 ){ continue; }
+		if( link2_transport_slaveread(&driver, &op, sizeof(op), 0, 0) <= 0 ){ continue; }
+		if( op.cmd == LINK_CMD_READSERIALNO ){
+			usleep(SERIALNO_LATENCY_US);
+			reply.err = strlen(m_serialno[port]);
+			reply.err_number = 0;
+			link2_transport_slavewrite(&driver, &reply, sizeof(reply), 0, 0);
+			link2_transport_slavewrite(&driver, m_serialno[port], reply.err, 0, 0);
+		}
+	}
+	return 0;
+}
+
+static int elapsed_ms(const struct timespec * start){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec)*1000 + (now.tv_nsec - start->tv_nsec)/1000000;
+}
+
+static void load_driver(link_transport_mdriver_t * driver){
+	link_load_default_driver(driver);
+	driver->getname = phy_getname;
+	driver->lock = phy_lock;
+	driver->unlock = phy_lock;
+	driver->status = phy_status;
+	driver->phy_driver.open = phy_open;
+	driver->phy_driver.read = phy_read;
+	driver->phy_driver.write = phy_write;
+	driver->phy_driver.close = phy_close;
+	driver->phy_driver.wait = phy_wait;
+	driver->phy_driver.flush = phy_flush;
+	driver->phy_driver.o_flags = LINK2_FLAG_IS_CHECKSUM;
+}
+
+static void test_probe(){
+	link_transport_mdriver_t driver;
+	link_device_t devices[PORT_COUNT];
+	link_device_t * device;
+	char serialno[LINK_DEVICE_SERIALNO_SIZE];
+	struct timespec start;
+	int probe_ms;
+	int count;
+	int i;
+
+	load_driver(&driver);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	count = link_probe_devices(&driver, devices, PORT_COUNT, 0);
+	probe_ms = elapsed_ms(&start);
+	assert(count == DEVICE_COUNT);
+
+	//sorted by serial number and each device keeps its own phy
+	for(i=1; i < count; i++){
+		assert(strcmp(devices[i-1].serialno, devices[i].serialno) < 0);
+		assert(devices[i-1].driver.phy_driver.handle != devices[i].driver.phy_driver.handle);
+	}
+
+	device = link_find_device(devices, count, "SN03ABCDEF");
+	assert(device != 0);
+	assert(strcmp(device->driver.dev_name, "fake9") == 0);
+	assert(link_find_device(devices, count, "SN05ABCDEF") == 0);
+
+	//the device can be used after the probe
+	memset(serialno, 0, sizeof(serialno));
+	assert(link_readserialno(&device->driver, serialno, sizeof(serialno)-1) == 0);
+	assert(strcmp(serialno, "SN03ABCDEF") == 0);
+
+	//the same devices one at a time for comparison
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i=0; i < count; i++){
+		assert(link_readserialno(&devices[i].driver, serialno, sizeof(serialno)-1) == 0);
+	}
+	printf("probe found %d devices in %d ms (one at a time: %d ms)\n", count, probe_ms, elapsed_ms(&start));
+
+	link_disconnect_devices(devices, count);
+	for(i=0; i < count; i++){
+		assert(devices[i].driver.phy_driver.handle == LINK_PHY_OPEN_ERROR);
+	}
+}
+
+static void test_probe_max(){
+	link_transport_mdriver_t driver;
+	link_device_t devices[3];
+	int count;
+
+	//more devices than the array holds -- the extra ones are closed
+	load_driver(&driver);
+	count = link_probe_devices(&driver, devices, 3, 2);
+	assert(count == 3);
+	link_disconnect_devices(devices, count);
+	printf("probe max ok\n");
+}
+
+int main(){
+	pthread_t thread;
+	int fd[2];
+	long port;
+
+	for(port=0; port < PORT_COUNT; port++){
+		assert(pipe(fd) == 0);
+		m_host[port].read_fd = fd[0];
+		m_device[port].write_fd = fd[1];
+		assert(pipe(fd) == 0);
+		m_device[port].read_fd = fd[0];
+		m_host[port].write_fd = fd[1];
+		snprintf(m_serialno[port], sizeof(m_serialno[port]), "SN%02ldABCDEF", PORT_COUNT - port);
+		if( port != PORT_NO_DEVICE ){
+			pthread_create(&thread, 0, device_thread, (void*)port);
+			pthread_detach(thread);
+		}
+	}
+
+	test_probe();
+	test_probe_max();
+	return 0;
+}
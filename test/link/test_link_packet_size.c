@@ -0,0 +1,216 @@
+/* Throughput benchmark for negotiated LINK2 packet sizes
+ *
+ * The device is a thread on the other end of a pair of pipes running the
+ * LINK2 slave transport the way the link thread does: it calls
+ * link2_transport_slaveread() in a loop and lets it time out while the
+ * host is idle. Every phy write waits a fixed time to stand in for a
+ * USB turnaround. The device accepts packets up to the size of its
+ * packet buffer.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "sos/link.h"
+
+#define TRANSFER_SIZE (1024*1024)
+#define TURNAROUND_US 125
+#define DEVICE_FILDES 3
+
+typedef struct {
+	int read_fd;
+	int write_fd;
+} pipe_phy_t;
+
+static pipe_phy_t m_host;
+static pipe_phy_t m_device;
+static u32 m_device_packet_buffer[LINK2_PACKET_BUFFER_SIZE(LINK2_PACKET_DATA_SIZE_MAX)/sizeof(u32) + 1];
+static volatile int m_device_max;
+static volatile int m_device_packet_size;
+static volatile int m_device_timeout_count;
+
+static int read_pipe(int fd, void * buf, int nbyte, int timeout){
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	int result;
+	if( poll(&pfd, 1, timeout) <= 0 ){ return 0; }
+	result = read(fd, buf, nbyte);
+	return result < 0 ? -1 : result;
+}
+
+static int phy_getname(char * dest, const char * last, int len){
+	if( strlen(last) ){ return -1; }
+	snprintf(dest, len, "fake0");
+	return 0;
+}
+
+static link_transport_phy_t phy_open(const char * name, const void * options){ return &m_host; }
+
+//the handle points to a pipe_phy_t on both sides
+static int phy_read(link_transport_phy_t handle, void * buf, int nbyte){ return read_pipe(((pipe_phy_t*)handle)->read_fd, buf, nbyte, 1); }
+static int phy_write(link_transport_phy_t handle, const void * buf, int nbyte){
+	usleep(TURNAROUND_US);
+	return write(((pipe_phy_t*)handle)->write_fd, buf, nbyte);
+}
+static int phy_close(link_transport_phy_t * handle){ return 0; }
+static void phy_wait(int msec){ usleep(msec*1000); }
+static void phy_flush(link_transport_phy_t handle){
+	char buf[256];
+	while( read_pipe(((pipe_phy_t*)handle)->read_fd, buf, sizeof(buf), 0) > 0 ){}
+}
+static int phy_lock(link_transport_phy_t handle){ return 0; }
+
+//device side
+static int sink(void * context, void * buf, int nbyte){ return nbyte; }
+static int source(void * context, void * buf, int nbyte){ memset(buf, 0x55, nbyte); return nbyte; }
+
+static void * device_thread(void * args){
+	link_transport_driver_t driver = {
+		.handle = &m_device,
+		.read = phy_read,
+		.write = phy_write,
+		.flush = phy_flush,
+		.wait = phy_wait,
+		.timeout = 20,
+		.o_flags = LINK2_FLAG_IS_CHECKSUM,
+		.packet_buffer = m_device_packet_buffer,
+		.packet_buffer_size = sizeof(m_device_packet_buffer)
+	};
+	link_op_t op;
+	link_reply_t reply;
+
+	for(;;){
+		m_device_packet_size = link2_transport_get_packet_data_size(&driver);
+		if( link2_transport_slaveread(&driver, &op, sizeof(op), 0, 0) <= 0 ){
+			m_device_timeout_count++;
+			continue;
+		}
+
+		reply.err_number = 0;
+		switch(op.cmd){
+			case LINK_CMD_READSERIALNO:
+				reply.err = 4;
+				link2_transport_slavewrite(&driver, &reply, sizeof(reply), 0, 0);
+				link2_transport_slavewrite(&driver, "SN01", reply.err, 0, 0);
+				continue;
+			case LINK_CMD_SETPACKETSIZE:
+				//the board's packet buffer limits the size (with __link the transport doesn't check it)
+				if( op.packet_size.size > m_device_max ){ op.packet_size.size = m_device_max; }
+				reply.err = link2_transport_set_packet_data_size(&driver, op.packet_size.size);
+				break;
+			case LINK_CMD_WRITE:
+				reply.err = link2_transport_slaveread(&driver, 0, op.write.nbyte, sink, 0);
+				break;
+			case LINK_CMD_READ:
+				reply.err = link2_transport_slavewrite(&driver, 0, op.read.nbyte, source, 0);
+				break;
+			default:
+				reply.err = -1;
+				reply.err_number = 22;
+				break;
+		}
+		link2_transport_slavewrite(&driver, &reply, sizeof(reply), 0, 0);
+	}
+	return 0;
+}
+
+static double elapsed(const struct timespec * start){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec)/1e9;
+}
+
+static void connect(link_transport_mdriver_t * driver, int device_max){
+	m_device_max = device_max;
+	assert(link_connect(driver, 0) == 0);
+	assert(link2_transport_get_packet_data_size(&driver->phy_driver) == device_max);
+}
+
+static double benchmark(link_transport_mdriver_t * driver, int device_max){
+	static char buf[TRANSFER_SIZE];
+	struct timespec start;
+	double write_seconds;
+	double read_seconds;
+
+	connect(driver, device_max);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	assert(link_write(driver, DEVICE_FILDES, buf, sizeof(buf)) == sizeof(buf));
+	write_seconds = elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	assert(link_read(driver, DEVICE_FILDES, buf, sizeof(buf)) == sizeof(buf));
+	read_seconds = elapsed(&start);
+	assert(buf[0] == 0x55 && buf[sizeof(buf)-1] == 0x55);
+
+	printf("packet %5d: write %.1f MB/s, read %.1f MB/s\n",
+			 device_max,
+			 sizeof(buf) / write_seconds / 1e6,
+			 sizeof(buf) / read_seconds / 1e6);
+	return write_seconds + read_seconds;
+}
+
+static void test_idle(link_transport_mdriver_t * driver){
+	static char buf[64*1024];
+	int timeout_count;
+
+	//the device times out while the host is idle -- that must not reset the negotiated size
+	connect(driver, LINK2_PACKET_DATA_SIZE_MAX);
+	timeout_count = m_device_timeout_count;
+	while( m_device_timeout_count < timeout_count + 3 ){ usleep(10000); }
+	assert(m_device_packet_size == LINK2_PACKET_DATA_SIZE_MAX);
+	//the slave sends a NACK each time it times out
+	phy_flush(&m_host);
+	assert(link_write(driver, DEVICE_FILDES, buf, sizeof(buf)) == sizeof(buf));
+
+	//reconnecting resolves the protocol again and both sides start over
+	connect(driver, LINK2_PACKET_DATA_SIZE);
+	assert(m_device_packet_size == LINK2_PACKET_DATA_SIZE);
+	assert(link_read(driver, DEVICE_FILDES, buf, sizeof(buf)) == sizeof(buf));
+	printf("idle and reconnect ok\n");
+}
+
+int main(){
+	link_transport_mdriver_t driver;
+	pthread_t thread;
+	int fd[2];
+	double default_seconds;
+	double max_seconds;
+
+	assert(pipe(fd) == 0);
+	m_host.read_fd = fd[0];
+	m_device.write_fd = fd[1];
+	assert(pipe(fd) == 0);
+	m_device.read_fd = fd[0];
+	m_host.write_fd = fd[1];
+	pthread_create(&thread, 0, device_thread, 0);
+	pthread_detach(thread);
+
+	link_load_default_driver(&driver);
+	driver.getname = phy_getname;
+	driver.lock = phy_lock;
+	driver.unlock = phy_lock;
+	driver.status = phy_lock;
+	driver.phy_driver.open = phy_open;
+	driver.phy_driver.read = phy_read;
+	driver.phy_driver.write = phy_write;
+	driver.phy_driver.close = phy_close;
+	driver.phy_driver.wait = phy_wait;
+	driver.phy_driver.flush = phy_flush;
+	driver.phy_driver.o_flags = LINK2_FLAG_IS_CHECKSUM;
+
+	//larger packets first so a reset to the default size is exercised on the way down
+	max_seconds = benchmark(&driver, LINK2_PACKET_DATA_SIZE_MAX);
+	benchmark(&driver, 4096);
+	default_seconds = benchmark(&driver, LINK2_PACKET_DATA_SIZE);
+	assert(max_seconds < default_seconds);
+
+	test_idle(&driver);
+	return 0;
+}
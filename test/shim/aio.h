@@ -0,0 +1,8 @@
+/* The kernel's <aio.h> instead of the host's */
+
+#ifndef TEST_SHIM_AIO_H_
+#define TEST_SHIM_AIO_H_
+
+#include "posix/aio.h"
+
+#endif /* TEST_SHIM_AIO_H_ */
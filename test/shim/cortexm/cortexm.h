@@ -0,0 +1,21 @@
+/* Host replacement for the Cortex-M header used by the unit tests */
+
+#ifndef TEST_SHIM_CORTEXM_CORTEXM_H_
+#define TEST_SHIM_CORTEXM_CORTEXM_H_
+
+#include "mcu/types.h"
+
+static inline void cortexm_disable_interrupts(){}
+static inline void cortexm_enable_interrupts(){}
+
+typedef void (*cortexm_svcall_t)(void*);
+#define CORTEXM_SVCALL_ENTER()
+
+//provided by the test when the code under test uses them
+void cortexm_svcall(cortexm_svcall_t call, void * args);
+void cortexm_delay_us(u32 us);
+void cortexm_delay_ms(u32 ms);
+void cortexm_assign_zero_sum32(void * data, int size);
+int cortexm_verify_zero_sum32(void * data, int size);
+
+#endif /* TEST_SHIM_CORTEXM_CORTEXM_H_ */
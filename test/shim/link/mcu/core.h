@@ -0,0 +1,11 @@
+/* Host replacement for the core header when the link transport is built with __link
+ *
+ * The slave transport only needs the types that sos/link/transport.h provides.
+ */
+
+#ifndef TEST_SHIM_LINK_MCU_CORE_H_
+#define TEST_SHIM_LINK_MCU_CORE_H_
+
+#include "mcu/types.h"
+
+#endif /* TEST_SHIM_LINK_MCU_CORE_H_ */
@@ -0,0 +1,31 @@
+/* Host replacement for the architecture header used by the unit tests */
+
+#ifndef TEST_SHIM_MCU_ARCH_H_
+#define TEST_SHIM_MCU_ARCH_H_
+
+#include <stdlib.h>
+#include "mcu/types.h"
+
+#define ARCH_DEFINED 1
+
+static inline unsigned int __CLZ(unsigned int value){ return value ? __builtin_clz(value) : 32; }
+static inline unsigned int __get_PRIMASK(){ return 0; }
+static inline void __set_PRIMASK(unsigned int value){ (void)value; }
+static inline void __disable_irq(){}
+static inline void __enable_irq(){}
+static inline void __DMB(){}
+//thread mode and privileged
+static inline unsigned int __get_IPSR(){ return 0; }
+static inline unsigned int __get_CONTROL(){ return 0; }
+//the tests are single threaded so the exclusive store always succeeds
+static inline unsigned int __LDREXW(volatile unsigned int * addr){ return *addr; }
+static inline unsigned int __STREXW(unsigned int value, volatile unsigned int * addr){ *addr = value; return 0; }
+
+//provided by the test when the code under test uses it
+typedef struct {
+	unsigned int CYCCNT;
+} test_dwt_t;
+test_dwt_t * test_get_dwt();
+#define DWT (test_get_dwt())
+
+#endif /* TEST_SHIM_MCU_ARCH_H_ */
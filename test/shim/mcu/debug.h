@@ -0,0 +1,14 @@
+/* Host replacement for the debug header used by the unit tests */
+
+#ifndef TEST_SHIM_MCU_DEBUG_H_
+#define TEST_SHIM_MCU_DEBUG_H_
+
+#include "cortexm/cortexm.h"
+
+#define mcu_debug_log_info(...)
+#define mcu_debug_log_error(...)
+#define mcu_debug_log_warning(...)
+#define mcu_debug_printf(...)
+#define mcu_debug_user_printf(...)
+
+#endif /* TEST_SHIM_MCU_DEBUG_H_ */
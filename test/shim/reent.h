@@ -0,0 +1,8 @@
+/* Host replacement for the newlib reent header used by the unit tests */
+
+#ifndef TEST_SHIM_REENT_H_
+#define TEST_SHIM_REENT_H_
+
+#include "sys/reent.h"
+
+#endif /* TEST_SHIM_REENT_H_ */
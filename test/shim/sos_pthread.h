@@ -0,0 +1,37 @@
+/* Stratify newlib pthread types for the unit tests that use their members
+ *
+ * Force include this (after test_prelude.h) for code that reads
+ * pthread_mutex_t or pthread_attr_t. The host types are declared first and
+ * then replaced by name so the rest of the build sees the newlib layout.
+ */
+
+#ifndef TEST_SHIM_SOS_PTHREAD_H_
+#define TEST_SHIM_SOS_PTHREAD_H_
+
+#include <pthread.h>
+#include <sched.h>
+
+typedef struct {
+	int flags;
+	int prio_ceiling;
+	int pthread;
+	int pid;
+	int lock;
+} sos_pthread_mutex_t;
+
+typedef struct {
+	int stacksize;
+	void * stackaddr;
+	int schedpolicy;
+	struct sched_param schedparam;
+	int detachstate;
+} sos_pthread_attr_t;
+
+#define pthread_mutex_t sos_pthread_mutex_t
+#define pthread_attr_t sos_pthread_attr_t
+
+//defined by src/config.h
+#define SCHED_LOWEST_PRIORITY 0
+#define SCHED_HIGHEST_PRIORITY 31
+
+#endif /* TEST_SHIM_SOS_PTHREAD_H_ */
@@ -0,0 +1,3 @@
+/* Host replacement for the newlib dirent header used by the unit tests */
+
+#include <dirent.h>
@@ -0,0 +1,9 @@
+/* Host replacement for the newlib lock header used by the unit tests */
+
+#ifndef TEST_SHIM_SYS_LOCK_H_
+#define TEST_SHIM_SYS_LOCK_H_
+
+typedef int _LOCK_T;
+typedef int _LOCK_RECURSIVE_T;
+
+#endif /* TEST_SHIM_SYS_LOCK_H_ */
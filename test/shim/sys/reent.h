@@ -0,0 +1,8 @@
+/* Host replacement for the newlib reent header used by the unit tests */
+
+#ifndef TEST_SHIM_SYS_REENT_H_
+#define TEST_SHIM_SYS_REENT_H_
+
+//struct _reent is in test_prelude.h
+
+#endif /* TEST_SHIM_SYS_REENT_H_ */
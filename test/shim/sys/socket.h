@@ -0,0 +1,11 @@
+/* Host replacement for the Stratify socket API (sockets aren't tested) */
+
+#ifndef TEST_SHIM_SYS_SOCKET_H_
+#define TEST_SHIM_SYS_SOCKET_H_
+
+typedef struct {
+	const void * config;
+	void * state;
+} sos_socket_api_t;
+
+#endif /* TEST_SHIM_SYS_SOCKET_H_ */
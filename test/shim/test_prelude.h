@@ -0,0 +1,37 @@
+/* Included before every source compiled by the unit tests.
+ *
+ * These are types the Stratify newlib provides that the host
+ * C library doesn't.
+ */
+
+#ifndef TEST_SHIM_TEST_PRELUDE_H_
+#define TEST_SHIM_TEST_PRELUDE_H_
+
+#include <limits.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+//defined by include/posix/mqueue.h
+#undef MQ_PRIO_MAX
+
+//defined by include/posix/sys/uio.h (glibc only has it with _XOPEN_SOURCE)
+#if !defined IOV_MAX
+#define IOV_MAX 16
+#endif
+
+//Stratify newlib open flag for character devices
+#define O_CHAR 0x40000000
+
+//only the members the code under test uses
+struct _reent {
+	int _errno;
+};
+
+typedef struct {
+	void * fs;
+	void * handle;
+	int flags;
+	int loc;
+} open_file_t;
+
+#endif /* TEST_SHIM_TEST_PRELUDE_H_ */
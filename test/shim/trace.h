@@ -0,0 +1,3 @@
+/* Host replacement that picks up the Stratify trace header */
+
+#include "posix/trace.h"
@@ -0,0 +1,195 @@
+/* Host tests for compressed assets
+ *
+ * Assets are packed with the link library (link_assetfs.c built for the
+ * host) and read back with the kernel chunk reader (assetfs_chunk.c).
+ * Both use the codec in assetfs_chunk_codec.c.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "sos/fs/sysfs.h"
+#include "sos/fs/assetfs.h"
+
+//from sos/link.h (link_assetfs.c is built with __link)
+int link_assetfs_compress(const void * data, u32 size, u8 ** compressed);
+int link_assetfs_decompress(const void * compressed, u32 size, u8 ** data);
+int link_debug_printf(int x, const char * function, int line, const char * fmt, ...){ return 0; }
+
+#define ASSET_SIZE (ASSETFS_CHUNK_SIZE*3 + 1000)
+
+static u8 m_asset[ASSET_SIZE];
+static u8 * m_image;
+static int m_image_size;
+static int m_drive_read_count;
+
+static void create_asset(){
+	int i;
+	//text-like data that compresses with one chunk of noise that doesn't
+	for(i=0; i < ASSET_SIZE; i++){
+		m_asset[i] = "stratify assets "[i % 16] + (i / 700);
+	}
+	srand(1);
+	for(i=ASSETFS_CHUNK_SIZE; i < ASSETFS_CHUNK_SIZE*2; i++){
+		m_asset[i] = rand();
+	}
+}
+
+static int read_image(const void * context, u32 offset, void * buf, int nbyte){
+	m_drive_read_count++;
+	if( offset + nbyte > (u32)m_image_size ){ return 0; }
+	memcpy(buf, m_image + offset, nbyte);
+	return nbyte;
+}
+
+static void test_link_round_trip(){
+	u8 * data;
+	assetfs_chunk_header_t header;
+	u32 offset[2];
+
+	m_image_size = link_assetfs_compress(m_asset, ASSET_SIZE, &m_image);
+	assert(m_image_size > 0);
+	assert(m_image_size < ASSET_SIZE);
+
+	memcpy(&header, m_image, sizeof(header));
+	assert(assetfs_chunk_is_valid(&header, m_image_size));
+	assert(header.chunk_count == 4);
+
+	//the noise chunk is stored as is
+	memcpy(offset, m_image + sizeof(header) + sizeof(u32), sizeof(offset));
+	assert(offset[1] - offset[0] == ASSETFS_CHUNK_SIZE);
+
+	assert(link_assetfs_decompress(m_image, m_image_size, &data) == ASSET_SIZE);
+	assert(memcmp(data, m_asset, ASSET_SIZE) == 0);
+	free(data);
+
+	//a truncated image is rejected
+	assert(link_assetfs_decompress(m_image, m_image_size - 1, &data) < 0);
+	printf("link round trip ok (%d -> %d bytes)\n", ASSET_SIZE, m_image_size);
+}
+
+static void test_link_bad_header(){
+	u8 * image = malloc(m_image_size);
+	u8 * data;
+	assetfs_chunk_header_t header;
+	u32 offset;
+
+	//more chunks than the size needs would overflow the output
+	memcpy(image, m_image, m_image_size);
+	memcpy(&header, image, sizeof(header));
+	header.size = 100;
+	memcpy(image, &header, sizeof(header));
+	assert(link_assetfs_decompress(image, m_image_size, &data) < 0);
+
+	//a chunk offset that points into the offset table
+	memcpy(image, m_image, m_image_size);
+	offset = 4;
+	memcpy(image + sizeof(header), &offset, sizeof(offset));
+	assert(link_assetfs_decompress(image, m_image_size, &data) < 0);
+
+	//a chunk offset past the end of the asset
+	memcpy(image, m_image, m_image_size);
+	offset = m_image_size + 16;
+	memcpy(image + sizeof(header) + 2*sizeof(u32), &offset, sizeof(offset));
+	assert(link_assetfs_decompress(image, m_image_size, &data) < 0);
+
+	free(image);
+	printf("link bad header ok\n");
+}
+
+static void read_all(assetfs_chunk_reader_t * reader, int page){
+	u8 buf[ASSET_SIZE];
+	int loc;
+	int result;
+	for(loc = 0; loc < ASSET_SIZE; loc += result){
+		result = assetfs_chunk_read(reader, loc, buf + loc, page);
+		assert(result > 0);
+	}
+	assert(assetfs_chunk_read(reader, ASSET_SIZE, buf, page) == 0);
+	assert(memcmp(buf, m_asset, ASSET_SIZE) == 0);
+}
+
+static void test_reader(){
+	assetfs_chunk_cache_t cache;
+	assetfs_chunk_reader_t memory_reader;
+	assetfs_chunk_reader_t drive_reader[2];
+	assetfs_chunk_header_t header;
+	u8 buf[64];
+	int i;
+
+	memcpy(&header, m_image, sizeof(header));
+	assert(assetfs_chunk_init_cache(&cache) == 0);
+
+	//memory mapped
+	assert(assetfs_chunk_open_reader(&memory_reader, &cache, &header, m_image_size, m_image) == 0);
+	assert(cache.users == 1);
+	assert(cache.compressed == 0);
+	read_all(&memory_reader, 1000);
+	read_all(&memory_reader, ASSET_SIZE);
+	assetfs_chunk_close_reader(&memory_reader);
+	assert(cache.users == 0);
+	assert(cache.data == 0);
+
+	//two drive readers share one buffer
+	for(i=0; i < 2; i++){
+		assert(assetfs_chunk_open_reader(drive_reader + i, &cache, &header, m_image_size, 0) == 0);
+		drive_reader[i].read = read_image;
+	}
+	assert(cache.users == 2);
+	assert(cache.compressed != 0);
+
+	for(i=0; i < ASSET_SIZE - (int)sizeof(buf); i += 777){
+		assert(assetfs_chunk_read(drive_reader + (i & 1), i, buf, sizeof(buf)) == sizeof(buf));
+		assert(memcmp(buf, m_asset + i, sizeof(buf)) == 0);
+	}
+
+	//small reads in the same chunk decode it once
+	m_drive_read_count = 0;
+	for(i=0; i < 16; i++){
+		assert(assetfs_chunk_read(drive_reader, i*sizeof(buf), buf, sizeof(buf)) == sizeof(buf));
+	}
+	assert(m_drive_read_count <= 2);
+	read_all(drive_reader + 1, 333);
+
+	assetfs_chunk_close_reader(drive_reader);
+	assetfs_chunk_close_reader(drive_reader + 1);
+	assert(cache.users == 0);
+	assert(cache.data == 0);
+	printf("reader ok\n");
+}
+
+static void test_reader_bad_offset(){
+	assetfs_chunk_cache_t cache;
+	assetfs_chunk_reader_t reader;
+	assetfs_chunk_header_t header;
+	u8 * image = malloc(m_image_size);
+	u8 buf[64];
+	u32 offset;
+
+	memcpy(image, m_image, m_image_size);
+	memcpy(&header, image, sizeof(header));
+	offset = m_image_size + 4096;
+	memcpy(image + sizeof(header) + 3*sizeof(u32), &offset, sizeof(offset));
+
+	assert(assetfs_chunk_init_cache(&cache) == 0);
+	assert(assetfs_chunk_open_reader(&reader, &cache, &header, m_image_size, image) == 0);
+	assert(assetfs_chunk_read(&reader, 0, buf, sizeof(buf)) == sizeof(buf));
+	assert(assetfs_chunk_read(&reader, ASSETFS_CHUNK_SIZE*2, buf, sizeof(buf)) < 0);
+	assetfs_chunk_close_reader(&reader);
+	free(image);
+	printf("reader bad offset ok\n");
+}
+
+int main(){
+	create_asset();
+	test_link_round_trip();
+	test_link_bad_header();
+	test_reader();
+	test_reader_bad_offset();
+	free(m_image);
+	return 0;
+}
@@ -0,0 +1,260 @@
+/* Host tests for src/sys/sysfs/devfs_aio.c
+ *
+ * The fake driver has one transfer in flight per direction like a
+ * real peripheral and returns EBUSY for a second one. The test
+ * completes transfers with fire(), which calls the handler the way
+ * the driver's interrupt would. Tasks 1 and 2 belong to different
+ * processes.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../src/sys/sysfs/devfs_local.h"
+
+//DEVFS_AIO_QUEUE_COUNT and DEVFS_AIO_ENTRY_COUNT are set in CMakeLists.txt
+#define DEVICE_COUNT (DEVFS_AIO_QUEUE_COUNT+1)
+#define REQUEST_COUNT 32
+
+volatile int m_task_current;
+volatile task_t sos_task_table[3] = { { .pid = 0 }, { .pid = 1 }, { .pid = 2 } };
+volatile void * volatile sos_sched_block_object[3];
+
+void cortexm_svcall(cortexm_svcall_t call, void * args){ call(args); }
+
+static int m_complete[REQUEST_COUNT];
+static int m_complete_count;
+
+int sysfs_aio_data_transfer_callback(void * context, const mcu_event_t * event){
+	struct aiocb * aiocbp = context;
+	//same bookkeeping as src/sys/aio/aio.c
+	aiocbp->aio_nbytes = aiocbp->async.nbyte;
+	aiocbp->async.buf = NULL;
+	if( aiocbp->async.nbyte < 0 ){
+		aiocbp->async.nbyte = SYSFS_GET_RETURN_ERRNO(aiocbp->async.nbyte);
+	} else {
+		aiocbp->async.nbyte = 0;
+	}
+	m_complete[m_complete_count++] = aiocbp->aio_offset;
+	return 0;
+}
+
+typedef struct {
+	devfs_transfer_handler_t transfer_handler;
+	int is_sync_next;
+	int is_error_next;
+} fake_state_t;
+
+static int fake_transfer(devfs_async_t ** slot, devfs_async_t * async, fake_state_t * state){
+	if( *slot ){ return SYSFS_SET_RETURN(EBUSY); }
+	if( state->is_error_next ){
+		state->is_error_next = 0;
+		return SYSFS_SET_RETURN(EIO);
+	}
+	if( state->is_sync_next ){
+		state->is_sync_next = 0;
+		return async->nbyte;
+	}
+	*slot = async;
+	return 0;
+}
+
+static int fake_read(const devfs_handle_t * handle, devfs_async_t * async){
+	fake_state_t * state = handle->state;
+	return fake_transfer(&state->transfer_handler.read, async, state);
+}
+
+static int fake_write(const devfs_handle_t * handle, devfs_async_t * async){
+	fake_state_t * state = handle->state;
+	return fake_transfer(&state->transfer_handler.write, async, state);
+}
+
+static fake_state_t m_state[DEVICE_COUNT];
+static devfs_device_t m_device[DEVICE_COUNT];
+static struct aiocb m_aiocb[REQUEST_COUNT];
+static char m_buf[64];
+
+static void fire(int device, int is_read, int nbyte){
+	devfs_async_t ** slot = is_read ? &m_state[device].transfer_handler.read : &m_state[device].transfer_handler.write;
+	devfs_async_t * async = *slot;
+	mcu_event_t event = { .o_events = MCU_EVENT_FLAG_DATA_READY };
+	assert(async != 0);
+	*slot = 0;
+	async->nbyte = nbyte;
+	async->handler.callback(async->handler.context, &event);
+}
+
+static void reset(){
+	int i;
+	memset(m_state, 0, sizeof(m_state));
+	for(i=0; i < DEVICE_COUNT; i++){
+		m_device[i].driver.read = fake_read;
+		m_device[i].driver.write = fake_write;
+		m_device[i].handle.state = m_state + i;
+	}
+	memset(m_aiocb, 0, sizeof(m_aiocb));
+	for(i=0; i < REQUEST_COUNT; i++){
+		m_aiocb[i].aio_offset = i;
+		m_aiocb[i].aio_nbytes = 8;
+		m_aiocb[i].aio_buf = m_buf;
+		m_aiocb[i].aio_lio_opcode = LIO_READ;
+	}
+	m_complete_count = 0;
+	m_task_current = 1;
+}
+
+static int transfer(int device, int request){
+	return devfs_aio_data_transfer(m_device + device, m_aiocb + request);
+}
+
+static void test_queue(){
+	int i;
+
+	reset();
+	//four reads on one device are accepted and run in order
+	for(i=0; i < 4; i++){ assert(transfer(0, i) == 0); }
+	//a write runs in parallel
+	m_aiocb[4].aio_lio_opcode = LIO_WRITE;
+	assert(transfer(0, 4) == 0);
+	assert(m_state[0].transfer_handler.read == &m_aiocb[0].async);
+	assert(m_state[0].transfer_handler.write == &m_aiocb[4].async);
+
+	fire(0, 1, 8);
+	assert(m_complete_count == 1 && m_complete[0] == 0);
+	assert(m_state[0].transfer_handler.read == &m_aiocb[1].async);
+
+	//1 completes, 2 completes synchronously and 3 is started
+	m_state[0].is_sync_next = 1;
+	fire(0, 1, 5);
+	assert(m_complete_count == 3 && m_complete[2] == 2);
+	assert(m_aiocb[1].aio_nbytes == 5 && m_aiocb[2].aio_nbytes == 8);
+	assert(m_state[0].transfer_handler.read == &m_aiocb[3].async);
+
+	//an error in the middle of the queue completes that request only
+	m_state[0].is_error_next = 1;
+	assert(transfer(0, 5) == 0);
+	fire(0, 1, 8);
+	assert(m_complete_count == 5 && m_complete[4] == 5 && m_aiocb[5].async.nbyte == EIO);
+	assert(m_state[0].transfer_handler.read == 0);
+	fire(0, 0, 8);
+	assert(m_complete_count == 6 && m_aiocb[4].async.buf == NULL);
+
+	//the device is idle -- the error is returned directly
+	m_state[0].is_error_next = 1;
+	assert(SYSFS_GET_RETURN_ERRNO(transfer(0, 6)) == EIO);
+
+	//zero length completes right away
+	m_aiocb[7].aio_nbytes = 0;
+	assert(transfer(0, 7) == 0 && m_aiocb[7].async.buf == NULL);
+	printf("queue ok\n");
+}
+
+static void test_full(){
+	int i;
+
+	reset();
+	//every queue in use -- the next device falls back to EBUSY
+	for(i=0; i < DEVICE_COUNT; i++){ assert(transfer(i, i) == 0); }
+	assert(SYSFS_GET_RETURN_ERRNO(transfer(DEVICE_COUNT-1, DEVICE_COUNT)) == EBUSY);
+	fire(DEVICE_COUNT-1, 1, 8);
+	for(i=0; i < DEVICE_COUNT-1; i++){ fire(i, 1, 8); }
+	assert(m_complete_count == DEVICE_COUNT);
+	assert(transfer(DEVICE_COUNT-1, DEVICE_COUNT) == 0);
+	fire(DEVICE_COUNT-1, 1, 8);
+
+	//every entry in use -- the same
+	reset();
+	for(i=0; i < DEVFS_AIO_ENTRY_COUNT; i++){ assert(transfer(0, i) == 0); }
+	assert(SYSFS_GET_RETURN_ERRNO(transfer(0, DEVFS_AIO_ENTRY_COUNT)) == EBUSY);
+	for(i=0; i < DEVFS_AIO_ENTRY_COUNT; i++){ fire(0, 1, 8); }
+	assert(m_complete_count == DEVFS_AIO_ENTRY_COUNT);
+	assert(transfer(0, DEVFS_AIO_ENTRY_COUNT) == 0);
+	fire(0, 1, 8);
+	printf("full ok\n");
+}
+
+static void test_cancel(){
+	int i;
+
+	reset();
+	for(i=0; i < 4; i++){ assert(transfer(0, i) == 0); }
+
+	//a queued request is removed and completes with ECANCELED
+	assert(devfs_aio_cancel(m_device + 0, m_aiocb + 2) == AIO_CANCELED);
+	assert(m_complete_count == 1 && m_complete[0] == 2 && m_aiocb[2].async.nbyte == ECANCELED);
+	assert(devfs_aio_cancel(m_device + 0, m_aiocb + 2) == AIO_ALLDONE);
+
+	//the driver has the first one
+	assert(devfs_aio_cancel(m_device + 0, m_aiocb + 0) == AIO_NOTCANCELED);
+
+	//the queue continues without the cancelled request
+	fire(0, 1, 8);
+	assert(m_state[0].transfer_handler.read == &m_aiocb[1].async);
+	fire(0, 1, 8);
+	assert(m_state[0].transfer_handler.read == &m_aiocb[3].async);
+
+	//the last one can be cancelled and new requests queue behind the tail
+	assert(transfer(0, 4) == 0);
+	assert(devfs_aio_cancel(m_device + 0, m_aiocb + 4) == AIO_CANCELED);
+	assert(transfer(0, 5) == 0);
+	fire(0, 1, 8);
+	assert(m_state[0].transfer_handler.read == &m_aiocb[5].async);
+	fire(0, 1, 8);
+	assert(m_state[0].transfer_handler.read == 0);
+
+	//NULL cancels the queued requests of the calling process only
+	m_task_current = 1;
+	assert(transfer(0, 10) == 0);
+	assert(transfer(0, 11) == 0);
+	m_task_current = 2;
+	assert(transfer(0, 12) == 0);
+	m_task_current = 1;
+	m_complete_count = 0;
+	assert(devfs_aio_cancel(m_device + 0, 0) == AIO_NOTCANCELED);
+	assert(m_complete_count == 1 && m_complete[0] == 11);
+	fire(0, 1, 8);
+	assert(m_state[0].transfer_handler.read == &m_aiocb[12].async);
+	assert(devfs_aio_cancel(m_device + 0, 0) == AIO_ALLDONE);
+	fire(0, 1, 8);
+	printf("cancel ok\n");
+}
+
+static void test_cancel_pid(){
+	int i;
+
+	reset();
+	m_task_current = 2;
+	assert(transfer(0, 0) == 0);
+	m_task_current = 1;
+	assert(transfer(0, 1) == 0);
+	assert(transfer(0, 2) == 0);
+	m_task_current = 2;
+	assert(transfer(0, 3) == 0);
+
+	//process 1 exits -- its requests are dropped without completing
+	devfs_aio_cancel_pid(1);
+	assert(m_complete_count == 0);
+	fire(0, 1, 8);
+	assert(m_state[0].transfer_handler.read == &m_aiocb[3].async);
+	fire(0, 1, 8);
+	assert(m_complete_count == 2 && m_complete[1] == 3);
+
+	//the entries are free again
+	m_task_current = 1;
+	m_complete_count = 0;
+	for(i=0; i < DEVFS_AIO_ENTRY_COUNT; i++){ assert(transfer(0, i) == 0); }
+	for(i=0; i < DEVFS_AIO_ENTRY_COUNT; i++){ fire(0, 1, 8); }
+	assert(m_complete_count == DEVFS_AIO_ENTRY_COUNT);
+	printf("cancel pid ok\n");
+}
+
+int main(){
+	test_queue();
+	test_full();
+	test_cancel();
+	test_cancel_pid();
+	return 0;
+}
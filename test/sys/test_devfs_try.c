@@ -0,0 +1,157 @@
+/* Latency benchmark for small reads in src/sys/sysfs/devfs_data_transfer.c
+ *
+ * Two FIFO devices share one buffer configuration. One is declared with
+ * DEVFS_VECTOR_DEVICE() so the kernel uses fifo_try_read() and
+ * fifo_try_write(), the other with DEVFS_DEVICE() so every transfer goes
+ * through the regular entry points. The svcall runs directly. The
+ * benchmark writes then reads 4 bytes at a time through
+ * devfs_data_transfer() on each device and counts how often the
+ * scheduler is involved.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "../../src/sys/sysfs/devfs_local.h"
+#include "device/fifo.h"
+
+#define FIFO_SIZE 64
+#define TRANSFER_SIZE 4
+#define TRANSFER_COUNT 200000
+
+volatile int m_task_current;
+volatile task_t sos_task_table[2] = { { .pid = 0 }, { .pid = 1 } };
+volatile void * volatile sos_sched_block_object[2];
+volatile u32 sos_sched_flags[2];
+
+static int m_permission_count;
+static int m_is_permitted = 1;
+static int m_sleep_count;
+
+void cortexm_svcall(cortexm_svcall_t call, void * args){ call(args); }
+u8 task_get_total(){ return 2; }
+int task_validate_memory(void * target, int size){ return 0; }
+int sysfs_is_r_ok(int mode, int uid, int gid){ m_permission_count++; return m_is_permitted; }
+int sysfs_is_w_ok(int mode, int uid, int gid){ m_permission_count++; return m_is_permitted; }
+void scheduler_root_update_on_sleep(){ m_sleep_count++; }
+void scheduler_root_update_on_wake(int id, int new_priority){}
+void scheduler_root_assert_active(int id, int unblock_type){}
+int devfs_ioctl(const void * cfg, void * handle, int request, void * ctl){ return 0; }
+
+static char m_buffer[2][FIFO_SIZE];
+static fifo_state_t m_state[2];
+static const fifo_config_t m_config[2] = {
+	{ .size = FIFO_SIZE, .buffer = m_buffer[0] },
+	{ .size = FIFO_SIZE, .buffer = m_buffer[1] }
+};
+
+static const devfs_device_t m_devices[] = {
+	DEVFS_VECTOR_DEVICE("fifo0", fifo, 0, m_config + 0, m_state + 0, 0666, 0, S_IFCHR),
+	DEVFS_DEVICE("fifo1", fifo, 0, m_config + 1, m_state + 1, 0666, 0, S_IFCHR),
+	DEVFS_TERMINATOR
+};
+
+static double elapsed_ns(const struct timespec * start){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec)*1e9 + (now.tv_nsec - start->tv_nsec);
+}
+
+static double benchmark(const devfs_device_t * device, int * permission_count, int * sleep_count){
+	char data[TRANSFER_SIZE] = "abcd";
+	char buf[TRANSFER_SIZE];
+	struct timespec start;
+	int i;
+
+	m_task_current = 1;
+	m_permission_count = 0;
+	m_sleep_count = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i=0; i < TRANSFER_COUNT; i++){
+		assert(devfs_data_transfer(0, device, O_RDWR, 0, data, TRANSFER_SIZE, 0) == TRANSFER_SIZE);
+		assert(devfs_data_transfer(0, device, O_RDWR, 0, buf, TRANSFER_SIZE, 1) == TRANSFER_SIZE);
+	}
+	*permission_count = m_permission_count;
+	*sleep_count = m_sleep_count;
+	assert(memcmp(buf, data, TRANSFER_SIZE) == 0);
+	return elapsed_ns(&start) / (2*TRANSFER_COUNT);
+}
+
+static void test_small_transfers(){
+	int try_permission_count, try_sleep_count;
+	int permission_count, sleep_count;
+	double try_ns;
+	double ns;
+	int i;
+
+	for(i=0; i < 2; i++){
+		fifo_open(&m_devices[i].handle);
+		fifo_ioctl(&m_devices[i].handle, I_FIFO_INIT, 0);
+	}
+
+	try_ns = benchmark(m_devices + 0, &try_permission_count, &try_sleep_count);
+	ns = benchmark(m_devices + 1, &permission_count, &sleep_count);
+	printf("%d byte transfers: try entry %.1f ns, regular entry %.1f ns\n", TRANSFER_SIZE, try_ns, ns);
+
+	//both check permissions -- the try entry skips the block object setup
+	assert(try_permission_count == 2*TRANSFER_COUNT && try_sleep_count == 0);
+	assert(permission_count == 2*TRANSFER_COUNT && sleep_count == 0);
+	assert(sos_sched_block_object[1] == 0);
+}
+
+static void test_would_block(){
+	char buf[TRANSFER_SIZE];
+
+	//nothing to read -- the try entry falls back to the regular read which reports EAGAIN
+	m_permission_count = 0;
+	assert(SYSFS_GET_RETURN_ERRNO(devfs_data_transfer(0, m_devices + 0, O_RDWR | O_NONBLOCK, 0, buf, TRANSFER_SIZE, 1)) == EAGAIN);
+	assert(m_permission_count == 1);
+	printf("would block ok\n");
+}
+
+static void test_try_permission(){
+	char data[TRANSFER_SIZE] = "abcd";
+	char buf[TRANSFER_SIZE];
+
+	//data is ready but the task can't read the device -- same result as when it would block
+	assert(devfs_data_transfer(0, m_devices + 0, O_RDWR, 0, data, TRANSFER_SIZE, 0) == TRANSFER_SIZE);
+	m_is_permitted = 0;
+	assert(SYSFS_GET_RETURN_ERRNO(devfs_data_transfer(0, m_devices + 0, O_RDWR, 0, buf, TRANSFER_SIZE, 1)) == EPERM);
+	assert(SYSFS_GET_RETURN_ERRNO(devfs_data_transfer(0, m_devices + 0, O_RDWR, 0, data, TRANSFER_SIZE, 0)) == EPERM);
+	m_is_permitted = 1;
+	assert(devfs_data_transfer(0, m_devices + 0, O_RDWR, 0, buf, TRANSFER_SIZE, 1) == TRANSFER_SIZE);
+	assert(memcmp(buf, data, TRANSFER_SIZE) == 0);
+	printf("try permission ok\n");
+}
+
+static void test_vector_permission(){
+	char data[TRANSFER_SIZE] = "abcd";
+	char buf[2][TRANSFER_SIZE/2];
+	struct iovec iov[2] = { { buf[0], sizeof(buf[0]) }, { buf[1], sizeof(buf[1]) } };
+
+	assert(devfs_data_transfer(0, m_devices + 0, O_RDWR, 0, data, TRANSFER_SIZE, 0) == TRANSFER_SIZE);
+
+	//readv() on a driver with a vector entry is checked like read()
+	m_is_permitted = 0;
+	assert(SYSFS_GET_RETURN_ERRNO(devfs_data_transfer_vector(0, m_devices + 0, O_RDWR, 0, iov, 2, 1)) == EPERM);
+	assert(SYSFS_GET_RETURN_ERRNO(devfs_data_transfer_vector(0, m_devices + 0, O_RDWR, 0, iov, 2, 0)) == EPERM);
+	m_is_permitted = 1;
+	assert(devfs_data_transfer_vector(0, m_devices + 0, O_RDWR, 0, iov, 2, 1) == TRANSFER_SIZE);
+	assert(memcmp(buf, data, TRANSFER_SIZE) == 0);
+	printf("vector permission ok\n");
+}
+
+int main(){
+	test_small_transfers();
+	test_would_block();
+	test_try_permission();
+	test_vector_permission();
+	return 0;
+}
@@ -0,0 +1,188 @@
+/* Host tests and lookup benchmark for drive_assetfs
+ *
+ * The same set of assets is packed as a version 1 image (linear
+ * directory) and a version 2 image (hashed directory) on a RAM drive.
+ * The benchmark counts the drive reads and the time per stat().
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "sos/fs/drive_assetfs.h"
+
+#define ASSET_COUNT 256
+#define ASSET_SIZE 32
+#define DRIVE_SIZE (64*1024)
+#define LOOKUP_COUNT 20000
+
+static u8 m_drive[DRIVE_SIZE];
+static int m_drive_read_count;
+
+static int ram_open(const void * cfg, void ** handle, const char * path, int flags, int mode){ return 0; }
+static int ram_close(const void * cfg, void ** handle){ return 0; }
+static int ram_ioctl(const void * cfg, void * handle, int request, void * ctl){ return 0; }
+
+static int ram_read(const void * cfg, void * handle, int flags, int loc, void * buf, int nbyte){
+	m_drive_read_count++;
+	if( loc >= DRIVE_SIZE ){ return 0; }
+	if( loc + nbyte > DRIVE_SIZE ){ nbyte = DRIVE_SIZE - loc; }
+	memcpy(buf, m_drive + loc, nbyte);
+	return nbyte;
+}
+
+//sysfs_file.c only compares against devfs_open
+int devfs_open(const void * cfg, void ** handle, const char * path, int flags, int mode){ return 0; }
+int sysfs_access(int file_mode, int file_uid, int file_gid, int amode){ return 0; }
+int sysfs_is_r_ok(int file_mode, int file_uid, int file_gid){ return 1; }
+void cortexm_assign_zero_sum32(void * data, int size){}
+int cortexm_verify_zero_sum32(void * data, int size){ return 1; }
+
+static const sysfs_t m_ram_fs = {
+	.open = ram_open,
+	.close = ram_close,
+	.read = ram_read,
+	.ioctl = ram_ioctl
+};
+
+static drive_assetfs_state_t m_state;
+static const drive_assetfs_config_t m_config = {
+	.drive = { .devfs = &m_ram_fs, .name = "drive", .state = &m_state.drive },
+	.offset = 0
+};
+
+static void get_name(int i, char * name){
+	sprintf(name, "images/icon-%03d.bmp", i);
+}
+
+static void fill_entry(drive_assetfs_dirent_t * entry, int i, u32 start){
+	memset(entry, 0, sizeof(drive_assetfs_dirent_t));
+	get_name(i, entry->name);
+	entry->start = start;
+	entry->size = ASSET_SIZE;
+	entry->mode = 0444 | S_IFREG;
+	memset(m_drive + start, i, ASSET_SIZE);
+}
+
+static void pack_v1(){
+	u32 count = ASSET_COUNT;
+	u32 data = sizeof(u32) + ASSET_COUNT*sizeof(drive_assetfs_dirent_t);
+	drive_assetfs_dirent_t entry;
+	int i;
+
+	memcpy(m_drive, &count, sizeof(count));
+	for(i=0; i < ASSET_COUNT; i++){
+		fill_entry(&entry, i, data + i*ASSET_SIZE);
+		memcpy(m_drive + sizeof(u32) + i*sizeof(entry), &entry, sizeof(entry));
+	}
+}
+
+static u32 m_sort_hash[ASSET_COUNT];
+
+static int compare_index(const void * a, const void * b){
+	u32 ha = m_sort_hash[*(const int*)a];
+	u32 hb = m_sort_hash[*(const int*)b];
+	return ha < hb ? -1 : ha > hb;
+}
+
+static void pack_v2(){
+	drive_assetfs_header_v2_t header;
+	drive_assetfs_dirent_t entry;
+	char name[LINK_NAME_MAX];
+	int order[ASSET_COUNT];
+	u32 data;
+	int i;
+
+	header.signature = DRIVE_ASSETFS_SIGNATURE_V2;
+	header.count = ASSET_COUNT;
+	header.hash_offset = sizeof(header);
+	header.entry_offset = header.hash_offset + ASSET_COUNT*sizeof(u32);
+	data = header.entry_offset + ASSET_COUNT*sizeof(drive_assetfs_dirent_t);
+	memcpy(m_drive, &header, sizeof(header));
+
+	for(i=0; i < ASSET_COUNT; i++){
+		get_name(i, name);
+		m_sort_hash[i] = drive_assetfs_hash(name, NAME_MAX-1);
+		order[i] = i;
+	}
+	qsort(order, ASSET_COUNT, sizeof(int), compare_index);
+
+	for(i=0; i < ASSET_COUNT; i++){
+		memcpy(m_drive + header.hash_offset + i*sizeof(u32), m_sort_hash + order[i], sizeof(u32));
+		fill_entry(&entry, order[i], data + order[i]*ASSET_SIZE);
+		memcpy(m_drive + header.entry_offset + i*sizeof(entry), &entry, sizeof(entry));
+	}
+}
+
+static void check_assets(){
+	char name[LINK_NAME_MAX];
+	u8 buf[ASSET_SIZE];
+	struct stat st;
+	void * handle;
+	int i;
+	int j;
+
+	for(i=0; i < ASSET_COUNT; i++){
+		get_name(i, name);
+		assert(drive_assetfs_stat(&m_config, name, &st) == 0);
+		assert(st.st_size == ASSET_SIZE);
+		assert(drive_assetfs_open(&m_config, &handle, name, O_RDONLY, 0) == 0);
+		assert(drive_assetfs_read(&m_config, handle, O_RDONLY, 0, buf, sizeof(buf)) == ASSET_SIZE);
+		for(j=0; j < ASSET_SIZE; j++){ assert(buf[j] == (u8)i); }
+		assert(drive_assetfs_close(&m_config, &handle) == 0);
+	}
+
+	assert(drive_assetfs_stat(&m_config, "images/missing.bmp", &st) < 0);
+}
+
+static double benchmark(const char * label){
+	char name[LINK_NAME_MAX];
+	struct stat st;
+	clock_t start;
+	double seconds;
+	int i;
+
+	m_drive_read_count = 0;
+	start = clock();
+	for(i=0; i < LOOKUP_COUNT; i++){
+		get_name((i*7) % ASSET_COUNT, name);
+		assert(drive_assetfs_stat(&m_config, name, &st) == 0);
+	}
+	seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("%s: %.2f drive reads per lookup, %.0f lookups per second\n",
+			 label, (double)m_drive_read_count / LOOKUP_COUNT, seconds > 0 ? LOOKUP_COUNT / seconds : 0.0);
+	return (double)m_drive_read_count / LOOKUP_COUNT;
+}
+
+int main(){
+	double v1_reads;
+	double v2_reads;
+
+	memset(m_drive, 0xff, sizeof(m_drive));
+	pack_v1();
+	assert(drive_assetfs_init(&m_config) == 0);
+	assert(m_state.hash_table == 0);
+	check_assets();
+	v1_reads = benchmark("v1");
+	assert(drive_assetfs_exit(&m_config) == 0);
+
+	memset(m_drive, 0xff, sizeof(m_drive));
+	pack_v2();
+	assert(drive_assetfs_init(&m_config) == 0);
+	assert(m_state.hash_table != 0);
+	check_assets();
+	v2_reads = benchmark("v2");
+	assert(drive_assetfs_exit(&m_config) == 0);
+
+	//a hashed lookup reads one directory entry (the names don't collide) plus the chunk header probe
+	assert(v2_reads == 2.0);
+	assert(v1_reads > ASSET_COUNT/4);
+	return 0;
+}
@@ -0,0 +1,265 @@
+/* Host tests for the wait lists in src/sys/scheduler/scheduler_wait.c
+ *
+ * The task table is the real one. Blocking only marks the task inactive
+ * and waking only marks it active, the way the timer and the context
+ * switcher see it. Every task starts enabled and active at priority 1.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include "../../src/sys/scheduler/scheduler_local.h"
+
+#define TASK_TOTAL 12
+
+volatile int m_task_current;
+volatile task_t sos_task_table[TASK_TOTAL];
+volatile sched_task_t sos_sched_table[TASK_TOTAL];
+volatile void * volatile sos_sched_block_object[TASK_TOTAL];
+
+static int m_is_timeout_passed;
+static struct mcu_timeval m_forever = { .tv_sec = SCHEDULER_TIMEVAL_SEC_INVALID };
+
+u8 task_get_total(){ return TASK_TOTAL; }
+void task_root_update_ready(int id){}
+
+void scheduler_root_assert_active(int id, int unblock_type){
+	task_assert_active(id);
+	sos_sched_block_object[id] = NULL;
+}
+
+void scheduler_timing_root_timedblock(void * block_object, struct mcu_timeval * abs_time){
+	sos_sched_block_object[task_get_current()] = block_object;
+	if( m_is_timeout_passed == 0 ){
+		task_deassert_active(task_get_current());
+	}
+}
+
+static void reset(){
+	int i;
+	scheduler_wait_init();
+	memset((void*)sos_task_table, 0, sizeof(sos_task_table));
+	memset((void*)sos_sched_table, 0, sizeof(sos_sched_table));
+	for(i=0; i < TASK_TOTAL; i++){
+		sos_task_table[i].flags = TASK_FLAGS_USED | TASK_FLAGS_ACTIVE;
+		sos_task_table[i].priority = 1;
+		sos_sched_table[i].attr.schedparam.sched_priority = 1;
+		sos_sched_block_object[i] = NULL;
+	}
+	m_is_timeout_passed = 0;
+}
+
+static void set_priority(int id, int priority){
+	task_set_priority(id, priority);
+	sos_sched_table[id].attr.schedparam.sched_priority = priority;
+}
+
+static void block(int id, int priority, void * block_object, int is_mutex){
+	m_task_current = id;
+	set_priority(id, priority);
+	scheduler_wait_root_timedblock(block_object, &m_forever, is_mutex);
+	assert(task_active_asserted(id) == 0);
+}
+
+static int wake(void * block_object){
+	int id = scheduler_root_get_highest_priority_blocked(block_object);
+	if( id > 0 ){
+		scheduler_root_assert_active(id, SCHEDULER_UNBLOCK_MUTEX);
+	}
+	return id;
+}
+
+static int get_list(const void * block_object){
+	u32 value = (u32)(uintptr_t)block_object;
+	return ((value >> 2) ^ (value >> 8)) % SCHEDULER_WAIT_LIST_COUNT;
+}
+
+//two objects in the array that hash to the same list
+static void find_shared_list(pthread_mutex_t * array, int count, pthread_mutex_t ** a, pthread_mutex_t ** b){
+	int i, j;
+	for(i=0; i < count; i++){
+		for(j=i+1; j < count; j++){
+			if( get_list(array + i) == get_list(array + j) ){
+				*a = array + i;
+				*b = array + j;
+				return;
+			}
+		}
+	}
+	assert(0);
+}
+
+static void test_fairness(){
+	int sem;
+
+	//equal priority waiters wake in the order they blocked
+	reset();
+	block(3, 5, &sem, 0);
+	block(1, 5, &sem, 0);
+	block(4, 5, &sem, 0);
+	block(2, 5, &sem, 0);
+	assert(wake(&sem) == 3);
+	assert(wake(&sem) == 1);
+	//blocking again goes behind the others
+	block(3, 5, &sem, 0);
+	assert(wake(&sem) == 4);
+	assert(wake(&sem) == 2);
+	assert(wake(&sem) == 3);
+	assert(wake(&sem) == -1);
+	assert(scheduler_wait_is_empty(&sem));
+
+	//higher priority first with the order kept inside each priority
+	reset();
+	block(1, 2, &sem, 0);
+	block(2, 7, &sem, 0);
+	block(3, 2, &sem, 0);
+	block(4, 7, &sem, 0);
+	block(5, 4, &sem, 0);
+	assert(wake(&sem) == 2);
+	assert(wake(&sem) == 4);
+	assert(wake(&sem) == 5);
+	assert(wake(&sem) == 1);
+	assert(wake(&sem) == 3);
+	assert(wake(&sem) == -1);
+	printf("fairness ok\n");
+}
+
+static void test_stale(){
+	pthread_mutex_t mutex[64];
+	pthread_mutex_t * a;
+	pthread_mutex_t * b;
+	int sem;
+
+	//a timeout wakes a task without removing it -- it is skipped and pruned
+	reset();
+	block(1, 9, &sem, 0);
+	block(2, 3, &sem, 0);
+	scheduler_root_assert_active(1, SCHEDULER_UNBLOCK_SLEEP);
+	assert(wake(&sem) == 2);
+	assert(scheduler_wait_is_empty(&sem));
+
+	//a stopped task is skipped but stays in the list
+	block(1, 9, &sem, 0);
+	block(2, 3, &sem, 0);
+	task_assert_stopped(1);
+	assert(wake(&sem) == 2);
+	task_deassert_stopped(1);
+	assert(wake(&sem) == 1);
+
+	//the timeout has already passed -- the task isn't added
+	m_is_timeout_passed = 1;
+	m_task_current = 5;
+	scheduler_wait_root_timedblock(&sem, &m_forever, 0);
+	assert(sos_sched_table[5].wait_list == 0 && scheduler_wait_is_empty(&sem));
+
+	//a task that exits while waiting is dropped
+	reset();
+	block(1, 4, &sem, 0);
+	block(2, 4, &sem, 0);
+	task_deassert_used(1);
+	assert(wake(&sem) == 2);
+
+	//the task timed out on mutex a and then blocked on b outside the wait lists (b shares the list)
+	reset();
+	find_shared_list(mutex, 64, &a, &b);
+	a->pthread = 1;
+	b->pthread = 1;
+	set_priority(1, 1);
+	block(3, 7, a, 1);
+	scheduler_wait_root_inherit_priority(a, 7);
+	assert(task_get_priority(1) == 7);
+	scheduler_root_assert_active(3, SCHEDULER_UNBLOCK_SLEEP);
+	sos_sched_block_object[3] = b;
+	task_deassert_active(3);
+	//the entry for a is stale -- b isn't treated as a mutex task 3 waits on
+	assert(scheduler_wait_root_get_inherited_priority(1) == 1);
+	assert(wake(b) == -1);
+	assert(task_active_asserted(3) == 0);
+	printf("stale ok\n");
+}
+
+static void test_shared_list(){
+	pthread_mutex_t mutex[64];
+	pthread_mutex_t * a;
+	pthread_mutex_t * b;
+
+	//objects that share a list are kept apart
+	reset();
+	find_shared_list(mutex, 64, &a, &b);
+	block(1, 5, a, 0);
+	block(2, 8, b, 0);
+	block(3, 5, b, 0);
+	block(4, 2, a, 0);
+	assert(wake(a) == 1);
+	assert(wake(a) == 4);
+	assert(wake(a) == -1);
+	assert(scheduler_root_unblock_all(b, SCHEDULER_UNBLOCK_MUTEX) == 8);
+	assert(task_active_asserted(2) && task_active_asserted(3));
+	assert(wake(b) == -1);
+
+	//a broadcast only wakes the waiters of the object
+	reset();
+	block(1, 3, a, 0);
+	block(2, 6, a, 0);
+	block(3, 9, b, 0);
+	assert(scheduler_root_unblock_all(a, SCHEDULER_UNBLOCK_MUTEX) == 6);
+	assert(task_active_asserted(1) && task_active_asserted(2) && !task_active_asserted(3));
+	assert(wake(b) == 3);
+	printf("shared list ok\n");
+}
+
+static void test_inversion(){
+	pthread_mutex_t m1;
+	pthread_mutex_t m2;
+
+	//low (1) owns m1, mid (2) owns m2 and waits on m1, high (3) waits on m2
+	reset();
+	memset(&m1, 0, sizeof(m1));
+	memset(&m2, 0, sizeof(m2));
+	m1.pthread = 1;
+	m2.pthread = 2;
+	block(5, 3, &m1, 1);
+	scheduler_wait_root_inherit_priority(&m1, 3);
+	assert(task_get_priority(1) == 3);
+
+	set_priority(2, 5);
+	scheduler_wait_root_inherit_priority(&m1, 5);
+	block(2, 5, &m1, 1);
+	assert(task_get_priority(1) == 5);
+
+	//the priority follows the chain of owners
+	scheduler_wait_root_inherit_priority(&m2, 9);
+	block(3, 9, &m2, 1);
+	assert(task_get_priority(2) == 9 && task_get_priority(1) == 9);
+
+	//low unlocks m1 -- mid moved ahead of task 5 and low goes back to its own priority
+	assert(wake(&m1) == 2);
+	m1.pthread = 2;
+	assert(scheduler_wait_root_get_inherited_priority(1) == 1);
+	//mid still owns m2 (high is waiting) and m1 (task 5 is waiting)
+	assert(scheduler_wait_root_get_inherited_priority(2) == 9);
+	//mid unlocks m2 -- its own priority is higher than task 5
+	assert(wake(&m2) == 3);
+	m2.pthread = 3;
+	assert(scheduler_wait_root_get_inherited_priority(2) == 5);
+
+	//a deadlock cycle doesn't loop forever
+	reset();
+	m1.pthread = 1;
+	m2.pthread = 2;
+	block(1, 2, &m2, 1);
+	block(2, 2, &m1, 1);
+	scheduler_wait_root_inherit_priority(&m1, 8);
+	assert(task_get_priority(1) == 8 && task_get_priority(2) == 8);
+	printf("inversion ok\n");
+}
+
+int main(){
+	test_fairness();
+	test_stale();
+	test_shared_list();
+	test_inversion();
+	return 0;
+}
@@ -0,0 +1,242 @@
+/* Host tests for src/sys/sysfs/sysfs_aio.c
+ *
+ * The workers are host threads. An svcall runs under a mutex so it is
+ * atomic like it is on the device. The execute function is a slow
+ * memory file that can be held on a gate to keep a worker busy.
+ * Tasks 1, 2 and 3 belong to different processes.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "sos/fs/sysfs.h"
+#include "cortexm/cortexm.h"
+#include "cortexm/task.h"
+
+//SYSFS_AIO_WORKER_COUNT and SYSFS_AIO_REQUEST_COUNT are set in CMakeLists.txt
+#define FILE_SIZE 4096
+#define EXECUTE_US 2000
+
+volatile int m_task_current;
+volatile task_t sos_task_table[4] = { { .pid = 0 }, { .pid = 1 }, { .pid = 2 }, { .pid = 3 } };
+
+static pthread_mutex_t m_svcall_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void cortexm_svcall(cortexm_svcall_t call, void * args){
+	pthread_mutex_lock(&m_svcall_mutex);
+	call(args);
+	pthread_mutex_unlock(&m_svcall_mutex);
+}
+
+int sysfs_aio_data_transfer_callback(void * context, const mcu_event_t * event){
+	struct aiocb * aiocbp = context;
+	//same bookkeeping as src/sys/aio/aio.c
+	aiocbp->aio_nbytes = aiocbp->async.nbyte;
+	if( aiocbp->async.nbyte < 0 ){
+		aiocbp->async.nbyte = SYSFS_GET_RETURN_ERRNO(aiocbp->async.nbyte);
+	} else {
+		aiocbp->async.nbyte = 0;
+	}
+	__atomic_store_n(&aiocbp->async.buf, NULL, __ATOMIC_SEQ_CST);
+	return 0;
+}
+
+static char m_file[FILE_SIZE];
+static volatile int m_is_gate;
+static sem_t m_gate;
+static volatile int m_running;
+static volatile int m_running_max;
+static int m_order[16];
+static volatile int m_order_count;
+
+static int execute(const void * config, void * handle, struct aiocb * aiocbp){
+	int running = __atomic_add_fetch(&m_running, 1, __ATOMIC_SEQ_CST);
+	if( running > m_running_max ){ m_running_max = running; }
+	if( m_is_gate ){
+		sem_wait(&m_gate);
+	} else {
+		usleep(EXECUTE_US);
+	}
+	m_order[__atomic_fetch_add(&m_order_count, 1, __ATOMIC_SEQ_CST)] = aiocbp->aio_offset;
+	__atomic_sub_fetch(&m_running, 1, __ATOMIC_SEQ_CST);
+
+	if( aiocbp->async.loc + aiocbp->async.nbyte > FILE_SIZE ){
+		errno = ENOSPC;
+		return -1;
+	}
+	if( aiocbp->aio_lio_opcode == LIO_WRITE ){
+		memcpy(m_file + aiocbp->async.loc, aiocbp->async.buf_const, aiocbp->async.nbyte);
+	} else {
+		memcpy(aiocbp->async.buf, m_file + aiocbp->async.loc, aiocbp->async.nbyte);
+	}
+	return aiocbp->async.nbyte;
+}
+
+static void init_aiocb(struct aiocb * aiocbp, int offset, void * buf, int nbyte, int opcode){
+	memset(aiocbp, 0, sizeof(struct aiocb));
+	aiocbp->aio_offset = offset;
+	aiocbp->aio_buf = buf;
+	aiocbp->aio_nbytes = nbyte;
+	aiocbp->aio_lio_opcode = opcode;
+}
+
+static int submit(int tid, struct aiocb * aiocbp){
+	m_task_current = tid;
+	return sysfs_aio_submit(0, 0, aiocbp, execute);
+}
+
+static int wait_aiocb(struct aiocb * aiocbp){
+	int spins = 0;
+	while( __atomic_load_n(&aiocbp->async.buf, __ATOMIC_SEQ_CST) != NULL ){
+		usleep(100);
+		spins++;
+	}
+	return spins;
+}
+
+static void reset(int is_gate){
+	m_is_gate = is_gate;
+	m_running_max = 0;
+	m_order_count = 0;
+	//give the workers from the last test time to exit
+	usleep(10000);
+}
+
+static void test_write_read(){
+	struct aiocb aiocb;
+	char buf[100];
+	char read_buf[100];
+	int spins;
+
+	reset(0);
+	memset(buf, 'q', sizeof(buf));
+	init_aiocb(&aiocb, 10, buf, sizeof(buf), LIO_WRITE);
+	assert(submit(1, &aiocb) == 0);
+	//the caller keeps running during the transfer
+	spins = wait_aiocb(&aiocb);
+	assert(spins > 0);
+	assert(aiocb.aio_nbytes == sizeof(buf) && aiocb.async.nbyte == 0);
+
+	memset(read_buf, 0, sizeof(read_buf));
+	init_aiocb(&aiocb, 10, read_buf, sizeof(read_buf), LIO_READ);
+	assert(submit(1, &aiocb) == 0);
+	wait_aiocb(&aiocb);
+	assert(aiocb.aio_nbytes == sizeof(read_buf));
+	assert(memcmp(buf, read_buf, sizeof(buf)) == 0);
+
+	//errors are reported through the aiocb
+	init_aiocb(&aiocb, FILE_SIZE - 10, buf, sizeof(buf), LIO_WRITE);
+	assert(submit(1, &aiocb) == 0);
+	wait_aiocb(&aiocb);
+	assert((int)aiocb.aio_nbytes < 0 && aiocb.async.nbyte == ENOSPC);
+	printf("write read ok (%d spins)\n", spins);
+}
+
+static void test_one_worker_per_process(){
+	struct aiocb aiocb[SYSFS_AIO_REQUEST_COUNT+2];
+	char buf[SYSFS_AIO_REQUEST_COUNT+2][16];
+	int i;
+
+	reset(1);
+	//the requests of one process run one at a time in order
+	init_aiocb(aiocb + 0, 0, buf[0], 16, LIO_WRITE);
+	assert(submit(1, aiocb + 0) == 0);
+	while( m_running == 0 ){ usleep(100); }
+	for(i=1; i <= SYSFS_AIO_REQUEST_COUNT; i++){
+		init_aiocb(aiocb + i, i*16, buf[i], 16, LIO_WRITE);
+		assert(submit(1, aiocb + i) == 0);
+	}
+
+	//the number of waiting requests is bounded
+	init_aiocb(aiocb + i, i*16, buf[i], 16, LIO_WRITE);
+	assert(SYSFS_GET_RETURN_ERRNO(submit(1, aiocb + i)) == EAGAIN);
+	assert(aiocb[i].async.buf == NULL);
+
+	for(i=0; i <= SYSFS_AIO_REQUEST_COUNT; i++){ sem_post(&m_gate); }
+	for(i=0; i <= SYSFS_AIO_REQUEST_COUNT; i++){
+		wait_aiocb(aiocb + i);
+		assert(aiocb[i].aio_nbytes == 16);
+		assert(m_order[i] == i*16);
+	}
+	assert(m_running_max == 1);
+	printf("one worker per process ok\n");
+}
+
+static void test_worker_limit(){
+	struct aiocb aiocb[4];
+	char buf[4][16];
+	int i;
+
+	reset(1);
+	//a worker for each of two processes -- the third process has to wait
+	for(i=0; i < SYSFS_AIO_WORKER_COUNT; i++){
+		init_aiocb(aiocb + i, i*16, buf[i], 16, LIO_READ);
+		assert(submit(i+1, aiocb + i) == 0);
+	}
+	init_aiocb(aiocb + i, i*16, buf[i], 16, LIO_READ);
+	assert(SYSFS_GET_RETURN_ERRNO(submit(i+1, aiocb + i)) == EAGAIN);
+
+	//both workers run at the same time
+	while( m_running < SYSFS_AIO_WORKER_COUNT ){ usleep(100); }
+	for(i=0; i < SYSFS_AIO_WORKER_COUNT; i++){ sem_post(&m_gate); }
+	for(i=0; i < SYSFS_AIO_WORKER_COUNT; i++){ wait_aiocb(aiocb + i); }
+
+	//the workers exit when they run out of requests
+	reset(0);
+	init_aiocb(aiocb + i, i*16, buf[i], 16, LIO_READ);
+	assert(submit(i+1, aiocb + i) == 0);
+	wait_aiocb(aiocb + i);
+	assert(aiocb[i].aio_nbytes == 16);
+	printf("worker limit ok\n");
+}
+
+static void svcall_cancel_pid(void * args){
+	sysfs_aio_root_cancel_pid(*(int*)args);
+}
+
+static void test_cancel_pid(){
+	struct aiocb aiocb[3];
+	char buf[3][16];
+	int pid = 1;
+	int i;
+
+	reset(1);
+	for(i=0; i < 3; i++){
+		init_aiocb(aiocb + i, i*16, buf[i], 16, LIO_READ);
+		assert(submit(1, aiocb + i) == 0);
+	}
+
+	//the process exits while its worker is busy -- the waiting requests are dropped
+	while( m_running == 0 ){ usleep(100); }
+	cortexm_svcall(svcall_cancel_pid, &pid);
+	sem_post(&m_gate);
+	wait_aiocb(aiocb + 0);
+	usleep(10000);
+	assert(m_order_count == 1);
+	assert(aiocb[1].async.buf != NULL && aiocb[2].async.buf != NULL);
+
+	//the worker and the requests can be used again
+	reset(0);
+	for(i=0; i < 3; i++){
+		init_aiocb(aiocb + i, i*16, buf[i], 16, LIO_READ);
+		assert(submit(2, aiocb + i) == 0);
+	}
+	for(i=0; i < 3; i++){ wait_aiocb(aiocb + i); }
+	assert(m_order_count == 3);
+	printf("cancel pid ok\n");
+}
+
+int main(){
+	sem_init(&m_gate, 0, 0);
+	test_write_read();
+	test_one_worker_per_process();
+	test_worker_limit();
+	test_cancel_pid();
+	return 0;
+}
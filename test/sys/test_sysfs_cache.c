@@ -0,0 +1,195 @@
+/* Host tests and benchmark for the sysfs_shared_* block cache
+ *
+ * The drive is a RAM buffer behind a fake filesystem that counts the
+ * calls that reach it. The benchmark compares the drive traffic of small
+ * sequential reads and small writes with and without the cache.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "sos/dev/drive.h"
+#include "sos/fs/sysfs.h"
+
+#define DRIVE_SIZE (32*1024)
+#define LINE_SIZE 256
+
+static u8 m_drive[DRIVE_SIZE];
+static int m_drive_read_count;
+static int m_drive_write_count;
+static int m_drive_fail_write;
+static int m_aio_count;
+
+static int ram_open(const void * cfg, void ** handle, const char * path, int flags, int mode){ return 0; }
+static int ram_close(const void * cfg, void ** handle){ return 0; }
+
+static int ram_read(const void * cfg, void * handle, int flags, int loc, void * buf, int nbyte){
+	m_drive_read_count++;
+	if( loc >= DRIVE_SIZE ){ return 0; }
+	if( loc + nbyte > DRIVE_SIZE ){ nbyte = DRIVE_SIZE - loc; }
+	memcpy(buf, m_drive + loc, nbyte);
+	return nbyte;
+}
+
+static int ram_write(const void * cfg, void * handle, int flags, int loc, const void * buf, int nbyte){
+	m_drive_write_count++;
+	if( m_drive_fail_write ){ return SYSFS_SET_RETURN(EIO); }
+	if( loc + nbyte > DRIVE_SIZE ){ return SYSFS_SET_RETURN(EINVAL); }
+	memcpy(m_drive + loc, buf, nbyte);
+	return nbyte;
+}
+
+static int ram_ioctl(const void * cfg, void * handle, int request, void * ctl){
+	//the request codes are size_t on the host
+	if( request == (int)I_DRIVE_GETINFO ){
+		drive_info_t * info = ctl;
+		memset(info, 0, sizeof(drive_info_t));
+		info->addressable_size = 1;
+		info->num_write_blocks = DRIVE_SIZE;
+		return 0;
+	}
+	return 0;
+}
+
+static int ram_aio(const void * cfg, void * handle, struct aiocb * aio){
+	m_aio_count++;
+	return 0;
+}
+
+//sysfs_file.c only compares against devfs_open
+int devfs_open(const void * cfg, void ** handle, const char * path, int flags, int mode){ return 0; }
+int sysfs_access(int file_mode, int file_uid, int file_gid, int amode){ return 0; }
+
+static const sysfs_t m_ram_fs = {
+	.open = ram_open,
+	.close = ram_close,
+	.read = ram_read,
+	.write = ram_write,
+	.ioctl = ram_ioctl,
+	.aio = ram_aio
+};
+
+SYSFS_CACHE_DECLARE(m_cache, 8, LINE_SIZE);
+
+static sysfs_shared_state_t m_state;
+static const sysfs_shared_config_t m_uncached_config = {
+	.devfs = &m_ram_fs, .name = "drive", .state = &m_state, .cache = 0
+};
+static const sysfs_shared_config_t m_cached_config = {
+	.devfs = &m_ram_fs, .name = "drive", .state = &m_state, .cache = &m_cache
+};
+
+static void reset_drive(){
+	int i;
+	for(i=0; i < DRIVE_SIZE; i++){ m_drive[i] = i*13 + (i>>8); }
+	m_drive_read_count = 0;
+	m_drive_write_count = 0;
+	m_drive_fail_write = 0;
+	m_aio_count = 0;
+	memset(&m_state, 0, sizeof(m_state));
+	m_cache.hit_count = 0;
+	m_cache.miss_count = 0;
+	m_cache.bypass_count = 0;
+	m_cache.read_ahead_count = 0;
+	m_cache.write_back_count = 0;
+}
+
+//reads the drive 64 bytes at a time then updates a few bytes in every 512 (a filesystem's allocation table)
+static void run_workload(const sysfs_shared_config_t * config, int * reads, int * writes){
+	u8 buf[64];
+	u8 value[16];
+	int loc;
+	int i;
+
+	reset_drive();
+	assert(sysfs_shared_open(config) >= 0);
+
+	for(loc = 0; loc < DRIVE_SIZE; loc += sizeof(buf)){
+		assert(sysfs_shared_read(config, loc, buf, sizeof(buf)) == sizeof(buf));
+		for(i=0; i < (int)sizeof(buf); i++){
+			assert(buf[i] == (u8)((loc+i)*13 + ((loc+i)>>8)));
+		}
+	}
+
+	memset(value, 0xA5, sizeof(value));
+	for(i=0; i < 4; i++){
+		for(loc = 0; loc < 2048; loc += 512){
+			assert(sysfs_shared_write(config, loc + i*sizeof(value), value, sizeof(value)) == sizeof(value));
+		}
+	}
+
+	assert(sysfs_shared_close(config) >= 0);
+	for(loc = 0; loc < 2048; loc += 512){
+		for(i=0; i < 4*(int)sizeof(value); i++){
+			assert(m_drive[loc + i] == 0xA5);
+		}
+	}
+
+	*reads = m_drive_read_count;
+	*writes = m_drive_write_count;
+}
+
+static void test_benchmark(){
+	int uncached_reads, uncached_writes;
+	int cached_reads, cached_writes;
+
+	run_workload(&m_uncached_config, &uncached_reads, &uncached_writes);
+	run_workload(&m_cached_config, &cached_reads, &cached_writes);
+
+	printf("uncached: %d drive reads, %d drive writes\n", uncached_reads, uncached_writes);
+	printf("cached: %d drive reads, %d drive writes (%u hits, %u misses, %u read ahead, %u write backs)\n",
+			 cached_reads, cached_writes,
+			 m_cache.hit_count, m_cache.miss_count, m_cache.read_ahead_count, m_cache.write_back_count);
+
+	//64 byte reads of 256 byte lines -- three of four reads hit
+	assert(cached_reads*3 < uncached_reads);
+	assert(cached_writes*4 == uncached_writes);
+	assert(m_cache.hit_count >= 3*m_cache.miss_count);
+	assert(m_cache.read_ahead_count > 0);
+}
+
+static void test_bypass(){
+	u8 buf[LINE_SIZE*4];
+
+	reset_drive();
+	assert(sysfs_shared_open(&m_cached_config) >= 0);
+	assert(sysfs_shared_read(&m_cached_config, LINE_SIZE*8, buf, sizeof(buf)) == sizeof(buf));
+	assert(memcmp(buf, m_drive + LINE_SIZE*8, sizeof(buf)) == 0);
+	assert(m_cache.bypass_count == 4);
+	assert(m_cache.miss_count == 4);
+	assert(sysfs_shared_close(&m_cached_config) >= 0);
+	printf("bypass ok\n");
+}
+
+static void test_aio_flush_error(){
+	u8 value[16];
+	struct aiocb aio;
+
+	reset_drive();
+	memset(value, 0x11, sizeof(value));
+	assert(sysfs_shared_open(&m_cached_config) >= 0);
+	assert(sysfs_shared_write(&m_cached_config, 100, value, sizeof(value)) == sizeof(value));
+
+	//the dirty line can't be written so the aio is not started and the data is kept
+	m_drive_fail_write = 1;
+	assert(sysfs_shared_aio(&m_cached_config, &aio) < 0);
+	assert(m_aio_count == 0);
+
+	m_drive_fail_write = 0;
+	assert(sysfs_shared_aio(&m_cached_config, &aio) == 0);
+	assert(m_aio_count == 1);
+	assert(memcmp(m_drive + 100, value, sizeof(value)) == 0);
+	assert(sysfs_shared_close(&m_cached_config) >= 0);
+	printf("aio flush error ok\n");
+}
+
+int main(){
+	test_benchmark();
+	test_bypass();
+	test_aio_flush_error();
+	return 0;
+}
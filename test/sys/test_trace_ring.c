@@ -0,0 +1,189 @@
+/* Host tests for the trace ring in src/sys/trace/sos_trace_ring.c and
+ * the JSON decoder in src/link/link_trace.c
+ *
+ * The ring is 8 records (SOS_TRACE_RING_SIZE is set in CMakeLists.txt).
+ * Reading the cycle counter runs an optional hook. The hook stands in
+ * for an interrupt that preempts the writer after it reserved a slot and
+ * before the record is complete.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "sos/sos.h"
+#include "sos/link.h"
+#include "cortexm/cortexm.h"
+
+#define RING_SIZE 8
+
+volatile int m_task_current;
+
+static test_dwt_t m_dwt;
+static void (*m_write_hook)();
+
+test_dwt_t * test_get_dwt(){
+	void (*hook)() = m_write_hook;
+	m_write_hook = 0;
+	if( hook ){ hook(); }
+	m_dwt.CYCCNT += 10;
+	return &m_dwt;
+}
+
+void cortexm_svcall(cortexm_svcall_t call, void * args){ call(args); }
+
+static link_trace_record_t m_records[SYS_TRACE_READ_MAX];
+static int m_count;
+static u32 m_dropped;
+
+static void reset(){
+	sos_trace_root_set_enabled(1);
+	sos_trace_root_flush();
+	m_task_current = 1;
+	m_dwt.CYCCNT = 0;
+	m_write_hook = 0;
+}
+
+static void read_records(){
+	m_count = sos_trace_root_read_records(m_records, SYS_TRACE_READ_MAX, &m_dropped);
+}
+
+static void test_lap(){
+	int i;
+
+	reset();
+	for(i=0; i < RING_SIZE + 5; i++){
+		sos_trace_record(LINK_TRACE_RECORD_BEGIN, i);
+	}
+
+	//the oldest records were overwritten
+	read_records();
+	assert(m_dropped == 5 && m_count == RING_SIZE);
+	for(i=0; i < RING_SIZE; i++){
+		assert(m_records[i].value == (u32)(i + 5) && m_records[i].tid == 1);
+		assert(m_records[i].o_flags == 0);
+	}
+	read_records();
+	assert(m_count == 0 && m_dropped == 0);
+
+	//a lap later the same slots are reused with a new tag
+	for(i=0; i < RING_SIZE + 2; i++){
+		sos_trace_record(LINK_TRACE_RECORD_END, 100 + i);
+	}
+	read_records();
+	assert(m_dropped == 2 && m_count == RING_SIZE && m_records[0].value == 102);
+
+	//nothing is written while the ring is disabled
+	sos_trace_root_set_enabled(0);
+	sos_trace_record(LINK_TRACE_RECORD_END, 1);
+	read_records();
+	assert(m_count == 0 && m_dropped == 0);
+	printf("lap ok\n");
+}
+
+static void read_hook(){
+	read_records();
+}
+
+static void nested_write_hook(){
+	m_task_current = 3;
+	sos_trace_root_record(LINK_TRACE_RECORD_READY, 30);
+	m_task_current = 1;
+	read_records();
+}
+
+static void test_partial_write(){
+	reset();
+
+	//the reader runs while record 2 is half written -- it stops in front of it
+	sos_trace_record(LINK_TRACE_RECORD_BEGIN, 1);
+	m_write_hook = read_hook;
+	sos_trace_record(LINK_TRACE_RECORD_BEGIN, 2);
+	assert(m_count == 1 && m_records[0].value == 1);
+	read_records();
+	assert(m_count == 1 && m_records[0].value == 2 && m_dropped == 0);
+
+	//an interrupt writes record 4 while record 3 is half written -- neither is read yet
+	m_write_hook = nested_write_hook;
+	sos_trace_record(LINK_TRACE_RECORD_BEGIN, 3);
+	assert(m_count == 0);
+	read_records();
+	assert(m_count == 2 && m_dropped == 0);
+	assert(m_records[0].value == 3 && m_records[0].tid == 1);
+	assert(m_records[1].value == 30 && m_records[1].tid == 3);
+	//the interrupt read its timestamp after the interrupted record reserved its slot
+	assert(m_records[1].timestamp < m_records[0].timestamp);
+	printf("partial write ok\n");
+}
+
+static void test_tid(){
+	reset();
+
+	//the scheduler traces a fault on behalf of the task that caused it
+	m_task_current = 0;
+	sos_trace_record_tid(LINK_POSIX_TRACE_FATAL, 4, 0x1235);
+	read_records();
+	assert(m_count == 1 && m_records[0].tid == 4 && m_records[0].value == 0x1235);
+	assert(m_records[0].event_id == LINK_POSIX_TRACE_FATAL);
+	printf("tid ok\n");
+}
+
+static void add_record(sys_trace_read_t * trace, u32 timestamp, u16 event_id, u8 tid, u32 value){
+	link_trace_record_t * record = trace->record + trace->count++;
+	record->timestamp = timestamp;
+	record->event_id = event_id;
+	record->tid = tid;
+	record->value = value;
+}
+
+static void test_decoder(){
+	link_trace_decoder_t decoder;
+	sys_trace_read_t trace;
+	char expected[1024];
+	char * json;
+	size_t size;
+	FILE * out;
+
+	//1 cycle per microsecond -- the cycle counter wraps between the second and third records
+	memset(&trace, 0, sizeof(trace));
+	trace.frequency = 1000000;
+	trace.dropped = 2;
+	add_record(&trace, 0xFFFFFFF0, LINK_TRACE_RECORD_SWITCH, 1, 0);
+	add_record(&trace, 0xFFFFFFF8, LINK_TRACE_RECORD_READY, 1, 2);
+	add_record(&trace, 0x00000008, LINK_TRACE_RECORD_SWITCH, 2, 1);
+	add_record(&trace, 0x00000010, LINK_POSIX_TRACE_FATAL, 4, 0x1235);
+
+	out = open_memstream(&json, &size);
+	link_trace_json_start(&decoder, out);
+	assert(link_trace_json_write(&decoder, &trace, out) == 4);
+	link_trace_json_finish(&decoder, out);
+	fclose(out);
+
+	snprintf(expected, sizeof(expected),
+				"{\"traceEvents\":[\n"
+				"{\"name\":\"dropped\",\"ph\":\"i\",\"ts\":0.000,\"pid\":0,\"tid\":0,\"s\":\"g\",\"args\":{\"count\":2}},\n"
+				"{\"name\":\"run\",\"ph\":\"B\",\"ts\":4294967280.000,\"pid\":0,\"tid\":1},\n"
+				"{\"name\":\"ready\",\"ph\":\"i\",\"ts\":4294967288.000,\"pid\":0,\"tid\":2,\"s\":\"t\"},\n"
+				"{\"name\":\"run\",\"ph\":\"E\",\"ts\":4294967304.000,\"pid\":0,\"tid\":1},\n"
+				"{\"name\":\"run\",\"ph\":\"B\",\"ts\":4294967304.000,\"pid\":0,\"tid\":2},\n"
+				"{\"name\":\"fatal\",\"ph\":\"i\",\"ts\":4294967312.000,\"pid\":0,\"tid\":4,\"s\":\"t\",\"args\":{\"id\":%d,\"value\":%d}},\n"
+				"{\"name\":\"run\",\"ph\":\"E\",\"ts\":4294967312.000,\"pid\":0,\"tid\":2}\n"
+				"]}\n",
+				LINK_POSIX_TRACE_FATAL, 0x1235);
+	if( strcmp(json, expected) ){
+		printf("%s", json);
+	}
+	assert(strcmp(json, expected) == 0);
+	free(json);
+	printf("decoder ok\n");
+}
+
+int main(){
+	test_lap();
+	test_partial_write();
+	test_tid();
+	test_decoder();
+	return 0;
+}